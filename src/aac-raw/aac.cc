@@ -1,11 +1,14 @@
+#include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include <neaacdec.h>
 
 #include <audacious/audtag.h>
+#include <libaudcore/audstrings.h>
 #include <libaudcore/input.h>
 #include <libaudcore/plugin.h>
 #include <libaudcore/i18n.h>
@@ -48,7 +51,7 @@ int aac_parse_frame (unsigned char * buf, int *srate, int *num)
     fl =
      ((buf[i + 3] & 0x03) << 11) | (buf[i + 4] << 3) | ((buf[i +
      5] >> 5) & 0x07);
-    *num = (buf[i + 6] & 0x02) + 1;
+    *num = (buf[i + 6] & 0x03) + 1;
 
     return fl;
 }
@@ -125,6 +128,206 @@ static int aac_probe (unsigned char * buf, int len)
     return len;
 }
 
+/* Returns the offset of the first frame header after any ID3v2 tag, or -1. */
+static int64_t find_stream_start (VFSFile * file)
+{
+    unsigned char buf[BUFFER_SIZE];
+    int64_t start = 0;
+    int buflen;
+
+    if (vfs_fseek (file, 0, SEEK_SET))
+        return -1;
+
+    buflen = vfs_fread (buf, 1, sizeof buf, file);
+
+    if (buflen >= 10 && ! strncmp ((char *) buf, "ID3", 3))
+    {
+        start = 10 + (buf[6] << 21) + (buf[7] << 14) + (buf[8] << 7) + buf[9];
+
+        if (vfs_fseek (file, start, SEEK_SET))
+            return -1;
+
+        buflen = vfs_fread (buf, 1, sizeof buf, file);
+    }
+
+    int used = aac_probe (buf, buflen);
+    return (used < buflen) ? start + used : -1;
+}
+
+/*
+ * Index of the ADTS frames of a file, built by a scan of the frame headers
+ * alone.  It gives the exact length of VBR streams and lets seeks land on
+ * the right frame, where an estimate from the average bitrate can be off by
+ * seconds in a long file.  Indexes of recently used local files are kept,
+ * keyed by name, size and modification time, so that playback reuses the one
+ * built when reading the tuple.
+ */
+
+#define INDEX_STEP 32           /* ADTS frames between index points */
+#define INDEX_CACHE_SIZE 16
+
+typedef struct {
+    int64_t offset;             /* of the ADTS frame */
+    int64_t block;              /* raw data blocks (1024 samples) before it */
+} IndexPoint;
+
+typedef struct {
+    char * filename;
+    int64_t size, mtime;
+    int refs;
+    int samplerate;
+    int64_t blocks;
+    int n_points;
+    IndexPoint * points;
+} ADTSIndex;
+
+static pthread_mutex_t index_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ADTSIndex * index_cache[INDEX_CACHE_SIZE];
+static int index_cache_next;
+
+static void index_unref (ADTSIndex * index)
+{
+    pthread_mutex_lock (& index_mutex);
+    bool_t last = ! -- index->refs;
+    pthread_mutex_unlock (& index_mutex);
+
+    if (last)
+    {
+        free (index->filename);
+        free (index->points);
+        free (index);
+    }
+}
+
+/* Walks the frame headers from <start>, seeking over the frame data, so that
+ * only a few bytes of each frame are read. */
+static ADTSIndex * scan_frames (VFSFile * file, int64_t start, int64_t file_size)
+{
+    unsigned char buf[4096];
+    int64_t offset = start;
+    int size, srate, num;
+
+    ADTSIndex * index = (ADTSIndex *) calloc (1, sizeof (ADTSIndex));
+    int64_t frames = 0;
+    int alloc = 0;
+
+    while (1)
+    {
+        if (vfs_fseek (file, offset, SEEK_SET) || vfs_fread (buf, 1, 8, file) != 8)
+            break;
+
+        size = aac_parse_frame (buf, & srate, & num);
+
+        if (size < 8)
+        {
+            /* skip garbage between frames */
+            int len = 8 + vfs_fread (buf + 8, 1, sizeof buf - 8, file);
+            int skip = find_aac_header (buf + 1, len - 1, & size);
+
+            if (skip < 0 && len < (int) sizeof buf)
+                break;
+
+            offset += (skip < 0) ? len - 7 : 1 + skip;
+            continue;
+        }
+
+        if (offset + size > file_size)
+            break;              /* truncated last frame */
+
+        if (! index->samplerate)
+            index->samplerate = srate;
+
+        if (frames % INDEX_STEP == 0)
+        {
+            if (index->n_points == alloc)
+            {
+                alloc = alloc ? alloc * 2 : 256;
+                index->points = (IndexPoint *) realloc (index->points, sizeof (IndexPoint) * alloc);
+            }
+
+            index->points[index->n_points].offset = offset;
+            index->points[index->n_points].block = index->blocks;
+            index->n_points ++;
+        }
+
+        frames ++;
+        index->blocks += num;
+        offset += size;
+    }
+
+    if (! frames)
+    {
+        free (index->points);
+        free (index);
+        return NULL;
+    }
+
+    return index;
+}
+
+/* Returns a reference to the index of <filename>, scanning the file if it
+ * is not cached; NULL for remote files or if no frames are found. */
+static ADTSIndex * get_index (const char * filename, VFSFile * file)
+{
+    StringBuf path = uri_to_filename (filename);
+    struct stat info;
+
+    if (vfs_is_remote (filename) || ! path || stat (path, & info) < 0)
+        return NULL;
+
+    int64_t size = info.st_size, mtime = info.st_mtime;
+
+    pthread_mutex_lock (& index_mutex);
+
+    for (int i = 0; i < INDEX_CACHE_SIZE; i ++)
+    {
+        ADTSIndex * index = index_cache[i];
+
+        if (index && index->size == size && index->mtime == mtime && ! strcmp (index->filename, filename))
+        {
+            index->refs ++;
+            pthread_mutex_unlock (& index_mutex);
+            return index;
+        }
+    }
+
+    pthread_mutex_unlock (& index_mutex);
+
+    int64_t start = find_stream_start (file);
+    ADTSIndex * index = (start >= 0) ? scan_frames (file, start, size) : NULL;
+
+    if (! index)
+        return NULL;
+
+    index->filename = strdup (filename);
+    index->size = size;
+    index->mtime = mtime;
+    index->refs = 2;            /* one for the cache, one for the caller */
+
+    pthread_mutex_lock (& index_mutex);
+    ADTSIndex * old = index_cache[index_cache_next];
+    index_cache[index_cache_next] = index;
+    index_cache_next = (index_cache_next + 1) % INDEX_CACHE_SIZE;
+    pthread_mutex_unlock (& index_mutex);
+
+    if (old)
+        index_unref (old);
+
+    return index;
+}
+
+static void aac_cleanup (void)
+{
+    for (int i = 0; i < INDEX_CACHE_SIZE; i ++)
+    {
+        if (index_cache[i])
+        {
+            index_unref (index_cache[i]);
+            index_cache[i] = NULL;
+        }
+    }
+}
+
 /* Gets info (some approximated) from an AAC/ADTS file.  <length> is
  * milliseconds, <bitrate> is kilobits per second.  Any parameters that cannot
  * be read are set to -1. */
@@ -241,7 +444,22 @@ static Tuple aac_get_tuple (const char * filename, VFSFile * handle)
     tuple.set_filename (filename);
     tuple.set_str (FIELD_CODEC, "MPEG-2/4 AAC");
 
-    if (!vfs_is_remote (filename))
+    ADTSIndex * index = get_index (filename, handle);
+
+    if (index)
+    {
+        length = index->blocks * 1024 * (int64_t) 1000 / index->samplerate;
+        bitrate = (length > 0) ? index->size * 8 / length : 0;
+
+        if (length > 0)
+            tuple.set_int (FIELD_LENGTH, length);
+
+        if (bitrate > 0)
+            tuple.set_int (FIELD_BITRATE, bitrate);
+
+        index_unref (index);
+    }
+    else if (!vfs_is_remote (filename))
     {
         calc_aac_info (handle, &length, &bitrate, &samplerate, &channels);
 
@@ -257,21 +475,70 @@ static Tuple aac_get_tuple (const char * filename, VFSFile * handle)
     return tuple;
 }
 
-static void aac_seek (VFSFile * file, NeAACDecHandle dec, int time, int len,
- void * buf, int size, int * buflen)
+/* Returns the offset of the ADTS frame holding sample <time> (in ms). */
+static int64_t index_find (VFSFile * file, const ADTSIndex * index, int time)
 {
-    /* == ESTIMATE BYTE OFFSET == */
+    int64_t block = (int64_t) time * index->samplerate / 1000 / 1024;
+    int lo = 0, hi = index->n_points - 1;
 
-    int64_t total = vfs_fsize (file);
-    if (total < 0)
+    while (lo < hi)
     {
-        fprintf (stderr, "aac: File is not seekable.\n");
-        return;
+        int mid = (lo + hi + 1) / 2;
+
+        if (index->points[mid].block <= block)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+
+    /* walk the frame headers from the index point */
+    int64_t offset = index->points[lo].offset;
+    int64_t cur = index->points[lo].block;
+
+    for (int i = 1; i < INDEX_STEP; i ++)
+    {
+        unsigned char header[8];
+        int size, srate, num;
+
+        if (vfs_fseek (file, offset, SEEK_SET) || vfs_fread (header, 1, 8, file) != 8)
+            break;
+
+        size = aac_parse_frame (header, & srate, & num);
+
+        if (size < 8 || cur + num > block)
+            break;
+
+        offset += size;
+        cur += num;
+    }
+
+    return offset;
+}
+
+static void aac_seek (VFSFile * file, NeAACDecHandle dec, const ADTSIndex * index,
+ int time, int len, void * buf, int size, int * buflen)
+{
+    int64_t offset;
+
+    if (index)
+        offset = index_find (file, index, time);
+    else
+    {
+        /* == ESTIMATE BYTE OFFSET == */
+
+        int64_t total = vfs_fsize (file);
+        if (total < 0)
+        {
+            fprintf (stderr, "aac: File is not seekable.\n");
+            return;
+        }
+
+        offset = total * time / len;
     }
 
     /* == SEEK == */
 
-    if (vfs_fseek (file, total * time / len, SEEK_SET))
+    if (vfs_fseek (file, offset, SEEK_SET))
         return;
 
     * buflen = vfs_fread (buf, 1, size, file);
@@ -314,6 +581,7 @@ static bool_t my_decode_aac (const char * filename, VFSFile * file)
     unsigned long samplerate = 0;
     unsigned char channels = 0;
     int bitrate = 0;
+    ADTSIndex * index = NULL;
 
     Tuple tuple = aud_input_get_tuple ();
 
@@ -337,6 +605,11 @@ static bool_t my_decode_aac (const char * filename, VFSFile * file)
 
     unsigned char buf[BUFFER_SIZE];
     int buflen;
+
+    /* scanning for the index leaves the file at the end */
+    if ((index = get_index (filename, file)) && vfs_fseek (file, 0, SEEK_SET))
+        goto ERR_CLOSE_DECODER;
+
     buflen = vfs_fread (buf, 1, sizeof buf, file);
 
     /* == SKIP ID3 TAG == */
@@ -404,8 +677,8 @@ static bool_t my_decode_aac (const char * filename, VFSFile * file)
         {
             int length = tuple ? tuple.get_int (FIELD_LENGTH) : 0;
 
-            if (length > 0)
-                aac_seek (file, decoder, seek_value, length, buf, sizeof buf, & buflen);
+            if (index || length > 0)
+                aac_seek (file, decoder, index, seek_value, length, buf, sizeof buf, & buflen);
         }
 
         /* == CHECK FOR END OF FILE == */
@@ -451,15 +724,22 @@ static bool_t my_decode_aac (const char * filename, VFSFile * file)
             aud_input_write_audio (audio, sizeof (float) * info.samples);
     }
 
+    if (index)
+        index_unref (index);
+
     NeAACDecClose (decoder);
     return TRUE;
 
 ERR_CLOSE_DECODER:
+    if (index)
+        index_unref (index);
+
     NeAACDecClose (decoder);
     return FALSE;
 }
 
 #define AUD_PLUGIN_NAME        N_("AAC (Raw) Decoder")
+#define AUD_PLUGIN_CLEANUP     aac_cleanup
 #define AUD_INPUT_PLAY         my_decode_aac
 #define AUD_INPUT_IS_OUR_FILE  parse_aac_stream
 #define AUD_INPUT_READ_TUPLE   aac_get_tuple
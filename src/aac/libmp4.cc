@@ -170,6 +170,7 @@ static bool_t my_decode_mp4 (const char * filename, mp4ff_t * mp4file)
     NeAACDecConfigurationPtr decoder_config;
     unsigned char *buffer = NULL;
     unsigned bufferSize = 0;
+    unsigned char sample[BUFFER_SIZE];
     unsigned long samplerate = 0;
     unsigned char channels = 0;
     unsigned numSamples;
@@ -225,21 +226,18 @@ static bool_t my_decode_mp4 (const char * filename, mp4ff_t * mp4file)
     {
         void *sampleBuffer;
         NeAACDecFrameInfo frameInfo;
-        int rc;
-
-        buffer = NULL;
-        bufferSize = 0;
 
         /* If we've run to the end of the file, we're done. */
         if (sampleID >= numSamples)
             break;
 
-        rc = mp4ff_read_sample (mp4file, mp4track,
-         sampleID++, &buffer, &bufferSize);
+        /* Each sample is read into the same buffer. */
+        bufferSize = mp4ff_read_sample_getsize (mp4file, mp4track, sampleID);
 
         /* If we can't read the file, we're done. */
-        if ((rc == 0) || (buffer == NULL) || (bufferSize == 0)
-         || (bufferSize > BUFFER_SIZE))
+        if (bufferSize == 0 || bufferSize > BUFFER_SIZE ||
+         mp4ff_read_sample_v2 (mp4file, mp4track, sampleID ++, sample) !=
+         (int) bufferSize)
         {
             fprintf (stderr, "MP4: read error\n");
             sampleBuffer = NULL;
@@ -249,7 +247,7 @@ static bool_t my_decode_mp4 (const char * filename, mp4ff_t * mp4file)
             return FALSE;
         }
 
-        sampleBuffer = NeAACDecDecode (decoder, &frameInfo, buffer, bufferSize);
+        sampleBuffer = NeAACDecDecode (decoder, &frameInfo, sample, bufferSize);
 
         /* If there was an error decoding, we're done. */
         if (frameInfo.error > 0)
@@ -259,13 +257,6 @@ static bool_t my_decode_mp4 (const char * filename, mp4ff_t * mp4file)
 
             return FALSE;
         }
-        if (buffer)
-        {
-            g_free (buffer);
-            buffer = NULL;
-            bufferSize = 0;
-        }
-
         /* Calculate frame size from the first (non-blank) frame.  This needs to
          * be done before we try to seek. */
         if (!framesize)
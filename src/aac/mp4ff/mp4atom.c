@@ -244,6 +244,44 @@ uint64_t mp4ff_atom_read_header(mp4ff_t *f, uint8_t *atom_type, uint8_t *header_
     return size;
 }
 
+/* Reads a table of <count> rows of <ncols> values, one array per column.
+ * The whole table is fetched in one read rather than value by value. */
+static void mp4ff_read_table(mp4ff_t *f, int32_t count, int32_t ncols, int32_t **cols)
+{
+    uint32_t *rows = 0;
+    int32_t i, j;
+
+    if (count <= 0) return;
+
+    for (j = 0; j < ncols; j++)
+        if (!cols[j]) return;
+
+    if (ncols == 1 && count <= 0x3fffffff)
+    {
+        mp4ff_read_int32_array(f, (uint32_t*)cols[0], count);
+        return;
+    }
+
+    if (count <= 0x3fffffff / ncols)
+        rows = (uint32_t*)malloc(count * ncols * sizeof(uint32_t));
+
+    if (!rows)
+    {
+        for (i = 0; i < count; i++)
+            for (j = 0; j < ncols; j++)
+                cols[j][i] = mp4ff_read_int32(f);
+        return;
+    }
+
+    mp4ff_read_int32_array(f, rows, count * ncols);
+
+    for (i = 0; i < count; i++)
+        for (j = 0; j < ncols; j++)
+            cols[j][i] = rows[i * ncols + j];
+
+    free(rows);
+}
+
 static int32_t mp4ff_read_stsz(mp4ff_t *f)
 {
     mp4ff_read_char(f); /* version */
@@ -253,14 +291,11 @@ static int32_t mp4ff_read_stsz(mp4ff_t *f)
 
     if (f->track[f->total_tracks - 1]->stsz_sample_size == 0)
     {
-        int32_t i;
         f->track[f->total_tracks - 1]->stsz_table =
             (int32_t*)malloc(f->track[f->total_tracks - 1]->stsz_sample_count*sizeof(int32_t));
 
-        for (i = 0; i < f->track[f->total_tracks - 1]->stsz_sample_count; i++)
-        {
-            f->track[f->total_tracks - 1]->stsz_table[i] = mp4ff_read_int32(f);
-        }
+        mp4ff_read_table(f, f->track[f->total_tracks - 1]->stsz_sample_count, 1,
+            &f->track[f->total_tracks - 1]->stsz_table);
     }
 
     return 0;
@@ -400,7 +435,7 @@ static int32_t mp4ff_read_stsd(mp4ff_t *f)
 
 static int32_t mp4ff_read_stsc(mp4ff_t *f)
 {
-    int32_t i;
+    int32_t *cols[3];
 
     mp4ff_read_char(f); /* version */
     mp4ff_read_int24(f); /* flags */
@@ -413,20 +448,16 @@ static int32_t mp4ff_read_stsc(mp4ff_t *f)
     f->track[f->total_tracks - 1]->stsc_sample_desc_index =
         (int32_t*)malloc(f->track[f->total_tracks - 1]->stsc_entry_count*sizeof(int32_t));
 
-    for (i = 0; i < f->track[f->total_tracks - 1]->stsc_entry_count; i++)
-    {
-        f->track[f->total_tracks - 1]->stsc_first_chunk[i] = mp4ff_read_int32(f);
-        f->track[f->total_tracks - 1]->stsc_samples_per_chunk[i] = mp4ff_read_int32(f);
-        f->track[f->total_tracks - 1]->stsc_sample_desc_index[i] = mp4ff_read_int32(f);
-    }
+    cols[0] = f->track[f->total_tracks - 1]->stsc_first_chunk;
+    cols[1] = f->track[f->total_tracks - 1]->stsc_samples_per_chunk;
+    cols[2] = f->track[f->total_tracks - 1]->stsc_sample_desc_index;
+    mp4ff_read_table(f, f->track[f->total_tracks - 1]->stsc_entry_count, 3, cols);
 
     return 0;
 }
 
 static int32_t mp4ff_read_stco(mp4ff_t *f)
 {
-    int32_t i;
-
     mp4ff_read_char(f); /* version */
     mp4ff_read_int24(f); /* flags */
     f->track[f->total_tracks - 1]->stco_entry_count = mp4ff_read_int32(f);
@@ -434,17 +465,15 @@ static int32_t mp4ff_read_stco(mp4ff_t *f)
     f->track[f->total_tracks - 1]->stco_chunk_offset =
         (int32_t*)malloc(f->track[f->total_tracks - 1]->stco_entry_count*sizeof(int32_t));
 
-    for (i = 0; i < f->track[f->total_tracks - 1]->stco_entry_count; i++)
-    {
-        f->track[f->total_tracks - 1]->stco_chunk_offset[i] = mp4ff_read_int32(f);
-    }
+    mp4ff_read_table(f, f->track[f->total_tracks - 1]->stco_entry_count, 1,
+        &f->track[f->total_tracks - 1]->stco_chunk_offset);
 
     return 0;
 }
 
 static int32_t mp4ff_read_ctts(mp4ff_t *f)
 {
-    int32_t i;
+    int32_t *cols[2];
     mp4ff_track_t * p_track = f->track[f->total_tracks - 1];
 
     if (p_track->ctts_entry_count) return 0;
@@ -465,18 +494,16 @@ static int32_t mp4ff_read_ctts(mp4ff_t *f)
     }
     else
     {
-        for (i = 0; i < f->track[f->total_tracks - 1]->ctts_entry_count; i++)
-        {
-            p_track->ctts_sample_count[i] = mp4ff_read_int32(f);
-            p_track->ctts_sample_offset[i] = mp4ff_read_int32(f);
-        }
+        cols[0] = p_track->ctts_sample_count;
+        cols[1] = p_track->ctts_sample_offset;
+        mp4ff_read_table(f, p_track->ctts_entry_count, 2, cols);
         return 1;
     }
 }
 
 static int32_t mp4ff_read_stts(mp4ff_t *f)
 {
-    int32_t i;
+    int32_t *cols[2];
     mp4ff_track_t * p_track = f->track[f->total_tracks - 1];
 
     if (p_track->stts_entry_count) return 0;
@@ -497,11 +524,9 @@ static int32_t mp4ff_read_stts(mp4ff_t *f)
     }
     else
     {
-        for (i = 0; i < f->track[f->total_tracks - 1]->stts_entry_count; i++)
-        {
-            p_track->stts_sample_count[i] = mp4ff_read_int32(f);
-            p_track->stts_sample_delta[i] = mp4ff_read_int32(f);
-        }
+        cols[0] = p_track->stts_sample_count;
+        cols[1] = p_track->stts_sample_delta;
+        mp4ff_read_table(f, p_track->stts_entry_count, 2, cols);
         return 1;
     }
 }
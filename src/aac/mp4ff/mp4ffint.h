@@ -234,6 +234,7 @@ int32_t mp4ff_read_data(mp4ff_t *f, void *data, uint32_t size);
 int32_t mp4ff_write_data(mp4ff_t *f, void *data, uint32_t size);
 uint64_t mp4ff_read_int64(mp4ff_t *f);
 uint32_t mp4ff_read_int32(mp4ff_t *f);
+int32_t mp4ff_read_int32_array(mp4ff_t *f, uint32_t *data, uint32_t count);
 uint32_t mp4ff_read_int24(mp4ff_t *f);
 uint16_t mp4ff_read_int16(mp4ff_t *f);
 uint8_t mp4ff_read_char(mp4ff_t *f);
@@ -30,6 +30,7 @@
 
 #include "mp4ffint.h"
 #include <stdlib.h>
+#include <string.h>
 
 int32_t mp4ff_read_data(mp4ff_t *f, void *data, uint32_t size)
 {
@@ -120,6 +121,24 @@ uint32_t mp4ff_read_int32(mp4ff_t *f)
     return (uint32_t)result;
 }
 
+/* reads <count> values with a single read, converting them in place */
+int32_t mp4ff_read_int32_array(mp4ff_t *f, uint32_t *data, uint32_t count)
+{
+    uint8_t *bytes = (uint8_t*)data;
+    uint32_t size = count * 4;
+    int32_t result;
+    uint32_t i;
+
+    result = mp4ff_read_data(f, data, size);
+    if (result < 0) result = 0;
+    if ((uint32_t)result < size) memset(bytes + result, 0, size - result);
+
+    for (i = 0; i < count; i++, bytes += 4)
+        data[i] = ((uint32_t)bytes[0]<<24) | ((uint32_t)bytes[1]<<16) | ((uint32_t)bytes[2]<<8) | bytes[3];
+
+    return (uint32_t)result == size;
+}
+
 uint32_t mp4ff_read_int24(mp4ff_t *f)
 {
     uint32_t result;
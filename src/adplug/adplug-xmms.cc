@@ -202,6 +202,9 @@ static bool_t play_loop (const char * filename, VFSFile * fd)
     {
       int time = aud_input_written_time ();
 
+      // run the player without emulating the OPL chips
+      opl.setskip (true);
+
       // backward seek ?
       if (seek < time)
       {
@@ -212,6 +215,8 @@ static bool_t play_loop (const char * filename, VFSFile * fd)
       // seek to requested position
       while (time < seek && plr.p->update ())
         time += (int) (1000 / plr.p->getrefresh ());
+
+      opl.setskip (false);
     }
 
     // fill sound buffer
@@ -21,8 +21,10 @@
 
 #include "emuopl.h"
 
+#include <string.h>
+
 CEmuopl::CEmuopl (int rate, bool bit16, bool usestereo):use16bit (bit16), stereo (usestereo),
-mixbufSamples (0)
+skipping (false), mixbufSamples (0)
 {
   opl[0] = OPLCreate (OPL_TYPE_YM3812, 3579545, rate);
   opl[1] = OPLCreate (OPL_TYPE_YM3812, 3579545, rate);
@@ -139,6 +141,11 @@ CEmuopl::update (short *buf, int samples)
 void
 CEmuopl::write (int reg, int val)
 {
+  regs[currChip][reg & 0xff] = val;
+
+  if (skipping)
+    return;
+
   switch (currType)
   {
   case TYPE_OPL2:
@@ -157,6 +164,40 @@ CEmuopl::init ()
   OPLResetChip (opl[0]);
   OPLResetChip (opl[1]);
   currChip = 0;
+  memset (regs, 0, sizeof regs);
+}
+
+void
+CEmuopl::setskip (bool skip)
+{
+  if (skipping && !skip)
+  {
+    // bring the chips this type has to the remembered state, keying on
+    // notes last (OPL3 is unsupported, as in write)
+    int chips = (currType == TYPE_DUAL_OPL2) ? 2 :
+     (currType == TYPE_OPL2) ? 1 : 0;
+
+    for (int chip = 0; chip < chips; chip++)
+    {
+      OPLResetChip (opl[chip]);
+
+      for (int reg = 0; reg < 256; reg++)
+        if ((reg & 0xf0) != 0xb0 && regs[chip][reg])
+        {
+          OPLWrite (opl[chip], 0, reg);
+          OPLWrite (opl[chip], 1, regs[chip][reg]);
+        }
+
+      for (int reg = 0xb0; reg < 0xc0; reg++)
+        if (regs[chip][reg])
+        {
+          OPLWrite (opl[chip], 0, reg);
+          OPLWrite (opl[chip], 1, regs[chip][reg]);
+        }
+    }
+  }
+
+  skipping = skip;
 }
 
 void
@@ -37,8 +37,13 @@ class CEmuopl: public Copl
   void init();
   void settype(ChipType type);
 
+  // While set, register writes are only remembered, not emulated (to
+  // fast-forward the song); clearing it loads the remembered registers.
+  void setskip(bool skip);
+
  private:
-  bool		use16bit, stereo;
+  bool		use16bit, stereo, skipping;
+  unsigned char	regs[2][256];				// last value written
   FM_OPL	*opl[2];				// OPL2 emulator data
   short		*mixbuf0, *mixbuf1;
   int		mixbufSamples;
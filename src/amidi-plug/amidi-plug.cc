@@ -47,6 +47,7 @@ static void amidiplug_play_loop (void);
 static bool_t amidiplug_play (const char * filename_uri, VFSFile * file);
 static Tuple amidiplug_get_song_tuple (const char * filename_uri, VFSFile * file);
 static void amidiplug_skipto (int playing_tick);
+static void replay_event (midievent_t * event);
 
 static midifile_t midifile;
 
@@ -255,6 +256,245 @@ ERR:
     return FALSE;
 }
 
+/* Seeking replays the events that change the state of the synthesizer, up
+   to the requested tick.  To shorten the replay, the state of each channel
+   (controllers, program, pressure, pitch bend) and the tempo are recorded
+   every CHECKPOINT_INTERVAL events; a seek restores the last checkpoint
+   before the requested tick and replays only the events after it.  Events
+   whose effect depends on what came before them (system exclusive, RPN and
+   NRPN data entry, channel mode messages) are not part of the checkpoints;
+   they are replayed in order before a checkpoint is restored, and are few. */
+
+#define CHECKPOINT_INTERVAL 4096
+
+typedef struct
+{
+    signed char ctrl[128];	/* -1 if never set */
+    signed char program;
+    signed char program_bank[2];	/* bank select (controllers 0, 32) at program change */
+    signed char pressure;
+    short bend;
+}
+channel_state_t;
+
+typedef struct
+{
+    int event;			/* index of the first event after the checkpoint */
+    int ordered;		/* number of ordered events before it */
+    int tempo;
+    channel_state_t channels[16];
+}
+checkpoint_t;
+
+static GArray * checkpoints;	/* of checkpoint_t */
+static GArray * ordered_events;	/* of int, indexes into midifile.events */
+static int initial_tempo;
+
+static void reset_channel (channel_state_t * channel)
+{
+    memset (channel->ctrl, -1, sizeof channel->ctrl);
+    channel->program = -1;
+    channel->program_bank[0] = channel->program_bank[1] = -1;
+    channel->pressure = -1;
+    channel->bend = -1;
+}
+
+/* controllers whose effect depends on the order of events */
+static bool_t is_ordered_controller (int ctrl)
+{
+    return (ctrl == 6 || ctrl == 38 || (ctrl >= 96 && ctrl <= 101) || ctrl >= 120);
+}
+
+/* GM system on, GS reset, XG system on */
+static bool_t is_reset_sysex (midievent_t * event)
+{
+    const unsigned char * d = event->sysex;
+    unsigned len = event->data.length;
+
+    if (! d || len < 6 || d[0] != 0xf0)
+        return FALSE;
+
+    if (d[1] == 0x7e && d[3] == 0x09)
+        return TRUE;
+    if (len >= 11 && d[1] == 0x41 && d[3] == 0x42 && d[4] == 0x12 && d[5] == 0x40 &&
+     d[6] == 0x00 && d[7] == 0x7f)
+        return TRUE;
+    if (len >= 9 && d[1] == 0x43 && d[3] == 0x4c && d[4] == 0x00 && d[5] == 0x00 &&
+     d[6] == 0x7e)
+        return TRUE;
+
+    return FALSE;
+}
+
+static void track_event (channel_state_t * channels, int index)
+{
+    midievent_t * event = midifile.events[index];
+    channel_state_t * channel = & channels[event->data.d[0] & 0x0f];
+
+    switch (event->type)
+    {
+    case SND_SEQ_EVENT_CONTROLLER:
+        if (! is_ordered_controller (event->data.d[1]))
+        {
+            channel->ctrl[event->data.d[1]] = event->data.d[2];
+            break;
+        }
+
+        g_array_append_val (ordered_events, index);
+
+        /* reset all controllers leaves volume, pan, bank, sound and
+           effect controllers alone */
+        if (event->data.d[1] == 121)
+        {
+            for (int c = 0; c < 128; c ++)
+            {
+                if (c != 0 && c != 7 && c != 10 && c != 32 && ! (c >= 70 && c <= 79) &&
+                 ! (c >= 91 && c <= 95))
+                    channel->ctrl[c] = -1;
+            }
+
+            channel->pressure = -1;
+            channel->bend = -1;
+        }
+        break;
+
+    case SND_SEQ_EVENT_PGMCHANGE:
+        channel->program = event->data.d[1];
+        channel->program_bank[0] = channel->ctrl[0];
+        channel->program_bank[1] = channel->ctrl[32];
+        break;
+
+    case SND_SEQ_EVENT_CHANPRESS:
+        channel->pressure = event->data.d[1];
+        break;
+
+    case SND_SEQ_EVENT_PITCHBEND:
+        channel->bend = (event->data.d[2] << 7) | event->data.d[1];
+        break;
+
+    case SND_SEQ_EVENT_SYSEX:
+        g_array_append_val (ordered_events, index);
+
+        if (is_reset_sysex (event))
+        {
+            for (int c = 0; c < 16; c ++)
+                reset_channel (& channels[c]);
+        }
+        break;
+    }
+}
+
+static void build_checkpoints (void)
+{
+    checkpoint_t cp;
+
+    checkpoints = g_array_new (FALSE, FALSE, sizeof (checkpoint_t));
+    ordered_events = g_array_new (FALSE, FALSE, sizeof (int));
+    initial_tempo = midifile.current_tempo;
+
+    cp.tempo = initial_tempo;
+
+    for (int c = 0; c < 16; c ++)
+        reset_channel (& cp.channels[c]);
+
+    for (int i = 0; i < midifile.num_events; i ++)
+    {
+        if (i && i % CHECKPOINT_INTERVAL == 0)
+        {
+            cp.event = i;
+            cp.ordered = ordered_events->len;
+            g_array_append_val (checkpoints, cp);
+        }
+
+        if (midifile.events[i]->type == SND_SEQ_EVENT_TEMPO)
+            cp.tempo = midifile.events[i]->data.tempo;
+        else
+            track_event (cp.channels, i);
+    }
+}
+
+static void free_checkpoints (void)
+{
+    g_array_free (checkpoints, TRUE);
+    g_array_free (ordered_events, TRUE);
+    checkpoints = ordered_events = NULL;
+}
+
+/* the last checkpoint with all the events before it earlier than <tick> */
+static const checkpoint_t * find_checkpoint (int tick)
+{
+    const checkpoint_t * found = NULL;
+    int lo = 0, hi = (int) checkpoints->len - 1;
+
+    while (lo <= hi)
+    {
+        int mid = (lo + hi) / 2;
+        const checkpoint_t * cp = & g_array_index (checkpoints, checkpoint_t, mid);
+
+        if (midifile.events[cp->event - 1]->tick < tick)
+        {
+            found = cp;
+            lo = mid + 1;
+        }
+        else
+            hi = mid - 1;
+    }
+
+    return found;
+}
+
+static void send_event (int type, int channel, int d1, int d2)
+{
+    midievent_t event = midievent_t ();
+
+    event.type = type;
+    event.data.d[0] = channel;
+    event.data.d[1] = d1;
+    event.data.d[2] = d2;
+
+    replay_event (& event);
+}
+
+static void restore_checkpoint (const checkpoint_t * cp)
+{
+    for (int i = 0; i < cp->ordered; i ++)
+        replay_event (midifile.events[g_array_index (ordered_events, int, i)]);
+
+    for (int c = 0; c < 16; c ++)
+    {
+        const channel_state_t * channel = & cp->channels[c];
+
+        /* the program first, with the bank it was chosen from */
+        if (channel->program >= 0)
+        {
+            for (int b = 0; b < 2; b ++)
+            {
+                if (channel->program_bank[b] >= 0)
+                    send_event (SND_SEQ_EVENT_CONTROLLER, c, b ? 32 : 0, channel->program_bank[b]);
+            }
+
+            send_event (SND_SEQ_EVENT_PGMCHANGE, c, channel->program, 0);
+        }
+
+        for (int ctrl = 0; ctrl < 128; ctrl ++)
+        {
+            if (channel->ctrl[ctrl] >= 0)
+                send_event (SND_SEQ_EVENT_CONTROLLER, c, ctrl, channel->ctrl[ctrl]);
+        }
+
+        if (channel->pressure >= 0)
+            send_event (SND_SEQ_EVENT_CHANPRESS, c, channel->pressure, 0);
+
+        if (channel->bend >= 0)
+            send_event (SND_SEQ_EVENT_PITCHBEND, c, channel->bend & 0x7f, channel->bend >> 7);
+    }
+
+    midievent_t tempo = midievent_t ();
+    tempo.type = SND_SEQ_EVENT_TEMPO;
+    tempo.data.tempo = cp->tempo;
+    replay_event (& tempo);
+}
+
 static void generate_to_tick (int tick)
 {
     double ticksecs = (double) midifile.current_tempo / midifile.ppq / 1000000;
@@ -267,10 +507,9 @@ static void amidiplug_play_loop ()
     bool_t stopped = FALSE;
 
     backend_prepare ();
+    build_checkpoints ();
 
-    /* initialize current position in each track */
-    for (int j = 0; j < midifile.num_tracks; ++j)
-        midifile.tracks[j].current_event = midifile.tracks[j].first_event;
+    midifile.playing_event = 0;
 
     while (! (stopped = aud_input_check_stop ()))
     {
@@ -278,29 +517,10 @@ static void amidiplug_play_loop ()
         if (seektime >= 0)
             amidiplug_skipto ((int64_t) seektime * 1000 / midifile.avg_microsec_per_tick);
 
-        midievent_t * event = NULL;
-        midifile_track_t * event_track = NULL;
-        int i, min_tick = midifile.max_tick + 1;
-
-        /* search next event */
-        for (i = 0; i < midifile.num_tracks; ++i)
-        {
-            midifile_track_t * track = &midifile.tracks[i];
-            midievent_t * e2 = track->current_event;
-
-            if ((e2) && (e2->tick < min_tick))
-            {
-                min_tick = e2->tick;
-                event = e2;
-                event_track = track;
-            }
-        }
-
-        if (!event)
+        if (midifile.playing_event >= midifile.num_events)
             break; /* end of song reached */
 
-        /* advance pointer to next event */
-        event_track->current_event = event->next;
+        midievent_t * event = midifile.events[midifile.playing_event ++];
 
         if (event->tick > midifile.playing_tick)
             generate_to_tick (event->tick);
@@ -365,51 +585,79 @@ static void amidiplug_play_loop ()
 
     backend_reset ();
 
+    free_checkpoints ();
     i_midi_free (& midifile);
 }
 
 
+/* re-does an event that influences the playing of our midi file, without
+   generating any sound */
+static void replay_event (midievent_t * event)
+{
+    switch (event->type)
+    {
+        /* do nothing for these
+        case SND_SEQ_EVENT_NOTEON:
+        case SND_SEQ_EVENT_NOTEOFF:
+        case SND_SEQ_EVENT_KEYPRESS:
+        {
+          break;
+        } */
+    case SND_SEQ_EVENT_CONTROLLER:
+        seq_event_controller (event);
+        break;
+
+    case SND_SEQ_EVENT_PGMCHANGE:
+        seq_event_pgmchange (event);
+        break;
+
+    case SND_SEQ_EVENT_CHANPRESS:
+        seq_event_chanpress (event);
+        break;
+
+    case SND_SEQ_EVENT_PITCHBEND:
+        seq_event_pitchbend (event);
+        break;
+
+    case SND_SEQ_EVENT_SYSEX:
+        seq_event_sysex (event);
+        break;
+
+    case SND_SEQ_EVENT_TEMPO:
+        seq_event_tempo (event);
+        midifile.current_tempo = event->data.tempo;
+        break;
+    }
+}
+
+
 /* amidigplug_skipto: re-do all events that influence the playing of our
    midi file; re-do them using a time-tick of 0, so they are processed
-   istantaneously and proceed this way until the playing_tick is reached */
+   istantaneously and proceed this way until the playing_tick is reached;
+   the replay starts from the last checkpoint before playing_tick */
 static void amidiplug_skipto (int playing_tick)
 {
+    int i = 0;
+
     backend_reset ();
 
     /* this check is always made, for safety*/
     if (playing_tick >= midifile.max_tick)
         playing_tick = midifile.max_tick - 1;
 
-    /* initialize current position in each track */
-    for (int i = 0; i < midifile.num_tracks; ++i)
-        midifile.tracks[i].current_event = midifile.tracks[i].first_event;
+    const checkpoint_t * cp = find_checkpoint (playing_tick);
 
-    for (;;)
+    if (cp)
     {
-        midievent_t * event = NULL;
-        midifile_track_t * event_track = NULL;
-        int i, min_tick = midifile.max_tick + 1;
-
-        /* search next event */
-        for (i = 0; i < midifile.num_tracks; ++i)
-        {
-            midifile_track_t * track = &midifile.tracks[i];
-            midievent_t * e2 = track->current_event;
-
-            if ((e2) && (e2->tick < min_tick))
-            {
-                min_tick = e2->tick;
-                event = e2;
-                event_track = track;
-            }
-        }
+        restore_checkpoint (cp);
+        i = cp->event;
+    }
+    else
+        midifile.current_tempo = initial_tempo;
 
-        /* unlikely here... unless very strange MIDI files are played :) */
-        if (!event)
-        {
-            AUDDBG ("SKIPTO request, reached the last event but not the requested tick (!)\n");
-            break; /* end of song reached */
-        }
+    for (; i < midifile.num_events; ++i)
+    {
+        midievent_t * event = midifile.events[i];
 
         /* reached the requested tick, job done */
         if (event->tick >= playing_tick)
@@ -418,45 +666,10 @@ static void amidiplug_skipto (int playing_tick)
             break;
         }
 
-        /* advance pointer to next event */
-        event_track->current_event = event->next;
-
-        switch (event->type)
-        {
-            /* do nothing for these
-            case SND_SEQ_EVENT_NOTEON:
-            case SND_SEQ_EVENT_NOTEOFF:
-            case SND_SEQ_EVENT_KEYPRESS:
-            {
-              break;
-            } */
-        case SND_SEQ_EVENT_CONTROLLER:
-            seq_event_controller (event);
-            break;
-
-        case SND_SEQ_EVENT_PGMCHANGE:
-            seq_event_pgmchange (event);
-            break;
-
-        case SND_SEQ_EVENT_CHANPRESS:
-            seq_event_chanpress (event);
-            break;
-
-        case SND_SEQ_EVENT_PITCHBEND:
-            seq_event_pitchbend (event);
-            break;
-
-        case SND_SEQ_EVENT_SYSEX:
-            seq_event_sysex (event);
-            break;
-
-        case SND_SEQ_EVENT_TEMPO:
-            seq_event_tempo (event);
-            midifile.current_tempo = event->data.tempo;
-            break;
-        }
+        replay_event (event);
     }
 
+    midifile.playing_event = i;
     midifile.playing_tick = playing_tick;
 }
 
@@ -23,6 +23,7 @@
 
 #include "i_midi.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -520,11 +521,46 @@ int i_midi_file_parse_smf (midifile_t * mf, int port_count)
             mf->max_tick = mf->tracks[i].end_tick;
     }
 
+    i_midi_merge_tracks (mf);
+
     /* ok, success */
     return 1;
 }
 
 
+static bool event_before (const midievent_t * a, const midievent_t * b)
+{
+    return a->tick < b->tick;
+}
+
+
+/* fills mf->events; events on the same tick keep the order of their
+   tracks, as when the next event was looked up across all tracks */
+void i_midi_merge_tracks (midifile_t * mf)
+{
+    int i, n = 0;
+
+    mf->num_events = 0;
+
+    for (i = 0 ; i < mf->num_tracks ; ++i)
+    {
+        for (midievent_t * event = mf->tracks[i].first_event ; event ; event = event->next)
+            mf->num_events ++;
+    }
+
+    g_free (mf->events);
+    mf->events = g_new (midievent_t *, mf->num_events);
+
+    for (i = 0 ; i < mf->num_tracks ; ++i)
+    {
+        for (midievent_t * event = mf->tracks[i].first_event ; event ; event = event->next)
+            mf->events[n ++] = event;
+    }
+
+    std::stable_sort (mf->events, mf->events + mf->num_events, event_before);
+}
+
+
 /* read a MIDI file enclosed in RIFF format */
 /* return values: 0 = error, 1 = ok */
 int i_midi_file_parse_riff (midifile_t * mf)
@@ -571,6 +607,8 @@ void i_midi_init (midifile_t * mf)
     mf->file_offset = 0;
     mf->num_tracks = 0;
     mf->tracks = NULL;
+    mf->num_events = 0;
+    mf->events = NULL;
     mf->max_tick = 0;
     mf->smpte_timing = 0;
     mf->format = 0;
@@ -578,6 +616,7 @@ void i_midi_init (midifile_t * mf)
     mf->ppq = 0;
     mf->current_tempo = 0;
     mf->playing_tick = 0;
+    mf->playing_event = 0;
     mf->avg_microsec_per_tick = 0;
     mf->length = 0;
     return;
@@ -589,6 +628,10 @@ void i_midi_free (midifile_t * mf)
     g_free (mf->file_name);
     mf->file_name = NULL;
 
+    g_free (mf->events);
+    mf->events = NULL;
+    mf->num_events = 0;
+
     if (mf->tracks)
     {
         int i;
@@ -678,8 +721,7 @@ int i_midi_setget_tempo (midifile_t * mf)
 }
 
 
-/* this will set the midi length in microseconds
-   COMMENT: this will also reset current position in each track! */
+/* this will set the midi length in microseconds */
 void i_midi_setget_length (midifile_t * mf)
 {
     int64_t length_microsec = 0;
@@ -687,44 +729,14 @@ void i_midi_setget_length (midifile_t * mf)
     /* get the first microsec_per_tick ratio */
     int microsec_per_tick = (int) (mf->current_tempo / mf->ppq);
 
-    /* initialize current position in each track */
-    for (i = 0; i < mf->num_tracks; ++i)
-        mf->tracks[i].current_event = mf->tracks[i].first_event;
-
     /* search for tempo events in each track; in fact, since the program
        currently supports type 0 and type 1 MIDI files, we should find
        tempo events only in one track */
     DEBUGMSG ("LENGTH calc: starting calc loop\n");
 
-    for (;;)
+    for (i = 0 ; i < mf->num_events ; ++i)
     {
-        midievent_t * event = NULL;
-        midifile_track_t * event_track = NULL;
-        int i, min_tick = mf->max_tick + 1;
-
-        /* search next event */
-        for (i = 0 ; i < mf->num_tracks ; ++i)
-        {
-            midifile_track_t * track = &mf->tracks[i];
-            midievent_t * e2 = track->current_event;
-
-            if (e2 && e2->tick < min_tick)
-            {
-                min_tick = e2->tick;
-                event = e2;
-                event_track = track;
-            }
-        }
-
-        if (!event)
-        {
-            /* calculate the remaining length */
-            length_microsec += (microsec_per_tick * (mf->max_tick - last_tick));
-            break; /* end of song reached */
-        }
-
-        /* advance pointer to next event */
-        event_track->current_event = event->next;
+        midievent_t * event = mf->events[i];
 
         /* check if this is a tempo event */
         if (event->type == SND_SEQ_EVENT_TEMPO)
@@ -739,6 +751,9 @@ void i_midi_setget_length (midifile_t * mf)
         }
     }
 
+    /* calculate the remaining length */
+    length_microsec += (microsec_per_tick * (mf->max_tick - last_tick));
+
     /* IMPORTANT
        this couple of important values is set by i_midi_set_length */
     mf->length = length_microsec;
@@ -753,8 +768,7 @@ void i_midi_setget_length (midifile_t * mf)
 
 
 /* this will get the weighted average bpm of the midi file;
-   if the file has a variable bpm, 'bpm' is set to -1;
-   COMMENT: this will also reset current position in each track! */
+   if the file has a variable bpm, 'bpm' is set to -1 */
 void i_midi_get_bpm (midifile_t * mf, int * bpm, int * wavg_bpm)
 {
     int i = 0, last_tick = 0;
@@ -762,44 +776,14 @@ void i_midi_get_bpm (midifile_t * mf, int * bpm, int * wavg_bpm)
     bool_t is_monotempo = TRUE;
     int last_tempo = mf->current_tempo;
 
-    /* initialize current position in each track */
-    for (i = 0 ; i < mf->num_tracks ; ++i)
-        mf->tracks[i].current_event = mf->tracks[i].first_event;
-
     /* search for tempo events in each track; in fact, since the program
        currently supports type 0 and type 1 MIDI files, we should find
        tempo events only in one track */
     DEBUGMSG ("BPM calc: starting calc loop\n");
 
-    for (;;)
+    for (i = 0 ; i < mf->num_events ; ++i)
     {
-        midievent_t * event = NULL;
-        midifile_track_t * event_track = NULL;
-        int i, min_tick = mf->max_tick + 1;
-
-        /* search next event */
-        for (i = 0 ; i < mf->num_tracks ; ++i)
-        {
-            midifile_track_t * track = &mf->tracks[i];
-            midievent_t * e2 = track->current_event;
-
-            if (e2 && e2->tick < min_tick)
-            {
-                min_tick = e2->tick;
-                event = e2;
-                event_track = track;
-            }
-        }
-
-        if (!event)
-        {
-            /* calculate the remaining length */
-            weighted_avg_tempo += (unsigned) (last_tempo * ((float) (mf->max_tick - last_tick) / (float) mf->max_tick));
-            break; /* end of song reached */
-        }
-
-        /* advance pointer to next event */
-        event_track->current_event = event->next;
+        midievent_t * event = mf->events[i];
 
         /* check if this is a tempo event */
         if (event->type == SND_SEQ_EVENT_TEMPO)
@@ -819,6 +803,9 @@ void i_midi_get_bpm (midifile_t * mf, int * bpm, int * wavg_bpm)
         }
     }
 
+    /* calculate the remaining length */
+    weighted_avg_tempo += (unsigned) (last_tempo * ((float) (mf->max_tick - last_tick) / (float) mf->max_tick));
+
     DEBUGMSG ("BPM calc: weighted average tempo: %i\n", weighted_avg_tempo);
 
     *wavg_bpm = (int) (60000000 / weighted_avg_tempo);
@@ -244,6 +244,10 @@ typedef struct
     int num_tracks;
     midifile_track_t * tracks;
 
+    /* the events of all tracks, in order of playback */
+    int num_events;
+    midievent_t * * events;
+
     unsigned short format;
     int max_tick;
     int smpte_timing;
@@ -253,6 +257,7 @@ typedef struct
     int current_tempo;
 
     int playing_tick;
+    int playing_event;	/* index of the next event to play */
     int avg_microsec_per_tick;
     int64_t length;
 }
@@ -268,6 +273,7 @@ int i_midi_file_read_var (midifile_t *);
 int i_midi_file_read_track (midifile_t *, midifile_track_t *, int, int);
 int i_midi_file_parse_riff (midifile_t *);
 int i_midi_file_parse_smf (midifile_t *, int);
+void i_midi_merge_tracks (midifile_t *);
 void i_midi_init (midifile_t *);
 void i_midi_free (midifile_t *);
 int i_midi_setget_tempo (midifile_t *);
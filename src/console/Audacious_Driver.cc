@@ -10,6 +10,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <glib.h>
+
 #include <libaudcore/audstrings.h>
 #include <libaudcore/input.h>
 #include <libaudcore/plugin.h>
@@ -17,10 +19,15 @@
 #include "configure.h"
 #include "Music_Emu.h"
 #include "Gzip_Reader.h"
+#include "length_scan.h"
+#include "loop_detect.h"
 
 static const int fade_threshold = 10 * 1000;
 static const int fade_length    = 8 * 1000;
 
+static const int scan_sample_rate = 32000;
+static const int scan_max_length  = 10 * 60 * 1000;
+
 static blargg_err_t log_err(blargg_err_t err)
 {
     if (err)
@@ -35,6 +42,32 @@ static void log_warning(Music_Emu * emu)
         fprintf (stderr, "console: %s\n", str);
 }
 
+/* Passes data through from another reader, computing a checksum of
+ * everything read if <enabled>. Used to identify tracks in the length cache.
+ */
+class Checksum_Reader : public Data_Reader {
+public:
+    Checksum_Reader(Data_Reader *in, bool enabled) :
+        m_in(in), m_sum(enabled ? g_checksum_new(G_CHECKSUM_SHA1) : NULL) {}
+    ~Checksum_Reader() { if (m_sum) g_checksum_free(m_sum); }
+
+    long remain() const { return m_in->remain(); }
+
+    long read_avail(void *out, long count)
+    {
+        long result = m_in->read_avail(out, count);
+        if (m_sum && result > 0)
+            g_checksum_update(m_sum, (const guchar *) out, result);
+        return result;
+    }
+
+    const char *digest() { return g_checksum_get_string(m_sum); }
+
+private:
+    Data_Reader *m_in;
+    GChecksum *m_sum;
+};
+
 /* Handles URL parsing, file opening and identification, and file
  * loading. Keeps file header around when loading rest of file to
  * avoid seeking and re-reading.
@@ -45,13 +78,16 @@ public:
     int m_track;             // track number (0 = first track)
     Music_Emu* m_emu;         // set to 0 to take ownership
     gme_type_t m_type;
+    String m_hash;            // checksum of file contents, set by load() if
+                              // asked to
 
     // Parses path and identifies file type
     ConsoleFileHandler(const char* path, VFSFile *fd = NULL);
 
     // Creates emulator and returns 0. If this wasn't a music file or
-    // emulator couldn't be created, returns 1.
-    int load(int sample_rate);
+    // emulator couldn't be created, returns 1. Hashing the file (for the
+    // length cache) costs a pass over all of it, so it is only done if asked.
+    int load(int sample_rate, bool hash);
 
     // Deletes owned emu and closes file
     ~ConsoleFileHandler();
@@ -102,7 +138,7 @@ ConsoleFileHandler::~ConsoleFileHandler()
     gme_delete(m_emu);
 }
 
-int ConsoleFileHandler::load(int sample_rate)
+int ConsoleFileHandler::load(int sample_rate, bool hash)
 {
     if (!m_type)
         return 1;
@@ -116,9 +152,14 @@ int ConsoleFileHandler::load(int sample_rate)
 
     // combine header with remaining file data
     Remaining_Reader reader(m_header, sizeof(m_header), &gzip_in);
-    if (log_err(m_emu->load(reader)))
+    Checksum_Reader sum_reader(&reader, hash);
+    if (log_err(m_emu->load(sum_reader)))
         return 1;
 
+    // info-only emulators stop after the header, so hash the rest as well
+    if (hash && !log_err(sum_reader.skip(sum_reader.remain())))
+        m_hash = String(sum_reader.digest());
+
     // files can be closed now
     gzip_in.close();
     vfs_in.close();
@@ -180,6 +221,81 @@ static Tuple get_track_ti(const char *path, const track_info_t *info, const int
     return tuple;
 }
 
+// Fills in a length measured by the background scanner if the file has
+// none, queuing the track to be measured if that hasn't happened yet.
+static void apply_scanned_length(const char *filename,
+ ConsoleFileHandler &fh, int track, track_info_t *info)
+{
+    if (info->length > 0 || !fh.m_hash)
+        return;
+
+    StringBuf key = str_printf("%s:%d", (const char *) fh.m_hash, track);
+    LengthScanResult result;
+
+    if (!length_scan_lookup(key, &result))
+        length_scan_queue(filename, key);
+    else if (result.loop > 0)
+    {
+        // played like a track with loop info of its own
+        info->intro_length = result.length - result.loop;
+        info->loop_length = result.loop;
+    }
+    else if (result.length > 0)
+        info->length = result.length;
+}
+
+void console_measure_length(const char *filename, LengthScanResult *result)
+{
+    ConsoleFileHandler fh(filename);
+    if (!fh.m_type)
+        return;
+
+    if (fh.m_track < 0)
+        fh.m_track = 0;
+
+    if (fh.load(scan_sample_rate, false) || fh.m_emu->start_track(fh.m_track))
+        return;
+
+    // run until the emulator detects lasting silence, in which case the
+    // length is the end of the last audible buffer, or until the output
+    // starts repeating itself
+    LoopDetect *loop = loop_detect_new(scan_sample_rate * 2);
+    int length = 0, loop_start, loop_length;
+
+    while (!fh.m_emu->track_ended())
+    {
+        int const buf_size = 1024;
+        Music_Emu::sample_t buf[buf_size];
+
+        if (fh.m_emu->play(buf_size, buf))
+            goto DONE;
+
+        for (int i = 0; i < buf_size; i++)
+        {
+            if (buf[i])
+            {
+                length = fh.m_emu->tell();
+                break;
+            }
+        }
+
+        if (loop_detect_feed(loop, buf, buf_size, &loop_start, &loop_length))
+        {
+            result->length = loop_start + loop_length;
+            result->loop = loop_length;
+            goto DONE;
+        }
+
+        if (fh.m_emu->tell() > scan_max_length || length_scan_cancelled())
+            goto DONE; // no end found, or the plugin is shutting down
+    }
+
+    result->length = length;
+
+DONE:
+    loop_detect_free(loop);
+}
+
 Tuple console_probe_for_tuple(const char *filename, VFSFile *fd)
 {
     ConsoleFileHandler fh(filename, fd);
@@ -187,11 +303,15 @@ Tuple console_probe_for_tuple(const char *filename, VFSFile *fd)
     if (!fh.m_type)
         return Tuple ();
 
-    if (!fh.load(gme_info_only))
+    if (!fh.load(gme_info_only, audcfg.scan_lengths))
     {
+        int track = fh.m_track < 0 ? 0 : fh.m_track;
         track_info_t info;
-        if (!log_err(fh.m_emu->track_info(&info, fh.m_track < 0 ? 0 : fh.m_track)))
+        if (!log_err(fh.m_emu->track_info(&info, track)))
+        {
+            apply_scanned_length(filename, fh, track, &info);
             return get_track_ti(fh.m_path, &info, fh.m_track);
+        }
     }
 
     return Tuple ();
@@ -220,7 +340,7 @@ bool_t console_play(const char *filename, VFSFile *file)
         sample_rate = 44100;
 
     // create emulator and load file
-    if (fh.load(sample_rate))
+    if (fh.load(sample_rate, audcfg.scan_lengths))
         return FALSE;
 
     // stereo echo depth
@@ -242,6 +362,10 @@ bool_t console_play(const char *filename, VFSFile *file)
         fh.m_emu->set_equalizer(eq);
     }
 
+    // snapshots for fast backward seeking
+    fh.m_emu->set_seek_snapshots(audcfg.snapshot_interval * 1000,
+     (long) audcfg.snapshot_memory << 20);
+
     // get info
     length = -1;
     if (!log_err(fh.m_emu->track_info(&info, fh.m_track)))
@@ -249,6 +373,8 @@ bool_t console_play(const char *filename, VFSFile *file)
         if (fh.m_type == gme_spc_type && audcfg.ignore_spc_length)
             info.length = -1;
 
+        apply_scanned_length(filename, fh, fh.m_track, &info);
+
         Tuple tuple = get_track_ti(fh.m_path, &info, fh.m_track);
         if (tuple)
         {
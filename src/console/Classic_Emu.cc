@@ -95,6 +95,18 @@ blargg_err_t Classic_Emu::start_track_( int track )
 	return 0;
 }
 
+void Classic_Emu::load_state_( byte const* )
+{
+	// sound already in buffer belongs to the abandoned timeline
+	buf->clear();
+}
+
+long Classic_Emu::samples_buffered_() const
+{
+	// whole frames are run at a time, so up to one buffer length is left over
+	return buf->samples_avail();
+}
+
 blargg_err_t Classic_Emu::play_( long count, sample_t* out )
 {
 	long remain = count;
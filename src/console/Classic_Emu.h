@@ -32,6 +32,8 @@ protected:
 	void mute_voices_( int );
 	void set_equalizer_( equalizer_t const& );
 	blargg_err_t play_( long, sample_t* );
+	void load_state_( byte const* );
+	long samples_buffered_() const;
 private:
 	Multi_Buffer* buf;
 	Multi_Buffer* stereo_buffer; // NULL if using custom buffer
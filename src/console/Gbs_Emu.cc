@@ -236,6 +236,33 @@ blargg_err_t Gbs_Emu::start_track_( int track )
 	return 0;
 }
 
+// Snapshots
+
+long Gbs_Emu::state_size_() const
+{
+	return sizeof (Gb_Cpu) + sizeof cpu_time + sizeof next_play + sizeof ram + sizeof apu;
+}
+
+void Gbs_Emu::save_state_( byte* out ) const
+{
+	save_block( &out, static_cast<Gb_Cpu const*> (this), sizeof (Gb_Cpu) );
+	save_block( &out, &cpu_time,  sizeof cpu_time );
+	save_block( &out, &next_play, sizeof next_play );
+	save_block( &out, ram,        sizeof ram );
+	save_block( &out, &apu,       sizeof apu );
+}
+
+void Gbs_Emu::load_state_( byte const* in )
+{
+	Classic_Emu::load_state_( in );
+	load_block( &in, static_cast<Gb_Cpu*> (this), sizeof (Gb_Cpu) );
+	load_block( &in, &cpu_time,  sizeof cpu_time );
+	load_block( &in, &next_play, sizeof next_play );
+	load_block( &in, ram,        sizeof ram );
+	load_block( &in, &apu,       sizeof apu );
+	update_timer(); // play_period depends on timer registers
+}
+
 blargg_err_t Gbs_Emu::run_clocks( blip_time_t& duration, int )
 {
 	cpu_time = 0;
@@ -57,6 +57,9 @@ protected:
 	void set_voice( int, Blip_Buffer*, Blip_Buffer*, Blip_Buffer* );
 	void update_eq( blip_eq_t const& );
 	void unload();
+	long state_size_() const;
+	void save_state_( byte* ) const;
+	void load_state_( byte const* );
 private:
 	// rom
 	enum { bank_size = 0x4000 };
@@ -3,6 +3,8 @@
 #include "Music_Emu.h"
 
 #include "Multi_Buffer.h"
+#include "../libemu/snappool.h"
+#include <stdlib.h>
 #include <string.h>
 
 /* Copyright (C) 2003-2006 Shay Green. This module is free software; you
@@ -45,6 +47,7 @@ void Music_Emu::unload()
 {
 	voice_count_ = 0;
 	clear_track_vars();
+	clear_snapshots();
 	Gme_File::unload();
 }
 
@@ -52,6 +55,11 @@ Music_Emu::Music_Emu()
 {
 	effects_buffer = 0;
 
+	snapshot_interval  = 0;
+	snapshot_max_bytes = 0;
+	snapshot_track     = -1;
+	snapshots          = 0;
+
 	sample_rate_ = 0;
 	mute_mask_   = 0;
 	tempo_       = 1.0;
@@ -72,7 +80,11 @@ Music_Emu::Music_Emu()
 	Music_Emu::unload(); // non-virtual
 }
 
-Music_Emu::~Music_Emu() { delete effects_buffer; }
+Music_Emu::~Music_Emu()
+{
+	clear_snapshots();
+	delete effects_buffer;
+}
 
 blargg_err_t Music_Emu::set_sample_rate( long rate )
 {
@@ -121,6 +133,7 @@ void Music_Emu::set_tempo( double t )
 	if ( t > max ) t = max;
 	tempo_ = t;
 	set_tempo_( t );
+	clear_snapshots(); // timing of emulation changed
 }
 
 void Music_Emu::post_load_()
@@ -135,6 +148,11 @@ blargg_err_t Music_Emu::start_track( int track )
 
 	int remapped = track;
 	RETURN_ERR( remap_track_( &remapped ) );
+	if ( track != snapshot_track )
+	{
+		clear_snapshots();
+		snapshot_track = track;
+	}
 	current_track_ = track;
 	RETURN_ERR( start_track_( remapped ) );
 
@@ -187,7 +205,13 @@ long Music_Emu::tell() const
 blargg_err_t Music_Emu::seek( long msec )
 {
 	blargg_long time = msec_to_samples( msec );
-	if ( time < out_time )
+	int snap_time = 0;
+	byte const* snap = 0;
+	if ( snapshots )
+		snap = (byte const*) snappool_find( snapshots, time, &snap_time );
+	if ( snap && snap_time <= time && (time < out_time || snap_time > out_time) )
+		load_snapshot( snap, snap_time );
+	else if ( time < out_time )
 		RETURN_ERR( start_track( current_track_ ) );
 	return skip( time - out_time );
 }
@@ -208,10 +232,20 @@ blargg_err_t Music_Emu::skip( long count )
 		count -= n;
 	}
 
-	if ( count && !emu_track_ended_ )
+	while ( count && !emu_track_ended_ )
 	{
-		emu_time += count;
-		end_track_if_error( skip_( count ) );
+		// stop at time of next snapshot so that it can be taken
+		long n = count;
+		if ( snapshots )
+		{
+			blargg_long next = snappool_next( snapshots, emu_time );
+			if ( next > emu_time && next - emu_time < n )
+				n = next - emu_time;
+		}
+		count -= n;
+		emu_time += n;
+		end_track_if_error( skip_( n ) );
+		check_snapshot();
 	}
 
 	if ( !(silence_count | buf_remain) ) // caught up to emulator, so update track ended
@@ -393,11 +427,84 @@ blargg_err_t Music_Emu::play( long out_count, sample_t* out )
 
 		if ( out_time > fade_start )
 			handle_fade( out_count, out );
+
+		check_snapshot();
 	}
 	out_time += out_count;
 	return 0;
 }
 
+// Seek snapshots
+
+void Music_Emu::set_seek_snapshots( long interval_msec, long max_bytes )
+{
+	require( sample_rate() ); // sample rate must be set first
+	snapshot_interval = 0;
+	if ( interval_msec > 0 && max_bytes > 0 )
+		snapshot_interval = msec_to_samples( interval_msec );
+	snapshot_max_bytes = max_bytes;
+	clear_snapshots();
+}
+
+void Music_Emu::clear_snapshots()
+{
+	if ( snapshots )
+		snappool_free( snapshots );
+	snapshots      = 0;
+	snapshot_track = -1;
+}
+
+void Music_Emu::check_snapshot()
+{
+	if ( !snapshot_interval || emu_track_ended_ )
+		return;
+
+	// the emulator may be ahead of emu_time by what it has buffered, which
+	// load_state_() discards
+	blargg_long time = emu_time + samples_buffered_();
+	if ( snapshots && !snappool_due( snapshots, time ) )
+		return;
+
+	long size = state_size_();
+	if ( !size || snapshot_max_bytes / size < 2 )
+		return; // unsupported, or not enough memory to be useful
+
+	byte* state = (byte*) malloc( size );
+	if ( !state )
+		return;
+	save_state_( state );
+
+	if ( !snapshots )
+		snapshots = snappool_new( snapshot_interval, snapshot_max_bytes, free );
+	snappool_add( snapshots, time, state, size );
+}
+
+void Music_Emu::load_snapshot( byte const* state, blargg_long time )
+{
+	load_state_( state );
+	remute_voices();
+
+	out_time         = time;
+	emu_time         = out_time;
+	emu_track_ended_ = false;
+	track_ended_     = false;
+	silence_time     = emu_time;
+	silence_count    = 0;
+	buf_remain       = 0;
+}
+
+void Music_Emu::save_block( byte** out, void const* in, long size )
+{
+	memcpy( *out, in, size );
+	*out += size;
+}
+
+void Music_Emu::load_block( byte const** in, void* out, long size )
+{
+	memcpy( out, *in, size );
+	*in += size;
+}
+
 // Gme_Info_
 
 blargg_err_t Gme_Info_::set_sample_rate_( long )            { return 0; }
@@ -6,6 +6,7 @@
 
 #include "Gme_File.h"
 class Multi_Buffer;
+struct SnapPool;
 
 struct Music_Emu : public Gme_File {
 public:
@@ -41,7 +42,8 @@ public:
 	// Number of milliseconds (1000 msec = 1 second) played since beginning of track
 	long tell() const;
 
-	// Seek to new time in track. Seeking backwards or far forward can take a while.
+	// Seek to new time in track. Seeking backwards or far forward can take a while,
+	// unless seek snapshots are enabled (see below).
 	blargg_err_t seek( long msec );
 
 	// Skip n samples
@@ -57,6 +59,13 @@ public:
 	// Disable automatic end-of-track detection and skipping of silence at beginning
 	void ignore_silence( bool disable = true );
 
+	// Keep snapshots of emulator state every 'interval_msec' of track time, using at
+	// most 'max_bytes' of memory, so that seek() resumes from the nearest earlier
+	// snapshot rather than restarting the track. Once memory runs out, every other
+	// snapshot is dropped and the interval doubled. Zero for either disables. Has no
+	// effect on emulators that don't support snapshots.
+	void set_seek_snapshots( long interval_msec, long max_bytes );
+
 	// Info for current track
 	using Gme_File::track_info;
 	blargg_err_t track_info( track_info_t* out ) const;
@@ -122,6 +131,18 @@ protected:
 	virtual blargg_err_t start_track_( int ) = 0; // tempo is set before this
 	virtual blargg_err_t play_( long count, sample_t* out ) = 0;
 	virtual blargg_err_t skip_( long count );
+
+	// Emulator state snapshots, used to speed up seeking. A snapshot is only ever
+	// loaded back into the emulator that saved it, between calls to play_(), so
+	// members can be saved as plain memory images. Returns 0 if not supported.
+	virtual long state_size_() const { return 0; }
+	virtual void save_state_( byte* out ) const { }
+	virtual void load_state_( byte const* in ) { }
+	// Number of samples already emulated but not yet returned by play_(). A
+	// snapshot saved now belongs that many samples past the time reached.
+	virtual long samples_buffered_() const { return 0; }
+	static void save_block( byte** out, void const* in, long size );
+	static void load_block( byte const** in, void* out, long size );
 protected:
 	virtual void unload();
 	virtual void pre_load();
@@ -164,6 +185,15 @@ private:
 	void fill_buf();
 	void emu_play( long count, sample_t* out );
 
+	// seek snapshots, kept in a pool shared with the other emulated formats
+	blargg_long snapshot_interval; // initial samples between snapshots, 0 if disabled
+	long snapshot_max_bytes;
+	int snapshot_track;            // track that snapshots were taken from
+	SnapPool* snapshots;           // created with the first snapshot
+	void clear_snapshots();
+	void check_snapshot();
+	void load_snapshot( byte const* state, blargg_long time );
+
 	Multi_Buffer* effects_buffer;
 	friend Music_Emu* gme_new_emu( gme_type_t, int );
 	friend void gme_set_stereo_depth( Music_Emu*, double );
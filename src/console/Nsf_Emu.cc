@@ -485,6 +485,59 @@ blargg_err_t Nsf_Emu::start_track_( int track )
 	return 0;
 }
 
+// Snapshots
+
+long Nsf_Emu::state_size_() const
+{
+	long size = sizeof (Nes_Cpu) + sizeof saved_state + sizeof next_play +
+			sizeof play_extra + sizeof play_ready + sizeof sram + sizeof apu;
+	#if !NSF_EMU_APU_ONLY
+	{
+		if ( namco ) size += sizeof *namco;
+		if ( vrc6  ) size += sizeof *vrc6;
+		if ( fme7  ) size += sizeof *fme7;
+	}
+	#endif
+	return size;
+}
+
+void Nsf_Emu::save_state_( byte* out ) const
+{
+	save_block( &out, static_cast<Nes_Cpu const*> (this), sizeof (Nes_Cpu) );
+	save_block( &out, &saved_state, sizeof saved_state );
+	save_block( &out, &next_play,   sizeof next_play );
+	save_block( &out, &play_extra,  sizeof play_extra );
+	save_block( &out, &play_ready,  sizeof play_ready );
+	save_block( &out, sram,         sizeof sram );
+	save_block( &out, &apu,         sizeof apu );
+	#if !NSF_EMU_APU_ONLY
+	{
+		if ( namco ) save_block( &out, namco, sizeof *namco );
+		if ( vrc6  ) save_block( &out, vrc6,  sizeof *vrc6 );
+		if ( fme7  ) save_block( &out, fme7,  sizeof *fme7 );
+	}
+	#endif
+}
+
+void Nsf_Emu::load_state_( byte const* in )
+{
+	Classic_Emu::load_state_( in );
+	load_block( &in, static_cast<Nes_Cpu*> (this), sizeof (Nes_Cpu) );
+	load_block( &in, &saved_state, sizeof saved_state );
+	load_block( &in, &next_play,   sizeof next_play );
+	load_block( &in, &play_extra,  sizeof play_extra );
+	load_block( &in, &play_ready,  sizeof play_ready );
+	load_block( &in, sram,         sizeof sram );
+	load_block( &in, &apu,         sizeof apu );
+	#if !NSF_EMU_APU_ONLY
+	{
+		if ( namco ) load_block( &in, namco, sizeof *namco );
+		if ( vrc6  ) load_block( &in, vrc6,  sizeof *vrc6 );
+		if ( fme7  ) load_block( &in, fme7,  sizeof *fme7 );
+	}
+	#endif
+}
+
 blargg_err_t Nsf_Emu::run_clocks( blip_time_t& duration, int )
 {
 	set_time( 0 );
@@ -61,6 +61,9 @@ protected:
 	void set_voice( int, Blip_Buffer*, Blip_Buffer*, Blip_Buffer* );
 	void update_eq( blip_eq_t const& );
 	void unload();
+	long state_size_() const;
+	void save_state_( byte* ) const;
+	void load_state_( byte const* );
 protected:
 	enum { bank_count = 8 };
 	byte initial_banks [bank_count];
@@ -302,6 +302,32 @@ blargg_err_t Spc_Emu::start_track_( int track )
 	return 0;
 }
 
+// Snapshots
+
+long Spc_Emu::state_size_() const
+{
+	return sizeof apu;
+}
+
+void Spc_Emu::save_state_( byte* out ) const
+{
+	save_block( &out, &apu, sizeof apu );
+}
+
+void Spc_Emu::load_state_( byte const* in )
+{
+	load_block( &in, &apu, sizeof apu );
+	resampler.clear();
+	filter.clear();
+}
+
+long Spc_Emu::samples_buffered_() const
+{
+	if ( sample_rate() == native_sample_rate )
+		return 0;
+	return resampler.avail();
+}
+
 blargg_err_t Spc_Emu::play_and_filter( long count, sample_t out [] )
 {
 	RETURN_ERR( apu.play( count, out ) );
@@ -67,6 +67,10 @@ protected:
 	void mute_voices_( int );
 	void set_tempo_( double );
 	void enable_accuracy_( bool );
+	long state_size_() const;
+	void save_state_( byte* ) const;
+	void load_state_( byte const* );
+	long samples_buffered_() const;
 private:
 	byte const* file_data;
 	long        file_size;
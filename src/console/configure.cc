@@ -25,6 +25,9 @@ static const char * const console_defaults[] = {
  "ignore_spc_length", "FALSE",
  "echo", "0",
  "inc_spc_reverb", "FALSE",
+ "snapshot_interval", "10",
+ "snapshot_memory", "32",
+ "scan_lengths", "FALSE",
  NULL};
 
 bool_t console_cfg_load (void)
@@ -39,6 +42,9 @@ bool_t console_cfg_load (void)
     audcfg.ignore_spc_length = aud_get_bool (CON_CFGID, "ignore_spc_length");
     audcfg.echo = aud_get_int (CON_CFGID, "echo");
     audcfg.inc_spc_reverb = aud_get_bool (CON_CFGID, "inc_spc_reverb");
+    audcfg.snapshot_interval = aud_get_int (CON_CFGID, "snapshot_interval");
+    audcfg.snapshot_memory = aud_get_int (CON_CFGID, "snapshot_memory");
+    audcfg.scan_lengths = aud_get_bool (CON_CFGID, "scan_lengths");
 
     return TRUE;
 }
@@ -53,4 +59,7 @@ void console_cfg_save (void)
     aud_set_bool (CON_CFGID, "ignore_spc_length", audcfg.ignore_spc_length);
     aud_set_int (CON_CFGID, "echo", audcfg.echo);
     aud_set_bool (CON_CFGID, "inc_spc_reverb", audcfg.inc_spc_reverb);
+    aud_set_int (CON_CFGID, "snapshot_interval", audcfg.snapshot_interval);
+    aud_set_int (CON_CFGID, "snapshot_memory", audcfg.snapshot_memory);
+    aud_set_bool (CON_CFGID, "scan_lengths", audcfg.scan_lengths);
 }
@@ -20,6 +20,9 @@ typedef struct {
 	bool_t ignore_spc_length; /* if true, ignore length from SPC tags */
 	int echo;                  /* 0 to +100 */
 	bool_t inc_spc_reverb;    /* if true, increases the default reverb */
+	int snapshot_interval;     /* seconds between seek snapshots, 0 to disable */
+	int snapshot_memory;       /* maximum memory for seek snapshots, in MB */
+	bool_t scan_lengths;      /* if true, measure untagged tracks in background */
 } AudaciousConsoleConfig;
 
 extern AudaciousConsoleConfig audcfg;
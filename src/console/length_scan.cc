@@ -0,0 +1,226 @@
+/*
+ * Audacious: Cross platform multimedia player
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Background length detection for tracks without timing information.
+ *
+ * Tracks are measured by a small pool of worker threads (one per CPU core,
+ * started on demand) so that neither probing nor playback ever waits for an
+ * emulator to run.  Results are kept in a cache file in the user's config
+ * directory, keyed by a hash of the file contents and the track number, so
+ * that renamed or duplicated files are not measured twice.
+ *
+ * Each line of the cache holds a key, a length and a loop length.  Lines
+ * without a loop length come from before loops were detected; those that
+ * found no end are ignored, so that the track is measured again.
+ */
+
+#include "length_scan.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include <libaudcore/playlist.h>
+#include <libaudcore/runtime.h>
+
+#define MAX_WORKERS 16
+
+struct ScanJob {
+    char * filename;
+    char * key;
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond = PTHREAD_COND_INITIALIZER;
+
+static LengthScanFunc scan_func;
+static GHashTable * cache;    /* key -> LengthScanResult */
+static GHashTable * pending;  /* keys queued or being measured */
+static GQueue queue = G_QUEUE_INIT;
+
+static pthread_t workers[MAX_WORKERS];
+static int n_workers, max_workers;
+static int quit;              /* read without the mutex by length_scan_cancelled () */
+
+static char * get_cache_path (void)
+{
+    return g_build_filename (aud_get_path (AUD_PATH_USER_DIR), "console-lengths", NULL);
+}
+
+static void load_cache (void)
+{
+    char * path = get_cache_path ();
+    FILE * file = fopen (path, "r");
+    g_free (path);
+
+    if (! file)
+        return;
+
+    char line[256];
+    while (fgets (line, sizeof line, file))
+    {
+        char * sep = strchr (line, ' ');
+        if (! sep)
+            continue;
+
+        * sep = 0;
+
+        LengthScanResult result = {0, 0};
+        int fields = sscanf (sep + 1, "%d %d", & result.length, & result.loop);
+
+        if (fields == 2 || (fields == 1 && result.length > 0))
+            g_hash_table_insert (cache, g_strdup (line),
+             g_memdup (& result, sizeof result));
+    }
+
+    fclose (file);
+}
+
+/* called with mutex locked */
+static void save_result (const char * key, const LengthScanResult * result)
+{
+    g_hash_table_insert (cache, g_strdup (key), g_memdup (result, sizeof * result));
+
+    char * path = get_cache_path ();
+    FILE * file = fopen (path, "a");
+    g_free (path);
+
+    if (! file)
+        return;
+
+    fprintf (file, "%s %d %d\n", key, result->length, result->loop);
+    fclose (file);
+}
+
+static void * worker (void *)
+{
+    pthread_mutex_lock (& mutex);
+
+    while (! quit)
+    {
+        ScanJob * job = (ScanJob *) g_queue_pop_head (& queue);
+
+        if (! job)
+        {
+            pthread_cond_wait (& cond, & mutex);
+            continue;
+        }
+
+        pthread_mutex_unlock (& mutex);
+        LengthScanResult result = {0, 0};
+        scan_func (job->filename, & result);
+        pthread_mutex_lock (& mutex);
+
+        g_hash_table_remove (pending, job->key);
+
+        if (! quit)
+        {
+            save_result (job->key, & result);
+
+            if (result.length > 0)
+            {
+                pthread_mutex_unlock (& mutex);
+                aud_playlist_rescan_file (job->filename);
+                pthread_mutex_lock (& mutex);
+            }
+        }
+
+        g_free (job->filename);
+        g_free (job->key);
+        g_slice_free (ScanJob, job);
+    }
+
+    pthread_mutex_unlock (& mutex);
+    return NULL;
+}
+
+void length_scan_init (LengthScanFunc func)
+{
+    pthread_mutex_lock (& mutex);
+
+    scan_func = func;
+    cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    pending = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    g_atomic_int_set (& quit, FALSE);
+
+    max_workers = CLAMP ((int) sysconf (_SC_NPROCESSORS_ONLN), 1, MAX_WORKERS);
+
+    load_cache ();
+
+    pthread_mutex_unlock (& mutex);
+}
+
+void length_scan_cleanup (void)
+{
+    pthread_mutex_lock (& mutex);
+
+    ScanJob * job;
+    while ((job = (ScanJob *) g_queue_pop_head (& queue)))
+    {
+        g_free (job->filename);
+        g_free (job->key);
+        g_slice_free (ScanJob, job);
+    }
+
+    g_atomic_int_set (& quit, TRUE);
+    pthread_cond_broadcast (& cond);
+    pthread_mutex_unlock (& mutex);
+
+    for (int i = 0; i < n_workers; i ++)
+        pthread_join (workers[i], NULL);
+
+    n_workers = 0;
+
+    g_hash_table_destroy (cache);
+    g_hash_table_destroy (pending);
+    cache = pending = NULL;
+}
+
+bool_t length_scan_cancelled (void)
+{
+    return g_atomic_int_get (& quit);
+}
+
+bool_t length_scan_lookup (const char * key, LengthScanResult * result)
+{
+    pthread_mutex_lock (& mutex);
+
+    LengthScanResult * found = cache ?
+     (LengthScanResult *) g_hash_table_lookup (cache, key) : NULL;
+    if (found)
+        * result = * found;
+
+    pthread_mutex_unlock (& mutex);
+
+    return found != NULL;
+}
+
+void length_scan_queue (const char * filename, const char * key)
+{
+    pthread_mutex_lock (& mutex);
+
+    if (cache && ! quit && ! g_hash_table_contains (cache, key) &&
+     ! g_hash_table_contains (pending, key))
+    {
+        ScanJob * job = g_slice_new (ScanJob);
+        job->filename = g_strdup (filename);
+        job->key = g_strdup (key);
+
+        g_hash_table_add (pending, g_strdup (key));
+        g_queue_push_tail (& queue, job);
+
+        /* workers are started on demand, up to one per core */
+        if (n_workers < max_workers && ! pthread_create (& workers[n_workers],
+         NULL, worker, NULL))
+            n_workers ++;
+
+        pthread_cond_signal (& cond);
+    }
+
+    pthread_mutex_unlock (& mutex);
+}
@@ -0,0 +1,46 @@
+/*
+ * Audacious: Cross platform multimedia player
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Background length detection for tracks without timing information.
+ */
+
+#ifndef AUD_CONSOLE_LENGTH_SCAN_H
+#define AUD_CONSOLE_LENGTH_SCAN_H 1
+
+#include <libaudcore/core.h>
+
+/* Lengths in milliseconds.  A track that ends has its length in <length> and
+ * 0 in <loop>.  For a track that loops, <length> runs to the end of the first
+ * pass through the loop, which is <loop> long.  If neither was found (or the
+ * track could not be emulated), both are 0. */
+typedef struct {
+    int length;
+    int loop;
+} LengthScanResult;
+
+/* Emulates the given track faster than real time and fills in <result>,
+ * which starts out zeroed.  Called from the worker threads, so it must not
+ * touch any shared state.  It should check length_scan_cancelled ()
+ * regularly and give up once that returns TRUE. */
+typedef void (* LengthScanFunc) (const char * filename, LengthScanResult * result);
+
+/* Loads the length cache and sets the function used to measure tracks. */
+void length_scan_init (LengthScanFunc func);
+
+/* Cancels pending scans, waits for the workers to exit and frees the cache. */
+void length_scan_cleanup (void);
+
+/* Whether length_scan_cleanup () has been called; safe from any thread. */
+bool_t length_scan_cancelled (void);
+
+/* Looks up the result cached for the given content key.  Returns FALSE if the
+ * track has not been measured yet. */
+bool_t length_scan_lookup (const char * key, LengthScanResult * result);
+
+/* Queues a track to be measured in the background.  When the result is in,
+ * the file is rescanned so that the playlist picks up the new length.  Does
+ * nothing if the key is already cached or queued. */
+void length_scan_queue (const char * filename, const char * key);
+
+#endif /* AUD_CONSOLE_LENGTH_SCAN_H */
@@ -0,0 +1,169 @@
+/*
+ * Audacious: Cross platform multimedia player
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Detection of looping tracks by their output.
+ *
+ * Each chunk of output is hashed, and the first chunk seen with each hash is
+ * remembered.  When a chunk repeats one from at least MIN_PERIOD seconds
+ * before, the chunks following both are compared one by one until they
+ * differ or the repeat is long enough to be believed.  Chunk boundaries
+ * depend only on the last few samples, so they fall at the same places in
+ * each pass through a loop.
+ */
+
+#include "loop_detect.h"
+
+#include <glib.h>
+
+/* A chunk ends where the low bits of a rolling hash are zero, which gives
+ * chunks of about 1500 samples, within these limits. */
+#define MIN_CHUNK 512
+#define MAX_CHUNK 16384
+#define CUT_MASK 0x3ff
+
+/* shortest loop looked for, in seconds */
+#define MIN_PERIOD 1
+
+#define FNV_BASIS 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+struct Chunk {
+    uint64_t hash;
+    int64_t start;
+    int len;
+    bool_t silent;
+};
+
+struct LoopDetect {
+    int rate;
+    uint64_t roll;          /* decides where chunks end */
+    uint64_t hash;          /* of the current chunk */
+    bool_t silent;          /* current chunk is all zeros so far */
+    int64_t pos;            /* samples fed so far */
+    int64_t chunk_start;
+
+    GArray * chunks;
+    GHashTable * first;     /* folded hash -> index + 1 of the first chunk with it */
+
+    int match;              /* earlier chunk matching the last one, or -1 */
+    int64_t match_start;    /* start of the earlier run of matching chunks */
+    int64_t run_start;      /* start of the later one */
+
+    bool_t found;
+    int found_start, found_length;
+};
+
+static inline uint64_t scramble (uint64_t x)
+{
+    x *= 0x9e3779b97f4a7c15ull;
+    return x ^ (x >> 29);
+}
+
+LoopDetect * loop_detect_new (int rate)
+{
+    LoopDetect * ld = g_slice_new0 (LoopDetect);
+
+    ld->rate = rate;
+    ld->hash = FNV_BASIS;
+    ld->silent = TRUE;
+    ld->chunks = g_array_new (FALSE, FALSE, sizeof (Chunk));
+    ld->first = g_hash_table_new (g_direct_hash, g_direct_equal);
+    ld->match = -1;
+
+    return ld;
+}
+
+void loop_detect_free (LoopDetect * ld)
+{
+    g_array_free (ld->chunks, TRUE);
+    g_hash_table_destroy (ld->first);
+    g_slice_free (LoopDetect, ld);
+}
+
+static void end_chunk (LoopDetect * ld, int len)
+{
+    Chunk c = {ld->hash ^ scramble (len), ld->chunk_start, len, ld->silent};
+    int i = ld->chunks->len;
+
+    g_array_append_val (ld->chunks, c);
+
+    if (ld->match >= 0 && ld->match + 1 < i)
+    {
+        Chunk * m = & g_array_index (ld->chunks, Chunk, ld->match + 1);
+
+        if (m->hash == c.hash && m->len == c.len)
+        {
+            ld->match ++;
+
+            int64_t period = ld->run_start - ld->match_start;
+            int64_t repeated = c.start + c.len - ld->run_start;
+
+            if (repeated >= MAX (period, (int64_t) ld->rate * LOOP_DETECT_CONFIRM))
+            {
+                ld->found = TRUE;
+                ld->found_start = ld->match_start * 1000 / ld->rate;
+                ld->found_length = period * 1000 / ld->rate;
+            }
+
+            return;
+        }
+    }
+
+    ld->match = -1;
+
+    /* silence repeats without being a loop */
+    if (c.silent)
+        return;
+
+    void * key = GSIZE_TO_POINTER ((gsize) (c.hash ^ (c.hash >> 32)));
+    int j = GPOINTER_TO_INT (g_hash_table_lookup (ld->first, key)) - 1;
+
+    if (j < 0)
+    {
+        g_hash_table_insert (ld->first, key, GINT_TO_POINTER (i + 1));
+        return;
+    }
+
+    Chunk * e = & g_array_index (ld->chunks, Chunk, j);
+
+    if (e->hash == c.hash && e->len == c.len &&
+     c.start - e->start >= (int64_t) ld->rate * MIN_PERIOD)
+    {
+        ld->match = j;
+        ld->match_start = e->start;
+        ld->run_start = c.start;
+    }
+}
+
+bool_t loop_detect_feed (LoopDetect * ld, const int16_t * data, int samples,
+ int * start, int * length)
+{
+    for (int n = 0; n < samples && ! ld->found; n ++)
+    {
+        uint16_t s = data[n];
+
+        ld->roll = (ld->roll << 1) + scramble (s);
+        ld->hash = (ld->hash ^ s) * FNV_PRIME;
+        ld->silent = ld->silent && ! s;
+        ld->pos ++;
+
+        int len = ld->pos - ld->chunk_start;
+
+        if (len >= MIN_CHUNK && (! (ld->roll & CUT_MASK) || len >= MAX_CHUNK))
+        {
+            end_chunk (ld, len);
+
+            ld->chunk_start = ld->pos;
+            ld->hash = FNV_BASIS;
+            ld->silent = TRUE;
+        }
+    }
+
+    if (! ld->found)
+        return FALSE;
+
+    * start = ld->found_start;
+    * length = ld->found_length;
+    return TRUE;
+}
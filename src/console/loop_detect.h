@@ -0,0 +1,36 @@
+/*
+ * Audacious: Cross platform multimedia player
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Detection of looping tracks by their output.
+ */
+
+#ifndef AUD_CONSOLE_LOOP_DETECT_H
+#define AUD_CONSOLE_LOOP_DETECT_H 1
+
+#include <stdint.h>
+
+#include <libaudcore/core.h>
+
+/* Watches the output of an emulator for a stretch that repeats exactly what
+ * came before it.  The output is cut into chunks at points chosen by its
+ * content, so that a repeat is found wherever the loop happens to start, and
+ * a loop counts as found once it has repeated for at least its own length
+ * and at least LOOP_DETECT_CONFIRM seconds.  Emulators whose output is not
+ * exactly the same on each pass (a free-running noise generator, for
+ * example) are not caught. */
+#define LOOP_DETECT_CONFIRM 40
+
+typedef struct LoopDetect LoopDetect;
+
+/* <rate> is in samples (not frames) per second. */
+LoopDetect * loop_detect_new (int rate);
+void loop_detect_free (LoopDetect * ld);
+
+/* Feeds the next block of output.  Returns TRUE once a loop has been found;
+ * then <start> and <length> are set to where the first pass through the loop
+ * begins and how long it is, in milliseconds. */
+bool_t loop_detect_feed (LoopDetect * ld, const int16_t * data, int samples,
+ int * start, int * length);
+
+#endif /* AUD_CONSOLE_LOOP_DETECT_H */
@@ -11,9 +11,11 @@
 #include <libaudcore/preferences.h>
 
 #include "configure.h"
+#include "length_scan.h"
 
 Tuple console_probe_for_tuple(const char *filename, VFSFile *fd);
 bool_t console_play(const char *filename, VFSFile *file);
+void console_measure_length(const char *filename, LengthScanResult *result);
 
 static const char console_about[] =
  N_("Console music decoder engine based on Game_Music_Emu 0.5.2\n"
@@ -43,6 +45,8 @@ static const PreferencesWidget console_widgets[] = {
     WidgetSpin (N_("Default song length:"),
         {VALUE_INT, & audcfg.loop_length},
         {-100, 100, 1, N_("seconds")}),
+    WidgetCheck (N_("Detect length of untagged songs in background"),
+        {VALUE_BOOLEAN, & audcfg.scan_lengths}),
     WidgetLabel (N_("<b>Resampling</b>")),
     WidgetCheck (N_("Enable audio resampling"),
         {VALUE_BOOLEAN, & audcfg.resample}),
@@ -54,7 +58,14 @@ static const PreferencesWidget console_widgets[] = {
     WidgetCheck (N_("Ignore length from SPC tags"),
         {VALUE_BOOLEAN, & audcfg.ignore_spc_length}),
     WidgetCheck (N_("Increase reverb"),
-        {VALUE_BOOLEAN, & audcfg.inc_spc_reverb})
+        {VALUE_BOOLEAN, & audcfg.inc_spc_reverb}),
+    WidgetLabel (N_("<b>Seeking</b>")),
+    WidgetSpin (N_("Snapshot interval:"),
+        {VALUE_INT, & audcfg.snapshot_interval},
+        {0, 60, 1, N_("seconds")}),
+    WidgetSpin (N_("Snapshot memory:"),
+        {VALUE_INT, & audcfg.snapshot_memory},
+        {1, 512, 1, N_("MB")})
 };
 
 static const PluginPreferences console_prefs = {
@@ -62,10 +73,23 @@ static const PluginPreferences console_prefs = {
     ARRAY_LEN (console_widgets)
 };
 
+static bool_t console_init (void)
+{
+    console_cfg_load ();
+    length_scan_init (console_measure_length);
+    return TRUE;
+}
+
+static void console_cleanup (void)
+{
+    length_scan_cleanup ();
+    console_cfg_save ();
+}
+
 #define AUD_PLUGIN_NAME        N_("Game Console Music Decoder")
 #define AUD_PLUGIN_ABOUT       console_about
-#define AUD_PLUGIN_INIT        console_cfg_load
-#define AUD_PLUGIN_CLEANUP     console_cfg_save
+#define AUD_PLUGIN_INIT        console_init
+#define AUD_PLUGIN_CLEANUP     console_cleanup
 #define AUD_PLUGIN_PREFS       & console_prefs
 #define AUD_INPUT_IS_OUR_FILE  NULL
 #define AUD_INPUT_PLAY         console_play
@@ -17,6 +17,7 @@
  * the use of this software.
  */
 
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -28,6 +29,8 @@
 #include <libaudcore/preferences.h>
 #include <libaudcore/runtime.h>
 
+#include "../libdsp/dsp.h"
+
 enum
 {
     STATE_OFF,
@@ -37,17 +40,40 @@ enum
     STATE_STOPPING,
 };
 
+enum
+{
+    CURVE_LINEAR,
+    CURVE_EQUAL_POWER,
+    CURVE_LOGARITHMIC,
+    CURVE_S_CURVE,
+    CURVE_COUNT
+};
+
+/* gain curves are tabulated at this many steps and interpolated linearly */
+#define CURVE_STEPS 1024
+
+/* anything quieter than -60 dB counts as silence */
+#define SILENCE_LEVEL 0.001f
+
 static const char * const crossfade_defaults[] = {
  "length", "3",
+ "curve", "0",
+ "skip_silence", "FALSE",
  NULL};
 
 static char state = STATE_OFF;
 static int current_channels = 0, current_rate = 0;
-static float * buffer = NULL;
-static int buffer_size = 0, buffer_filled = 0;
+static float * buffer = NULL; /* ring buffer */
+static int buffer_size = 0, buffer_start = 0, buffer_filled = 0;
 static int prebuffer_filled = 0;
 static float * output = NULL;
 static int output_size = 0;
+static int silence_skipped = 0;
+static int audible_overlap = 0; /* audible length of the previous song's fade */
+
+/* fade-in gain at each step from 0 to 1; fading out reads the table backward */
+static float curve_tables[CURVE_COUNT][CURVE_STEPS + 1];
+static const float * curve = NULL;
 
 static void reset (void)
 {
@@ -57,16 +83,36 @@ static void reset (void)
     g_free (buffer);
     buffer = NULL;
     buffer_size = 0;
+    buffer_start = 0;
     buffer_filled = 0;
     prebuffer_filled = 0;
     g_free (output);
     output = NULL;
     output_size = 0;
+    silence_skipped = 0;
+    audible_overlap = 0;
+}
+
+static void make_curves (void)
+{
+    for (int i = 0; i <= CURVE_STEPS; i ++)
+    {
+        double x = (double) i / CURVE_STEPS;
+
+        curve_tables[CURVE_LINEAR][i] = x;
+        /* sin² + cos² = 1: the summed power stays constant through the overlap */
+        curve_tables[CURVE_EQUAL_POWER][i] = sin (x * M_PI / 2);
+        /* linear in dB over a 60 dB range, then pulled down to reach zero */
+        curve_tables[CURVE_LOGARITHMIC][i] = (pow (1000, x) - 1) / 999;
+        curve_tables[CURVE_S_CURVE][i] = (1 - cos (x * M_PI)) / 2;
+    }
 }
 
 static bool_t crossfade_init (void)
 {
     aud_config_set_defaults ("crossfade", crossfade_defaults);
+    dsp_init ();
+    make_curves ();
     return TRUE;
 }
 
@@ -94,44 +140,203 @@ static void crossfade_start (int * channels, int * rate)
         reset ();
     }
 
+    int type = aud_get_int ("crossfade", "curve");
+    curve = curve_tables[(type >= 0 && type < CURVE_COUNT) ? type : CURVE_LINEAR];
+
     state = STATE_PREBUFFER;
     current_channels = * channels;
     current_rate = * rate;
     prebuffer_filled = 0;
+    silence_skipped = 0;
+}
+
+static float curve_at (float pos)
+{
+    float x = CLAMP (pos, 0.0f, 1.0f) * CURVE_STEPS;
+    int i = MIN ((int) x, CURVE_STEPS - 1);
+    return curve[i] + (curve[i + 1] - curve[i]) * (x - i);
+}
+
+/* Like dsp_ramp(), but following the gain curve from position a to position b.
+ * The curve is linear between table steps, so the range is split at each step
+ * and each piece is handed to the (vectorized) linear ramp. */
+static void do_curve (float * data, int length, float a, float b)
+{
+    if (curve == curve_tables[CURVE_LINEAR] || a == b)
+    {
+        dsp_ramp (data, length, curve_at (a), curve_at (b));
+        return;
+    }
+
+    int done = 0;
+    float gain = curve_at (a);
+
+    while (done < length)
+    {
+        float x = (a + (b - a) * done / length) * CURVE_STEPS;
+        float step = (b > a) ? floorf (x) + 1 : ceilf (x) - 1;
+        int end = ceilf ((step / CURVE_STEPS - a) / (b - a) * length);
+        end = CLAMP (end, done + 1, length);
+
+        float next = curve_at (a + (b - a) * end / length);
+        dsp_ramp (data + done, end - done, gain, next);
+
+        gain = next;
+        done = end;
+    }
+}
+
+static int frames_to_samples (int samples)
+{
+    return samples - samples % current_channels;
+}
+
+static int leading_silence (const float * data, int length)
+{
+    int count = 0;
+    while (count < length && fabsf (data[count]) < SILENCE_LEVEL)
+        count ++;
+
+    return frames_to_samples (count);
+}
+
+/* The buffer is a ring, so that returning data never moves what remains.
+ * Positions passed to the ring_* functions are relative to the oldest sample;
+ * each operation is split into at most two contiguous pieces. */
+
+static float * ring_at (int pos)
+{
+    pos += buffer_start;
+    return buffer + (pos < buffer_size ? pos : pos - buffer_size);
+}
+
+static int ring_contig (int pos, int length)
+{
+    pos += buffer_start;
+    if (pos >= buffer_size)
+        pos -= buffer_size;
+    return MIN (length, buffer_size - pos);
+}
+
+static void ring_zero (int pos, int length)
+{
+    while (length)
+    {
+        int part = ring_contig (pos, length);
+        memset (ring_at (pos), 0, sizeof (float) * part);
+        pos += part;
+        length -= part;
+    }
 }
 
-static void do_ramp (float * data, int length, float a, float b)
+static void ring_write (int pos, const float * data, int length)
 {
-    int count;
+    while (length)
+    {
+        int part = ring_contig (pos, length);
+        memcpy (ring_at (pos), data, sizeof (float) * part);
+        pos += part;
+        data += part;
+        length -= part;
+    }
+}
 
-    for (count = 0; count < length; count ++)
+static void ring_read (int pos, float * data, int length)
+{
+    while (length)
     {
-        * data = (* data) * (a * (length - count) + b * count) / length;
-        data ++;
+        int part = ring_contig (pos, length);
+        memcpy (data, ring_at (pos), sizeof (float) * part);
+        pos += part;
+        data += part;
+        length -= part;
     }
 }
 
-static void mix (float * data, float * add, int length)
+static void ring_mix (int pos, const float * add, int length)
 {
-    while (length --)
-        (* data ++) += (* add ++);
+    while (length)
+    {
+        int part = ring_contig (pos, length);
+        dsp_mix (ring_at (pos), add, part);
+        pos += part;
+        add += part;
+        length -= part;
+    }
+}
+
+static void ring_ramp (int pos, int length, float a, float b)
+{
+    int total = length;
+
+    while (length)
+    {
+        int part = ring_contig (pos, length);
+        float mid = a + (b - a) * (total - length + part) / total;
+        do_curve (ring_at (pos), part, a, mid);
+        a = mid;
+        pos += part;
+        length -= part;
+    }
+}
+
+static void ring_consume (int length)
+{
+    buffer_start += length;
+    if (buffer_start >= buffer_size)
+        buffer_start -= buffer_size;
+    buffer_filled -= length;
 }
 
 static void enlarge_buffer (int length)
 {
     if (length > buffer_size)
     {
-        buffer = g_renew (float, buffer, length);
-        buffer_size = length;
+        /* grow geometrically, unwrapping the contents to the new start */
+        int new_size = MAX (length, buffer_size * 2);
+        float * new_buffer = g_new (float, new_size);
+
+        ring_read (0, new_buffer, buffer_filled);
+        g_free (buffer);
+
+        buffer = new_buffer;
+        buffer_size = new_size;
+        buffer_start = 0;
     }
 }
 
+static int ring_trailing_silence (void)
+{
+    int count = 0;
+    while (count < buffer_filled && fabsf (* ring_at (buffer_filled - 1 - count)) < SILENCE_LEVEL)
+        count ++;
+
+    return frames_to_samples (count);
+}
+
 static void add_data (float * data, int length)
 {
     if (state == STATE_PREBUFFER)
     {
         int full = current_channels * current_rate * aud_get_int ("crossfade", "length");
 
+        /* match the fade-in to the audible part of the fade-out */
+        if (audible_overlap > 0 && audible_overlap < full)
+            full = audible_overlap;
+
+        /* start fading in at the first audible sample, but never drop more
+         * than one overlap's worth of the new song */
+        if (! prebuffer_filled && aud_get_bool ("crossfade", "skip_silence"))
+        {
+            int skip = leading_silence (data, MIN (length, full - silence_skipped));
+            silence_skipped += skip;
+            data += skip;
+            length -= skip;
+
+            if (! length)
+                return;
+        }
+
         if (prebuffer_filled < full)
         {
             int copy = MIN (length, full - prebuffer_filled);
@@ -141,13 +346,12 @@ static void add_data (float * data, int length)
             if (prebuffer_filled + copy > buffer_filled)
             {
                 enlarge_buffer (prebuffer_filled + copy);
-                memset (buffer + buffer_filled, 0, sizeof (float) *
-                 (prebuffer_filled + copy - buffer_filled));
+                ring_zero (buffer_filled, prebuffer_filled + copy - buffer_filled);
                 buffer_filled = prebuffer_filled + copy;
             }
 
-            do_ramp (data, copy, a, b);
-            mix (buffer + prebuffer_filled, data, copy);
+            do_curve (data, copy, a, b);
+            ring_mix (prebuffer_filled, data, copy);
             prebuffer_filled += copy;
             data += copy;
             length -= copy;
@@ -160,7 +364,7 @@ static void add_data (float * data, int length)
         {
             int copy = MIN (length, buffer_filled - prebuffer_filled);
 
-            mix (buffer + prebuffer_filled, data, copy);
+            ring_mix (prebuffer_filled, data, copy);
             prebuffer_filled += copy;
             data += copy;
             length -= copy;
@@ -176,7 +380,7 @@ static void add_data (float * data, int length)
         return;
 
     enlarge_buffer (buffer_filled + length);
-    memcpy (buffer + buffer_filled, data, sizeof (float) * length);
+    ring_write (buffer_filled, data, length);
     buffer_filled += length;
 }
 
@@ -194,8 +398,7 @@ static void return_data (float * * data, int * length)
     int full = current_channels * current_rate * aud_get_int ("crossfade", "length");
     int copy = buffer_filled - full;
 
-    /* only return if we have at least 1/2 second -- this reduces memmove's */
-    if (state != STATE_RUNNING || copy < current_channels * (current_rate / 2))
+    if (state != STATE_RUNNING || copy <= 0)
     {
         * data = NULL;
         * length = 0;
@@ -203,9 +406,8 @@ static void return_data (float * * data, int * length)
     }
 
     enlarge_output (copy);
-    memcpy (output, buffer, sizeof (float) * copy);
-    buffer_filled -= copy;
-    memmove (buffer, buffer + copy, sizeof (float) * buffer_filled);
+    ring_read (0, output, copy);
+    ring_consume (copy);
     * data = output;
     * length = copy;
 }
@@ -221,6 +423,7 @@ static void crossfade_flush (void)
     if (state == STATE_PREBUFFER || state == STATE_RUNNING)
     {
         state = STATE_RUNNING;
+        buffer_start = 0;
         buffer_filled = 0;
     }
 }
@@ -230,9 +433,10 @@ static void crossfade_finish (float * * data, int * samples)
     if (state == STATE_BETWEEN) /* second call, end of last song */
     {
         enlarge_output (buffer_filled);
-        memcpy (output, buffer, sizeof (float) * buffer_filled);
+        ring_read (0, output, buffer_filled);
         * data = output;
         * samples = buffer_filled;
+        buffer_start = 0;
         buffer_filled = 0;
         state = STATE_OFF;
         return;
@@ -243,7 +447,16 @@ static void crossfade_finish (float * * data, int * samples)
 
     if (state == STATE_PREBUFFER || state == STATE_RUNNING)
     {
-        do_ramp (buffer, buffer_filled, 1.0, 0.0);
+        /* fade out over audible content only; the next song then overlaps
+         * from where the sound actually ends */
+        audible_overlap = 0;
+        if (aud_get_bool ("crossfade", "skip_silence"))
+        {
+            buffer_filled -= ring_trailing_silence ();
+            audible_overlap = buffer_filled;
+        }
+
+        ring_ramp (0, buffer_filled, 1.0, 0.0);
         state = STATE_BETWEEN;
     }
 }
@@ -257,11 +470,22 @@ static const char crossfade_about[] =
  N_("Crossfade Plugin for Audacious\n"
     "Copyright 2010-2012 John Lindgren");
 
+static const ComboBoxElements curve_list[] = {
+ {"0", N_("Linear")},
+ {"1", N_("Equal power")},
+ {"2", N_("Logarithmic")},
+ {"3", N_("S-curve")}};
+
 static const PreferencesWidget crossfade_widgets[] = {
     WidgetLabel (N_("<b>Crossfade</b>")),
     WidgetSpin (N_("Overlap:"),
         {VALUE_INT, 0, "crossfade", "length"},
-        {1, 10, 1, N_("seconds")})
+        {1, 10, 1, N_("seconds")}),
+    WidgetCombo (N_("Curve:"),
+        {VALUE_STRING, 0, "crossfade", "curve"},
+        {curve_list, ARRAY_LEN (curve_list)}),
+    WidgetCheck (N_("Overlap audible content only (skip silence)"),
+        {VALUE_BOOLEAN, 0, "crossfade", "skip_silence"})
 };
 
 static const PluginPreferences crossfade_prefs = {
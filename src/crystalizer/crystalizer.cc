@@ -26,6 +26,8 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/preferences.h>
 
+#include "../libdsp/dsp.h"
+
 static bool_t init (void);
 static void cryst_start (int * channels, int * rate);
 static void cryst_process (float * * data, int * samples);
@@ -66,6 +68,7 @@ static float * cryst_prev;
 static bool_t init (void)
 {
     aud_config_set_defaults ("crystalizer", cryst_defaults);
+    dsp_init ();
     return TRUE;
 }
 
@@ -79,20 +82,8 @@ static void cryst_start (int * channels, int * rate)
 static void cryst_process (float * * data, int * samples)
 {
     float value = aud_get_double ("crystalizer", "intensity");
-    float * f = * data;
-    float * end = f + (* samples);
-    int channel;
-
-    while (f < end)
-    {
-        for (channel = 0; channel < cryst_channels; channel ++)
-        {
-            float current = * f;
-
-            * f ++ = current + (current - cryst_prev[channel]) * value;
-            cryst_prev[channel] = current;
-        }
-    }
+
+    dsp_emphasis (* data, * samples, cryst_channels, cryst_prev, value);
 }
 
 static void cryst_flush ()
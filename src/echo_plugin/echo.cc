@@ -8,6 +8,8 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/preferences.h>
 
+#include "../libdsp/dsp.h"
+
 #define MAX_DELAY 1000
 #define MAX_SRATE 50000
 #define BYTES_PS sizeof(float)
@@ -45,6 +47,7 @@ static int w_ofs;
 static bool_t init (void)
 {
     aud_config_set_defaults ("echo_plugin", echo_defaults);
+    dsp_init ();
     return TRUE;
 }
 
@@ -82,28 +85,33 @@ static void echo_process(float **d, int *samples)
     int feedback = aud_get_int ("echo_plugin", "feedback");
     int volume = aud_get_int ("echo_plugin", "volume");
 
-    float in, out, buf;
-    int r_ofs;
+    int r_ofs, distance;
     float *data = *d;
     float *end = *d + *samples;
 
-    r_ofs = w_ofs - (echo_rate * delay / 1000) * echo_channels;
+    distance = (echo_rate * delay / 1000) * echo_channels;
+    r_ofs = w_ofs - distance;
     if (r_ofs < 0)
         r_ofs += BUFFER_SHORTS;
 
-    for (; data < end; data++)
+    /* work on the longest runs that do not wrap around the buffer */
+    while (data < end)
     {
-        in = *data;
+        int len = end - data;
+        len = MIN (len, BUFFER_SHORTS - r_ofs);
+        len = MIN (len, BUFFER_SHORTS - w_ofs);
+
+        /* a very short delay reads back what was just written */
+        if (distance > 0 && distance < 16)
+            len = MIN (len, distance);
 
-        buf = buffer[r_ofs];
-        out = in + buf * volume / 100;
-        buf = in + buf * feedback / 100;
-        buffer[w_ofs] = buf;
-        *data = out;
+        dsp_echo (data, buffer + r_ofs, buffer + w_ofs, len,
+         volume / 100.0f, feedback / 100.0f);
 
-        if (++r_ofs >= BUFFER_SHORTS)
+        data += len;
+        if ((r_ofs += len) >= BUFFER_SHORTS)
             r_ofs -= BUFFER_SHORTS;
-        if (++w_ofs >= BUFFER_SHORTS)
+        if ((w_ofs += len) >= BUFFER_SHORTS)
             w_ofs -= BUFFER_SHORTS;
     }
 }
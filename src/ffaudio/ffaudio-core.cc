@@ -20,6 +20,7 @@
 
 #include <glib.h>
 #include <pthread.h>
+#include <string.h>
 
 #undef FFAUDIO_DOUBLECHECK  /* Doublecheck probing result for debugging purposes */
 #undef FFAUDIO_NO_BLACKLIST /* Don't blacklist any recognized codecs/formats */
@@ -75,6 +76,7 @@ static gboolean ffaudio_init (void)
     av_lockmgr_register (lockmgr);
 
     create_extension_dict ();
+    probe_cache_init ();
 
     return TRUE;
 }
@@ -83,6 +85,7 @@ static void
 ffaudio_cleanup(void)
 {
     extension_dict.clear ();
+    probe_cache_cleanup ();
 
     av_lockmgr_register (NULL);
 }
@@ -192,9 +195,13 @@ static AVInputFormat * get_format (const gchar * name, VFSFile * file)
     return f ? f : get_format_by_content (name, file);
 }
 
-static AVFormatContext * open_input_file (const gchar * name, VFSFile * file)
+static AVFormatContext * open_input_file (const gchar * name, VFSFile * file,
+ const ProbeInfo * probe)
 {
-    AVInputFormat * f = get_format (name, file);
+    AVInputFormat * f = probe ? av_find_input_format (probe->format) : NULL;
+
+    if (! f)
+        f = get_format (name, file);
 
     if (! f)
     {
@@ -231,38 +238,121 @@ static void close_input_file (AVFormatContext * c)
     io_context_free (io);
 }
 
+static bool_t use_stream (AVFormatContext * c, int idx, CodecInfo * cinfo)
+{
+    AVStream * stream = c->streams[idx];
+
+    if (stream && stream->codec && stream->codec->codec_type == AVMEDIA_TYPE_AUDIO)
+    {
+        AVCodec * codec = avcodec_find_decoder (stream->codec->codec_id);
+
+        if (codec)
+        {
+            cinfo->stream_idx = idx;
+            cinfo->stream = stream;
+            cinfo->context = stream->codec;
+            cinfo->codec = codec;
+
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
 static bool_t find_codec (AVFormatContext * c, CodecInfo * cinfo)
 {
     avformat_find_stream_info (c, NULL);
 
     for (unsigned i = 0; i < c->nb_streams; i++)
     {
-        AVStream * stream = c->streams[i];
+        if (use_stream (c, i, cinfo))
+            return TRUE;
+    }
 
-        if (stream && stream->codec && stream->codec->codec_type == AVMEDIA_TYPE_AUDIO)
-        {
-            AVCodec * codec = avcodec_find_decoder (stream->codec->codec_id);
+    return FALSE;
+}
 
-            if (codec)
-            {
-                cinfo->stream_idx = i;
-                cinfo->stream = stream;
-                cinfo->context = stream->codec;
-                cinfo->codec = codec;
+/* Demuxers known to set up everything the decoder needs (parameters, extradata
+ * and timing) while reading the header.  Others may leave some of it to
+ * avformat_find_stream_info (), which must not be skipped for them. */
+static bool_t header_is_enough (const char * format)
+{
+    static const char * const formats[] = {"wav", "w64", "aiff", "au"};
 
-                return TRUE;
-            }
-        }
+    for (const char * f : formats)
+    {
+        if (! strcmp (format, f))
+            return TRUE;
     }
 
     return FALSE;
 }
 
+/* Opens a file and finds the audio stream to decode.  For a file probed
+ * before, the format is known, and if it is one whose header is enough and
+ * the stream parameters there were complete, avformat_find_stream_info () is
+ * skipped as well. */
+static AVFormatContext * open_stream (const gchar * name, VFSFile * file,
+ CodecInfo * cinfo, ProbeInfo * probe)
+{
+    bool_t cached = probe_cache_lookup (name, probe);
+    AVFormatContext * ic = open_input_file (name, file, cached ? probe : NULL);
+
+    if (! ic)
+        return NULL;
+
+    if (cached && probe->complete && header_is_enough (ic->iformat->name) &&
+     probe->stream_idx < (int) ic->nb_streams &&
+     (int) ic->streams[probe->stream_idx]->codec->codec_id == probe->codec_id &&
+     use_stream (ic, probe->stream_idx, cinfo))
+        return ic;
+
+    /* check what the header tells before avformat_find_stream_info () */
+    CodecInfo header;
+    int header_idx = -1;
+
+    for (unsigned i = 0; header_idx < 0 && i < ic->nb_streams; i ++)
+    {
+        if (use_stream (ic, i, & header) && header.context->sample_rate > 0 &&
+         header.context->channels > 0)
+            header_idx = i;
+    }
+
+    if (! find_codec (ic, cinfo))
+    {
+        fprintf (stderr, "ffaudio: No codec found for %s.\n", name);
+        close_input_file (ic);
+        return NULL;
+    }
+
+    /* a complete entry that did not match is out of date */
+    if (! cached || probe->complete)
+    {
+        probe->format = String (ic->iformat->name);
+        probe->stream_idx = cinfo->stream_idx;
+        probe->codec_id = cinfo->context->codec_id;
+        probe->duration = ic->duration;
+        probe->bitrate = ic->bit_rate;
+        probe->complete = (header_idx == cinfo->stream_idx &&
+         header_is_enough (ic->iformat->name));
+
+        probe_cache_store (name, probe);
+    }
+
+    return ic;
+}
+
 static gboolean ffaudio_probe (const gchar * filename, VFSFile * file)
 {
     if (! file)
         return FALSE;
 
+    ProbeInfo probe;
+
+    if (probe_cache_lookup (filename, & probe))
+        return TRUE;
+
     return get_format (filename, file) ? TRUE : FALSE;
 }
 
@@ -308,27 +398,24 @@ static void read_metadata_dict (Tuple & tuple, AVDictionary * dict)
 static Tuple read_tuple (const gchar * filename, VFSFile * file)
 {
     Tuple tuple;
-    AVFormatContext * ic = open_input_file (filename, file);
+    CodecInfo cinfo;
+    ProbeInfo probe;
+    AVFormatContext * ic = open_stream (filename, file, & cinfo, & probe);
 
     if (ic)
     {
-        CodecInfo cinfo;
+        tuple.set_filename (filename);
 
-        if (find_codec (ic, & cinfo))
-        {
-            tuple.set_filename (filename);
-
-            tuple.set_int (FIELD_LENGTH, ic->duration / 1000);
-            tuple.set_int (FIELD_BITRATE, ic->bit_rate / 1000);
+        tuple.set_int (FIELD_LENGTH, probe.duration / 1000);
+        tuple.set_int (FIELD_BITRATE, probe.bitrate / 1000);
 
-            if (cinfo.codec->long_name)
-                tuple.set_str (FIELD_CODEC, cinfo.codec->long_name);
+        if (cinfo.codec->long_name)
+            tuple.set_str (FIELD_CODEC, cinfo.codec->long_name);
 
-            if (ic->metadata)
-                read_metadata_dict (tuple, ic->metadata);
-            if (cinfo.stream->metadata)
-                read_metadata_dict (tuple, cinfo.stream->metadata);
-        }
+        if (ic->metadata)
+            read_metadata_dict (tuple, ic->metadata);
+        if (cinfo.stream->metadata)
+            read_metadata_dict (tuple, cinfo.stream->metadata);
 
         close_input_file (ic);
     }
@@ -361,6 +448,47 @@ static gboolean ffaudio_write_tag (const char * filename, VFSFile * file, const
     return tag_tuple_write(tuple, file, TAG_TYPE_NONE);
 }
 
+static AVFrame * alloc_frame (void)
+{
+#if CHECK_LIBAVCODEC_VERSION (55, 45, 101, 55, 28, 1)
+    return av_frame_alloc ();
+#else
+    return avcodec_alloc_frame ();
+#endif
+}
+
+static void free_frame (AVFrame * frame)
+{
+#if CHECK_LIBAVCODEC_VERSION (55, 45, 101, 55, 28, 1)
+    av_frame_free (& frame);
+#elif CHECK_LIBAVCODEC_VERSION (54, 59, 100, 54, 28, 0)
+    avcodec_free_frame (& frame);
+#else
+    av_free (frame);
+#endif
+}
+
+static void write_frame (AVFrame * frame, gint out_fmt, gboolean planar,
+ gint channels, void * * buf, gint * bufsize)
+{
+    gint size = FMT_SIZEOF (out_fmt) * channels * frame->nb_samples;
+
+    if (planar)
+    {
+        if (* bufsize < size)
+        {
+            * buf = g_realloc (* buf, size);
+            * bufsize = size;
+        }
+
+        audio_interlace ((const void * *) frame->data, out_fmt, channels, * buf,
+         frame->nb_samples);
+        aud_input_write_audio (* buf, size);
+    }
+    else
+        aud_input_write_audio (frame->data[0], size);
+}
+
 static gboolean ffaudio_play (const gchar * filename, VFSFile * file)
 {
     AUDDBG ("Playing %s.\n", filename);
@@ -368,29 +496,32 @@ static gboolean ffaudio_play (const gchar * filename, VFSFile * file)
         return FALSE;
 
     AVPacket pkt = AVPacket();
-    gint errcount;
     gboolean codec_opened = FALSE;
     gint out_fmt;
     gboolean planar;
     gboolean error = FALSE;
+    gint seek_value = -1;
 
     void *buf = NULL;
     gint bufsize = 0;
 
-    AVFormatContext * ic = open_input_file (filename, file);
-    if (! ic)
-        return FALSE;
+    AVFrame * frame = NULL;
+    Demuxer * demuxer = NULL;
 
     CodecInfo cinfo;
+    ProbeInfo probe;
 
-    if (! find_codec (ic, & cinfo))
-    {
-        fprintf (stderr, "ffaudio: No codec found for %s.\n", filename);
-        goto error_exit;
-    }
+    AVFormatContext * ic = open_stream (filename, file, & cinfo, & probe);
+    if (! ic)
+        return FALSE;
 
     AUDDBG("got codec %s for stream index %d, opening\n", cinfo.codec->name, cinfo.stream_idx);
 
+    /* Let libavcodec pick the number of threads.  Codecs that support frame or
+     * slice threading use them; others ignore the setting. */
+    cinfo.context->thread_count = 0;
+    cinfo.context->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
     if (avcodec_open2 (cinfo.context, cinfo.codec, NULL) < 0)
         goto error_exit;
 
@@ -424,59 +555,49 @@ static gboolean ffaudio_play (const gchar * filename, VFSFile * file)
 
     AUDDBG("setting parameters\n");
 
-    aud_input_set_bitrate(ic->bit_rate);
+    aud_input_set_bitrate(probe.bitrate);
 
-    errcount = 0;
+    /* one frame is reused for all packets */
+    if (! (frame = alloc_frame ()) || ! (demuxer = demuxer_new (ic, cinfo.stream_idx)))
+    {
+        error = TRUE;
+        goto error_exit;
+    }
 
     while (! aud_input_check_stop ())
     {
-        int seek_value = aud_input_check_seek ();
+        if (seek_value < 0)
+            seek_value = aud_input_check_seek ();
 
         if (seek_value >= 0)
         {
-            if (av_seek_frame (ic, -1, (gint64) seek_value * AV_TIME_BASE /
-             1000, AVSEEK_FLAG_ANY) < 0)
-            {
+            if (! demuxer_seek (demuxer, (gint64) seek_value * AV_TIME_BASE / 1000))
                 _ERROR("error while seeking\n");
-            } else
-                errcount = 0;
 
+            /* drop frames still being decoded from before the seek */
+            avcodec_flush_buffers (cinfo.context);
             seek_value = -1;
         }
 
         AVPacket tmp;
-        gint ret;
+        gint ret = demuxer_read (demuxer, & pkt);
 
-        /* Read next frame (or more) of data */
-        if ((ret = av_read_frame(ic, &pkt)) < 0)
-        {
-            if (ret == (int) AVERROR_EOF)
-            {
-                AUDDBG("eof reached\n");
-                break;
-            }
-            else
-            {
-                if (++errcount > 4)
-                {
-                    _ERROR("av_read_frame error %d, giving up.\n", ret);
-                    break;
-                } else
-                    continue;
-            }
-        } else
-            errcount = 0;
+        /* nothing read yet; check for stop and seek requests again */
+        if (ret < 0)
+            continue;
 
-        /* Ignore any other substreams */
-        if (pkt.stream_index != cinfo.stream_idx)
+        /* At the end of the stream, feed empty packets to get out the frames
+         * still held back by the codec (or its threads). */
+        if (ret == 0)
         {
-            av_free_packet(&pkt);
-            continue;
+            av_init_packet (& pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
         }
 
         /* Decode and play packet/frame */
         memcpy(&tmp, &pkt, sizeof(tmp));
-        while (tmp.size > 0 && ! aud_input_check_stop ())
+        while ((tmp.size > 0 || ret == 0) && ! aud_input_check_stop ())
         {
             /* Check for seek request and bail out if we have one */
             if (seek_value < 0)
@@ -485,11 +606,6 @@ static gboolean ffaudio_play (const gchar * filename, VFSFile * file)
             if (seek_value >= 0)
                 break;
 
-#if CHECK_LIBAVCODEC_VERSION (55, 45, 101, 55, 28, 1)
-            AVFrame * frame = av_frame_alloc ();
-#else
-            AVFrame * frame = avcodec_alloc_frame ();
-#endif
             int decoded = 0;
             int len = avcodec_decode_audio4 (cinfo.context, frame, & decoded, & tmp);
 
@@ -503,39 +619,28 @@ static gboolean ffaudio_play (const gchar * filename, VFSFile * file)
             tmp.data += len;
 
             if (! decoded)
-                continue;
-
-            gint size = FMT_SIZEOF (out_fmt) * cinfo.context->channels * frame->nb_samples;
-
-            if (planar)
             {
-                if (bufsize < size)
-                {
-                    buf = g_realloc (buf, size);
-                    bufsize = size;
-                }
-
-                audio_interlace ((const void * *) frame->data, out_fmt,
-                 cinfo.context->channels, buf, frame->nb_samples);
-                aud_input_write_audio (buf, size);
+                if (ret == 0)
+                    break;
+
+                continue;
             }
-            else
-                aud_input_write_audio (frame->data[0], size);
 
-#if CHECK_LIBAVCODEC_VERSION (55, 45, 101, 55, 28, 1)
-            av_frame_free (& frame);
-#elif CHECK_LIBAVCODEC_VERSION (54, 59, 100, 54, 28, 0)
-            avcodec_free_frame (& frame);
-#else
-            av_free (frame);
-#endif
+            write_frame (frame, out_fmt, planar, cinfo.context->channels, & buf, & bufsize);
         }
 
         if (pkt.data)
             av_free_packet(&pkt);
+
+        if (ret == 0 && seek_value < 0)
+            break;
     }
 
 error_exit:
+    if (demuxer)
+        demuxer_free (demuxer);
+    if (frame)
+        free_frame (frame);
     if (pkt.data)
         av_free_packet(&pkt);
     if (codec_opened)
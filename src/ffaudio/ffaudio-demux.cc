@@ -0,0 +1,264 @@
+/*
+ * ffaudio-demux.cc
+ * Copyright 2014 Audacious Team
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <glib.h>
+
+#include "ffaudio-stdinc.h"
+
+#include <libaudcore/runtime.h>
+
+/* The read-ahead queue is a ring of packets; it is full when either limit is
+ * reached (but always holds at least one packet, however large). */
+#define QUEUE_PACKETS 256
+#define QUEUE_BYTES (2 * 1024 * 1024)
+
+/* how long demuxer_read () waits before letting the caller check for stop
+ * and seek requests */
+#define READ_TIMEOUT 100 /* milliseconds */
+
+struct Demuxer
+{
+    AVFormatContext * ic;
+    int stream_idx;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+
+    AVPacket packets[QUEUE_PACKETS];
+    int head, count, bytes;
+
+    bool_t eof, quit;
+    int64_t seek_time;          /* AV_TIME_BASE units, -1 if none pending */
+    bool_t seek_ok;
+};
+
+static bool_t queue_full (Demuxer * d)
+{
+    return d->count == QUEUE_PACKETS || (d->count && d->bytes >= QUEUE_BYTES);
+}
+
+static void queue_push (Demuxer * d, AVPacket * pkt)
+{
+    d->packets[(d->head + d->count) % QUEUE_PACKETS] = * pkt;
+    d->count ++;
+    d->bytes += pkt->size;
+}
+
+static void queue_pop (Demuxer * d, AVPacket * pkt)
+{
+    * pkt = d->packets[d->head];
+    d->head = (d->head + 1) % QUEUE_PACKETS;
+    d->count --;
+    d->bytes -= pkt->size;
+}
+
+static void queue_flush (Demuxer * d)
+{
+    AVPacket pkt;
+
+    while (d->count)
+    {
+        queue_pop (d, & pkt);
+        av_free_packet (& pkt);
+    }
+}
+
+/* Only this thread touches the format context once the demuxer is running.
+ * The mutex is dropped while reading or seeking, which may block on slow
+ * sources. */
+static void * demux_thread (void * data)
+{
+    Demuxer * d = (Demuxer *) data;
+    int errcount = 0;
+
+    pthread_mutex_lock (& d->mutex);
+
+    while (! d->quit)
+    {
+        if (d->seek_time >= 0)
+        {
+            int64_t time = d->seek_time;
+
+            pthread_mutex_unlock (& d->mutex);
+            int ret = av_seek_frame (d->ic, -1, time, AVSEEK_FLAG_ANY);
+            pthread_mutex_lock (& d->mutex);
+
+            queue_flush (d);
+            d->seek_ok = (ret >= 0);
+            d->seek_time = -1;
+            d->eof = FALSE;
+            errcount = 0;
+
+            pthread_cond_broadcast (& d->cond);
+            continue;
+        }
+
+        if (d->eof || queue_full (d))
+        {
+            pthread_cond_wait (& d->cond, & d->mutex);
+            continue;
+        }
+
+        pthread_mutex_unlock (& d->mutex);
+
+        AVPacket pkt;
+        int ret = av_read_frame (d->ic, & pkt);
+        bool_t keep = FALSE;
+
+        if (ret >= 0)
+        {
+            /* Skip other streams.  Packets may point into the demuxer's own
+             * buffers until copied. */
+            keep = (pkt.stream_index == d->stream_idx && av_dup_packet (& pkt) >= 0);
+
+            if (! keep)
+                av_free_packet (& pkt);
+        }
+
+        pthread_mutex_lock (& d->mutex);
+
+        /* a seek was requested meanwhile; this packet is from before it */
+        if (d->seek_time >= 0)
+        {
+            if (keep)
+                av_free_packet (& pkt);
+
+            continue;
+        }
+
+        if (ret >= 0)
+        {
+            errcount = 0;
+
+            if (keep)
+            {
+                queue_push (d, & pkt);
+                pthread_cond_broadcast (& d->cond);
+            }
+        }
+        else if (ret == (int) AVERROR_EOF)
+        {
+            AUDDBG ("eof reached\n");
+            d->eof = TRUE;
+            pthread_cond_broadcast (& d->cond);
+        }
+        else if (++ errcount > 4)
+        {
+            _ERROR ("av_read_frame error %d, giving up.\n", ret);
+            d->eof = TRUE;
+            pthread_cond_broadcast (& d->cond);
+        }
+    }
+
+    pthread_mutex_unlock (& d->mutex);
+    return NULL;
+}
+
+Demuxer * demuxer_new (AVFormatContext * ic, int stream_idx)
+{
+    Demuxer * d = g_new0 (Demuxer, 1);
+
+    d->ic = ic;
+    d->stream_idx = stream_idx;
+    d->seek_time = -1;
+
+    pthread_mutex_init (& d->mutex, NULL);
+    pthread_cond_init (& d->cond, NULL);
+
+    if (pthread_create (& d->thread, NULL, demux_thread, d))
+    {
+        _ERROR ("Could not start the read-ahead thread.\n");
+        pthread_mutex_destroy (& d->mutex);
+        pthread_cond_destroy (& d->cond);
+        g_free (d);
+        return NULL;
+    }
+
+    return d;
+}
+
+void demuxer_free (Demuxer * d)
+{
+    pthread_mutex_lock (& d->mutex);
+    d->quit = TRUE;
+    pthread_cond_broadcast (& d->cond);
+    pthread_mutex_unlock (& d->mutex);
+
+    pthread_join (d->thread, NULL);
+
+    queue_flush (d);
+
+    pthread_mutex_destroy (& d->mutex);
+    pthread_cond_destroy (& d->cond);
+    g_free (d);
+}
+
+int demuxer_read (Demuxer * d, AVPacket * pkt)
+{
+    int ret = -1;
+
+    pthread_mutex_lock (& d->mutex);
+
+    if (! d->count && ! d->eof)
+    {
+        struct timeval now;
+        gettimeofday (& now, NULL);
+
+        int64_t usec = (int64_t) now.tv_usec + READ_TIMEOUT * 1000;
+        struct timespec until = {(time_t) (now.tv_sec + usec / 1000000),
+         (long) (usec % 1000000 * 1000)};
+
+        pthread_cond_timedwait (& d->cond, & d->mutex, & until);
+    }
+
+    if (d->count)
+    {
+        queue_pop (d, pkt);
+        pthread_cond_broadcast (& d->cond);
+        ret = 1;
+    }
+    else if (d->eof)
+        ret = 0;
+
+    pthread_mutex_unlock (& d->mutex);
+
+    return ret;
+}
+
+bool_t demuxer_seek (Demuxer * d, int64_t time)
+{
+    pthread_mutex_lock (& d->mutex);
+
+    queue_flush (d);
+    d->seek_time = time;
+    pthread_cond_broadcast (& d->cond);
+
+    while (d->seek_time >= 0)
+        pthread_cond_wait (& d->cond, & d->mutex);
+
+    bool_t ok = d->seek_ok;
+
+    pthread_mutex_unlock (& d->mutex);
+
+    return ok;
+}
@@ -0,0 +1,254 @@
+/*
+ * ffaudio-probe.cc
+ * Copyright 2014 Audacious Team
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include "ffaudio-stdinc.h"
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/runtime.h>
+
+/* Probe results are appended to a text file, one line per file:
+ *
+ *   uri size mtime format stream codec duration bitrate complete
+ *
+ * A later line for the same URI replaces an earlier one.  The file is
+ * rewritten without the replaced lines when they make up more than half of
+ * it. */
+
+struct ProbeEntry {
+    int64_t size, mtime;
+    char format[64];
+    int stream_idx, codec_id;
+    int64_t duration;
+    int bitrate;
+    bool_t complete;
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static GHashTable * cache;      /* uri -> struct ProbeEntry */
+static FILE * cache_file;       /* opened for appending on first use */
+
+static char * get_cache_path (void)
+{
+    return g_build_filename (aud_get_path (AUD_PATH_USER_DIR), "ffaudio-probe", NULL);
+}
+
+/* Only local files are cached, since only they have a modification time. */
+static bool_t get_file_stamp (const char * filename, int64_t * size, int64_t * mtime)
+{
+    StringBuf path = uri_to_filename (filename);
+    GStatBuf info;
+
+    if (! path || g_stat (path, & info) < 0)
+        return FALSE;
+
+    * size = info.st_size;
+    * mtime = info.st_mtime;
+    return TRUE;
+}
+
+static void print_entry (FILE * file, const char * uri, const ProbeEntry * e)
+{
+    fprintf (file, "%s %lld %lld %s %d %d %lld %d %d\n", uri, (long long) e->size,
+     (long long) e->mtime, e->format, e->stream_idx, e->codec_id,
+     (long long) e->duration, e->bitrate, (int) e->complete);
+}
+
+/* Rewrites the cache file with one line per entry, leaving out entries for
+ * files that were deleted or changed since.  This stats every file, so it is
+ * only done once the file has grown to twice the number of entries. */
+static void compact_cache (const char * path)
+{
+    char * temp = g_strconcat (path, ".new", NULL);
+    FILE * file = fopen (temp, "w");
+
+    if (file)
+    {
+        GHashTableIter iter;
+        void * key, * value;
+
+        g_hash_table_iter_init (& iter, cache);
+
+        while (g_hash_table_iter_next (& iter, & key, & value))
+        {
+            const ProbeEntry * e = (const ProbeEntry *) value;
+            int64_t size, mtime;
+
+            if (get_file_stamp ((const char *) key, & size, & mtime) &&
+             size == e->size && mtime == e->mtime)
+                print_entry (file, (const char *) key, e);
+            else
+                g_hash_table_iter_remove (& iter);
+        }
+
+        if (fclose (file) < 0 || g_rename (temp, path) < 0)
+            g_unlink (temp);
+    }
+
+    g_free (temp);
+}
+
+static void load_cache (void)
+{
+    char * path = get_cache_path ();
+    FILE * file = fopen (path, "r");
+
+    if (! file)
+    {
+        g_free (path);
+        return;
+    }
+
+    char line[4096];
+    int lines = 0;
+
+    while (fgets (line, sizeof line, file))
+    {
+        char * sep = strchr (line, ' ');
+        if (! sep)
+            continue;
+
+        * sep = 0;
+        lines ++;
+
+        ProbeEntry e;
+        long long size, mtime, duration;
+        int complete;
+
+        if (sscanf (sep + 1, "%lld %lld %63s %d %d %lld %d %d", & size, & mtime,
+         e.format, & e.stream_idx, & e.codec_id, & duration, & e.bitrate, & complete) != 8)
+            continue;
+
+        e.size = size;
+        e.mtime = mtime;
+        e.duration = duration;
+        e.complete = complete;
+
+        g_hash_table_insert (cache, g_strdup (line), g_memdup (& e, sizeof e));
+    }
+
+    fclose (file);
+
+    AUDDBG ("Loaded %d probe results from %d lines.\n", g_hash_table_size (cache), lines);
+
+    if (lines > 2 * (int) g_hash_table_size (cache))
+        compact_cache (path);
+
+    g_free (path);
+}
+
+void probe_cache_init (void)
+{
+    pthread_mutex_lock (& mutex);
+
+    cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+    load_cache ();
+
+    pthread_mutex_unlock (& mutex);
+}
+
+void probe_cache_cleanup (void)
+{
+    pthread_mutex_lock (& mutex);
+
+    if (cache_file)
+    {
+        fclose (cache_file);
+        cache_file = NULL;
+    }
+
+    g_hash_table_destroy (cache);
+    cache = NULL;
+
+    pthread_mutex_unlock (& mutex);
+}
+
+bool_t probe_cache_lookup (const char * filename, ProbeInfo * info)
+{
+    int64_t size, mtime;
+    bool_t found = FALSE;
+
+    if (! get_file_stamp (filename, & size, & mtime))
+        return FALSE;
+
+    pthread_mutex_lock (& mutex);
+
+    ProbeEntry * e = (ProbeEntry *) g_hash_table_lookup (cache, filename);
+
+    /* an entry for an older version of the file will never match again */
+    if (e && (e->size != size || e->mtime != mtime))
+        g_hash_table_remove (cache, filename);
+    else if (e)
+    {
+        info->format = String (e->format);
+        info->stream_idx = e->stream_idx;
+        info->codec_id = e->codec_id;
+        info->duration = e->duration;
+        info->bitrate = e->bitrate;
+        info->complete = e->complete;
+        found = TRUE;
+    }
+
+    pthread_mutex_unlock (& mutex);
+
+    return found;
+}
+
+void probe_cache_store (const char * filename, const ProbeInfo * info)
+{
+    ProbeEntry e;
+
+    /* format names never contain spaces, but be safe */
+    if (! get_file_stamp (filename, & e.size, & e.mtime) || ! info->format ||
+     strlen (info->format) >= sizeof e.format || strchr (info->format, ' ') ||
+     strchr (filename, ' ') || strchr (filename, '\n'))
+        return;
+
+    strcpy (e.format, info->format);
+    e.stream_idx = info->stream_idx;
+    e.codec_id = info->codec_id;
+    e.duration = info->duration;
+    e.bitrate = info->bitrate;
+    e.complete = info->complete;
+
+    pthread_mutex_lock (& mutex);
+
+    g_hash_table_insert (cache, g_strdup (filename), g_memdup (& e, sizeof e));
+
+    if (! cache_file)
+    {
+        char * path = get_cache_path ();
+        cache_file = fopen (path, "a");
+        g_free (path);
+    }
+
+    if (cache_file)
+    {
+        print_entry (cache_file, filename, & e);
+        fflush (cache_file);
+    }
+
+    pthread_mutex_unlock (& mutex);
+}
@@ -22,6 +22,7 @@
 #define _ERROR(...) printf ("ffaudio: " __VA_ARGS__)
 
 #define __STDC_CONSTANT_MACROS
+#include <libaudcore/objects.h>
 #include <libaudcore/plugin.h>
 
 extern "C" {
@@ -47,4 +48,35 @@ extern "C" {
 AVIOContext * io_context_new (VFSFile * file);
 void io_context_free (AVIOContext * context);
 
+/* Read-ahead thread: demuxes packets of one stream into a queue, so that slow
+ * sources do not hold up decoding.  The format context must not be used by
+ * anyone else until demuxer_free () is called. */
+struct Demuxer;
+
+Demuxer * demuxer_new (AVFormatContext * ic, int stream_idx);
+void demuxer_free (Demuxer * demuxer);
+
+/* Returns 1 and a packet (to be freed by the caller), 0 at the end of the
+ * stream, or -1 if nothing arrived within a short time. */
+int demuxer_read (Demuxer * demuxer, AVPacket * pkt);
+
+/* Seeks to <time> (in AV_TIME_BASE units), dropping any queued packets. */
+bool_t demuxer_seek (Demuxer * demuxer, int64_t time);
+
+/* Results of probing a file, remembered across sessions for local files
+ * whose size and modification time have not changed. */
+struct ProbeInfo {
+    String format;      /* name of the AVInputFormat */
+    int stream_idx;     /* audio stream to decode */
+    int codec_id;
+    int64_t duration;   /* AV_TIME_BASE units */
+    int bitrate;
+    bool_t complete;    /* stream parameters known without avformat_find_stream_info () */
+};
+
+void probe_cache_init (void);
+void probe_cache_cleanup (void);
+bool_t probe_cache_lookup (const char * filename, ProbeInfo * info);
+void probe_cache_store (const char * filename, const ProbeInfo * info);
+
 #endif
@@ -30,19 +30,20 @@
     printf("flacng: " __VA_ARGS__); \
 } while (0)
 
+/* Decoded audio is converted to float as it comes out of libFLAC and
+ * collected here until there is enough to pass on.  The buffer holds at least
+ * one frame of the largest possible size. */
 #define BUFFER_SIZE_SAMP (FLAC__MAX_BLOCK_SIZE * FLAC__MAX_CHANNELS)
-#define BUFFER_SIZE_BYTE (BUFFER_SIZE_SAMP * (FLAC__MAX_BITS_PER_SAMPLE/8))
-
-#define SAMPLE_SIZE(a) (a == 8 ? 1 : (a == 16 ? 2 : 4))
-#define SAMPLE_FMT(a) (a == 8 ? FMT_S8 : (a == 16 ? FMT_S16_NE : (a == 24 ? FMT_S24_NE : FMT_S32_NE)))
+#define BUFFER_SIZE_BYTE (BUFFER_SIZE_SAMP * sizeof (float))
 
 typedef struct callback_info {
     unsigned bits_per_sample;
     unsigned sample_rate;
     unsigned channels;
+    unsigned max_blocksize;
     unsigned long total_samples;
-    int32_t* output_buffer;
-    int32_t* write_pointer;
+    float* output_buffer;
+    float* write_pointer;
     unsigned buffer_used;
     VFSFile* fd;
     int bitrate;
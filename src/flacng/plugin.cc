@@ -27,6 +27,10 @@
 #include <libaudcore/plugin.h>
 
 #include "flacng.h"
+#include "../libdsp/dsp.h"
+
+/* decoded frames are passed on in batches of about this length */
+#define BATCH_LENGTH 100 /* milliseconds */
 
 static FLAC__StreamDecoder *decoder;
 static callback_info *info;
@@ -35,6 +39,8 @@ static bool_t flac_init (void)
 {
     FLAC__StreamDecoderInitStatus ret;
 
+    dsp_init();
+
     /* Callback structure and decoder for main decoding loop */
 
     if ((info = init_callback_info()) == NULL)
@@ -90,43 +96,13 @@ bool_t flac_is_our_fd(const char *filename, VFSFile *fd)
     return ! strncmp (buf, "fLaC", sizeof buf);
 }
 
-static void squeeze_audio(int32_t* src, void* dst, unsigned count, unsigned res)
-{
-    int32_t* rp = src;
-    int8_t*  wp = (int8_t*) dst;
-    int16_t* wp2 = (int16_t*) dst;
-    int32_t* wp4 = (int32_t*) dst;
-
-    switch (res)
-    {
-        case 8:
-            for (unsigned i = 0; i < count; i++, wp++, rp++)
-                *wp = *rp & 0xff;
-            break;
-
-        case 16:
-            for (unsigned i = 0; i < count; i++, wp2++, rp++)
-                *wp2 = *rp & 0xffff;
-            break;
-
-        case 24:
-        case 32:
-            for (unsigned i = 0; i < count; i++, wp4++, rp++)
-                *wp4 = *rp;
-            break;
-
-        default:
-            FLACNG_ERROR("Can not convert to %u bps\n", res);
-    }
-}
-
 static bool_t flac_play (const char * filename, VFSFile * file)
 {
     if (!file)
         return FALSE;
 
-    void * play_buffer = NULL;
     bool_t error = FALSE;
+    unsigned batch, max_frame;
 
     info->fd = file;
 
@@ -137,10 +113,7 @@ static bool_t flac_play (const char * filename, VFSFile * file)
         goto ERR_NO_CLOSE;
     }
 
-    play_buffer = g_malloc (BUFFER_SIZE_BYTE);
-
-    if (! aud_input_open_audio (SAMPLE_FMT (info->bits_per_sample),
-        info->sample_rate, info->channels))
+    if (! aud_input_open_audio (FMT_FLOAT, info->sample_rate, info->channels))
     {
         error = TRUE;
         goto ERR_NO_CLOSE;
@@ -148,6 +121,9 @@ static bool_t flac_play (const char * filename, VFSFile * file)
 
     aud_input_set_bitrate(info->bitrate);
 
+    batch = info->sample_rate * BATCH_LENGTH / 1000 * info->channels;
+    max_frame = (info->max_blocksize ? info->max_blocksize : FLAC__MAX_BLOCK_SIZE) * info->channels;
+
     while (FLAC__stream_decoder_get_state(decoder) != FLAC__STREAM_DECODER_END_OF_STREAM)
     {
         if (aud_input_check_stop ())
@@ -155,8 +131,12 @@ static bool_t flac_play (const char * filename, VFSFile * file)
 
         int seek_value = aud_input_check_seek ();
         if (seek_value >= 0)
+        {
+            /* drop what was decoded before the seek */
+            reset_info(info);
             FLAC__stream_decoder_seek_absolute (decoder, (int64_t)
              seek_value * info->sample_rate / 1000);
+        }
 
         /* Try to decode a single frame of audio */
         if (FLAC__stream_decoder_process_single(decoder) == FALSE)
@@ -166,14 +146,20 @@ static bool_t flac_play (const char * filename, VFSFile * file)
             break;
         }
 
-        squeeze_audio(info->output_buffer, play_buffer, info->buffer_used, info->bits_per_sample);
-        aud_input_write_audio(play_buffer, info->buffer_used * SAMPLE_SIZE(info->bits_per_sample));
-
-        reset_info(info);
+        /* Collect frames until a batch is complete or the next frame might
+         * not fit, then pass them on in one write. */
+        if (info->buffer_used >= batch || BUFFER_SIZE_SAMP - info->buffer_used < max_frame)
+        {
+            aud_input_write_audio(info->output_buffer, info->buffer_used * sizeof (float));
+            reset_info(info);
+        }
     }
 
+    if (! error && info->buffer_used &&
+        FLAC__stream_decoder_get_state(decoder) == FLAC__STREAM_DECODER_END_OF_STREAM)
+        aud_input_write_audio(info->output_buffer, info->buffer_used * sizeof (float));
+
 ERR_NO_CLOSE:
-    g_free (play_buffer);
     reset_info(info);
 
     if (FLAC__stream_decoder_flush(decoder) == FALSE)
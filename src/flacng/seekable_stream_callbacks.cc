@@ -24,6 +24,7 @@
 #include <libaudcore/runtime.h>
 
 #include "flacng.h"
+#include "../libdsp/dsp.h"
 
 FLAC__StreamDecoderReadStatus read_callback(const FLAC__StreamDecoder *decoder, FLAC__byte buffer[], size_t *bytes, void *client_data)
 {
@@ -128,15 +129,21 @@ FLAC__StreamDecoderWriteStatus write_callback(const FLAC__StreamDecoder *decoder
         return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
     }
 
-    for (unsigned sample = 0; sample < frame->header.blocksize; sample++)
+    unsigned samples = frame->header.blocksize * frame->header.channels;
+
+    if (samples > BUFFER_SIZE_SAMP - info->buffer_used)
     {
-        for (unsigned channel = 0; channel < frame->header.channels; channel++)
-        {
-            *(info->write_pointer++) = buffer[channel][sample];
-            info->buffer_used += 1;
-        }
+        FLACNG_ERROR("No room for %u samples in the output buffer!\n", samples);
+        return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
     }
 
+    /* convert straight from libFLAC's buffers, scaling to the -1 to 1 range */
+    dsp_interleave_int(buffer, info->write_pointer, frame->header.channels,
+        frame->header.blocksize, 1.0f / (1u << (frame->header.bits_per_sample - 1)));
+
+    info->write_pointer += samples;
+    info->buffer_used += samples;
+
     return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
 
@@ -155,6 +162,9 @@ void metadata_callback(const FLAC__StreamDecoder *decoder, const FLAC__StreamMet
         info->total_samples = metadata->data.stream_info.total_samples;
         AUDDBG("total_total_samples=%ld\n", (long) metadata->data.stream_info.total_samples);
 
+        info->max_blocksize = metadata->data.stream_info.max_blocksize;
+        AUDDBG("max_blocksize=%d\n", metadata->data.stream_info.max_blocksize);
+
         info->bits_per_sample = metadata->data.stream_info.bits_per_sample;
         AUDDBG("bits_per_sample=%d\n", metadata->data.stream_info.bits_per_sample);
 
@@ -31,11 +31,11 @@ callback_info *init_callback_info(void)
     callback_info *info;
 
     info = g_new0 (callback_info, 1);
-    info->output_buffer = (int32_t*) g_malloc (BUFFER_SIZE_BYTE);
+    info->output_buffer = (float*) g_malloc (BUFFER_SIZE_BYTE);
 
     reset_info(info);
 
-    AUDDBG("Playback buffer allocated for %d samples, %d bytes\n", BUFFER_SIZE_SAMP, BUFFER_SIZE_BYTE);
+    AUDDBG("Playback buffer allocated for %d samples, %d bytes\n", BUFFER_SIZE_SAMP, (int) BUFFER_SIZE_BYTE);
 
     return info;
 }
@@ -0,0 +1,76 @@
+/*
+ * DSP Kernels for Audacious Effect Plugins
+ * Copyright 2014 Audacious Team
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef AUD_LIBDSP_DSP_INTERNAL_H
+#define AUD_LIBDSP_DSP_INTERNAL_H
+
+#include <stdint.h>
+
+/* One set of kernels per instruction set.  Functions that have nothing to
+ * gain from a given instruction set point to the scalar version. */
+
+struct DSPKernels {
+    void (* gain) (float * data, int samples, float gain);
+    void (* ramp) (float * data, int samples, float a, float b);
+    void (* mix) (float * data, const float * add, int samples);
+    void (* mix_gain) (float * data, const float * add, int samples, float gain);
+    void (* stereo_matrix) (float * data, int frames, float ll, float lr, float rl, float rr);
+    void (* emphasis) (float * data, int samples, int channels, float * prev, float amount);
+    void (* echo) (float * data, const float * read, float * write, int samples,
+     float volume, float feedback);
+    void (* deinterleave_stereo) (const float * in, float * left, float * right, int frames);
+    void (* interleave_stereo) (const float * left, const float * right, float * out, int frames);
+    void (* mix_mul) (float * data, const float * add, const float * mul, int samples);
+    float (* dot) (const float * a, const float * b, int samples);
+    void (* int_to_float) (const int32_t * in, float * out, int samples, float scale);
+    void (* interleave_int_stereo) (const int32_t * left, const int32_t * right,
+     float * out, int frames, float scale);
+};
+
+extern const DSPKernels dsp_kernels_scalar;
+
+#if defined (__GNUC__) && (defined (__i386__) || defined (__x86_64__))
+#define DSP_HAVE_X86
+extern const DSPKernels dsp_kernels_sse2;
+extern const DSPKernels dsp_kernels_avx2;
+#endif
+
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+#define DSP_HAVE_NEON
+extern const DSPKernels dsp_kernels_neon;
+#endif
+
+/* scalar tails, shared by the vector versions */
+void dsp_scalar_gain (float * data, int samples, float gain);
+void dsp_scalar_ramp (float * data, int samples, float a, float b);
+void dsp_scalar_mix (float * data, const float * add, int samples);
+void dsp_scalar_mix_gain (float * data, const float * add, int samples, float gain);
+void dsp_scalar_stereo_matrix (float * data, int frames, float ll, float lr, float rl, float rr);
+void dsp_scalar_emphasis (float * data, int samples, int channels, float * prev, float amount);
+void dsp_scalar_echo (float * data, const float * read, float * write, int samples,
+ float volume, float feedback);
+void dsp_scalar_deinterleave_stereo (const float * in, float * left, float * right, int frames);
+void dsp_scalar_interleave_stereo (const float * left, const float * right, float * out, int frames);
+void dsp_scalar_mix_mul (float * data, const float * add, const float * mul, int samples);
+float dsp_scalar_dot (const float * a, const float * b, int samples);
+void dsp_scalar_int_to_float (const int32_t * in, float * out, int samples, float scale);
+void dsp_scalar_interleave_int_stereo (const int32_t * left, const int32_t * right,
+ float * out, int frames, float scale);
+
+#endif /* AUD_LIBDSP_DSP_INTERNAL_H */
@@ -0,0 +1,236 @@
+/*
+ * DSP Kernels for Audacious Effect Plugins
+ * Copyright 2014 Audacious Team
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+/* NEON kernels.  NEON is a build-time choice on ARM (it is always present on
+ * AArch64), so these are only compiled when the compiler targets it. */
+
+#include "dsp-internal.h"
+
+#ifdef DSP_HAVE_NEON
+
+#include <string.h>
+
+#include <arm_neon.h>
+
+#include <libaudcore/audio.h>
+
+static void gain_neon (float * data, int samples, float gain)
+{
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32 (data + i, vmulq_n_f32 (vld1q_f32 (data + i), gain));
+
+    dsp_scalar_gain (data + i, samples - i, gain);
+}
+
+static void ramp_neon (float * data, int samples, float a, float b)
+{
+    float step = (b - a) / samples;
+    static const float first[4] = {0, 1, 2, 3};
+    float32x4_t index = vld1q_f32 (first);
+    float32x4_t va = vdupq_n_f32 (a);
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+    {
+        float32x4_t g = vmlaq_n_f32 (va, index, step);
+        vst1q_f32 (data + i, vmulq_f32 (vld1q_f32 (data + i), g));
+        index = vaddq_f32 (index, vdupq_n_f32 (4));
+    }
+
+    for (; i < samples; i ++)
+        data[i] *= a + step * i;
+}
+
+static void mix_neon (float * data, const float * add, int samples)
+{
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32 (data + i, vaddq_f32 (vld1q_f32 (data + i), vld1q_f32 (add + i)));
+
+    dsp_scalar_mix (data + i, add + i, samples - i);
+}
+
+static void mix_gain_neon (float * data, const float * add, int samples, float gain)
+{
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32 (data + i, vmlaq_n_f32 (vld1q_f32 (data + i), vld1q_f32 (add + i), gain));
+
+    dsp_scalar_mix_gain (data + i, add + i, samples - i, gain);
+}
+
+static void mix_mul_neon (float * data, const float * add, const float * mul, int samples)
+{
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32 (data + i, vmlaq_f32 (vld1q_f32 (data + i), vld1q_f32 (add + i), vld1q_f32 (mul + i)));
+
+    dsp_scalar_mix_mul (data + i, add + i, mul + i, samples - i);
+}
+
+static float dot_neon (const float * a, const float * b, int samples)
+{
+    float32x4_t sum = vdupq_n_f32 (0);
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        sum = vmlaq_f32 (sum, vld1q_f32 (a + i), vld1q_f32 (b + i));
+
+    float part[4];
+    vst1q_f32 (part, sum);
+
+    return part[0] + part[1] + part[2] + part[3] + dsp_scalar_dot (a + i, b + i, samples - i);
+}
+
+static void stereo_matrix_neon (float * data, int frames, float ll, float lr, float rl, float rr)
+{
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        float32x4x2_t x = vld2q_f32 (data + 2 * i);
+        float32x4x2_t y;
+        y.val[0] = vmlaq_n_f32 (vmulq_n_f32 (x.val[0], ll), x.val[1], lr);
+        y.val[1] = vmlaq_n_f32 (vmulq_n_f32 (x.val[0], rl), x.val[1], rr);
+        vst2q_f32 (data + 2 * i, y);
+    }
+
+    dsp_scalar_stereo_matrix (data + 2 * i, frames - i, ll, lr, rl, rr);
+}
+
+static void emphasis_neon (float * data, int samples, int channels, float * prev, float amount)
+{
+    if (samples < channels)
+        return;
+
+    float last[AUD_MAX_CHANNELS];
+    memcpy (last, data + samples - channels, sizeof (float) * channels);
+
+    int i = samples;
+
+    while (i - 4 >= channels)
+    {
+        i -= 4;
+        float32x4_t x = vld1q_f32 (data + i);
+        float32x4_t p = vld1q_f32 (data + i - channels);
+        vst1q_f32 (data + i, vmlaq_n_f32 (x, vsubq_f32 (x, p), amount));
+    }
+
+    while (-- i >= channels)
+        data[i] += (data[i] - data[i - channels]) * amount;
+
+    for (int c = 0; c < channels; c ++)
+        data[c] += (data[c] - prev[c]) * amount;
+
+    memcpy (prev, last, sizeof (float) * channels);
+}
+
+static void echo_neon (float * data, const float * read, float * write, int samples,
+ float volume, float feedback)
+{
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+    {
+        float32x4_t in = vld1q_f32 (data + i);
+        float32x4_t buf = vld1q_f32 (read + i);
+        vst1q_f32 (data + i, vmlaq_n_f32 (in, buf, volume));
+        vst1q_f32 (write + i, vmlaq_n_f32 (in, buf, feedback));
+    }
+
+    dsp_scalar_echo (data + i, read + i, write + i, samples - i, volume, feedback);
+}
+
+static void deinterleave_stereo_neon (const float * in, float * left, float * right, int frames)
+{
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        float32x4x2_t x = vld2q_f32 (in + 2 * i);
+        vst1q_f32 (left + i, x.val[0]);
+        vst1q_f32 (right + i, x.val[1]);
+    }
+
+    dsp_scalar_deinterleave_stereo (in + 2 * i, left + i, right + i, frames - i);
+}
+
+static void interleave_stereo_neon (const float * left, const float * right, float * out, int frames)
+{
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        float32x4x2_t x;
+        x.val[0] = vld1q_f32 (left + i);
+        x.val[1] = vld1q_f32 (right + i);
+        vst2q_f32 (out + 2 * i, x);
+    }
+
+    dsp_scalar_interleave_stereo (left + i, right + i, out + 2 * i, frames - i);
+}
+
+static void int_to_float_neon (const int32_t * in, float * out, int samples, float scale)
+{
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32 (out + i, vmulq_n_f32 (vcvtq_f32_s32 (vld1q_s32 (in + i)), scale));
+
+    dsp_scalar_int_to_float (in + i, out + i, samples - i, scale);
+}
+
+static void interleave_int_stereo_neon (const int32_t * left, const int32_t * right,
+ float * out, int frames, float scale)
+{
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        float32x4x2_t x;
+        x.val[0] = vmulq_n_f32 (vcvtq_f32_s32 (vld1q_s32 (left + i)), scale);
+        x.val[1] = vmulq_n_f32 (vcvtq_f32_s32 (vld1q_s32 (right + i)), scale);
+        vst2q_f32 (out + 2 * i, x);
+    }
+
+    dsp_scalar_interleave_int_stereo (left + i, right + i, out + 2 * i, frames - i, scale);
+}
+
+const DSPKernels dsp_kernels_neon = {
+    gain_neon,
+    ramp_neon,
+    mix_neon,
+    mix_gain_neon,
+    stereo_matrix_neon,
+    emphasis_neon,
+    echo_neon,
+    deinterleave_stereo_neon,
+    interleave_stereo_neon,
+    mix_mul_neon,
+    dot_neon,
+    int_to_float_neon,
+    interleave_int_stereo_neon
+};
+
+#endif /* DSP_HAVE_NEON */
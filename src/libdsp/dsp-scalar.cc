@@ -0,0 +1,155 @@
+/*
+ * DSP Kernels for Audacious Effect Plugins
+ * Copyright 2014 Audacious Team
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#include <string.h>
+
+#include <libaudcore/audio.h>
+
+#include "dsp-internal.h"
+
+void dsp_scalar_gain (float * data, int samples, float gain)
+{
+    for (int i = 0; i < samples; i ++)
+        data[i] *= gain;
+}
+
+void dsp_scalar_ramp (float * data, int samples, float a, float b)
+{
+    float step = (b - a) / samples;
+
+    for (int i = 0; i < samples; i ++)
+        data[i] *= a + step * i;
+}
+
+void dsp_scalar_mix (float * data, const float * add, int samples)
+{
+    for (int i = 0; i < samples; i ++)
+        data[i] += add[i];
+}
+
+void dsp_scalar_mix_gain (float * data, const float * add, int samples, float gain)
+{
+    for (int i = 0; i < samples; i ++)
+        data[i] += add[i] * gain;
+}
+
+void dsp_scalar_mix_mul (float * data, const float * add, const float * mul, int samples)
+{
+    for (int i = 0; i < samples; i ++)
+        data[i] += add[i] * mul[i];
+}
+
+float dsp_scalar_dot (const float * a, const float * b, int samples)
+{
+    float sum = 0;
+
+    for (int i = 0; i < samples; i ++)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+void dsp_scalar_stereo_matrix (float * data, int frames, float ll, float lr, float rl, float rr)
+{
+    for (float * end = data + 2 * frames; data < end; data += 2)
+    {
+        float left = data[0], right = data[1];
+        data[0] = ll * left + lr * right;
+        data[1] = rl * left + rr * right;
+    }
+}
+
+void dsp_scalar_emphasis (float * data, int samples, int channels, float * prev, float amount)
+{
+    if (samples < channels)
+        return;
+
+    /* work backward so that each sample still sees its unmodified predecessor */
+    float last[AUD_MAX_CHANNELS];
+    memcpy (last, data + samples - channels, sizeof (float) * channels);
+
+    for (int i = samples - 1; i >= channels; i --)
+        data[i] += (data[i] - data[i - channels]) * amount;
+
+    for (int c = 0; c < channels; c ++)
+        data[c] += (data[c] - prev[c]) * amount;
+
+    memcpy (prev, last, sizeof (float) * channels);
+}
+
+void dsp_scalar_echo (float * data, const float * read, float * write, int samples,
+ float volume, float feedback)
+{
+    for (int i = 0; i < samples; i ++)
+    {
+        float in = data[i], buf = read[i];
+        data[i] = in + buf * volume;
+        write[i] = in + buf * feedback;
+    }
+}
+
+void dsp_scalar_deinterleave_stereo (const float * in, float * left, float * right, int frames)
+{
+    for (int i = 0; i < frames; i ++)
+    {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+void dsp_scalar_interleave_stereo (const float * left, const float * right, float * out, int frames)
+{
+    for (int i = 0; i < frames; i ++)
+    {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+void dsp_scalar_int_to_float (const int32_t * in, float * out, int samples, float scale)
+{
+    for (int i = 0; i < samples; i ++)
+        out[i] = in[i] * scale;
+}
+
+void dsp_scalar_interleave_int_stereo (const int32_t * left, const int32_t * right,
+ float * out, int frames, float scale)
+{
+    for (int i = 0; i < frames; i ++)
+    {
+        out[2 * i] = left[i] * scale;
+        out[2 * i + 1] = right[i] * scale;
+    }
+}
+
+const DSPKernels dsp_kernels_scalar = {
+    dsp_scalar_gain,
+    dsp_scalar_ramp,
+    dsp_scalar_mix,
+    dsp_scalar_mix_gain,
+    dsp_scalar_stereo_matrix,
+    dsp_scalar_emphasis,
+    dsp_scalar_echo,
+    dsp_scalar_deinterleave_stereo,
+    dsp_scalar_interleave_stereo,
+    dsp_scalar_mix_mul,
+    dsp_scalar_dot,
+    dsp_scalar_int_to_float,
+    dsp_scalar_interleave_int_stereo
+};
@@ -0,0 +1,466 @@
+/*
+ * DSP Kernels for Audacious Effect Plugins
+ * Copyright 2014 Audacious Team
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+/* SSE2 and AVX2 kernels.  Each function is compiled for its instruction set
+ * through a target attribute, so the rest of the plugin (and this file's
+ * scalar fallbacks) keep the baseline flags. */
+
+#include "dsp-internal.h"
+
+#ifdef DSP_HAVE_X86
+
+#include <string.h>
+
+#include <immintrin.h>
+
+#include <libaudcore/audio.h>
+
+#define SSE2 __attribute__ ((target ("sse2")))
+#define AVX2 __attribute__ ((target ("avx2")))
+
+/* ---- SSE2 ---- */
+
+SSE2 static void gain_sse2 (float * data, int samples, float gain)
+{
+    __m128 g = _mm_set1_ps (gain);
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        _mm_storeu_ps (data + i, _mm_mul_ps (_mm_loadu_ps (data + i), g));
+
+    dsp_scalar_gain (data + i, samples - i, gain);
+}
+
+SSE2 static void ramp_sse2 (float * data, int samples, float a, float b)
+{
+    float step = (b - a) / samples;
+    __m128 va = _mm_set1_ps (a);
+    __m128 vstep = _mm_set1_ps (step);
+    __m128 index = _mm_set_ps (3, 2, 1, 0);
+    __m128 four = _mm_set1_ps (4);
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+    {
+        __m128 g = _mm_add_ps (va, _mm_mul_ps (index, vstep));
+        _mm_storeu_ps (data + i, _mm_mul_ps (_mm_loadu_ps (data + i), g));
+        index = _mm_add_ps (index, four);
+    }
+
+    for (; i < samples; i ++)
+        data[i] *= a + step * i;
+}
+
+SSE2 static void mix_sse2 (float * data, const float * add, int samples)
+{
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        _mm_storeu_ps (data + i, _mm_add_ps (_mm_loadu_ps (data + i), _mm_loadu_ps (add + i)));
+
+    dsp_scalar_mix (data + i, add + i, samples - i);
+}
+
+SSE2 static void mix_gain_sse2 (float * data, const float * add, int samples, float gain)
+{
+    __m128 g = _mm_set1_ps (gain);
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        _mm_storeu_ps (data + i, _mm_add_ps (_mm_loadu_ps (data + i),
+         _mm_mul_ps (_mm_loadu_ps (add + i), g)));
+
+    dsp_scalar_mix_gain (data + i, add + i, samples - i, gain);
+}
+
+SSE2 static void mix_mul_sse2 (float * data, const float * add, const float * mul, int samples)
+{
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+        _mm_storeu_ps (data + i, _mm_add_ps (_mm_loadu_ps (data + i),
+         _mm_mul_ps (_mm_loadu_ps (add + i), _mm_loadu_ps (mul + i))));
+
+    dsp_scalar_mix_mul (data + i, add + i, mul + i, samples - i);
+}
+
+SSE2 static float dot_sse2 (const float * a, const float * b, int samples)
+{
+    /* two accumulators to hide the latency of the adds */
+    __m128 sum0 = _mm_setzero_ps (), sum1 = _mm_setzero_ps ();
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8)
+    {
+        sum0 = _mm_add_ps (sum0, _mm_mul_ps (_mm_loadu_ps (a + i), _mm_loadu_ps (b + i)));
+        sum1 = _mm_add_ps (sum1, _mm_mul_ps (_mm_loadu_ps (a + i + 4), _mm_loadu_ps (b + i + 4)));
+    }
+
+    float part[4];
+    _mm_storeu_ps (part, _mm_add_ps (sum0, sum1));
+
+    return part[0] + part[1] + part[2] + part[3] + dsp_scalar_dot (a + i, b + i, samples - i);
+}
+
+SSE2 static void stereo_matrix_sse2 (float * data, int frames, float ll, float lr, float rl, float rr)
+{
+    /* [L R L R] * [ll rr ll rr] + [R L R L] * [lr rl lr rl] */
+    __m128 same = _mm_set_ps (rr, ll, rr, ll);
+    __m128 cross = _mm_set_ps (rl, lr, rl, lr);
+    int i = 0;
+
+    for (; i + 2 <= frames; i += 2)
+    {
+        __m128 x = _mm_loadu_ps (data + 2 * i);
+        __m128 swapped = _mm_shuffle_ps (x, x, _MM_SHUFFLE (2, 3, 0, 1));
+        _mm_storeu_ps (data + 2 * i, _mm_add_ps (_mm_mul_ps (x, same), _mm_mul_ps (swapped, cross)));
+    }
+
+    dsp_scalar_stereo_matrix (data + 2 * i, frames - i, ll, lr, rl, rr);
+}
+
+SSE2 static void emphasis_sse2 (float * data, int samples, int channels, float * prev, float amount)
+{
+    if (samples < channels)
+        return;
+
+    float last[AUD_MAX_CHANNELS];
+    memcpy (last, data + samples - channels, sizeof (float) * channels);
+
+    __m128 g = _mm_set1_ps (amount);
+    int i = samples;
+
+    /* backward, so that loads always see unmodified samples */
+    while (i - 4 >= channels)
+    {
+        i -= 4;
+        __m128 x = _mm_loadu_ps (data + i);
+        __m128 p = _mm_loadu_ps (data + i - channels);
+        _mm_storeu_ps (data + i, _mm_add_ps (x, _mm_mul_ps (_mm_sub_ps (x, p), g)));
+    }
+
+    while (-- i >= channels)
+        data[i] += (data[i] - data[i - channels]) * amount;
+
+    for (int c = 0; c < channels; c ++)
+        data[c] += (data[c] - prev[c]) * amount;
+
+    memcpy (prev, last, sizeof (float) * channels);
+}
+
+SSE2 static void echo_sse2 (float * data, const float * read, float * write, int samples,
+ float volume, float feedback)
+{
+    __m128 vol = _mm_set1_ps (volume);
+    __m128 fb = _mm_set1_ps (feedback);
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+    {
+        __m128 in = _mm_loadu_ps (data + i);
+        __m128 buf = _mm_loadu_ps (read + i);
+        _mm_storeu_ps (data + i, _mm_add_ps (in, _mm_mul_ps (buf, vol)));
+        _mm_storeu_ps (write + i, _mm_add_ps (in, _mm_mul_ps (buf, fb)));
+    }
+
+    dsp_scalar_echo (data + i, read + i, write + i, samples - i, volume, feedback);
+}
+
+SSE2 static void deinterleave_stereo_sse2 (const float * in, float * left, float * right, int frames)
+{
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        __m128 a = _mm_loadu_ps (in + 2 * i);
+        __m128 b = _mm_loadu_ps (in + 2 * i + 4);
+        _mm_storeu_ps (left + i, _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0)));
+        _mm_storeu_ps (right + i, _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1)));
+    }
+
+    dsp_scalar_deinterleave_stereo (in + 2 * i, left + i, right + i, frames - i);
+}
+
+SSE2 static void interleave_stereo_sse2 (const float * left, const float * right, float * out, int frames)
+{
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        __m128 l = _mm_loadu_ps (left + i);
+        __m128 r = _mm_loadu_ps (right + i);
+        _mm_storeu_ps (out + 2 * i, _mm_unpacklo_ps (l, r));
+        _mm_storeu_ps (out + 2 * i + 4, _mm_unpackhi_ps (l, r));
+    }
+
+    dsp_scalar_interleave_stereo (left + i, right + i, out + 2 * i, frames - i);
+}
+
+SSE2 static void int_to_float_sse2 (const int32_t * in, float * out, int samples, float scale)
+{
+    __m128 s = _mm_set1_ps (scale);
+    int i = 0;
+
+    for (; i + 4 <= samples; i += 4)
+    {
+        __m128i x = _mm_loadu_si128 ((const __m128i *) (in + i));
+        _mm_storeu_ps (out + i, _mm_mul_ps (_mm_cvtepi32_ps (x), s));
+    }
+
+    dsp_scalar_int_to_float (in + i, out + i, samples - i, scale);
+}
+
+SSE2 static void interleave_int_stereo_sse2 (const int32_t * left, const int32_t * right,
+ float * out, int frames, float scale)
+{
+    __m128 s = _mm_set1_ps (scale);
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        __m128 l = _mm_mul_ps (_mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i *) (left + i))), s);
+        __m128 r = _mm_mul_ps (_mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i *) (right + i))), s);
+        _mm_storeu_ps (out + 2 * i, _mm_unpacklo_ps (l, r));
+        _mm_storeu_ps (out + 2 * i + 4, _mm_unpackhi_ps (l, r));
+    }
+
+    dsp_scalar_interleave_int_stereo (left + i, right + i, out + 2 * i, frames - i, scale);
+}
+
+const DSPKernels dsp_kernels_sse2 = {
+    gain_sse2,
+    ramp_sse2,
+    mix_sse2,
+    mix_gain_sse2,
+    stereo_matrix_sse2,
+    emphasis_sse2,
+    echo_sse2,
+    deinterleave_stereo_sse2,
+    interleave_stereo_sse2,
+    mix_mul_sse2,
+    dot_sse2,
+    int_to_float_sse2,
+    interleave_int_stereo_sse2
+};
+
+/* ---- AVX2 ---- */
+
+AVX2 static void gain_avx2 (float * data, int samples, float gain)
+{
+    __m256 g = _mm256_set1_ps (gain);
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8)
+        _mm256_storeu_ps (data + i, _mm256_mul_ps (_mm256_loadu_ps (data + i), g));
+
+    dsp_scalar_gain (data + i, samples - i, gain);
+}
+
+AVX2 static void ramp_avx2 (float * data, int samples, float a, float b)
+{
+    float step = (b - a) / samples;
+    __m256 va = _mm256_set1_ps (a);
+    __m256 vstep = _mm256_set1_ps (step);
+    __m256 index = _mm256_set_ps (7, 6, 5, 4, 3, 2, 1, 0);
+    __m256 eight = _mm256_set1_ps (8);
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m256 g = _mm256_add_ps (va, _mm256_mul_ps (index, vstep));
+        _mm256_storeu_ps (data + i, _mm256_mul_ps (_mm256_loadu_ps (data + i), g));
+        index = _mm256_add_ps (index, eight);
+    }
+
+    for (; i < samples; i ++)
+        data[i] *= a + step * i;
+}
+
+AVX2 static void mix_avx2 (float * data, const float * add, int samples)
+{
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8)
+        _mm256_storeu_ps (data + i, _mm256_add_ps (_mm256_loadu_ps (data + i),
+         _mm256_loadu_ps (add + i)));
+
+    dsp_scalar_mix (data + i, add + i, samples - i);
+}
+
+AVX2 static void mix_gain_avx2 (float * data, const float * add, int samples, float gain)
+{
+    __m256 g = _mm256_set1_ps (gain);
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8)
+        _mm256_storeu_ps (data + i, _mm256_add_ps (_mm256_loadu_ps (data + i),
+         _mm256_mul_ps (_mm256_loadu_ps (add + i), g)));
+
+    dsp_scalar_mix_gain (data + i, add + i, samples - i, gain);
+}
+
+AVX2 static void mix_mul_avx2 (float * data, const float * add, const float * mul, int samples)
+{
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8)
+        _mm256_storeu_ps (data + i, _mm256_add_ps (_mm256_loadu_ps (data + i),
+         _mm256_mul_ps (_mm256_loadu_ps (add + i), _mm256_loadu_ps (mul + i))));
+
+    dsp_scalar_mix_mul (data + i, add + i, mul + i, samples - i);
+}
+
+AVX2 static float dot_avx2 (const float * a, const float * b, int samples)
+{
+    __m256 sum0 = _mm256_setzero_ps (), sum1 = _mm256_setzero_ps ();
+    int i = 0;
+
+    for (; i + 16 <= samples; i += 16)
+    {
+        sum0 = _mm256_add_ps (sum0, _mm256_mul_ps (_mm256_loadu_ps (a + i), _mm256_loadu_ps (b + i)));
+        sum1 = _mm256_add_ps (sum1, _mm256_mul_ps (_mm256_loadu_ps (a + i + 8), _mm256_loadu_ps (b + i + 8)));
+    }
+
+    float part[8];
+    _mm256_storeu_ps (part, _mm256_add_ps (sum0, sum1));
+
+    float sum = 0;
+    for (int j = 0; j < 8; j ++)
+        sum += part[j];
+
+    return sum + dsp_scalar_dot (a + i, b + i, samples - i);
+}
+
+AVX2 static void stereo_matrix_avx2 (float * data, int frames, float ll, float lr, float rl, float rr)
+{
+    __m256 same = _mm256_set_ps (rr, ll, rr, ll, rr, ll, rr, ll);
+    __m256 cross = _mm256_set_ps (rl, lr, rl, lr, rl, lr, rl, lr);
+    int i = 0;
+
+    for (; i + 4 <= frames; i += 4)
+    {
+        __m256 x = _mm256_loadu_ps (data + 2 * i);
+        __m256 swapped = _mm256_permute_ps (x, _MM_SHUFFLE (2, 3, 0, 1));
+        _mm256_storeu_ps (data + 2 * i, _mm256_add_ps (_mm256_mul_ps (x, same),
+         _mm256_mul_ps (swapped, cross)));
+    }
+
+    dsp_scalar_stereo_matrix (data + 2 * i, frames - i, ll, lr, rl, rr);
+}
+
+AVX2 static void emphasis_avx2 (float * data, int samples, int channels, float * prev, float amount)
+{
+    if (samples < channels)
+        return;
+
+    float last[AUD_MAX_CHANNELS];
+    memcpy (last, data + samples - channels, sizeof (float) * channels);
+
+    __m256 g = _mm256_set1_ps (amount);
+    int i = samples;
+
+    while (i - 8 >= channels)
+    {
+        i -= 8;
+        __m256 x = _mm256_loadu_ps (data + i);
+        __m256 p = _mm256_loadu_ps (data + i - channels);
+        _mm256_storeu_ps (data + i, _mm256_add_ps (x, _mm256_mul_ps (_mm256_sub_ps (x, p), g)));
+    }
+
+    while (-- i >= channels)
+        data[i] += (data[i] - data[i - channels]) * amount;
+
+    for (int c = 0; c < channels; c ++)
+        data[c] += (data[c] - prev[c]) * amount;
+
+    memcpy (prev, last, sizeof (float) * channels);
+}
+
+AVX2 static void echo_avx2 (float * data, const float * read, float * write, int samples,
+ float volume, float feedback)
+{
+    __m256 vol = _mm256_set1_ps (volume);
+    __m256 fb = _mm256_set1_ps (feedback);
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m256 in = _mm256_loadu_ps (data + i);
+        __m256 buf = _mm256_loadu_ps (read + i);
+        _mm256_storeu_ps (data + i, _mm256_add_ps (in, _mm256_mul_ps (buf, vol)));
+        _mm256_storeu_ps (write + i, _mm256_add_ps (in, _mm256_mul_ps (buf, fb)));
+    }
+
+    dsp_scalar_echo (data + i, read + i, write + i, samples - i, volume, feedback);
+}
+
+AVX2 static void int_to_float_avx2 (const int32_t * in, float * out, int samples, float scale)
+{
+    __m256 s = _mm256_set1_ps (scale);
+    int i = 0;
+
+    for (; i + 8 <= samples; i += 8)
+    {
+        __m256i x = _mm256_loadu_si256 ((const __m256i *) (in + i));
+        _mm256_storeu_ps (out + i, _mm256_mul_ps (_mm256_cvtepi32_ps (x), s));
+    }
+
+    dsp_scalar_int_to_float (in + i, out + i, samples - i, scale);
+}
+
+AVX2 static void interleave_int_stereo_avx2 (const int32_t * left, const int32_t * right,
+ float * out, int frames, float scale)
+{
+    __m256 s = _mm256_set1_ps (scale);
+    int i = 0;
+
+    for (; i + 8 <= frames; i += 8)
+    {
+        __m256 l = _mm256_mul_ps (_mm256_cvtepi32_ps (_mm256_loadu_si256 ((const __m256i *) (left + i))), s);
+        __m256 r = _mm256_mul_ps (_mm256_cvtepi32_ps (_mm256_loadu_si256 ((const __m256i *) (right + i))), s);
+
+        /* unpack works within each 128-bit half; put the halves back in order */
+        __m256 lo = _mm256_unpacklo_ps (l, r);
+        __m256 hi = _mm256_unpackhi_ps (l, r);
+        _mm256_storeu_ps (out + 2 * i, _mm256_permute2f128_ps (lo, hi, 0x20));
+        _mm256_storeu_ps (out + 2 * i + 8, _mm256_permute2f128_ps (lo, hi, 0x31));
+    }
+
+    dsp_scalar_interleave_int_stereo (left + i, right + i, out + 2 * i, frames - i, scale);
+}
+
+const DSPKernels dsp_kernels_avx2 = {
+    gain_avx2,
+    ramp_avx2,
+    mix_avx2,
+    mix_gain_avx2,
+    stereo_matrix_avx2,
+    emphasis_avx2,
+    echo_avx2,
+    /* float (de)interleaving would need lane-crossing shuffles in AVX2 that
+     * gain little, so the SSE2 versions are used */
+    deinterleave_stereo_sse2,
+    interleave_stereo_sse2,
+    mix_mul_avx2,
+    dot_avx2,
+    int_to_float_avx2,
+    interleave_int_stereo_avx2
+};
+
+#endif /* DSP_HAVE_X86 */
@@ -0,0 +1,206 @@
+/*
+ * DSP Kernels for Audacious Effect Plugins
+ * Copyright 2014 Audacious Team
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#include "dsp.h"
+#include "dsp-internal.h"
+
+#include <string.h>
+
+#include <libaudcore/audio.h>
+
+/* frames per block in dsp_channel_matrix () */
+#define MATRIX_BLOCK 256
+
+static const DSPKernels * kernels = & dsp_kernels_scalar;
+
+void dsp_init (void)
+{
+#ifdef DSP_HAVE_X86
+    __builtin_cpu_init ();
+
+    if (__builtin_cpu_supports ("avx2"))
+        kernels = & dsp_kernels_avx2;
+    else if (__builtin_cpu_supports ("sse2"))
+        kernels = & dsp_kernels_sse2;
+#endif
+
+#ifdef DSP_HAVE_NEON
+    kernels = & dsp_kernels_neon;
+#endif
+}
+
+void dsp_gain (float * data, int samples, float gain)
+{
+    kernels->gain (data, samples, gain);
+}
+
+void dsp_ramp (float * data, int samples, float a, float b)
+{
+    kernels->ramp (data, samples, a, b);
+}
+
+void dsp_mix (float * data, const float * add, int samples)
+{
+    kernels->mix (data, add, samples);
+}
+
+void dsp_mix_gain (float * data, const float * add, int samples, float gain)
+{
+    kernels->mix_gain (data, add, samples, gain);
+}
+
+void dsp_mix_mul (float * data, const float * add, const float * mul, int samples)
+{
+    kernels->mix_mul (data, add, mul, samples);
+}
+
+float dsp_dot (const float * a, const float * b, int samples)
+{
+    return kernels->dot (a, b, samples);
+}
+
+void dsp_stereo_matrix (float * data, int frames, float ll, float lr, float rl, float rr)
+{
+    kernels->stereo_matrix (data, frames, ll, lr, rl, rr);
+}
+
+void dsp_mid_side (float * data, int frames, float mid, float side)
+{
+    /* L' = (L + R) / 2 * mid + (L - R) / 2 * side, and likewise for R' */
+    float a = (mid + side) / 2, b = (mid - side) / 2;
+    kernels->stereo_matrix (data, frames, a, b, b, a);
+}
+
+void dsp_emphasis (float * data, int samples, int channels, float * prev, float amount)
+{
+    kernels->emphasis (data, samples, channels, prev, amount);
+}
+
+void dsp_echo (float * data, const float * read, float * write, int samples,
+ float volume, float feedback)
+{
+    kernels->echo (data, read, write, samples, volume, feedback);
+}
+
+void dsp_deinterleave (const float * in, float * const * out, int channels, int frames)
+{
+    if (channels == 2)
+    {
+        kernels->deinterleave_stereo (in, out[0], out[1], frames);
+        return;
+    }
+
+    for (int c = 0; c < channels; c ++)
+    {
+        const float * get = in + c;
+        float * set = out[c];
+
+        for (int i = 0; i < frames; i ++, get += channels)
+            set[i] = * get;
+    }
+}
+
+void dsp_interleave (const float * const * in, float * out, int channels, int frames)
+{
+    if (channels == 2)
+    {
+        kernels->interleave_stereo (in[0], in[1], out, frames);
+        return;
+    }
+
+    for (int c = 0; c < channels; c ++)
+    {
+        const float * get = in[c];
+        float * set = out + c;
+
+        for (int i = 0; i < frames; i ++, set += channels)
+            * set = get[i];
+    }
+}
+
+void dsp_interleave_int (const int32_t * const * in, float * out, int channels,
+ int frames, float scale)
+{
+    if (channels == 1)
+    {
+        kernels->int_to_float (in[0], out, frames, scale);
+        return;
+    }
+
+    if (channels == 2)
+    {
+        kernels->interleave_int_stereo (in[0], in[1], out, frames, scale);
+        return;
+    }
+
+    for (int c = 0; c < channels; c ++)
+    {
+        const int32_t * get = in[c];
+        float * set = out + c;
+
+        for (int i = 0; i < frames; i ++, set += channels)
+            * set = get[i] * scale;
+    }
+}
+
+/* Works on blocks small enough to stay in cache: the block is split into one
+ * buffer per channel, each output channel is built up as a weighted sum of
+ * whole input channels, and the result is interleaved again. */
+void dsp_channel_matrix (const float * in, int in_channels, float * out,
+ int out_channels, const float * matrix, int frames)
+{
+    float in_planes[AUD_MAX_CHANNELS][MATRIX_BLOCK];
+    float out_planes[AUD_MAX_CHANNELS][MATRIX_BLOCK];
+    float * in_ptrs[AUD_MAX_CHANNELS];
+    float * out_ptrs[AUD_MAX_CHANNELS];
+
+    for (int c = 0; c < AUD_MAX_CHANNELS; c ++)
+    {
+        in_ptrs[c] = in_planes[c];
+        out_ptrs[c] = out_planes[c];
+    }
+
+    while (frames > 0)
+    {
+        int block = (frames < MATRIX_BLOCK) ? frames : MATRIX_BLOCK;
+
+        dsp_deinterleave (in, in_ptrs, in_channels, block);
+
+        for (int o = 0; o < out_channels; o ++)
+        {
+            const float * row = matrix + o * in_channels;
+
+            memset (out_planes[o], 0, sizeof (float) * block);
+
+            for (int i = 0; i < in_channels; i ++)
+            {
+                if (row[i] == 1)
+                    kernels->mix (out_planes[o], in_planes[i], block);
+                else if (row[i] != 0)
+                    kernels->mix_gain (out_planes[o], in_planes[i], block, row[i]);
+            }
+        }
+
+        dsp_interleave (out_ptrs, out, out_channels, block);
+
+        in += block * in_channels;
+        out += block * out_channels;
+        frames -= block;
+    }
+}
@@ -0,0 +1,87 @@
+/*
+ * DSP Kernels for Audacious Effect Plugins
+ * Copyright 2014 Audacious Team
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions, and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions, and the following disclaimer in the documentation
+ *    provided with the distribution.
+ *
+ * This software is provided "as is" and without any warranty, express or
+ * implied. In no event shall the authors be liable for any damages arising from
+ * the use of this software.
+ */
+
+#ifndef AUD_LIBDSP_DSP_H
+#define AUD_LIBDSP_DSP_H
+
+#include <stdint.h>
+
+/* Vectorized processing of interleaved float audio, shared by the effect
+ * plugins (and by decoders that produce float output).  Each plugin links its
+ * own copy, so each must call dsp_init () from its init function; it picks
+ * the fastest code the CPU supports (SSE2 or AVX2 on x86, NEON on ARM) and is
+ * cheap to call more than once.  Until then, plain C versions are used.
+ *
+ * "samples" counts individual values; "frames" counts one value for each
+ * channel. */
+
+void dsp_init (void);
+
+/* data *= gain */
+void dsp_gain (float * data, int samples, float gain);
+
+/* data *= gain, with gain going linearly from a (first sample) toward b */
+void dsp_ramp (float * data, int samples, float a, float b);
+
+/* data += add */
+void dsp_mix (float * data, const float * add, int samples);
+
+/* data += add * gain */
+void dsp_mix_gain (float * data, const float * add, int samples, float gain);
+
+/* data += add * mul, for example to overlap-add a windowed block */
+void dsp_mix_mul (float * data, const float * add, const float * mul, int samples);
+
+/* sum of a * b */
+float dsp_dot (const float * a, const float * b, int samples);
+
+/* For stereo data: L' = ll * L + lr * R, R' = rl * L + rr * R. */
+void dsp_stereo_matrix (float * data, int frames, float ll, float lr, float rl, float rr);
+
+/* For stereo data: scales the mid (L + R) and side (L - R) signals. */
+void dsp_mid_side (float * data, int frames, float mid, float side);
+
+/* First-order high frequency emphasis: each sample gets the difference from
+ * the previous sample in its channel, times amount, added to it.  prev holds
+ * the last frame of the previous call and is updated. */
+void dsp_emphasis (float * data, int samples, int channels, float * prev, float amount);
+
+/* Feedback delay line: data += read * volume, then write = data_in + read *
+ * feedback.  read and write are contiguous runs of the caller's delay buffer;
+ * they must either be the same run or not overlap within 16 samples. */
+void dsp_echo (float * data, const float * read, float * write, int samples,
+ float volume, float feedback);
+
+/* Conversion between interleaved data and one buffer per channel. */
+void dsp_deinterleave (const float * in, float * const * out, int channels, int frames);
+void dsp_interleave (const float * const * in, float * out, int channels, int frames);
+
+/* Interleaves one buffer of integer samples per channel, as produced by
+ * decoders such as libFLAC, into float data, multiplying each sample by
+ * scale (1 / 2^(bits - 1) gives the usual -1 to 1 range).  in and out must
+ * not overlap. */
+void dsp_interleave_int (const int32_t * const * in, float * out, int channels,
+ int frames, float scale);
+
+/* Channel conversion: out[o] = sum of in[i] * matrix[o * in_channels + i].
+ * in and out must not overlap. */
+void dsp_channel_matrix (const float * in, int in_channels, float * out,
+ int out_channels, const float * matrix, int frames);
+
+#endif /* AUD_LIBDSP_DSP_H */
@@ -0,0 +1,207 @@
+/*
+ * Cache of decoded PSF and 2SF library files
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/vfs.h>
+
+#include "libcache.h"
+
+/* unused entries are dropped once all entries together hold more than this */
+#define LIBCACHE_SIZE (64 * 1024 * 1024)
+
+typedef struct {
+	LibImage image;         /* must come first */
+	GList link;             /* in lru, while unused */
+	char *path;
+	int64_t size, mtime;
+	int refs;
+	bool_t cached;          /* in the table, not replaced by a newer version */
+	LibFreeFunc free_decoded;
+} LibEntry;
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static GHashTable *entries;     /* path -> LibEntry */
+static GQueue lru;              /* unused entries, most recently used first */
+static int64_t total;           /* bytes held by cached entries */
+
+/* Only local files are cached, since only they have a modification time. */
+static bool_t get_stamp(const char *path, int64_t *size, int64_t *mtime)
+{
+	StringBuf local = uri_to_filename(path);
+	GStatBuf info;
+
+	if (!local || g_stat(local, &info) < 0)
+		return FALSE;
+
+	*size = info.st_size;
+	*mtime = info.st_mtime;
+	return TRUE;
+}
+
+static int64_t entry_size(LibEntry *e)
+{
+	return e->image.raw_len + e->image.decoded_len;
+}
+
+static void free_entry(LibEntry *e)
+{
+	e->free_decoded(&e->image);
+	free(e->image.raw);
+	g_free(e->path);
+	g_free(e);
+}
+
+static void remove_entry(LibEntry *e)
+{
+	g_hash_table_remove(entries, e->path);
+	e->cached = FALSE;
+	total -= entry_size(e);
+
+	if (!e->refs)
+	{
+		g_queue_unlink(&lru, &e->link);
+		free_entry(e);
+	}
+}
+
+static void trim(void)
+{
+	while (total > LIBCACHE_SIZE && lru.tail)
+		remove_entry((LibEntry *) lru.tail->data);
+}
+
+const LibImage *libcache_get(const char *path, LibDecodeFunc decode, LibFreeFunc free_decoded)
+{
+	int64_t size = 0, mtime = 0;
+	bool_t stamped = get_stamp(path, &size, &mtime);
+	LibEntry *e = NULL;
+
+	pthread_mutex_lock(&mutex);
+
+	if (!entries)
+		entries = g_hash_table_new(g_str_hash, g_str_equal);
+
+	if (stamped)
+		e = (LibEntry *) g_hash_table_lookup(entries, path);
+
+	if (e && (e->size != size || e->mtime != mtime))
+	{
+		remove_entry(e);
+		e = NULL;
+	}
+
+	if (e)
+	{
+		if (!e->refs)
+			g_queue_unlink(&lru, &e->link);
+
+		e->refs++;
+		pthread_mutex_unlock(&mutex);
+		return &e->image;
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	/* read and decode without holding the lock */
+	void *buf;
+	int64_t len;
+
+	vfs_file_get_contents(path, &buf, &len);
+
+	if (!buf)
+		return NULL;
+
+	e = g_new0(LibEntry, 1);
+	e->image.raw = buf;
+	e->image.raw_len = len;
+
+	if (!decode(&e->image))
+	{
+		free(buf);
+		g_free(e);
+		return NULL;
+	}
+
+	e->link.data = e;
+	e->path = g_strdup(path);
+	e->size = size;
+	e->mtime = mtime;
+	e->refs = 1;
+	e->free_decoded = free_decoded;
+
+	pthread_mutex_lock(&mutex);
+
+	/* another thread may have loaded the same file meanwhile; if so, this
+	 * copy is simply not kept */
+	if (stamped && !g_hash_table_lookup(entries, path))
+	{
+		g_hash_table_insert(entries, e->path, e);
+		e->cached = TRUE;
+		total += entry_size(e);
+		trim();
+	}
+
+	pthread_mutex_unlock(&mutex);
+
+	return &e->image;
+}
+
+void libcache_release(const LibImage *image)
+{
+	LibEntry *e = (LibEntry *) image;
+
+	pthread_mutex_lock(&mutex);
+
+	if (--e->refs == 0)
+	{
+		if (e->cached)
+		{
+			g_queue_push_head_link(&lru, &e->link);
+			trim();
+		}
+		else
+			free_entry(e);
+	}
+
+	pthread_mutex_unlock(&mutex);
+}
+
+void libcache_cleanup(void)
+{
+	pthread_mutex_lock(&mutex);
+
+	while (lru.head)
+		remove_entry((LibEntry *) lru.head->data);
+
+	if (entries && !g_hash_table_size(entries))
+	{
+		g_hash_table_destroy(entries);
+		entries = NULL;
+	}
+
+	pthread_mutex_unlock(&mutex);
+}
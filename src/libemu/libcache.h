@@ -0,0 +1,59 @@
+/*
+ * Cache of decoded PSF and 2SF library files
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef LIBCACHE_H
+#define LIBCACHE_H
+
+#include <stdint.h>
+
+#include <libaudcore/core.h>
+
+/*
+ * The tracks of a set of minipsf (or mini2sf) files all refer to the same
+ * library file, often several megabytes of compressed data.  Libraries are
+ * kept here in decoded form, so that each is read and inflated only once.
+ * Entries are keyed by path and checked against the file's size and
+ * modification time; unused ones are dropped, least recently used first,
+ * once the cache grows beyond a fixed size.
+ */
+
+typedef struct {
+	void *raw;              /* file contents */
+	int64_t raw_len;
+	void *decoded;          /* set by the decode function */
+	int64_t decoded_len;    /* bytes held by decoded, counted against the limit */
+} LibImage;
+
+/* Fills in image->decoded and image->decoded_len from image->raw. */
+typedef bool_t (*LibDecodeFunc)(LibImage *image);
+/* Frees image->decoded. */
+typedef void (*LibFreeFunc)(LibImage *image);
+
+/* Returns a reference to the decoded library at <path> (a URI), or NULL if
+ * it could not be read or decoded.  All callers must pass the same decode
+ * and free functions. */
+const LibImage *libcache_get(const char *path, LibDecodeFunc decode, LibFreeFunc free_decoded);
+void libcache_release(const LibImage *image);
+
+/* Drops all unused entries. */
+void libcache_cleanup(void);
+
+#endif
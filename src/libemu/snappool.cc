@@ -0,0 +1,129 @@
+/*
+ * Pool of emulator snapshots for seeking
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <glib.h>
+
+#include "snappool.h"
+
+typedef struct {
+	int time;
+	void *snap;
+	int64_t size;
+} SnapEntry;
+
+struct SnapPool {
+	GArray *entries;        /* SnapEntry, by time */
+	int64_t total, limit;   /* bytes */
+	int interval;
+	SnapFreeFunc free_snap;
+};
+
+SnapPool *snappool_new(int interval, int64_t limit, SnapFreeFunc free_snap)
+{
+	SnapPool *pool = g_new0(SnapPool, 1);
+
+	pool->entries = g_array_new(FALSE, FALSE, sizeof(SnapEntry));
+	pool->limit = limit;
+	pool->interval = interval;
+	pool->free_snap = free_snap;
+
+	return pool;
+}
+
+void snappool_free(SnapPool *pool)
+{
+	for (unsigned i = 0; i < pool->entries->len; i++)
+		pool->free_snap(g_array_index(pool->entries, SnapEntry, i).snap);
+
+	g_array_free(pool->entries, TRUE);
+	g_free(pool);
+}
+
+/* index of the first entry after <time> */
+static unsigned find_after(SnapPool *pool, int time)
+{
+	unsigned i = 0;
+
+	while (i < pool->entries->len && g_array_index(pool->entries, SnapEntry, i).time <= time)
+		i++;
+
+	return i;
+}
+
+int snappool_next(SnapPool *pool, int time)
+{
+	unsigned i = find_after(pool, time);
+
+	if (i == 0)
+		return time;
+
+	/* after seeking back, the snapshots ahead are still valid */
+	return MAX(g_array_index(pool->entries, SnapEntry, i - 1).time + pool->interval, time);
+}
+
+bool_t snappool_due(SnapPool *pool, int time)
+{
+	return snappool_next(pool, time) <= time;
+}
+
+static void thin_out(SnapPool *pool)
+{
+	unsigned kept = 0;
+
+	for (unsigned i = 0; i < pool->entries->len; i++)
+	{
+		SnapEntry *e = &g_array_index(pool->entries, SnapEntry, i);
+
+		if (i % 2)
+		{
+			pool->total -= e->size;
+			pool->free_snap(e->snap);
+		}
+		else
+			g_array_index(pool->entries, SnapEntry, kept++) = *e;
+	}
+
+	g_array_set_size(pool->entries, kept);
+	pool->interval *= 2;
+}
+
+void snappool_add(SnapPool *pool, int time, void *snap, int64_t size)
+{
+	SnapEntry e = {time, snap, size};
+
+	g_array_insert_val(pool->entries, find_after(pool, time), e);
+	pool->total += size;
+
+	while (pool->total > pool->limit && pool->entries->len > 1)
+		thin_out(pool);
+}
+
+void *snappool_find(SnapPool *pool, int time, int *snap_time)
+{
+	if (!pool->entries->len)
+		return NULL;
+
+	unsigned i = find_after(pool, time);
+	SnapEntry *e = &g_array_index(pool->entries, SnapEntry, i ? i - 1 : 0);
+
+	*snap_time = e->time;
+	return e->snap;
+}
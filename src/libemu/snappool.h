@@ -0,0 +1,60 @@
+/*
+ * Pool of emulator snapshots for seeking
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef SNAPPOOL_H
+#define SNAPPOOL_H
+
+#include <stdint.h>
+
+#include <libaudcore/core.h>
+
+/*
+ * Emulated formats can only seek forward, by running the emulation without
+ * output.  During playback, the state of the emulator is saved every few
+ * seconds; a seek then starts from the last snapshot before the target
+ * instead of from the beginning of the song.  Snapshots are kept in order of
+ * time.  Once together they would take more than the pool's limit, every
+ * second one is dropped and the interval between snapshots is doubled.
+ *
+ * Times are in whatever unit the caller counts in (milliseconds for psf and
+ * xsf, samples for console); the pool only compares them.
+ */
+
+typedef void (*SnapFreeFunc)(void *snap);
+
+typedef struct SnapPool SnapPool;
+
+/* <interval> is the initial time between snapshots, <limit> in bytes. */
+SnapPool *snappool_new(int interval, int64_t limit, SnapFreeFunc free_snap);
+void snappool_free(SnapPool *pool);
+
+/* The time at which the next snapshot after <time> is due; <time> itself if
+ * one is due already. */
+int snappool_next(SnapPool *pool, int time);
+/* Whether a snapshot should be added at <time>. */
+bool_t snappool_due(SnapPool *pool, int time);
+/* Takes ownership of <snap>, a snapshot of <size> bytes at <time>. */
+void snappool_add(SnapPool *pool, int time, void *snap, int64_t size);
+/* Returns the last snapshot at or before <time>, or the first one if there
+ * is none, and its time in *snap_time; NULL if the pool is empty. */
+void *snappool_find(SnapPool *pool, int time, int *snap_time);
+
+#endif
@@ -17,10 +17,10 @@
  * the use of this software.
  */
 
-/* TODO: implement more surround converters */
-
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <glib.h>
 
@@ -29,137 +29,311 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/preferences.h>
 
-typedef void (* Converter) (float * * data, int * samples);
+#include "../libdsp/dsp.h"
+
+enum {
+    FRONT_LEFT,
+    FRONT_RIGHT,
+    FRONT_CENTER,
+    LFE,
+    BACK_LEFT,
+    BACK_RIGHT,
+    SIDE_LEFT,
+    SIDE_RIGHT,
+    BACK_CENTER
+};
+
+#define MAX_LAYOUT 8
+
+/* the usual channel order (as in WAVE, FLAC, etc.) for each channel count */
+static const signed char layouts[MAX_LAYOUT + 1][MAX_LAYOUT] = {
+    {},
+    {FRONT_CENTER},
+    {FRONT_LEFT, FRONT_RIGHT},
+    {FRONT_LEFT, FRONT_RIGHT, FRONT_CENTER},
+    {FRONT_LEFT, FRONT_RIGHT, BACK_LEFT, BACK_RIGHT},
+    {FRONT_LEFT, FRONT_RIGHT, FRONT_CENTER, BACK_LEFT, BACK_RIGHT},
+    {FRONT_LEFT, FRONT_RIGHT, FRONT_CENTER, LFE, BACK_LEFT, BACK_RIGHT},
+    {FRONT_LEFT, FRONT_RIGHT, FRONT_CENTER, LFE, BACK_CENTER, SIDE_LEFT, SIDE_RIGHT},
+    {FRONT_LEFT, FRONT_RIGHT, FRONT_CENTER, LFE, BACK_LEFT, BACK_RIGHT, SIDE_LEFT, SIDE_RIGHT}
+};
+
+static int input_channels, output_channels;
+static bool_t passthrough;
 
+/* matrix[out * input_channels + in] */
+static float matrix[AUD_MAX_CHANNELS * AUD_MAX_CHANNELS];
 static float * mixer_buf;
 
-static void mono_to_stereo (float * * data, int * samples)
+static int find_speaker (int channels, int speaker)
 {
-    int frames = * samples;
-    float * get = * data;
-    float * set = mixer_buf = g_renew (float, mixer_buf, 2 * frames);
-
-    * data = mixer_buf;
-    * samples = 2 * frames;
+    if (channels > MAX_LAYOUT)
+        return -1;
 
-    while (frames --)
+    for (int c = 0; c < channels; c ++)
     {
-        float val = * get ++;
-        * set ++ = val;
-        * set ++ = val;
+        if (layouts[channels][c] == speaker)
+            return c;
     }
+
+    return -1;
 }
 
-static void stereo_to_mono (float * * data, int * samples)
+/* Adds a speaker of the input to the matrix, folding it into its nearest
+ * neighbors if the output does not have it. */
+static void route (int in, int speaker, float weight, int depth)
 {
-    int frames = * samples / 2;
-    float * get = * data;
-    float * set = mixer_buf = g_renew (float, mixer_buf, frames);
+    int out = find_speaker (output_channels, speaker);
 
-    * data = mixer_buf;
-    * samples = frames;
+    if (out >= 0)
+    {
+        matrix[out * input_channels + in] += weight;
+        return;
+    }
+
+    if (weight == 0 || depth > 3)
+        return;
 
-    while (frames --)
+    /* quad sources have a level of their own, so that they keep the 0.7 of
+     * the old quad to stereo converter */
+    float center = aud_get_double ("mixer", "center_level");
+    float surround = aud_get_double ("mixer", (input_channels == 4) ?
+     "quad_surround_level" : "surround_level");
+
+    switch (speaker)
+    {
+    case FRONT_LEFT:
+    case FRONT_RIGHT:
+        route (in, FRONT_CENTER, weight * 0.5, depth + 1);
+        break;
+
+    case FRONT_CENTER:
+        /* a lone mono channel goes to both sides at full level */
+        if (input_channels == 1)
+            center = 1;
+
+        route (in, FRONT_LEFT, weight * center, depth + 1);
+        route (in, FRONT_RIGHT, weight * center, depth + 1);
+        break;
+
+    case LFE:
+        weight *= aud_get_double ("mixer", "lfe_level");
+        route (in, FRONT_LEFT, weight, depth + 1);
+        route (in, FRONT_RIGHT, weight, depth + 1);
+        break;
+
+    case BACK_LEFT:
+    case BACK_RIGHT:
+    case SIDE_LEFT:
+    case SIDE_RIGHT:
     {
-        float val = * get ++;
-        val += * get ++;
-        * set ++ = val / 2;
+        bool_t left = (speaker == BACK_LEFT || speaker == SIDE_LEFT);
+        bool_t back = (speaker == BACK_LEFT || speaker == BACK_RIGHT);
+        int pair = back ? (left ? SIDE_LEFT : SIDE_RIGHT) : (left ? BACK_LEFT : BACK_RIGHT);
+
+        /* back and side channels stand in for each other; if both are
+         * present in the input they share the output channel */
+        if (find_speaker (output_channels, pair) >= 0)
+            route (in, pair, (find_speaker (input_channels, pair) >= 0) ?
+             weight * M_SQRT1_2 : weight, depth + 1);
+        else
+            route (in, left ? FRONT_LEFT : FRONT_RIGHT, weight * surround, depth + 1);
+
+        break;
+    }
+
+    case BACK_CENTER:
+        route (in, BACK_LEFT, weight * M_SQRT1_2, depth + 1);
+        route (in, BACK_RIGHT, weight * M_SQRT1_2, depth + 1);
+        break;
     }
 }
 
-static void quadro_to_stereo (float * * data, int * samples)
+/* Feeds output speakers missing from the input from the front channels. */
+static void upmix (void)
 {
-    int frames = * samples / 4;
-    float * get = * data;
-    float * set = mixer_buf = g_renew (float, mixer_buf, 2 * frames);
+    int left = find_speaker (input_channels, FRONT_LEFT);
+    int right = find_speaker (input_channels, FRONT_RIGHT);
 
-    * data = mixer_buf;
-    * samples = 2 * frames;
+    if (left < 0 || right < 0)
+        return;
 
-    while (frames --)
+    float surround = aud_get_double ("mixer", "surround_level");
+
+    for (int out = 0; out < output_channels; out ++)
     {
-        float front_left  = * get ++;
-        float front_right = * get ++;
-        float back_left   = * get ++;
-        float back_right  = * get ++;
-        * set ++ = front_left + (back_left * 0.7);
-        * set ++ = front_right + (back_right * 0.7);
+        int speaker = layouts[output_channels][out];
+        float * row = matrix + out * input_channels;
+
+        if (find_speaker (input_channels, speaker) >= 0)
+            continue;
+
+        switch (speaker)
+        {
+        case FRONT_CENTER:
+            row[left] += 0.5;
+            row[right] += 0.5;
+            break;
+
+        case BACK_LEFT:
+        case SIDE_LEFT:
+            row[left] += surround;
+            break;
+
+        case BACK_RIGHT:
+        case SIDE_RIGHT:
+            row[right] += surround;
+            break;
+
+        case BACK_CENTER:
+            row[left] += surround * 0.5;
+            row[right] += surround * 0.5;
+            break;
+        }
     }
 }
 
-static void surround_5p1_to_stereo (float * * data, int * samples)
+static void normalize (void)
 {
-    int frames = * samples / 6;
-    float * get = * data;
-    float * set = mixer_buf = g_renew (float, mixer_buf, 2 * frames);
+    for (int out = 0; out < output_channels; out ++)
+    {
+        float * row = matrix + out * input_channels;
+        float sum = 0;
 
-    * data = mixer_buf;
-    * samples = 2 * frames;
+        for (int in = 0; in < input_channels; in ++)
+            sum += fabsf (row[in]);
 
-    while (frames --)
-    {
-        float front_left  = * get ++;
-        float front_right = * get ++;
-        float center = * get ++;
-        float lfe    = * get ++;
-        float rear_left   = * get ++;
-        float rear_right  = * get ++;
-        * set ++ = front_left + (center * 0.5) + (lfe * 0.5) + (rear_left * 0.5);
-        * set ++ = front_right + (center * 0.5) + (lfe * 0.5) + (rear_right * 0.5);
+        if (sum > 1)
+        {
+            for (int in = 0; in < input_channels; in ++)
+                row[in] /= sum;
+        }
     }
 }
 
-static Converter get_converter (int in, int out)
+static void build_matrix (void)
 {
-    if (in == 1 && out == 2)
-        return mono_to_stereo;
-    if (in == 2 && out == 1)
-        return stereo_to_mono;
-    if (in == 4 && out == 2)
-        return quadro_to_stereo;
-    if (in == 6 && out == 2)
-        return surround_5p1_to_stereo;
-
-    return NULL;
+    memset (matrix, 0, sizeof matrix);
+
+    /* channel counts without a usual layout are matched up one to one */
+    if (input_channels > MAX_LAYOUT || output_channels > MAX_LAYOUT)
+    {
+        for (int c = 0; c < input_channels && c < output_channels; c ++)
+            matrix[c * input_channels + c] = 1;
+
+        return;
+    }
+
+    for (int in = 0; in < input_channels; in ++)
+        route (in, layouts[input_channels][in], 1, 0);
+
+    if (aud_get_bool ("mixer", "upmix"))
+        upmix ();
+    if (aud_get_bool ("mixer", "normalize"))
+        normalize ();
 }
 
-static int input_channels, output_channels;
+/* The custom matrix has one row of input channel weights per output channel,
+ * with rows separated by semicolons: for example "1 0 0.7 0; 0 1 0 0.7". */
+static bool_t parse_matrix (const char * text)
+{
+    int row = 0, col = 0;
+
+    memset (matrix, 0, sizeof matrix);
+
+    while (1)
+    {
+        while (* text == ' ' || * text == '\t' || * text == ',')
+            text ++;
+
+        if (! * text || * text == ';')
+        {
+            if (col > 0 || * text)
+            {
+                if (col != input_channels)
+                    return FALSE;
+
+                row ++;
+                col = 0;
+            }
+
+            if (! * text ++)
+                break;
+
+            continue;
+        }
+
+        char * end;
+        double value = strtod (text, & end);
+
+        if (end == text || row >= output_channels || col >= input_channels)
+            return FALSE;
+
+        matrix[row * input_channels + col ++] = value;
+        text = end;
+    }
+
+    return (row == output_channels);
+}
 
 void mixer_start (int * channels, int * rate)
 {
     input_channels = * channels;
     output_channels = aud_get_int ("mixer", "channels");
+    passthrough = FALSE;
 
-    if (input_channels == output_channels)
-        return;
-
-    if (! get_converter (input_channels, output_channels))
+    if (aud_get_bool ("mixer", "custom"))
     {
-        fprintf (stderr, "Converting %d to %d channels is not implemented.\n",
+        if (parse_matrix (aud_get_str ("mixer", "matrix")))
+        {
+            * channels = output_channels;
+            return;
+        }
+
+        fprintf (stderr, "Custom matrix does not convert %d to %d channels.\n",
          input_channels, output_channels);
+    }
+
+    if (input_channels == output_channels)
+    {
+        passthrough = TRUE;
         return;
     }
 
+    build_matrix ();
     * channels = output_channels;
 }
 
 void mixer_process (float * * data, int * samples)
 {
-    if (input_channels == output_channels)
+    if (passthrough)
         return;
 
-    Converter converter = get_converter (input_channels, output_channels);
-    if (converter)
-        converter (data, samples);
+    int frames = * samples / input_channels;
+    mixer_buf = g_renew (float, mixer_buf, output_channels * frames);
+
+    dsp_channel_matrix (* data, input_channels, mixer_buf, output_channels, matrix, frames);
+
+    * data = mixer_buf;
+    * samples = output_channels * frames;
 }
 
 static const char * const mixer_defaults[] = {
  "channels", "2",
+ "center_level", "0.5",
+ "surround_level", "0.5",
+ "quad_surround_level", "0.7",
+ "lfe_level", "0.5",
+ "normalize", "FALSE",
+ "upmix", "FALSE",
+ "custom", "FALSE",
+ "matrix", "",
   NULL};
 
 static bool_t mixer_init (void)
 {
     aud_config_set_defaults ("mixer", mixer_defaults);
+    dsp_init ();
     return TRUE;
 }
 
@@ -177,7 +351,32 @@ static const PreferencesWidget mixer_widgets[] = {
     WidgetLabel (N_("<b>Channel Mixer</b>")),
     WidgetSpin (N_("Output channels:"),
         {VALUE_INT, 0, "mixer", "channels"},
-        {1, AUD_MAX_CHANNELS, 1})
+        {1, AUD_MAX_CHANNELS, 1}),
+    WidgetLabel (N_("<b>Downmix</b>")),
+    WidgetSpin (N_("Center level:"),
+        {VALUE_FLOAT, 0, "mixer", "center_level"},
+        {0, 1, 0.05}),
+    WidgetSpin (N_("Surround level:"),
+        {VALUE_FLOAT, 0, "mixer", "surround_level"},
+        {0, 1, 0.05}),
+    WidgetSpin (N_("Surround level (4 channels):"),
+        {VALUE_FLOAT, 0, "mixer", "quad_surround_level"},
+        {0, 1, 0.05}),
+    WidgetSpin (N_("LFE level:"),
+        {VALUE_FLOAT, 0, "mixer", "lfe_level"},
+        {0, 1, 0.05}),
+    WidgetCheck (N_("Normalize to avoid clipping"),
+        {VALUE_BOOLEAN, 0, "mixer", "normalize"}),
+    WidgetLabel (N_("<b>Upmix</b>")),
+    WidgetCheck (N_("Fill center and surround channels from front channels"),
+        {VALUE_BOOLEAN, 0, "mixer", "upmix"}),
+    WidgetLabel (N_("<b>Custom Matrix</b>")),
+    WidgetCheck (N_("Use custom matrix"),
+        {VALUE_BOOLEAN, 0, "mixer", "custom"}),
+    WidgetEntry (N_("Rows (one per output channel, separated by ;):"),
+        {VALUE_STRING, 0, "mixer", "matrix"},
+        {false},
+        WIDGET_CHILD)
 };
 
 static const PluginPreferences mixer_prefs = {
@@ -0,0 +1,96 @@
+/* Modplug XMMS Plugin
+ * gzip support written by the Audacious Team, 2014,
+ * after the archive classes of Kenton Varda.
+ *
+ * This source code is public domain.
+ */
+
+#include <cstdlib>
+#include <zlib.h>
+
+#include "arch_gzip.h"
+#include "arch_raw.h"
+
+using namespace std;
+
+//The module is decompressed in memory with zlib; no temporary files.
+arch_Gzip::arch_Gzip(const string& aFileName)
+{
+    mSize = 0;
+    mMap = NULL;
+
+    arch_Raw lRaw(aFileName);
+    const unsigned char *lData = (const unsigned char *)lRaw.Map();
+    uint32_t lLength = lRaw.Size();
+
+    if (lLength < 18)
+        return;
+
+    //the trailer holds the uncompressed size (modulo 4 GB), but anyone can
+    //write anything there: take it only as a hint for the first allocation
+    //and grow the buffer as needed
+    const unsigned char *lTrailer = lData + lLength - 4;
+    uint32_t lAlloc = lTrailer[0] | (lTrailer[1] << 8) | (lTrailer[2] << 16) |
+     ((uint32_t)lTrailer[3] << 24);
+    uint32_t lGuess = (lLength < MaxInflatedSize / 4) ? lLength * 4 : MaxInflatedSize;
+    if (lAlloc == 0 || lAlloc > lGuess)
+        lAlloc = lGuess;
+
+    z_stream lStream = z_stream();
+    if (inflateInit2(&lStream, 15 + 32) != Z_OK)
+        return;
+
+    unsigned char *lOut = (unsigned char *)malloc(lAlloc);
+    lStream.next_in = (Bytef *)lData;
+    lStream.avail_in = lLength;
+
+    int lResult = Z_OK;
+    while (lOut && lResult == Z_OK)
+    {
+        if (lStream.total_out == lAlloc)
+        {
+            if (lAlloc == MaxInflatedSize)
+                break;
+            lAlloc = (lAlloc < MaxInflatedSize / 2) ? lAlloc * 2 : MaxInflatedSize;
+            unsigned char *lNew = (unsigned char *)realloc(lOut, lAlloc);
+            if (!lNew)
+                break;
+            lOut = lNew;
+        }
+
+        lStream.next_out = lOut + lStream.total_out;
+        lStream.avail_out = lAlloc - lStream.total_out;
+        lResult = inflate(&lStream, Z_NO_FLUSH);
+    }
+
+    if (lResult == Z_STREAM_END && lStream.total_out > 0)
+    {
+        mMap = lOut;
+        mSize = lStream.total_out;
+    }
+    else
+        free(lOut);
+
+    inflateEnd(&lStream);
+}
+
+arch_Gzip::~arch_Gzip()
+{
+    free(mMap);
+}
+
+bool arch_Gzip::IsGzipName(const string& aFileName)
+{
+    return HasSuffix(aFileName, ".gz") || HasSuffix(aFileName, ".mdgz") ||
+     HasSuffix(aFileName, ".s3gz") || HasSuffix(aFileName, ".xmgz") ||
+     HasSuffix(aFileName, ".itgz");
+}
+
+bool arch_Gzip::ContainsMod(const string& aFileName)
+{
+    //song.mod.gz holds song.mod; the other names are modules by definition
+    if (HasSuffix(aFileName, ".gz"))
+        return IsOurFile(aFileName.substr(0, aFileName.length() - 3));
+
+    return IsGzipName(aFileName);
+}
@@ -0,0 +1,23 @@
+/* Modplug XMMS Plugin
+ * gzip support written by the Audacious Team, 2014,
+ * after the archive classes of Kenton Varda.
+ *
+ * This source code is public domain.
+ */
+
+#ifndef __MODPLUG_ARCH_GZIP_H__INCLUDED__
+#define __MODPLUG_ARCH_GZIP_H__INCLUDED__
+
+#include "archive.h"
+
+class arch_Gzip: public Archive
+{
+public:
+    arch_Gzip(const std::string& aFileName);
+    virtual ~arch_Gzip();
+
+    static bool IsGzipName(const std::string& aFileName);
+    static bool ContainsMod(const std::string& aFileName);
+};
+
+#endif
@@ -5,6 +5,12 @@
  */
 
 #include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <libaudcore/audstrings.h>
 
 #include "arch_raw.h"
 
@@ -12,38 +18,71 @@ using namespace std;
 
 arch_Raw::arch_Raw(const string& aFileName)
 {
-    mFileDesc = vfs_fopen(aFileName.c_str(), "r");
-    if (!mFileDesc)
-    {
-        mSize = 0;
+    mSize = 0;
+    mMap = NULL;
+    mMapped = false;
+
+    //local files are mapped rather than copied
+    StringBuf lPath = uri_to_filename(aFileName.c_str());
+    if (lPath && MapFile(lPath))
         return;
-    }
 
-    mSize = vfs_fsize(mFileDesc);
-    if (mSize <= 0)
+    VFSFile *lFileDesc = vfs_fopen(aFileName.c_str(), "r");
+    if (!lFileDesc)
+        return;
+
+    int64_t lSize = vfs_fsize(lFileDesc);
+    if (lSize <= 0 || lSize > UINT32_MAX)
     {
-        vfs_fclose(mFileDesc);
-        mSize = 0;
+        vfs_fclose(lFileDesc);
         return;
     }
 
-    mMap = malloc(mSize);
-    if (vfs_fread(mMap, 1, mSize, mFileDesc) < mSize)
+    mMap = malloc(lSize);
+    if (!mMap || vfs_fread(mMap, 1, lSize, lFileDesc) < lSize)
     {
         free(mMap);
-        vfs_fclose(mFileDesc);
-        mSize = 0;
+        mMap = NULL;
+        vfs_fclose(lFileDesc);
         return;
     }
+
+    vfs_fclose(lFileDesc);
+    mSize = lSize;
 }
 
-arch_Raw::~arch_Raw()
+bool arch_Raw::MapFile(const char* aPath)
 {
-    if(mSize != 0)
+    int lFD = open(aPath, O_RDONLY);
+    if (lFD < 0)
+        return false;
+
+    struct stat lInfo;
+    if (fstat(lFD, &lInfo) < 0 || !S_ISREG(lInfo.st_mode) ||
+     lInfo.st_size <= 0 || lInfo.st_size > UINT32_MAX)
     {
-        free(mMap);
-        vfs_fclose(mFileDesc);
+        close(lFD);
+        return false;
     }
+
+    void *lMap = mmap(NULL, lInfo.st_size, PROT_READ, MAP_PRIVATE, lFD, 0);
+    close(lFD);
+
+    if (lMap == MAP_FAILED)
+        return false;
+
+    mMap = lMap;
+    mSize = lInfo.st_size;
+    mMapped = true;
+    return true;
+}
+
+arch_Raw::~arch_Raw()
+{
+    if (mMapped)
+        munmap(mMap, mSize);
+    else
+        free(mMap);
 }
 
 bool arch_Raw::ContainsMod(const string& aFileName)
@@ -13,7 +13,9 @@
 
 class arch_Raw: public Archive
 {
-    VFSFile *mFileDesc;
+    bool mMapped;   //mMap is a memory mapping of a local file
+
+    bool MapFile(const char* aPath);
 
 public:
     arch_Raw(const std::string& aFileName);
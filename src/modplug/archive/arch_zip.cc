@@ -0,0 +1,168 @@
+/* Modplug XMMS Plugin
+ * zip support written by the Audacious Team, 2014,
+ * after the archive classes of Kenton Varda.
+ *
+ * This source code is public domain.
+ */
+
+#include <cstdlib>
+#include <zlib.h>
+
+#include "arch_zip.h"
+#include "arch_raw.h"
+
+using namespace std;
+
+static uint32_t Read16(const unsigned char* aData)
+{
+    return aData[0] | (aData[1] << 8);
+}
+
+static uint32_t Read32(const unsigned char* aData)
+{
+    return aData[0] | (aData[1] << 8) | (aData[2] << 16) | ((uint32_t)aData[3] << 24);
+}
+
+//Looks through the central directory for the first module that is stored or
+//deflated.  Gives the offset of its data within the zip file.
+bool arch_Zip::FindModule(const unsigned char* aData, uint32_t aLength,
+ uint32_t* aMethod, uint32_t* aOffset, uint32_t* aCSize, uint32_t* aUSize)
+{
+    const unsigned char* lEnd = NULL;
+
+    //the end record is followed by a comment of up to 64 KB
+    for (int64_t i = (int64_t)aLength - 22; i >= 0 && i >= (int64_t)aLength - 22 - 65535; i--)
+    {
+        if (Read32(aData + i) == 0x06054b50)
+        {
+            lEnd = aData + i;
+            break;
+        }
+    }
+
+    if (!lEnd)
+        return false;
+
+    uint32_t lCount = Read16(lEnd + 10);
+    uint32_t lPos = Read32(lEnd + 16);
+
+    for (uint32_t i = 0; i < lCount; i++)
+    {
+        if (lPos > aLength || aLength - lPos < 46)
+            return false;
+
+        const unsigned char* lEntry = aData + lPos;
+        if (Read32(lEntry) != 0x02014b50)
+            return false;
+
+        uint32_t lFlags = Read16(lEntry + 8);
+        uint32_t lMethod = Read16(lEntry + 10);
+        uint32_t lNameLen = Read16(lEntry + 28);
+        uint32_t lLocal = Read32(lEntry + 42);
+
+        if (aLength - lPos - 46 < lNameLen)
+            return false;
+
+        string lName((const char*)lEntry + 46, lNameLen);
+
+        //skip encrypted entries and compression methods zlib can't handle
+        if (!(lFlags & 1) && (lMethod == 0 || lMethod == 8) && IsOurFile(lName) &&
+         lLocal <= aLength && aLength - lLocal >= 30 &&
+         Read32(aData + lLocal) == 0x04034b50)
+        {
+            uint32_t lData = lLocal + 30 + Read16(aData + lLocal + 26) +
+             Read16(aData + lLocal + 28);
+            uint32_t lCSize = Read32(lEntry + 20);
+
+            if (lData <= aLength && aLength - lData >= lCSize)
+            {
+                *aMethod = lMethod;
+                *aOffset = lData;
+                *aCSize = lCSize;
+                *aUSize = Read32(lEntry + 24);
+                return true;
+            }
+        }
+
+        lPos += 46 + lNameLen + Read16(lEntry + 30) + Read16(lEntry + 32);
+    }
+
+    return false;
+}
+
+//A stored module is used in place; a deflated one is inflated in memory.
+arch_Zip::arch_Zip(const string& aFileName)
+{
+    mSize = 0;
+    mMap = NULL;
+    mInflated = false;
+    mRaw = new arch_Raw(aFileName);
+
+    const unsigned char* lData = (const unsigned char*)mRaw->Map();
+    uint32_t lMethod, lOffset, lCSize, lUSize;
+
+    if (!mRaw->Size() || !FindModule(lData, mRaw->Size(), &lMethod, &lOffset, &lCSize, &lUSize))
+        return;
+
+    if (lMethod == 0)
+    {
+        mMap = (void*)(lData + lOffset);
+        mSize = lCSize;
+        return;
+    }
+
+    //the central directory is trusted no further than the gzip trailer
+    if (lUSize == 0 || lUSize > MaxInflatedSize)
+        return;
+
+    z_stream lStream = z_stream();
+    if (inflateInit2(&lStream, -15) != Z_OK)
+        return;
+
+    unsigned char* lOut = (unsigned char*)malloc(lUSize);
+    if (lOut)
+    {
+        lStream.next_in = (Bytef*)(lData + lOffset);
+        lStream.avail_in = lCSize;
+        lStream.next_out = lOut;
+        lStream.avail_out = lUSize;
+
+        if (inflate(&lStream, Z_FINISH) == Z_STREAM_END && lStream.total_out == lUSize)
+        {
+            mMap = lOut;
+            mSize = lUSize;
+            mInflated = true;
+        }
+        else
+            free(lOut);
+    }
+
+    inflateEnd(&lStream);
+}
+
+arch_Zip::~arch_Zip()
+{
+    if (mInflated)
+        free(mMap);
+
+    delete mRaw;
+}
+
+bool arch_Zip::IsZipName(const string& aFileName)
+{
+    return HasSuffix(aFileName, ".zip") || HasSuffix(aFileName, ".mdz") ||
+     HasSuffix(aFileName, ".s3z") || HasSuffix(aFileName, ".xmz") ||
+     HasSuffix(aFileName, ".itz");
+}
+
+bool arch_Zip::ContainsMod(const string& aFileName)
+{
+    if (!IsZipName(aFileName))
+        return false;
+
+    arch_Raw lRaw(aFileName);
+    uint32_t lMethod, lOffset, lCSize, lUSize;
+
+    return lRaw.Size() && FindModule((const unsigned char*)lRaw.Map(),
+     lRaw.Size(), &lMethod, &lOffset, &lCSize, &lUSize);
+}
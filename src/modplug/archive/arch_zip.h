@@ -0,0 +1,31 @@
+/* Modplug XMMS Plugin
+ * zip support written by the Audacious Team, 2014,
+ * after the archive classes of Kenton Varda.
+ *
+ * This source code is public domain.
+ */
+
+#ifndef __MODPLUG_ARCH_ZIP_H__INCLUDED__
+#define __MODPLUG_ARCH_ZIP_H__INCLUDED__
+
+#include "archive.h"
+
+class arch_Raw;
+
+class arch_Zip: public Archive
+{
+    arch_Raw *mRaw;     //the zip file itself
+    bool mInflated;     //mMap was allocated, rather than pointing into mRaw
+
+    static bool FindModule(const unsigned char* aData, uint32_t aLength,
+     uint32_t* aMethod, uint32_t* aOffset, uint32_t* aCSize, uint32_t* aUSize);
+
+public:
+    arch_Zip(const std::string& aFileName);
+    virtual ~arch_Zip();
+
+    static bool IsZipName(const std::string& aFileName);
+    static bool ContainsMod(const std::string& aFileName);
+};
+
+#endif
@@ -4,21 +4,30 @@
  * This source code is public domain.
  */
 
+#include <cctype>
+#include <cstring>
+
 #include "archive.h"
 
 using namespace std;
 
-///* Open a read pipe */ File f;
-//f=popen("gzip -d compressed.file.name","r");
-///* Read some data in the usual manner, for example */
-//fscanf(f,"%d %f %f",name,&age,$id);
-///* Close the pipe */
-//pclose(f);
-
 Archive::~Archive()
 {
 }
 
+bool Archive::HasSuffix(const string& aFileName, const char* aSuffix)
+{
+    uint32_t lLen = strlen(aSuffix);
+    if (aFileName.length() <= lLen)
+        return false;
+
+    for (uint32_t i = 0; i < lLen; i++)
+        if (tolower((unsigned char)aFileName[aFileName.length() - lLen + i]) != aSuffix[i])
+            return false;
+
+    return true;
+}
+
 bool Archive::IsOurFile(const string& aFileName)
 {
     string lExt;
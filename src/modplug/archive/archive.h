@@ -16,8 +16,14 @@ protected:
     uint32_t mSize;
     void* mMap;
 
+    //Compressed archives are not trusted to state their own size; nothing
+    //is inflated beyond this.
+    static const uint32_t MaxInflatedSize = 256 << 20;
+
     //This version of IsOurFile is slightly different...
     static bool IsOurFile(const std::string& aFileName);
+    //aSuffix is in lower case
+    static bool HasSuffix(const std::string& aFileName, const char* aSuffix);
 
 public:
     virtual ~Archive();
@@ -6,10 +6,32 @@
 
 #include "open.h"
 #include "arch_raw.h"
+#include "arch_gzip.h"
+#include "arch_zip.h"
 
 using namespace std;
 
 Archive* OpenArchive(const string& aFileName) //aFilename is url --yaz
 {
+    if (arch_Gzip::IsGzipName(aFileName))
+        return new arch_Gzip(aFileName);
+    if (arch_Zip::IsZipName(aFileName))
+        return new arch_Zip(aFileName);
+
     return new arch_Raw(aFileName);
 }
+
+bool IsArchiveName(const string& aFileName)
+{
+    return arch_Gzip::IsGzipName(aFileName) || arch_Zip::IsZipName(aFileName);
+}
+
+bool ContainsMod(const string& aFileName)
+{
+    if (arch_Gzip::IsGzipName(aFileName))
+        return arch_Gzip::ContainsMod(aFileName);
+    if (arch_Zip::IsZipName(aFileName))
+        return arch_Zip::ContainsMod(aFileName);
+
+    return arch_Raw::ContainsMod(aFileName);
+}
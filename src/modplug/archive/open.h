@@ -10,6 +10,7 @@
 #include "archive.h"
 
 Archive* OpenArchive(const std::string& aFileName);
+bool IsArchiveName(const std::string& aFileName);
 bool ContainsMod(const std::string& aFileName);
 
 #endif
@@ -21,6 +21,7 @@
 #include <libaudcore/input.h>
 
 #include "archive/open.h"
+#include "../libdsp/dsp.h"
 
 using namespace std;
 
@@ -44,6 +45,10 @@ bool ModplugXMMS::CanPlayFileFromVFS(const string& aFilename, VFSFile *file)
     const int magicSize = 32;
     char magic[magicSize];
 
+    //compressed modules are known by the name of the file inside
+    if (IsArchiveName(aFilename))
+        return ContainsMod(aFilename);
+
     if (vfs_fread(magic, 1, magicSize, file) < magicSize)
         return false;
     if (!memcmp(magic, UMX_MAGIC, 4))
@@ -144,6 +149,38 @@ bool ModplugXMMS::CanPlayFileFromVFS(const string& aFilename, VFSFile *file)
     return false;
 }
 
+// Preamp for integer output.  Samples saturate at the limits of their range.
+
+static void ApplyGainU8(unsigned char *aData, uint32_t aCount, float aGain)
+{
+    for (uint32_t i = 0; i < aCount; i++)
+    {
+        float f = (aData[i] - 128) * aGain;
+        f = (f < -128) ? -128 : (f > 127) ? 127 : f;
+        aData[i] = (int)f + 128;
+    }
+}
+
+static void ApplyGainS16(int16_t *aData, uint32_t aCount, float aGain)
+{
+    for (uint32_t i = 0; i < aCount; i++)
+    {
+        float f = aData[i] * aGain;
+        f = (f < -32768) ? -32768 : (f > 32767) ? 32767 : f;
+        aData[i] = (int16_t)f;
+    }
+}
+
+// Converts 32-bit mixer output to floating point, with the preamp folded into
+// the scale factor.  The mixer has already clipped its output to full scale;
+// anything the preamp adds on top is left to the output chain, which has the
+// headroom for it.
+static void ConvertS32ToFloat(const void *aData, float *aOut, uint32_t aCount, float aGain)
+{
+    const int32_t *in = (const int32_t *)aData;
+    dsp_interleave_int(&in, aOut, 1, aCount, aGain / 2147483648.0f);
+}
+
 void ModplugXMMS::PlayLoop()
 {
     uint32_t lLength;
@@ -160,33 +197,21 @@ void ModplugXMMS::PlayLoop()
         if (! lLength)
             break;
 
+        //apply preamp (only allocated for 32-bit output)
+        if(mFloatBuffer)
+        {
+            ConvertS32ToFloat(mBuffer, mFloatBuffer, mBufSize >> 2,
+             mModProps.mPreamp ? mPreampFactor : 1);
+            aud_input_write_audio (mFloatBuffer, mBufSize);
+            continue;
+        }
+
         if(mModProps.mPreamp)
         {
-            //apply preamp
             if(mModProps.mBits == 16)
-            {
-                unsigned n = mBufSize >> 1;
-                for(unsigned i = 0; i < n; i++) {
-                    short old = ((short*)mBuffer)[i];
-                    ((short*)mBuffer)[i] *= (short int)mPreampFactor;
-                    // detect overflow and clip!
-                    if ((old & 0x8000) !=
-                     (((short*)mBuffer)[i] & 0x8000))
-                      ((short*)mBuffer)[i] = old | 0x7FFF;
-
-                }
-            }
+                ApplyGainS16((int16_t*)mBuffer, mBufSize >> 1, mPreampFactor);
             else
-            {
-                for(unsigned i = 0; i < mBufSize; i++) {
-                    unsigned char old = ((unsigned char*)mBuffer)[i];
-                    ((unsigned char*)mBuffer)[i] *= (short int)mPreampFactor;
-                    // detect overflow and clip!
-                    if ((old & 0x80) !=
-                     (((unsigned char*)mBuffer)[i] & 0x80))
-                      ((unsigned char*)mBuffer)[i] = old | 0x7F;
-                }
-            }
+                ApplyGainU8(mBuffer, mBufSize, mPreampFactor);
         }
 
         aud_input_write_audio (mBuffer, mBufSize);
@@ -201,6 +226,9 @@ void ModplugXMMS::PlayLoop()
         delete [] mBuffer;
         mBuffer = NULL;
     }
+
+    delete [] mFloatBuffer;
+    mFloatBuffer = NULL;
 }
 
 bool ModplugXMMS::PlayFile(const string& aFilename)
@@ -216,6 +244,9 @@ bool ModplugXMMS::PlayFile(const string& aFilename)
     if (mBuffer)
         delete [] mBuffer;
 
+    delete [] mFloatBuffer;
+    mFloatBuffer = NULL;
+
     //find buftime to get approx. 512 samples/block
     mBufTime = 512000 / mModProps.mFrequency + 1;
 
@@ -229,6 +260,9 @@ bool ModplugXMMS::PlayFile(const string& aFilename)
     if(!mBuffer)
         return false;        //out of memory!
 
+    if(mModProps.mBits == 32)
+        mFloatBuffer = new float[mBufSize >> 2];
+
     CSoundFile::SetWaveConfig
     (
         mModProps.mFrequency,
@@ -289,7 +323,8 @@ bool ModplugXMMS::PlayFile(const string& aFilename)
 
     aud_input_set_bitrate(mSoundFile->GetNumChannels() * 1000);
 
-    int fmt = (mModProps.mBits == 16) ? FMT_S16_NE : FMT_U8;
+    int fmt = (mModProps.mBits == 32) ? FMT_FLOAT :
+     (mModProps.mBits == 16) ? FMT_S16_NE : FMT_U8;
     if (! aud_input_open_audio(fmt, mModProps.mFrequency, mModProps.mChannels))
         return false;
 
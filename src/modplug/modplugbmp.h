@@ -56,6 +56,7 @@ public:
 
 private:
     unsigned char*  mBuffer;
+    float*    mFloatBuffer; //32-bit output converted for the output chain
     uint32_t  mBufSize;
 
     ModplugSettings mModProps;
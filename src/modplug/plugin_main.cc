@@ -13,12 +13,14 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/preferences.h>
 
+#include "../libdsp/dsp.h"
+
 #define MODPLUG_CFGID "modplug"
 
 static const char * fmts[] =
     { "amf", "ams", "dbm", "dbf", "dsm", "far", "mdl", "stm", "ult", "mt2",
       "mod", "s3m", "dmf", "umx", "it", "669", "xm", "mtm", "psm", "ft2",
-      NULL };
+      "mdz", "s3z", "xmz", "itz", "mdgz", "s3gz", "xmgz", "itgz", NULL };
 
 static const char * const modplug_defaults[] = {
  "Bits", "16",
@@ -57,6 +59,8 @@ static const PreferencesWidget quality_widgets[] = {
      & modplug_settings.mBits}, {8}),
     WidgetRadio (N_("16-bit"), {VALUE_INT,
      & modplug_settings.mBits}, {16}),
+    WidgetRadio (N_("Floating point"), {VALUE_INT,
+     & modplug_settings.mBits}, {32}),
     WidgetLabel (N_("<b>Channels</b>")),
     WidgetRadio (N_("Mono"), {VALUE_INT,
      & modplug_settings.mChannels}, {1}),
@@ -213,6 +217,7 @@ static void modplug_settings_save ()
 
 static bool_t modplug_init (void)
 {
+    dsp_init ();
     modplug_settings_load ();
     InitSettings (& modplug_settings);
     return TRUE;
@@ -37,6 +37,8 @@
 #include <libaudcore/preferences.h>
 #include <audacious/audtag.h>
 
+#include "seek_index.h"
+
 static const char * const mpg123_defaults[] = {
 	"full_scan", "FALSE",
 	nullptr
@@ -70,6 +72,20 @@ static off_t replace_lseek_dummy (void * file, off_t to, int whence)
 	return -1;
 }
 
+/* Only local VBR files get a saved index: mpg123 seeks CBR files exactly
+ * without one, and streams and remote files are not worth hashing.  The first
+ * frame must have been read (by mpg123_getformat) already. */
+static String get_index_key (const char * filename, VFSFile * file, mpg123_handle * dec)
+{
+	struct mpg123_frameinfo info;
+
+	if (vfs_is_streaming (file) || vfs_is_remote (filename) ||
+	 mpg123_info (dec, & info) != MPG123_OK || info.vbr == MPG123_CBR)
+		return String ();
+
+	return seek_index_key (file);
+}
+
 /** plugin glue **/
 static bool_t aud_mpg123_init (void)
 {
@@ -197,7 +213,12 @@ static Tuple mpg123_probe_for_tuple (const char * filename, VFSFile * file)
 	struct mpg123_frameinfo info;
 	char scratch[32];
 
+	String index_key;
+	int64_t index_samples = -1;
+	bool_t scan = FALSE;
+
 	mpg123_param (decoder, MPG123_ADD_FLAGS, DECODE_OPTIONS, 0);
+	mpg123_param (decoder, MPG123_INDEX_SIZE, SEEK_INDEX_SIZE, 0);
 
 	if (stream)
 		mpg123_replace_reader_handle (decoder, replace_read, replace_lseek_dummy, NULL);
@@ -205,10 +226,22 @@ static Tuple mpg123_probe_for_tuple (const char * filename, VFSFile * file)
 		mpg123_replace_reader_handle (decoder, replace_read, replace_lseek, NULL);
 
 	if ((result = mpg123_open_handle (decoder, file)) < 0
-	 || (! stream && aud_get_bool ("mpg123", "full_scan") && (result = mpg123_scan (decoder)) < 0)
-	 || (result = mpg123_getformat (decoder, & rate, & channels, & encoding)) < 0
+	 || (result = mpg123_getformat (decoder, & rate, & channels, & encoding)) < 0)
+		goto PROBE_ERROR;
+
+	/* a saved index also has the exact length, so there is no need to scan */
+	if (! stream)
+	{
+		index_key = get_index_key (filename, file, decoder);
+
+		if (! (index_key && seek_index_load (index_key, NULL, & index_samples)))
+			scan = aud_get_bool ("mpg123", "full_scan");
+	}
+
+	if ((scan && (result = mpg123_scan (decoder)) < 0)
 	 || (result = mpg123_info (decoder, & info)) < 0)
 	{
+PROBE_ERROR:
 		fprintf (stderr, "mpg123 probe error for %s: %s\n", filename, mpg123_plain_strerror (result));
 		mpg123_delete (decoder);
 		return Tuple ();
@@ -223,10 +256,13 @@ static Tuple mpg123_probe_for_tuple (const char * filename, VFSFile * file)
 	tuple.set_str (FIELD_QUALITY, scratch);
 	tuple.set_int (FIELD_BITRATE, info.bitrate);
 
+	if (scan && index_key)
+		seek_index_save (index_key, decoder, mpg123_length (decoder));
+
 	if (! stream)
 	{
 		int64_t size = vfs_fsize (file);
-		int64_t samples = mpg123_length (decoder);
+		int64_t samples = (index_samples >= 0) ? index_samples : mpg123_length (decoder);
 		int length = (samples > 0 && rate > 0) ? samples * 1000 / rate : 0;
 
 		if (length > 0)
@@ -281,8 +317,12 @@ static bool_t mpg123_playback_worker (const char * filename, VFSFile * file)
 	ctx.stream = vfs_is_streaming (file);
 	ctx.tu = ctx.stream ? aud_input_get_tuple () : Tuple ();
 
+	String index_key;
+	bool_t indexed = FALSE, done = FALSE;
+
 	ctx.decoder = mpg123_new (NULL, NULL);
 	mpg123_param (ctx.decoder, MPG123_ADD_FLAGS, DECODE_OPTIONS, 0);
+	mpg123_param (ctx.decoder, MPG123_INDEX_SIZE, SEEK_INDEX_SIZE, 0);
 
 	if (ctx.stream)
 		mpg123_replace_reader_handle (ctx.decoder, replace_read, replace_lseek_dummy, NULL);
@@ -302,8 +342,22 @@ OPEN_ERROR:
 		goto cleanup;
 	}
 
-	if (! ctx.stream && aud_get_bool ("mpg123", "full_scan") && mpg123_scan (ctx.decoder) < 0)
-		goto OPEN_ERROR;
+	if (! ctx.stream && mpg123_getformat (ctx.decoder, & ctx.rate,
+	 & ctx.channels, & ctx.encoding) == MPG123_OK)
+		index_key = get_index_key (filename, file, ctx.decoder);
+
+	if (index_key && seek_index_load (index_key, ctx.decoder, NULL))
+		indexed = TRUE;
+	else if (! ctx.stream && aud_get_bool ("mpg123", "full_scan"))
+	{
+		if (mpg123_scan (ctx.decoder) < 0)
+			goto OPEN_ERROR;
+
+		if (index_key)
+			seek_index_save (index_key, ctx.decoder, mpg123_length (ctx.decoder));
+
+		indexed = TRUE;
+	}
 
 GET_FORMAT:
 	if (mpg123_getformat (ctx.decoder, & ctx.rate, & ctx.channels,
@@ -363,7 +417,10 @@ GET_FORMAT:
 		 (unsigned char *) outbuf, sizeof outbuf, & outbuf_size)) < 0)
 		{
 			if (ret == MPG123_DONE || ret == MPG123_ERR_READER)
+			{
+				done = (ret == MPG123_DONE);
 				break;
+			}
 
 			print_mpg123_error (filename, ctx.decoder);
 
@@ -382,6 +439,12 @@ GET_FORMAT:
 		}
 	}
 
+	/* Playing to the end indexes every frame, unless a seek went past the
+	 * indexed part, in which case the index is left incomplete. */
+	if (done && index_key && ! indexed && seek_index_complete (ctx.decoder,
+	 mpg123_tellframe (ctx.decoder)))
+		seek_index_save (index_key, ctx.decoder, mpg123_tell (ctx.decoder));
+
 cleanup:
 	mpg123_delete(ctx.decoder);
 	return ! error;
@@ -0,0 +1,292 @@
+/*
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "seek_index.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glib.h>
+#include <glib/gstdio.h>
+
+#include <libaudcore/audstrings.h>
+#include <libaudcore/runtime.h>
+
+/* The key is a checksum of this much data from each end of the file, together
+ * with its size.  Tags are included, so editing them (which may move the audio
+ * data) invalidates the index. */
+#define KEY_BLOCK 16384
+
+/* File format: the magic string, then the number of samples, the index step
+ * and the number of entries, the first offset, and the difference of each
+ * following offset from the one before.  All numbers are stored as unsigned
+ * LEB128, which usually takes two or three bytes per entry. */
+#define INDEX_MAGIC "AudMPGi1"
+#define INDEX_MAGIC_LEN 8
+
+/* Nothing removes an index when its file is deleted, so after each save the
+ * least recently used ones beyond this many are pruned.  Loading an index
+ * touches it, so its modification time records when it was last used. */
+#define MAX_INDEXES 1000
+
+typedef struct {
+	char * name;
+	time_t mtime;
+} IndexFile;
+
+static char * get_dir (void)
+{
+	return g_build_filename (aud_get_path (AUD_PATH_USER_DIR), "mpg123-index", NULL);
+}
+
+static char * get_path (const char * key)
+{
+	return g_build_filename (aud_get_path (AUD_PATH_USER_DIR), "mpg123-index", key, NULL);
+}
+
+static bool_t update_checksum (GChecksum * sum, VFSFile * file, int64_t pos, int64_t len)
+{
+	char buf[KEY_BLOCK];
+
+	if (vfs_fseek (file, pos, SEEK_SET) < 0 || vfs_fread (buf, 1, len, file) != len)
+		return FALSE;
+
+	g_checksum_update (sum, (const guchar *) buf, len);
+	return TRUE;
+}
+
+String seek_index_key (VFSFile * file)
+{
+	int64_t size = vfs_fsize (file);
+	int64_t pos = vfs_ftell (file);
+
+	if (size <= 0 || pos < 0)
+		return String ();
+
+	GChecksum * sum = g_checksum_new (G_CHECKSUM_SHA1);
+	String key;
+
+	if (update_checksum (sum, file, 0, MIN (size, KEY_BLOCK)) && (size <= KEY_BLOCK ||
+	 update_checksum (sum, file, MAX (size - KEY_BLOCK, KEY_BLOCK), MIN (size - KEY_BLOCK, KEY_BLOCK))))
+		key = String (str_printf ("%s-%lld", g_checksum_get_string (sum), (long long) size));
+
+	g_checksum_free (sum);
+
+	if (vfs_fseek (file, pos, SEEK_SET) < 0)
+		return String ();
+
+	return key;
+}
+
+static void put_number (GByteArray * buf, uint64_t n)
+{
+	do
+	{
+		guint8 byte = (n & 0x7f) | (n > 0x7f ? 0x80 : 0);
+		g_byte_array_append (buf, & byte, 1);
+		n >>= 7;
+	}
+	while (n);
+}
+
+static bool_t get_number (const guint8 * * data, const guint8 * end, uint64_t * n)
+{
+	* n = 0;
+
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (* data == end)
+			return FALSE;
+
+		guint8 byte = * (* data) ++;
+		* n |= (uint64_t) (byte & 0x7f) << shift;
+
+		if (! (byte & 0x80))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+bool_t seek_index_load (const char * key, mpg123_handle * dec, int64_t * samples)
+{
+	char * path = get_path (key);
+	char * contents = NULL;
+	gsize len = 0;
+	bool_t found = g_file_get_contents (path, & contents, & len, NULL);
+
+	if (found)
+		g_utime (path, NULL);
+
+	g_free (path);
+
+	if (! found)
+		return FALSE;
+
+	const guint8 * data = (const guint8 *) contents + INDEX_MAGIC_LEN;
+	const guint8 * end = (const guint8 *) contents + len;
+	uint64_t count, step, fill, offset, delta;
+	off_t * offsets = NULL;
+	bool_t success = FALSE;
+
+	if (len < INDEX_MAGIC_LEN || memcmp (contents, INDEX_MAGIC, INDEX_MAGIC_LEN) ||
+	 ! get_number (& data, end, & count) || ! get_number (& data, end, & step) ||
+	 ! get_number (& data, end, & fill) || ! step || ! fill ||
+	 fill > (uint64_t) (end - data) || ! get_number (& data, end, & offset))
+		goto DONE;
+
+	if (dec)
+	{
+		offsets = g_new (off_t, fill);
+		offsets[0] = offset;
+
+		for (uint64_t i = 1; i < fill; i ++)
+		{
+			if (! get_number (& data, end, & delta))
+				goto DONE;
+
+			offsets[i] = offset += delta;
+		}
+
+		if (mpg123_set_index (dec, offsets, step, fill) != MPG123_OK)
+			goto DONE;
+	}
+
+	if (samples)
+		* samples = count;
+
+	success = TRUE;
+
+DONE:
+	if (! success)
+		AUDDBG ("Invalid seek index for %s.\n", key);
+
+	g_free (offsets);
+	g_free (contents);
+	return success;
+}
+
+static int index_file_compare (const void * a, const void * b)
+{
+	time_t ta = ((const IndexFile *) a)->mtime;
+	time_t tb = ((const IndexFile *) b)->mtime;
+	return (ta > tb) - (ta < tb);
+}
+
+static void prune_indexes (const char * dir)
+{
+	GDir * handle = g_dir_open (dir, 0, NULL);
+	if (! handle)
+		return;
+
+	GArray * files = g_array_new (FALSE, FALSE, sizeof (IndexFile));
+	const char * name;
+
+	while ((name = g_dir_read_name (handle)))
+	{
+		char * path = g_build_filename (dir, name, NULL);
+		GStatBuf st;
+
+		if (g_stat (path, & st) == 0 && S_ISREG (st.st_mode))
+		{
+			IndexFile file = {g_strdup (name), st.st_mtime};
+			g_array_append_val (files, file);
+		}
+
+		g_free (path);
+	}
+
+	g_dir_close (handle);
+
+	if (files->len > MAX_INDEXES)
+	{
+		g_array_sort (files, index_file_compare);
+
+		for (unsigned i = 0; i < files->len - MAX_INDEXES; i ++)
+		{
+			char * path = g_build_filename (dir, g_array_index (files, IndexFile, i).name, NULL);
+			g_remove (path);
+			g_free (path);
+		}
+
+		AUDDBG ("Pruned %d seek indexes.\n", (int) (files->len - MAX_INDEXES));
+	}
+
+	for (unsigned i = 0; i < files->len; i ++)
+		g_free (g_array_index (files, IndexFile, i).name);
+
+	g_array_free (files, TRUE);
+}
+
+bool_t seek_index_complete (mpg123_handle * dec, int64_t frames)
+{
+	off_t * offsets;
+	off_t step;
+	size_t fill;
+
+	if (mpg123_index (dec, & offsets, & step, & fill) != MPG123_OK)
+		return FALSE;
+
+	return fill > 0 && (int64_t) fill * step >= frames;
+}
+
+void seek_index_save (const char * key, mpg123_handle * dec, int64_t samples)
+{
+	struct mpg123_frameinfo info;
+	off_t * offsets;
+	off_t step;
+	size_t fill;
+
+	if (mpg123_info (dec, & info) != MPG123_OK || info.vbr == MPG123_CBR)
+		return;
+
+	if (mpg123_index (dec, & offsets, & step, & fill) != MPG123_OK || ! fill || step <= 0)
+		return;
+
+	GByteArray * buf = g_byte_array_sized_new (INDEX_MAGIC_LEN + 3 * fill + 32);
+	g_byte_array_append (buf, (const guint8 *) INDEX_MAGIC, INDEX_MAGIC_LEN);
+
+	put_number (buf, MAX (samples, 0));
+	put_number (buf, step);
+	put_number (buf, fill);
+	put_number (buf, offsets[0]);
+
+	for (size_t i = 1; i < fill; i ++)
+		put_number (buf, offsets[i] - offsets[i - 1]);
+
+	char * dir = get_dir ();
+	char * path = get_path (key);
+
+	/* g_file_set_contents () replaces the file atomically */
+	if (g_mkdir_with_parents (dir, 0755) < 0 ||
+	 ! g_file_set_contents (path, (const char *) buf->data, buf->len, NULL))
+		fprintf (stderr, "mpg123: Could not save seek index to %s.\n", path);
+	else
+	{
+		AUDDBG ("Saved seek index for %s: %d entries, step %d.\n", key,
+		 (int) fill, (int) step);
+		prune_indexes (dir);
+	}
+
+	g_free (dir);
+	g_free (path);
+	g_byte_array_free (buf, TRUE);
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2014 Audacious Team
+ *
+ * Permission to use, copy, modify, and/or distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT,
+ * INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+ * STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * Frame index cache.  VBR files without a Xing/LAME table of contents can only
+ * be seeked accurately once every frame has been located.  The index mpg123
+ * builds while scanning or playing a file to the end is saved in the user's
+ * config directory, keyed by the file contents, and given back to mpg123 the
+ * next time so that seeks go straight to the right frame.
+ */
+
+#ifndef AUD_MPG123_SEEK_INDEX_H
+#define AUD_MPG123_SEEK_INDEX_H
+
+#include <mpg123.h>
+
+#include <libaudcore/objects.h>
+#include <libaudcore/vfs.h>
+
+/* Entries mpg123 keeps in its index; when it fills up, every other entry is
+ * dropped.  This keeps a three hour file at 32 frames per entry. */
+#define SEEK_INDEX_SIZE 16384
+
+/* Returns a key identifying the contents of a local file, or an empty string
+ * on error.  This reads and hashes both ends of the file, so it is only worth
+ * doing for files that can have an index.  The file position is preserved. */
+String seek_index_key (VFSFile * file);
+
+/* Looks up the index saved for <key>.  If <dec> is not NULL, the index is
+ * handed to it.  The length of the file in samples is returned in <samples>,
+ * if not NULL. */
+bool_t seek_index_load (const char * key, mpg123_handle * dec, int64_t * samples);
+
+/* Returns TRUE if the index of <dec> covers all <frames> frames. */
+bool_t seek_index_complete (mpg123_handle * dec, int64_t frames);
+
+/* Saves the index of <dec>, which must be complete.  Nothing is saved for
+ * constant bitrate files, which mpg123 can seek without one. */
+void seek_index_save (const char * key, mpg123_handle * dec, int64_t samples);
+
+#endif /* AUD_MPG123_SEEK_INDEX_H */
@@ -0,0 +1,458 @@
+/*
+ *  A neon HTTP input plugin for Audacious
+ *  Copyright (C) 2007 Ralf Ertzinger
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib.h>
+
+#include <libaudcore/runtime.h>
+
+#include "cache.h"
+#include "debug.h"
+
+#define CACHE_BLOCK     (64*1024)
+#define CACHE_ENTRIES   32          /* URLs remembered when not in use */
+
+struct cache_block
+{
+    GList link;                 /* in block_lru or spill_lru */
+    struct cache_entry * entry;
+    int64_t index;              /* position in the stream / CACHE_BLOCK */
+    int lo, hi;                 /* range of valid bytes within the block */
+    char * data;                /* NULL once moved to the spill file */
+    int64_t slot;               /* position in the spill file / CACHE_BLOCK */
+};
+
+struct cache_entry
+{
+    GList link;                 /* in entry_lru */
+    char * url;
+    char * validator;
+    int64_t length;
+    int refs;
+    bool_t detached;            /* replaced by a newer entry for the same URL */
+    GHashTable * blocks;        /* index -> struct cache_block */
+};
+
+static const char * const cache_defaults[] = {
+ "cache_size", "8",             /* MiB */
+ "disk_cache", "FALSE",
+ "disk_cache_size", "256",      /* MiB */
+ NULL};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static GHashTable * entries;    /* url -> struct cache_entry */
+static GQueue entry_lru;        /* most recently opened first */
+static GQueue block_lru;        /* blocks in memory, most recently used first */
+static GQueue spill_lru;        /* blocks in the spill file, likewise */
+
+static int64_t mem_used, mem_limit;
+static int64_t disk_used, disk_limit;
+static bool_t disk_cache;
+
+/* All entries share one spill file, divided into slots of CACHE_BLOCK. */
+static int spill_fd = -1;
+static int64_t spill_slots;     /* slots the file has grown to */
+static int64_t * free_slots;
+static int n_free_slots, free_slots_size;
+
+static void release_slot (int64_t slot)
+{
+    if (n_free_slots == free_slots_size)
+    {
+        free_slots_size = MAX (16, free_slots_size * 2);
+        free_slots = g_renew (int64_t, free_slots, free_slots_size);
+    }
+
+    free_slots[n_free_slots ++] = slot;
+}
+
+static void free_block (void * data)
+{
+    struct cache_block * b = (cache_block *) data;
+
+    if (b->data)
+    {
+        g_queue_unlink (& block_lru, & b->link);
+        mem_used -= CACHE_BLOCK;
+        g_free (b->data);
+    }
+    else
+    {
+        g_queue_unlink (& spill_lru, & b->link);
+        disk_used -= CACHE_BLOCK;
+        release_slot (b->slot);
+    }
+
+    g_free (b);
+}
+
+static void drop_block (struct cache_block * b)
+{
+    g_hash_table_remove (b->entry->blocks, & b->index);
+}
+
+static void touch_block (struct cache_block * b)
+{
+    GQueue * queue = b->data ? & block_lru : & spill_lru;
+
+    g_queue_unlink (queue, & b->link);
+    g_queue_push_head_link (queue, & b->link);
+}
+
+static void free_entry (struct cache_entry * e)
+{
+    _DEBUG ("Dropping cache for %s", e->url);
+
+    g_hash_table_destroy (e->blocks);
+    g_free (e->url);
+    g_free (e->validator);
+    g_free (e);
+}
+
+static void remove_entry (struct cache_entry * e)
+{
+    g_hash_table_remove (entries, e->url);
+    g_queue_unlink (& entry_lru, & e->link);
+    e->detached = TRUE;
+
+    if (! e->refs)
+        free_entry (e);
+}
+
+static void trim_entries (void)
+{
+    GList * node = entry_lru.tail;
+
+    while (node && g_hash_table_size (entries) > CACHE_ENTRIES)
+    {
+        GList * prev = node->prev;
+        struct cache_entry * e = (cache_entry *) node->data;
+
+        if (! e->refs)
+            remove_entry (e);
+
+        node = prev;
+    }
+}
+
+static bool_t spill_io (int64_t pos, void * buf, int len, bool_t write_op)
+{
+    if (lseek (spill_fd, pos, SEEK_SET) != pos)
+        return FALSE;
+
+    if (write_op)
+        return write (spill_fd, buf, len) == len;
+    else
+        return read (spill_fd, buf, len) == len;
+}
+
+static int64_t alloc_slot (void)
+{
+    if (spill_fd < 0)
+    {
+        char * name = NULL;
+
+        if ((spill_fd = g_file_open_tmp ("audacious-neon-XXXXXX", & name, NULL)) < 0)
+        {
+            _ERROR ("Could not create a cache file");
+            return -1;
+        }
+
+        unlink (name);
+        g_free (name);
+    }
+
+    if (n_free_slots)
+        return free_slots[-- n_free_slots];
+
+    if ((spill_slots + 1) * CACHE_BLOCK <= disk_limit)
+        return spill_slots ++;
+
+    if (! spill_lru.tail)
+        return -1;
+
+    /* file is full, reuse the least recently used slot */
+    drop_block ((cache_block *) spill_lru.tail->data);
+    return free_slots[-- n_free_slots];
+}
+
+/* Moves a block from memory to the spill file. */
+static bool_t spill_block (struct cache_block * b)
+{
+    int64_t slot = alloc_slot ();
+
+    if (slot < 0)
+        return FALSE;
+
+    if (! spill_io (slot * CACHE_BLOCK + b->lo, b->data + b->lo, b->hi - b->lo, TRUE))
+    {
+        release_slot (slot);
+        return FALSE;
+    }
+
+    g_queue_unlink (& block_lru, & b->link);
+    g_free (b->data);
+    b->data = NULL;
+    b->slot = slot;
+    g_queue_push_head_link (& spill_lru, & b->link);
+
+    mem_used -= CACHE_BLOCK;
+    disk_used += CACHE_BLOCK;
+
+    return TRUE;
+}
+
+static void enforce_limits (void)
+{
+    while (mem_used > mem_limit && block_lru.tail)
+    {
+        struct cache_block * b = (cache_block *) block_lru.tail->data;
+
+        if (! disk_cache || ! spill_block (b))
+            drop_block (b);
+    }
+
+    while (disk_used > disk_limit && spill_lru.tail)
+        drop_block ((cache_block *) spill_lru.tail->data);
+
+    /* nothing left in the spill file, give the space back */
+    if (spill_fd >= 0 && ! disk_used)
+    {
+        close (spill_fd);
+        spill_fd = -1;
+        spill_slots = 0;
+        n_free_slots = 0;
+    }
+}
+
+void cache_init (void)
+{
+    aud_config_set_defaults ("neon", cache_defaults);
+    entries = g_hash_table_new (g_str_hash, g_str_equal);
+}
+
+void cache_cleanup (void)
+{
+    while (entry_lru.head)
+        remove_entry ((cache_entry *) entry_lru.head->data);
+
+    g_hash_table_destroy (entries);
+    entries = NULL;
+
+    enforce_limits ();
+
+    g_free (free_slots);
+    free_slots = NULL;
+    free_slots_size = 0;
+}
+
+struct cache_entry * cache_open (const char * url, const char * validator, int64_t length)
+{
+    int64_t new_mem_limit = (int64_t) aud_get_int ("neon", "cache_size") << 20;
+    int64_t new_disk_limit = (int64_t) aud_get_int ("neon", "disk_cache_size") << 20;
+    bool_t new_disk_cache = aud_get_bool ("neon", "disk_cache");
+
+    pthread_mutex_lock (& mutex);
+
+    mem_limit = new_mem_limit;
+    disk_limit = new_disk_limit;
+    disk_cache = new_disk_cache;
+
+    struct cache_entry * e = (cache_entry *) g_hash_table_lookup (entries, url);
+
+    if (e && (strcmp (e->validator, validator) || e->length != length))
+    {
+        _DEBUG ("%s has changed on the server", url);
+        remove_entry (e);
+        e = NULL;
+    }
+
+    if (e)
+        g_queue_unlink (& entry_lru, & e->link);
+    else
+    {
+        e = g_new0 (struct cache_entry, 1);
+        e->link.data = e;
+        e->url = g_strdup (url);
+        e->validator = g_strdup (validator);
+        e->length = length;
+        e->blocks = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL, free_block);
+
+        g_hash_table_insert (entries, e->url, e);
+    }
+
+    g_queue_push_head_link (& entry_lru, & e->link);
+    e->refs ++;
+
+    trim_entries ();
+    enforce_limits ();
+
+    pthread_mutex_unlock (& mutex);
+
+    return e;
+}
+
+void cache_close (struct cache_entry * e)
+{
+    pthread_mutex_lock (& mutex);
+
+    e->refs --;
+
+    if (e->detached && ! e->refs)
+        free_entry (e);
+    else
+        trim_entries ();
+
+    pthread_mutex_unlock (& mutex);
+}
+
+int64_t cache_avail (struct cache_entry * e, int64_t pos, int64_t len)
+{
+    int64_t avail = 0;
+
+    len = MIN (len, e->length - pos);
+
+    pthread_mutex_lock (& mutex);
+
+    while (avail < len)
+    {
+        int64_t index = (pos + avail) / CACHE_BLOCK;
+        int off = (pos + avail) % CACHE_BLOCK;
+
+        struct cache_block * b = (cache_block *) g_hash_table_lookup (e->blocks, & index);
+
+        if (! b || off < b->lo || off >= b->hi)
+            break;
+
+        avail += b->hi - off;
+
+        if (b->hi < CACHE_BLOCK)
+            break;
+    }
+
+    pthread_mutex_unlock (& mutex);
+
+    return MIN (avail, len);
+}
+
+bool_t cache_read (struct cache_entry * e, int64_t pos, void * buf, int64_t len)
+{
+    bool_t success = TRUE;
+
+    pthread_mutex_lock (& mutex);
+
+    while (len > 0)
+    {
+        int64_t index = pos / CACHE_BLOCK;
+        int off = pos % CACHE_BLOCK;
+
+        struct cache_block * b = (cache_block *) g_hash_table_lookup (e->blocks, & index);
+
+        if (! b || off < b->lo || off >= b->hi)
+        {
+            success = FALSE;
+            break;
+        }
+
+        int part = MIN (len, b->hi - off);
+
+        if (b->data)
+            memcpy (buf, b->data + off, part);
+        else if (! spill_io (b->slot * CACHE_BLOCK + off, buf, part, FALSE))
+        {
+            _ERROR ("Could not read from the cache file");
+            drop_block (b);
+            success = FALSE;
+            break;
+        }
+
+        touch_block (b);
+
+        buf = (char *) buf + part;
+        pos += part;
+        len -= part;
+    }
+
+    pthread_mutex_unlock (& mutex);
+
+    return success;
+}
+
+void cache_write (struct cache_entry * e, int64_t pos, const void * buf, int64_t len)
+{
+    len = MIN (len, e->length - pos);
+
+    pthread_mutex_lock (& mutex);
+
+    while (len > 0)
+    {
+        int64_t index = pos / CACHE_BLOCK;
+        int off = pos % CACHE_BLOCK;
+        int part = MIN (len, CACHE_BLOCK - off);
+
+        struct cache_block * b = (cache_block *) g_hash_table_lookup (e->blocks, & index);
+
+        if (! b)
+        {
+            b = g_new0 (struct cache_block, 1);
+            b->link.data = b;
+            b->entry = e;
+            b->index = index;
+            b->lo = b->hi = off;
+            b->data = (char *) g_malloc (CACHE_BLOCK);
+
+            g_queue_push_head_link (& block_lru, & b->link);
+            mem_used += CACHE_BLOCK;
+
+            g_hash_table_insert (e->blocks, & b->index, b);
+        }
+
+        /* A block holds a single range; new data not adjoining it replaces it. */
+        if (off > b->hi || off + part < b->lo)
+            b->lo = b->hi = off;
+
+        if (b->data)
+            memcpy (b->data + off, buf, part);
+        else if (! spill_io (b->slot * CACHE_BLOCK + off, (void *) buf, part, TRUE))
+        {
+            _ERROR ("Could not write to the cache file");
+            drop_block (b);
+            b = NULL;
+        }
+
+        if (b)
+        {
+            b->lo = MIN (b->lo, off);
+            b->hi = MAX (b->hi, off + part);
+            touch_block (b);
+        }
+
+        buf = (const char *) buf + part;
+        pos += part;
+        len -= part;
+    }
+
+    enforce_limits ();
+
+    pthread_mutex_unlock (& mutex);
+}
@@ -0,0 +1,51 @@
+/*
+ *  A neon HTTP input plugin for Audacious
+ *  Copyright (C) 2007 Ralf Ertzinger
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _NEON_CACHE_H
+#define _NEON_CACHE_H
+
+#include <stdint.h>
+
+#include <libaudcore/core.h>
+
+/*
+ * Cache of byte ranges already downloaded, shared by all handles opened on
+ * the same URL.  An entry is only reused as long as the server reports the
+ * same validator (ETag and Last-Modified) and content length.  Blocks that
+ * do not fit in memory are moved to a temporary file if enabled in the
+ * settings, and dropped otherwise, least recently used first.
+ */
+struct cache_entry;
+
+void cache_init (void);
+void cache_cleanup (void);
+
+/* Returns a reference to the entry for <url>, emptied first if <validator>
+ * or <length> do not match what was cached before. */
+struct cache_entry * cache_open (const char * url, const char * validator, int64_t length);
+void cache_close (struct cache_entry * entry);
+
+/* Returns how many bytes (up to <len>) are cached starting at <pos>. */
+int64_t cache_avail (struct cache_entry * entry, int64_t pos, int64_t len);
+/* Copies <len> bytes starting at <pos>, which must be available.  Returns
+ * FALSE if they could not be read back from the spill file. */
+bool_t cache_read (struct cache_entry * entry, int64_t pos, void * buf, int64_t len);
+void cache_write (struct cache_entry * entry, int64_t pos, const void * buf, int64_t len);
+
+#endif
@@ -33,6 +33,7 @@
 #include <libaudcore/i18n.h>
 #include <libaudcore/runtime.h>
 #include <libaudcore/plugin.h>
+#include <libaudcore/preferences.h>
 #include <libaudcore/audstrings.h>
 
 #include <ne_socket.h>
@@ -42,10 +43,15 @@
 #include <ne_auth.h>
 
 #include "debug.h"
+#include "cache.h"
+#include "pool.h"
 #include "rb.h"
 #include "cert_verification.h"
 
-#define NEON_BUFSIZE        (128*1024)
+#define NEON_BUFSIZE        (128*1024)  /* when the bitrate is not known */
+#define NEON_MINBUFSIZE     (32*1024)
+#define NEON_MAXBUFSIZE     (1024*1024)
+#define NEON_BUFSECS        8           /* seconds of audio to buffer */
 #define NEON_NETBLKSIZE     (4096)
 #define NEON_ICY_BUFSIZE    (4096)
 #define NEON_RETRY_COUNT 6
@@ -60,11 +66,15 @@ static bool_t neon_plugin_init (void)
         return FALSE;
     }
 
+    cache_init ();
+
     return TRUE;
 }
 
 static void neon_plugin_fini (void)
 {
+    cache_cleanup ();
+    pool_cleanup ();
     ne_sock_exit ();
 }
 
@@ -77,7 +87,7 @@ static struct neon_handle * handle_init (void)
     h->reader_status.reading = FALSE;
     h->reader_status.status = NEON_READER_INIT;
 
-    init_rb_with_lock (& h->rb, NEON_BUFSIZE, & h->reader_status.mutex);
+    init_rb (& h->rb, NEON_BUFSIZE);
 
     h->purl = g_new0 (ne_uri, 1);
     h->content_length = -1;
@@ -91,6 +101,9 @@ static void handle_free (struct neon_handle * h)
     g_free (h->purl);
     destroy_rb (& h->rb);
 
+    if (h->cache)
+        cache_close (h->cache);
+
     pthread_mutex_destroy (& h->reader_status.mutex);
     pthread_cond_destroy (& h->reader_status.cond);
 
@@ -98,6 +111,8 @@ static void handle_free (struct neon_handle * h)
     g_free (h->icy_metadata.stream_title);
     g_free (h->icy_metadata.stream_url);
     g_free (h->icy_metadata.stream_contenttype);
+    g_free (h->validator);
+    g_free (h->session_key);
     g_free (h->url);
     g_free (h);
 }
@@ -212,11 +227,28 @@ static void parse_icy (struct icy_metadata * m, char * metadata, size_t len)
     }
 }
 
+/* Wakes up the other thread, which has announced that it is waiting. */
+static void wake_peer (struct neon_handle * h)
+{
+    pthread_mutex_lock (& h->reader_status.mutex);
+    pthread_cond_broadcast (& h->reader_status.cond);
+    pthread_mutex_unlock (& h->reader_status.mutex);
+}
+
+/* Changes the reader status and wakes up anyone waiting for the change. */
+static void set_status (struct neon_handle * h, neon_reader_t status)
+{
+    pthread_mutex_lock (& h->reader_status.mutex);
+    g_atomic_int_set (& h->reader_status.status, status);
+    pthread_cond_broadcast (& h->reader_status.cond);
+    pthread_mutex_unlock (& h->reader_status.mutex);
+}
+
 static void kill_reader (struct neon_handle * h)
 {
     _DEBUG ("Signaling reader thread to terminate");
     pthread_mutex_lock (& h->reader_status.mutex);
-    h->reader_status.reading = FALSE;
+    g_atomic_int_set (& h->reader_status.reading, FALSE);
     pthread_cond_broadcast (& h->reader_status.cond);
     pthread_mutex_unlock (& h->reader_status.mutex);
 
@@ -228,15 +260,15 @@ static void kill_reader (struct neon_handle * h)
 static int server_auth_callback (void * userdata, const char * realm,
  int attempt, char * username, char * password)
 {
-    struct neon_handle * h = (neon_handle *) userdata;
+    const char * userinfo = (const char *) userdata;
 
-    if (! h->purl->userinfo || ! h->purl->userinfo[0])
+    if (! userinfo || ! userinfo[0])
     {
         _ERROR ("Authentication required, but no credentials set");
         return 1;
     }
 
-    char * * authtok = g_strsplit (h->purl->userinfo, ":", 2);
+    char * * authtok = g_strsplit (userinfo, ":", 2);
 
     if (strlen (authtok[1]) > NE_ABUFSIZ - 1 || strlen (authtok[0]) > NE_ABUFSIZ - 1)
     {
@@ -260,6 +292,10 @@ static void handle_headers (struct neon_handle * h)
     const char * name;
     const char * value;
     void * cursor = NULL;
+    const char * etag = NULL;
+    const char * last_modified = NULL;
+
+    h->no_store = FALSE;
 
     _DEBUG ("Header responses:");
 
@@ -327,7 +363,24 @@ static void handle_headers (struct neon_handle * h)
             _DEBUG ("ICY bitrate: %d", atoi (value));
             h->icy_metadata.stream_bitrate = atoi (value);
         }
+        else if (neon_strcmp (name, "etag"))
+            etag = value;
+        else if (neon_strcmp (name, "last-modified"))
+            last_modified = value;
+        else if (neon_strcmp (name, "cache-control"))
+        {
+            if (strstr (value, "no-store"))
+                h->no_store = TRUE;
+        }
     }
+
+    /* Either one tells us whether the data we cached is still valid. */
+    g_free (h->validator);
+    h->validator = NULL;
+
+    if (etag || last_modified)
+        h->validator = g_strconcat (etag ? etag : "", "\n",
+         last_modified ? last_modified : "", NULL);
 }
 
 static int neon_proxy_auth_cb (void * userdata, const char * realm, int attempt,
@@ -356,6 +409,8 @@ static int open_request (struct neon_handle * handle, uint64_t startbyte)
     else
         handle->request = ne_request_create (handle->session, "GET", handle->purl->path);
 
+    handle->request_done = FALSE;
+
     if (startbyte > 0)
         ne_print_request_header (handle->request, "Range", "bytes=%" PRIu64 "-", startbyte);
 
@@ -384,6 +439,7 @@ static int open_request (struct neon_handle * handle, uint64_t startbyte)
         case 307:
             /* Redirect encountered. Reconnect. */
             ne_end_request (handle->request);
+            handle->request_done = TRUE;
             ret = NE_REDIRECT;
             break;
 
@@ -405,6 +461,7 @@ static int open_request (struct neon_handle * handle, uint64_t startbyte)
             _DEBUG ("<%p> URL opened OK", handle);
             handle->content_start = startbyte;
             handle->pos = startbyte;
+            handle->rb_pos = startbyte;
             handle_headers (handle);
             return 0;
         }
@@ -441,6 +498,105 @@ static int open_request (struct neon_handle * handle, uint64_t startbyte)
     return -1;
 }
 
+/* Sizes the buffer to hold a few seconds of audio at the bitrate announced
+ * by the server.  The reader thread must not be running. */
+static void size_buffer (struct neon_handle * h)
+{
+    unsigned size = NEON_BUFSIZE;
+    int bitrate = h->icy_metadata.stream_bitrate;  /* kbit/s */
+
+    if (bitrate > 0)
+    {
+        size = (unsigned) bitrate * 1000 / 8 * NEON_BUFSECS;
+        size = CLAMP (size, NEON_MINBUFSIZE, NEON_MAXBUFSIZE);
+    }
+
+    size = MAX (size, used_rb (& h->rb));
+
+    _DEBUG ("<%p> Using a buffer of %u bytes", h, size);
+    resize_rb (& h->rb, size);
+}
+
+/* Looks up the data already downloaded from this URL.  Only seekable files
+ * are cached, and only if the server lets us check that they have not
+ * changed since. */
+static void attach_cache (struct neon_handle * h)
+{
+    if (h->cache)
+    {
+        cache_close (h->cache);
+        h->cache = NULL;
+    }
+
+    if (h->content_length < 0 || ! h->can_ranges || h->icy_metaint ||
+     ! h->validator || h->no_store)
+        return;
+
+    h->cache = cache_open (h->url, h->validator,
+     (int64_t) h->content_start + h->content_length);
+}
+
+/* Sets up a session for the server in <purl>.  Nothing in it refers to the
+ * handle, so that it can be given to other handles through the pool. */
+static ne_session * create_session (const ne_uri * purl, const char * proxy_host,
+ int proxy_port, bool_t use_proxy_auth)
+{
+    _DEBUG ("Creating session to %s://%s:%d", purl->scheme, purl->host, purl->port);
+
+    ne_session * session = ne_session_create (purl->scheme, purl->host, purl->port);
+
+    char * userinfo = g_strdup (purl->userinfo);
+    ne_hook_destroy_session (session, g_free, userinfo);
+
+    ne_redirect_register (session);
+    ne_add_server_auth (session, NE_AUTH_BASIC, server_auth_callback, userinfo);
+    ne_set_session_flag (session, NE_SESSFLAG_ICYPROTO, 1);
+
+#ifdef HAVE_NE_SET_CONNECT_TIMEOUT
+    ne_set_connect_timeout (session, 10);
+#endif
+
+    ne_set_read_timeout (session, 10);
+    ne_set_useragent (session, "Audacious/" PACKAGE_VERSION);
+
+    if (proxy_host)
+    {
+        _DEBUG ("Using proxy: %s:%d", proxy_host, proxy_port);
+        ne_session_proxy (session, proxy_host, proxy_port);
+
+        if (use_proxy_auth)
+        {
+            _DEBUG ("Using proxy authentication");
+            ne_add_proxy_auth (session, NE_AUTH_BASIC, neon_proxy_auth_cb, NULL);
+        }
+    }
+
+    if (! strcmp ("https", purl->scheme))
+    {
+        ne_ssl_trust_default_ca (session);
+        ne_ssl_set_verify (session, neon_vfs_verify_environment_ssl_certs, session);
+    }
+
+    return session;
+}
+
+/* Ends the current request, if any, and gives the session back to the pool.
+ * The connection is left open only if the whole response has been read. */
+static void close_request (struct neon_handle * h)
+{
+    if (h->request)
+    {
+        ne_request_destroy (h->request);
+        h->request = NULL;
+    }
+
+    if (h->session)
+    {
+        pool_put (h->session, h->session_key, h->request_done);
+        h->session = NULL;
+    }
+}
+
 static int open_handle (struct neon_handle * handle, uint64_t startbyte)
 {
     int ret;
@@ -471,58 +627,38 @@ static int open_handle (struct neon_handle * handle, uint64_t startbyte)
         if (! handle->purl->port)
             handle->purl->port = ne_uri_defaultport (handle->purl->scheme);
 
-        _DEBUG ("<%p> Creating session to %s://%s:%d", handle,
-         handle->purl->scheme, handle->purl->host, handle->purl->port);
-        handle->session = ne_session_create (handle->purl->scheme,
-         handle->purl->host, handle->purl->port);
-        ne_redirect_register (handle->session);
-        ne_add_server_auth (handle->session, NE_AUTH_BASIC, server_auth_callback, (void *) handle);
-        ne_set_session_flag (handle->session, NE_SESSFLAG_ICYPROTO, 1);
-        ne_set_session_flag (handle->session, NE_SESSFLAG_PERSIST, 0);
+        /* the key is logged by the pool, so it carries a hash of the
+         * credentials rather than the credentials themselves */
+        char * user = handle->purl->userinfo ? g_compute_checksum_for_string
+         (G_CHECKSUM_SHA1, handle->purl->userinfo, -1) : NULL;
 
-#ifdef HAVE_NE_SET_CONNECT_TIMEOUT
-        ne_set_connect_timeout (handle->session, 10);
-#endif
-
-        ne_set_read_timeout (handle->session, 10);
-        ne_set_useragent (handle->session, "Audacious/" PACKAGE_VERSION);
+        g_free (handle->session_key);
+        handle->session_key = g_strdup_printf ("%s://%s%s%s:%u proxy %s:%d%s",
+         handle->purl->scheme, user ? user : "", user ? "@" : "", handle->purl->host,
+         handle->purl->port, use_proxy ? (const char *) proxy_host : "", proxy_port,
+         use_proxy_auth ? " auth" : "");
 
-        if (use_proxy)
-        {
-            _DEBUG ("<%p> Using proxy: %s:%d", handle, proxy_host, proxy_port);
-            ne_session_proxy (handle->session, proxy_host, proxy_port);
+        g_free (user);
 
-            if (use_proxy_auth)
-            {
-                _DEBUG ("<%p> Using proxy authentication", handle);
-                ne_add_proxy_auth (handle->session, NE_AUTH_BASIC,
-                 neon_proxy_auth_cb, (void *) handle);
-            }
-        }
-
-        if (! strcmp ("https", handle->purl->scheme))
-        {
-            ne_ssl_trust_default_ca (handle->session);
-            ne_ssl_set_verify (handle->session,
-             neon_vfs_verify_environment_ssl_certs, handle->session);
-        }
+        if (! (handle->session = pool_get (handle->session_key)))
+            handle->session = create_session (handle->purl, proxy_host, proxy_port, use_proxy_auth);
 
         _DEBUG ("<%p> Creating request", handle);
         ret = open_request (handle, startbyte);
 
         if (! ret)
+        {
+            size_buffer (handle);
+            attach_cache (handle);
             return 0;
+        }
+
+        close_request (handle);
 
         if (ret == -1)
-        {
-            ne_session_destroy (handle->session);
-            handle->session = NULL;
             return -1;
-        }
 
         _DEBUG ("<%p> Following redirect...", handle);
-        ne_session_destroy (handle->session);
-        handle->session = NULL;
     }
 
     /* If we get here, our redirect count exceeded */
@@ -550,6 +686,9 @@ static FillBufferResult fill_buffer (struct neon_handle * h)
     if (! bsize)
     {
         _DEBUG ("<%p> End of file encountered", h);
+
+        /* finishing the request lets the next one reuse the connection */
+        h->request_done = (ne_end_request (h->request) == NE_OK);
         return FILL_BUFFER_EOF;
     }
 
@@ -565,6 +704,10 @@ static FillBufferResult fill_buffer (struct neon_handle * h)
 
     write_rb (& h->rb, buffer, bsize);
 
+    /* Wake up main thread if it is waiting. */
+    if (g_atomic_int_get (& h->reader_status.data_wanted))
+        wake_peer (h);
+
     return FILL_BUFFER_SUCCESS;
 }
 
@@ -572,36 +715,25 @@ static void * reader_thread (void * data)
 {
     struct neon_handle * h = (neon_handle *) data;
 
-    pthread_mutex_lock (& h->reader_status.mutex);
-
-    while (h->reader_status.reading)
+    while (g_atomic_int_get (& h->reader_status.reading))
     {
         /* Hit the network only if we have more than NEON_NETBLKSIZE of free buffer */
-        if (NEON_NETBLKSIZE < free_rb_locked (& h->rb))
+        if (NEON_NETBLKSIZE < free_rb (& h->rb))
         {
-            pthread_mutex_unlock (& h->reader_status.mutex);
-
             FillBufferResult ret = fill_buffer (h);
 
-            pthread_mutex_lock (& h->reader_status.mutex);
-
-            /* Wake up main thread if it is waiting. */
-            pthread_cond_broadcast (& h->reader_status.cond);
-
             if (ret == FILL_BUFFER_ERROR)
             {
                 _ERROR ("<%p> Error while reading from the network. "
                         "Terminating reader thread", (void *) h);
-                h->reader_status.status = NEON_READER_ERROR;
-                pthread_mutex_unlock (& h->reader_status.mutex);
+                set_status (h, NEON_READER_ERROR);
                 return NULL;
             }
             else if (ret == FILL_BUFFER_EOF)
             {
                 _DEBUG ("<%p> EOF encountered while reading from the network. "
                         "Terminating reader thread", (void *) h);
-                h->reader_status.status = NEON_READER_EOF;
-                pthread_mutex_unlock (& h->reader_status.mutex);
+                set_status (h, NEON_READER_EOF);
                 return NULL;
             }
         }
@@ -609,13 +741,20 @@ static void * reader_thread (void * data)
         {
             /* Not enough free space in the buffer.
              * Sleep until the main thread wakes us up. */
-            pthread_cond_wait (& h->reader_status.cond, & h->reader_status.mutex);
+            pthread_mutex_lock (& h->reader_status.mutex);
+            g_atomic_int_set (& h->reader_status.room_wanted, TRUE);
+
+            /* check again, now that the main thread will see the flag */
+            if (NEON_NETBLKSIZE >= free_rb (& h->rb) && h->reader_status.reading)
+                pthread_cond_wait (& h->reader_status.cond, & h->reader_status.mutex);
+
+            g_atomic_int_set (& h->reader_status.room_wanted, FALSE);
+            pthread_mutex_unlock (& h->reader_status.mutex);
         }
     }
 
     _DEBUG ("<%p> Reader thread terminating gracefully", h);
-    h->reader_status.status = NEON_READER_TERM;
-    pthread_mutex_unlock (& h->reader_status.mutex);
+    set_status (h, NEON_READER_TERM);
 
     return NULL;
 }
@@ -645,43 +784,115 @@ int neon_vfs_fclose_impl (VFSFile * file)
     if (h->reader_status.reading)
         kill_reader (h);
 
-    if (h->request)
-        ne_request_destroy (h->request);
-    if (h->session)
-        ne_session_destroy (h->session);
-
+    close_request (h);
     handle_free (h);
 
     return 0;
 }
 
+/* Drops the current request and the data buffered from it, and opens a new
+ * request starting at <pos>. */
+static int reopen_handle (struct neon_handle * h, int64_t pos)
+{
+    if (h->reader_status.reading)
+        kill_reader (h);
+
+    close_request (h);
+    reset_rb (& h->rb);
+
+    if (open_handle (h, pos) != 0)
+    {
+        _ERROR ("<%p> Error while creating new request!", (void *) h);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* TRUE if the data at <pos> is already in the ringbuffer or will be next. */
+static bool_t in_buffer (struct neon_handle * h, int64_t pos)
+{
+    return h->request && pos >= h->rb_pos && pos - h->rb_pos <= used_rb (& h->rb);
+}
+
+/* Brings the ringbuffer to the current position, after reads have been
+ * served from the cache. */
+static bool_t sync_buffer (struct neon_handle * h)
+{
+    if (! in_buffer (h, h->pos))
+    {
+        _DEBUG ("<%p> Leaving cached data, reconnecting at %ld", h, h->pos);
+        return ! reopen_handle (h, h->pos);
+    }
+
+    char buffer[NEON_NETBLKSIZE];
+
+    while (h->rb_pos < h->pos)
+    {
+        int part = MIN (h->pos - h->rb_pos, NEON_NETBLKSIZE);
+
+        read_rb (& h->rb, buffer, part);
+        cache_write (h->cache, h->rb_pos, buffer, part);
+        h->rb_pos += part;
+    }
+
+    if (g_atomic_int_get (& h->reader_status.room_wanted))
+        wake_peer (h);
+
+    return TRUE;
+}
+
 static int64_t neon_fread_real (void * ptr, int64_t size, int64_t nmemb, VFSFile * file)
 {
     struct neon_handle * h = (neon_handle *) vfs_get_handle (file);
 
+    if (! size || ! nmemb || h->eof)
+        return 0;
+
+    if (h->cache)
+    {
+        /* Deliver data downloaded before from the cache. */
+        int64_t avail = cache_avail (h->cache, h->pos, size * nmemb) / size;
+
+        if (avail && cache_read (h->cache, h->pos, ptr, avail * size))
+        {
+            h->pos += avail * size;
+            return avail;
+        }
+
+        if (h->pos >= (int64_t) h->content_start + h->content_length)
+        {
+            h->eof = TRUE;
+            return 0;
+        }
+
+        if (h->rb_pos != h->pos && ! sync_buffer (h))
+            return 0;
+    }
+
     if (! h->request)
     {
         _ERROR ("<%p> No request to read from, seek gone wrong?", (void *) h);
         return 0;
     }
 
-    if (! size || ! nmemb || h->eof)
-        return 0;
-
     /* If the buffer is empty, wait for the reader thread to fill it. */
-    pthread_mutex_lock (& h->reader_status.mutex);
-
-    for (int retries = 0; retries < NEON_RETRY_COUNT; retries ++)
+    if (used_rb (& h->rb) < size && h->reader_status.reading)
     {
-        if (used_rb_locked (& h->rb) / size > 0 || ! h->reader_status.reading ||
-         h->reader_status.status != NEON_READER_RUN)
-            break;
+        pthread_mutex_lock (& h->reader_status.mutex);
+        g_atomic_int_set (& h->reader_status.data_wanted, TRUE);
 
-        pthread_cond_broadcast (& h->reader_status.cond);
-        pthread_cond_wait (& h->reader_status.cond, & h->reader_status.mutex);
-    }
+        for (int retries = 0; retries < NEON_RETRY_COUNT; retries ++)
+        {
+            if (used_rb (& h->rb) / size > 0 || h->reader_status.status != NEON_READER_RUN)
+                break;
 
-    pthread_mutex_unlock (& h->reader_status.mutex);
+            pthread_cond_wait (& h->reader_status.cond, & h->reader_status.mutex);
+        }
+
+        g_atomic_int_set (& h->reader_status.data_wanted, FALSE);
+        pthread_mutex_unlock (& h->reader_status.mutex);
+    }
 
     if (! h->reader_status.reading)
     {
@@ -702,31 +913,25 @@ static int64_t neon_fread_real (void * ptr, int64_t size, int64_t nmemb, VFSFile
             /* We have some data in the buffer now.
              * Start the reader thread if we did not reach EOF during
              * the initial fill */
-            pthread_mutex_lock (& h->reader_status.mutex);
-
             if (ret == FILL_BUFFER_SUCCESS)
             {
-                h->reader_status.reading = TRUE;
+                g_atomic_int_set (& h->reader_status.reading, TRUE);
+                g_atomic_int_set (& h->reader_status.status, NEON_READER_RUN);
                 _DEBUG ("<%p> Starting reader thread", h);
                 pthread_create (& h->reader, NULL, reader_thread, h);
-                h->reader_status.status = NEON_READER_RUN;
             }
             else if (ret == FILL_BUFFER_EOF)
             {
                 _DEBUG ("<%p> No reader thread needed (stream has reached EOF during fill)", h);
-                h->reader_status.reading = FALSE;
-                h->reader_status.status = NEON_READER_EOF;
+                g_atomic_int_set (& h->reader_status.status, NEON_READER_EOF);
             }
-
-            pthread_mutex_unlock (& h->reader_status.mutex);
         }
     }
     else
     {
-        /* There already is a reader thread. Look if it is in good shape. */
-        pthread_mutex_lock (& h->reader_status.mutex);
-
-        switch (h->reader_status.status)
+        /* There already is a reader thread. Look if it is in good shape.
+         * Only the running thread itself changes its status. */
+        switch (g_atomic_int_get (& h->reader_status.status))
         {
         case NEON_READER_INIT:
         case NEON_READER_RUN:
@@ -737,21 +942,17 @@ static int64_t neon_fread_real (void * ptr, int64_t size, int64_t nmemb, VFSFile
             /* A reader error happened. Log it, and treat it like an EOF
              * condition, by falling through to the NEON_READER_EOF codepath. */
             _DEBUG ("<%p> NEON_READER_ERROR happened. Terminating reader thread and marking EOF.", h);
-            h->reader_status.status = NEON_READER_EOF;
-            pthread_mutex_unlock (& h->reader_status.mutex);
+            g_atomic_int_set (& h->reader_status.status, NEON_READER_EOF);
 
             if (h->reader_status.reading)
                 kill_reader (h);
 
-            pthread_mutex_lock (& h->reader_status.mutex);
-
         case NEON_READER_EOF:
             /* If there still is data in the buffer, carry on.
              * If not, terminate the reader thread and return 0. */
-            if (! used_rb_locked (& h->rb))
+            if (! used_rb (& h->rb))
             {
                 _DEBUG ("<%p> Reached end of stream", h);
-                pthread_mutex_unlock (& h->reader_status.mutex);
 
                 if (h->reader_status.reading)
                     kill_reader (h);
@@ -766,11 +967,8 @@ static int64_t neon_fread_real (void * ptr, int64_t size, int64_t nmemb, VFSFile
             /* The reader thread terminated gracefully, most likely on our own request.
              * We should not get here. */
             g_warn_if_reached ();
-            pthread_mutex_unlock (& h->reader_status.mutex);
             return 0;
         }
-
-        pthread_mutex_unlock (& h->reader_status.mutex);
     }
 
     /* Deliver data from the buffer */
@@ -824,23 +1022,23 @@ static int64_t neon_fread_real (void * ptr, int64_t size, int64_t nmemb, VFSFile
     nmemb = MIN (belem, nmemb);
     read_rb (& h->rb, ptr, nmemb * size);
 
-    /* Signal the network thread to continue reading */
-    pthread_mutex_lock (& h->reader_status.mutex);
+    if (h->cache)
+        cache_write (h->cache, h->pos, ptr, nmemb * size);
 
-    if (h->reader_status.status == NEON_READER_EOF)
+    /* Signal the network thread to continue reading */
+    if (g_atomic_int_get (& h->reader_status.status) == NEON_READER_EOF)
     {
-        if (! free_rb_locked (& h->rb))
+        if (! used_rb (& h->rb))
         {
             _DEBUG ("<%p> stream EOF reached and buffer empty", h);
             h->eof = TRUE;
         }
     }
-    else
-        pthread_cond_broadcast (& h->reader_status.cond);
-
-    pthread_mutex_unlock (& h->reader_status.mutex);
+    else if (g_atomic_int_get (& h->reader_status.room_wanted))
+        wake_peer (h);
 
     h->pos += nmemb * size;
+    h->rb_pos += nmemb * size;
     h->icy_metaleft -= nmemb * size;
 
     return nmemb;
@@ -960,33 +1158,23 @@ int neon_vfs_fseek_impl (VFSFile * file, int64_t offset, int whence)
     if (newpos == h->pos)
         return 0;
 
+    /* Data we have downloaded already does not need a new request.  The next
+     * read takes it from the cache or skips ahead in the ringbuffer. */
+    if (h->cache && (cache_avail (h->cache, newpos, 1) || in_buffer (h, newpos)))
+    {
+        _DEBUG ("<%p> Seeking within downloaded data", h);
+        h->pos = newpos;
+        h->eof = FALSE;
+        return 0;
+    }
+
     /* To seek to the new position we have to
      * - stop the current reader thread, if there is one
      * - destroy the current request
      * - dump all data currently in the ringbuffer
      * - create a new request starting at newpos */
-    if (h->reader_status.reading)
-        kill_reader (h);
-
-    if (h->request)
-    {
-        ne_request_destroy (h->request);
-        h->request = NULL;
-    }
-
-    if (h->session)
-    {
-        ne_session_destroy (h->session);
-        h->session = NULL;
-    }
-
-    reset_rb (& h->rb);
-
-    if (open_handle (h, newpos) != 0)
-    {
-        _ERROR ("<%p> Error while creating new request!", (void *) h);
+    if (reopen_handle (h, newpos) != 0)
         return -1;
-    }
 
     /* Things seem to have worked. The next read request will start
      * the reader thread again. */
@@ -1029,6 +1217,24 @@ int64_t neon_vfs_fsize_impl (VFSFile * file)
     return h->content_start + h->content_length;
 }
 
+static const PreferencesWidget neon_widgets[] = {
+    WidgetLabel (N_("<b>Cache</b>")),
+    WidgetSpin (N_("Memory:"),
+        {VALUE_INT, 0, "neon", "cache_size"},
+        {0, 1024, 1, N_("MiB")}),
+    WidgetCheck (N_("Keep more in a temporary file"),
+        {VALUE_BOOLEAN, 0, "neon", "disk_cache"}),
+    WidgetSpin (N_("Temporary file:"),
+        {VALUE_INT, 0, "neon", "disk_cache_size"},
+        {0, 65536, 64, N_("MiB")},
+        WIDGET_CHILD)
+};
+
+static const PluginPreferences neon_prefs = {
+    neon_widgets,
+    ARRAY_LEN (neon_widgets)
+};
+
 static const char * const neon_schemes[] = {"http", "https", NULL};
 
 static const VFSConstructor constructor = {
@@ -1045,6 +1251,7 @@ static const VFSConstructor constructor = {
 };
 
 #define AUD_PLUGIN_NAME        N_("Neon HTTP/HTTPS Plugin")
+#define AUD_PLUGIN_PREFS       & neon_prefs
 #define AUD_TRANSPORT_SCHEMES  neon_schemes
 #define AUD_PLUGIN_INIT        neon_plugin_init
 #define AUD_PLUGIN_CLEANUP     neon_plugin_fini
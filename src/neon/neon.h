@@ -28,6 +28,7 @@
 #include <ne_request.h>
 #include <ne_uri.h>
 
+#include "cache.h"
 #include "rb.h"
 
 typedef enum
@@ -39,12 +40,17 @@ typedef enum
     NEON_READER_TERM
 } neon_reader_t;
 
+/* The ringbuffer itself needs no locking.  The mutex and condition are used
+ * to sleep when the buffer is empty or full, and to change the status.  The
+ * fields below are read with g_atomic_int_get () where the mutex is not held. */
 struct reader_status
 {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
-    bool_t reading;
-    neon_reader_t status;
+    int reading;
+    int status;                 /* neon_reader_t */
+    int data_wanted;            /* main thread is waiting for data */
+    int room_wanted;            /* reader thread is waiting for free space */
 };
 
 struct icy_metadata
@@ -61,6 +67,10 @@ struct neon_handle
     char * url;                        /* The URL, as passed to us */
     ne_uri * purl;                      /* The URL, parsed into a structure */
     struct ringbuf rb;                  /* Ringbuffer for our data */
+    long rb_pos;                        /* Position in the stream of the next byte in the ringbuffer */
+    struct cache_entry * cache;         /* Data of this URL already downloaded, NULL if not cacheable */
+    char * validator;                   /* ETag and Last-Modified of the current response */
+    bool_t no_store;                    /* TRUE if the server forbids caching the response */
     unsigned char redircount;                  /* Redirect count for the opened URL */
     long pos;                           /* Current position in the stream (number of last byte delivered to the player) */
     gulong content_start;               /* Start position in the stream */
@@ -70,7 +80,9 @@ struct neon_handle
     gulong icy_metaleft;                /* Bytes left until the next metadata block */
     struct icy_metadata icy_metadata;   /* Current ICY metadata */
     ne_session * session;
+    char * session_key;                 /* Identifies the session in the pool */
     ne_request * request;
+    bool_t request_done;                /* TRUE if the whole response has been read */
     pthread_t reader;
     struct reader_status reader_status;
     bool_t eof;
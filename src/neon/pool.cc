@@ -0,0 +1,163 @@
+/*
+ *  A neon HTTP input plugin for Audacious
+ *  Copyright (C) 2007 Ralf Ertzinger
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <pthread.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "debug.h"
+#include "pool.h"
+
+#define POOL_SIZE       16          /* idle sessions kept */
+#define POOL_TIMEOUT    30          /* seconds until an idle session is closed */
+
+struct pool_item
+{
+    GList link;
+    ne_session * session;
+    char * key;
+    int64_t idle_since;         /* g_get_monotonic_time () */
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static GQueue idle;             /* most recently used first */
+static unsigned expire_source;  /* timeout closing the oldest idle session */
+
+static void free_item (struct pool_item * item)
+{
+    g_queue_unlink (& idle, & item->link);
+
+    if (item->session)
+        ne_session_destroy (item->session);
+
+    g_free (item->key);
+    g_free (item);
+}
+
+static void expire (void)
+{
+    int64_t now = g_get_monotonic_time ();
+
+    while (idle.tail)
+    {
+        struct pool_item * item = (pool_item *) idle.tail->data;
+
+        if (idle.length <= POOL_SIZE &&
+         now - item->idle_since < (int64_t) POOL_TIMEOUT * G_USEC_PER_SEC)
+            break;
+
+        _DEBUG ("Closing idle session for %s", item->key);
+        free_item (item);
+    }
+}
+
+static gboolean expire_cb (void *);
+
+/* Arms the timeout for the oldest idle session, if there is one and no
+ * timeout is pending.  Called with the mutex held. */
+static void schedule_expire (void)
+{
+    if (expire_source || ! idle.tail)
+        return;
+
+    struct pool_item * item = (pool_item *) idle.tail->data;
+    int64_t left = item->idle_since + (int64_t) POOL_TIMEOUT * G_USEC_PER_SEC -
+     g_get_monotonic_time ();
+
+    expire_source = g_timeout_add (MAX (left, 0) / 1000 + 1, expire_cb, NULL);
+}
+
+/* Closes idle sessions without waiting for more neon activity. */
+static gboolean expire_cb (void *)
+{
+    pthread_mutex_lock (& mutex);
+
+    expire_source = 0;
+    expire ();
+    schedule_expire ();
+
+    pthread_mutex_unlock (& mutex);
+
+    return FALSE;
+}
+
+ne_session * pool_get (const char * key)
+{
+    ne_session * session = NULL;
+
+    pthread_mutex_lock (& mutex);
+
+    expire ();
+
+    for (GList * node = idle.head; node; node = node->next)
+    {
+        struct pool_item * item = (pool_item *) node->data;
+
+        if (! strcmp (item->key, key))
+        {
+            _DEBUG ("Reusing session for %s", key);
+            session = item->session;
+            item->session = NULL;
+            free_item (item);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock (& mutex);
+
+    return session;
+}
+
+void pool_put (ne_session * session, const char * key, bool_t keep_connection)
+{
+    if (! keep_connection)
+        ne_close_connection (session);
+
+    struct pool_item * item = g_new0 (struct pool_item, 1);
+
+    item->link.data = item;
+    item->session = session;
+    item->key = g_strdup (key);
+    item->idle_since = g_get_monotonic_time ();
+
+    pthread_mutex_lock (& mutex);
+
+    g_queue_push_head_link (& idle, & item->link);
+    expire ();
+    schedule_expire ();
+
+    pthread_mutex_unlock (& mutex);
+}
+
+void pool_cleanup (void)
+{
+    pthread_mutex_lock (& mutex);
+
+    if (expire_source)
+    {
+        g_source_remove (expire_source);
+        expire_source = 0;
+    }
+
+    while (idle.head)
+        free_item ((pool_item *) idle.head->data);
+
+    pthread_mutex_unlock (& mutex);
+}
@@ -0,0 +1,43 @@
+/*
+ *  A neon HTTP input plugin for Audacious
+ *  Copyright (C) 2007 Ralf Ertzinger
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef _NEON_POOL_H
+#define _NEON_POOL_H
+
+#include <libaudcore/core.h>
+#include <ne_session.h>
+
+/*
+ * Sessions that are not in use are kept for a while, so that the next
+ * request to the same server can skip the DNS lookup and reuse the
+ * connection (if it was left open) or at least the TLS session.  A timeout
+ * in the main loop closes them after 30 seconds; any left are closed by
+ * pool_cleanup ().  <key> identifies the server and everything else the
+ * session was set up with; it is written to debug output, so it must not
+ * contain credentials.
+ */
+ne_session * pool_get (const char * key);
+
+/* Gives a session back.  The connection is closed unless <keep_connection>
+ * is set, which is only safe if the last response was read completely. */
+void pool_put (ne_session * session, const char * key, bool_t keep_connection);
+
+void pool_cleanup (void);
+
+#endif
@@ -26,172 +26,147 @@
 #include "rb.h"
 
 /*
- * Reset a ringbuffer structure (i.e. discard all data inside of it)
+ * The positions only ever grow (modulo 2^32), so used space is simply their
+ * difference.  Each side loads the other side's position before touching the
+ * data, and publishes its own position only after it is done with the data;
+ * release and acquire would be enough for that.  Both the loads and the stores
+ * are sequentially consistent, though, because neon.cc relies on them for its
+ * wakeups: a thread that publishes data and then checks whether its peer is
+ * waiting must not miss a peer that announced it is about to wait and then
+ * checked the buffer.  That takes a single total order over the positions and
+ * the waiting flags (which glib's atomics also access sequentially
+ * consistently), on both sides.
  */
-void reset_rb (struct ringbuf * rb)
+#define LOAD(p) __atomic_load_n ((p), __ATOMIC_SEQ_CST)
+#define STORE(p, v) __atomic_store_n ((p), (v), __ATOMIC_SEQ_CST)
+
+static unsigned round_size (unsigned size)
 {
-    _RB_LOCK (rb->lock);
+    unsigned rounded = 1;
 
-    rb->wp = rb->buf;
-    rb->rp = rb->buf;
-    rb->free = rb->size;
-    rb->used = 0;
-    rb->end = rb->buf + (rb->size - 1);
+    while (rounded < size)
+        rounded <<= 1;
 
-    _RB_UNLOCK (rb->lock);
+    return rounded;
+}
+
+/*
+ * Reset a ringbuffer structure (i.e. discard all data inside of it).
+ * Neither the reader nor the writer may be active.
+ */
+void reset_rb (struct ringbuf * rb)
+{
+    STORE (& rb->wpos, 0);
+    STORE (& rb->rpos, 0);
 }
 
 /*
- * Initialize a ringbuffer structure (including memory allocation.
- * The mutex to be used is passed in the function call.
- * The mutex must not be held while calling this function.
+ * Initialize a ringbuffer structure (including memory allocation).
+ * The size is rounded up to a power of two.
  */
-void init_rb_with_lock (struct ringbuf * rb, int size, rb_mutex_t * lock)
+void init_rb (struct ringbuf * rb, unsigned size)
 {
     assert (size > 0);
 
-    rb->lock = lock;
-    rb->buf = g_new (char, size);
-    rb->size = size;
+    rb->size = round_size (size);
+    rb->buf = g_new (char, rb->size);
     reset_rb (rb);
 }
 
 /*
- * Write size bytes at buf into the ringbuffer.
+ * Change the size of a ringbuffer, keeping the data inside of it.  The new
+ * size must be large enough for the data.  Neither the reader nor the writer
+ * may be active.
  */
-void write_rb (struct ringbuf * rb, void * buf, int size)
+void resize_rb (struct ringbuf * rb, unsigned size)
 {
-    _RB_LOCK (rb->lock);
+    size = round_size (size);
 
-    assert (size <= rb->free);
+    if (size == rb->size)
+        return;
 
-    int endfree = (rb->end - rb->wp) + 1;
+    unsigned used = used_rb (rb);
+    assert (used <= size);
 
-    if (endfree < size)
-    {
-        /* There is enough space in the buffer, but not in one piece.
-         * We need to split the copy into two parts. */
-        memcpy (rb->wp, buf, endfree);
-        memcpy (rb->buf, (char *) buf + endfree, size - endfree);
-        rb->wp = rb->buf + (size-endfree);
-    }
-    else if (endfree > size)
-    {
-        /* There is more space than needed at the end */
-        memcpy (rb->wp, buf, size);
-        rb->wp += size;
-    }
-    else
-    {
-        /* There is exactly the space needed at the end.
-         * We need to wrap around the read pointer. */
-        memcpy (rb->wp, buf, size);
-        rb->wp = rb->buf;
-    }
+    char * buf = g_new (char, size);
+    unsigned rp = rb->rpos & (rb->size - 1);
+    unsigned part = MIN (used, rb->size - rp);
 
-    rb->free -= size;
-    rb->used += size;
+    memcpy (buf, rb->buf + rp, part);
+    memcpy (buf + part, rb->buf, used - part);
 
-    _RB_UNLOCK (rb->lock);
+    g_free (rb->buf);
+    rb->buf = buf;
+    rb->size = size;
+
+    STORE (& rb->rpos, 0);
+    STORE (& rb->wpos, used);
 }
 
 /*
- * Read size byes from buffer into buf.
- * Return -1 on error (not enough data in buffer)
+ * Write size bytes at buf into the ringbuffer.  Only to be called by the
+ * writer thread.
  */
-int read_rb (struct ringbuf * rb, void * buf, int size)
+void write_rb (struct ringbuf * rb, const void * buf, unsigned size)
 {
-    _RB_LOCK (rb->lock);
-    int ret = read_rb_locked (rb, buf, size);
-    _RB_UNLOCK (rb->lock);
+    unsigned wpos = rb->wpos;
+
+    assert (size <= rb->size - (wpos - LOAD (& rb->rpos)));
 
-    return ret;
+    unsigned wp = wpos & (rb->size - 1);
+    unsigned part = MIN (size, rb->size - wp);
+
+    /* The free space may be split at the end of the buffer. */
+    memcpy (rb->buf + wp, buf, part);
+    memcpy (rb->buf, (const char *) buf + part, size - part);
+
+    STORE (& rb->wpos, wpos + size);
 }
 
 /*
- * Read size bytes from buffer into buf, assuming the buffer lock is already held.
+ * Read size bytes from buffer into buf.  Only to be called by the reader
+ * thread.
  * Return -1 on error (not enough data in buffer)
  */
-int read_rb_locked (struct ringbuf * rb, void * buf, int size)
+int read_rb (struct ringbuf * rb, void * buf, unsigned size)
 {
-    if (rb->used < size)
+    unsigned rpos = rb->rpos;
+
+    if (LOAD (& rb->wpos) - rpos < size)
     {
         /* Not enough bytes in buffer */
         return -1;
     }
 
-    if (rb->rp < rb->wp)
-    {
-        /* Read pointer is behind write pointer, all the data is available in one chunk */
-        memcpy (buf, rb->rp, size);
-        rb->rp += size;
-    }
-    else
-    {
-        /* Read pointer is before write pointer */
-        int endused = (rb->end - rb->rp) +1;
-
-        if (size < endused)
-        {
-            /* Data is available in one chunk */
-            memcpy (buf, rb->rp, size);
-            rb->rp += size;
-        }
-        else
-        {
-            /* There is enough data in the buffer, but it is fragmented. */
-            memcpy (buf, rb->rp, endused);
-            memcpy ((char *) buf + endused, rb->buf, size - endused);
-            rb->rp = rb->buf + (size-endused);
-        }
-    }
+    unsigned rp = rpos & (rb->size - 1);
+    unsigned part = MIN (size, rb->size - rp);
+
+    /* The data may be split at the end of the buffer. */
+    memcpy (buf, rb->buf + rp, part);
+    memcpy ((char *) buf + part, rb->buf, size - part);
 
-    rb->free += size;
-    rb->used -= size;
+    STORE (& rb->rpos, rpos + size);
 
     return 0;
 }
 
 /*
- * Return the amount of free space currently in the rb
+ * Return the amount of free space currently in the rb.  This is exact for the
+ * writer and a lower bound for the reader.
  */
 unsigned free_rb (struct ringbuf * rb)
 {
-    _RB_LOCK (rb->lock);
-    unsigned f = free_rb_locked (rb);
-    _RB_UNLOCK (rb->lock);
-
-    return f;
-}
-
-/*
- * Return the amount of free space currently in the rb.
- * Assume the rb lock is already being held.
- */
-unsigned free_rb_locked (struct ringbuf * rb)
-{
-    return rb->free;
+    return rb->size - used_rb (rb);
 }
 
 /*
- * Return the amount of used space currently in the rb
+ * Return the amount of used space currently in the rb.  This is exact for the
+ * reader and an upper bound for the writer.
  */
 unsigned used_rb (struct ringbuf * rb)
 {
-    _RB_LOCK (rb->lock);
-    unsigned u = used_rb_locked (rb);
-    _RB_UNLOCK (rb->lock);
-
-    return u;
-}
-
-/*
- * Return the amount of used space currently in the rb.
- * Assume the rb lock is already being held.
- */
-unsigned used_rb_locked (struct ringbuf * rb)
-{
-    return rb->used;
+    unsigned rpos = LOAD (& rb->rpos);
+    return LOAD (& rb->wpos) - rpos;
 }
 
 /*
@@ -17,34 +17,27 @@
 #ifndef _RB_H
 #define _RB_H
 
-#include <pthread.h>
-
-typedef pthread_mutex_t rb_mutex_t;
-
-#define _RB_LOCK(L) pthread_mutex_lock (L)
-#define _RB_UNLOCK(L) pthread_mutex_unlock (L)
-
+/*
+ * Single-producer, single-consumer ringbuffer.  One thread may write while
+ * another reads without any locking; the read and write positions are
+ * advanced with atomic operations.  Waiting for data or space, if needed, is
+ * up to the caller.
+ */
 struct ringbuf
 {
-    rb_mutex_t * lock;
     char * buf;
-    char * end;
-    char * wp;
-    char * rp;
-    int free;
-    int used;
-    int size;
+    unsigned size;      /* always a power of two */
+    unsigned wpos;      /* bytes written so far, advanced only by the writer */
+    unsigned rpos;      /* bytes read so far, advanced only by the reader */
 };
 
-void init_rb_with_lock (struct ringbuf * rb, int size, rb_mutex_t * lock);
-void write_rb (struct ringbuf * rb, void * buf, int size);
-int read_rb (struct ringbuf * rb, void * buf, int size);
-int read_rb_locked (struct ringbuf * rb, void * buf, int size);
+void init_rb (struct ringbuf * rb, unsigned size);
+void resize_rb (struct ringbuf * rb, unsigned size);
+void write_rb (struct ringbuf * rb, const void * buf, unsigned size);
+int read_rb (struct ringbuf * rb, void * buf, unsigned size);
 void reset_rb (struct ringbuf * rb);
 unsigned free_rb (struct ringbuf * rb);
-unsigned free_rb_locked (struct ringbuf * rb);
 unsigned used_rb (struct ringbuf * rb);
-unsigned used_rb_locked (struct ringbuf * rb);
 void destroy_rb (struct ringbuf * rb);
 
 #endif
@@ -40,6 +40,10 @@ enum
 	COMMAND_JUMP
 };
 
-int ao_get_lib(char *filename, uint8_t **buffer, uint64_t *length);
+#include "../libemu/libcache.h"
+
+// ao_get_lib: returns the library file decoded into a corlett_lib_t (in
+// image->decoded), to be released with libcache_release()
+const LibImage *ao_get_lib(char *filename);
 
 #endif // AO_H
@@ -0,0 +1,135 @@
+//
+// Audio Overload
+// Emulated music player
+//
+// context.cc - creation of emulator contexts
+//
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "context.h"
+
+thread_local PSFContext *psf_ctx;
+
+PSFContext *psf_context_new(void (*update)(PSFContext *, unsigned char *, long), void *user)
+{
+	PSFContext *ctx = g_new0(PSFContext, 1);
+
+	ctx->psf_refresh = -1;
+	ctx->update = update;
+	ctx->user = user;
+
+	ctx->cpu = mips_state_new();
+	ctx->hw = psx_hw_state_new();
+	ctx->spu = spu_state_new();
+	ctx->spu2 = spu2_state_new();
+	ctx->psf = psf_state_new();
+	ctx->psf2 = psf2_state_new();
+	ctx->spx = spx_state_new();
+
+	return ctx;
+}
+
+void psf_context_free(PSFContext *ctx)
+{
+	if (psf_ctx == ctx)
+		psf_ctx = NULL;
+
+	g_free(ctx->cpu);
+	g_free(ctx->hw);
+	g_free(ctx->spu);
+	g_free(ctx->spu2);
+	g_free(ctx->psf);
+	g_free(ctx->psf2);
+	g_free(ctx->spx);
+	g_free(ctx);
+}
+
+struct PSFSnapshot
+{
+	size_t size;
+	// followed by the parts listed by get_parts()
+};
+
+typedef struct
+{
+	void *data;
+	size_t size;
+} StatePart;
+
+#define N_PARTS 10
+
+static void get_parts(PSFContext *ctx, StatePart *parts)
+{
+	StatePart list[N_PARTS] = {
+		{ctx->psx_ram, sizeof ctx->psx_ram},
+		{ctx->psx_scratch, sizeof ctx->psx_scratch},
+		{&ctx->psf_refresh, sizeof ctx->psf_refresh},
+		{ctx->cpu, mips_state_size},
+		{ctx->hw, psx_hw_state_size},
+		{ctx->spu, spu_state_size},
+		{ctx->spu2, spu2_state_size},
+		{ctx->psf, psf_state_size},
+		{ctx->psf2, psf2_state_size},
+		{ctx->spx, spx_state_size}
+	};
+
+	memcpy(parts, list, sizeof list);
+}
+
+PSFSnapshot *psf_snapshot_take(PSFContext *ctx)
+{
+	StatePart parts[N_PARTS];
+	size_t size = sizeof(PSFSnapshot);
+	int i;
+
+	g_return_val_if_fail(ctx == psf_ctx, NULL);
+
+	if (psx_hw_files_open())
+		return NULL;
+
+	get_parts(ctx, parts);
+
+	for (i = 0; i < N_PARTS; i++)
+		size += parts[i].size;
+
+	PSFSnapshot *snap = (PSFSnapshot *) g_malloc(size);
+	char *pos = (char *) (snap + 1);
+
+	snap->size = size;
+
+	for (i = 0; i < N_PARTS; i++)
+	{
+		memcpy(pos, parts[i].data, parts[i].size);
+		pos += parts[i].size;
+	}
+
+	return snap;
+}
+
+void psf_snapshot_restore(PSFContext *ctx, const PSFSnapshot *snap)
+{
+	StatePart parts[N_PARTS];
+	const char *pos = (const char *) (snap + 1);
+	int i;
+
+	get_parts(ctx, parts);
+
+	for (i = 0; i < N_PARTS; i++)
+	{
+		memcpy(parts[i].data, pos, parts[i].size);
+		pos += parts[i].size;
+	}
+}
+
+size_t psf_snapshot_size(const PSFSnapshot *snap)
+{
+	return snap->size;
+}
+
+void psf_snapshot_free(PSFSnapshot *snap)
+{
+	g_free(snap);
+}
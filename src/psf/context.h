@@ -0,0 +1,87 @@
+//
+// Audio Overload
+// Emulated music player
+//
+// context.h - state of one emulated PSX/PS2 IOP
+//
+// Each module keeps its state in a structure of its own, allocated by
+// <module>_state_new() and reached through the context of the calling
+// thread.  Any number of contexts may exist, each driven from one thread
+// at a time.
+//
+
+#ifndef __CONTEXT_H
+#define __CONTEXT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct PSFContext PSFContext;
+
+struct PSFContext
+{
+	// PSX main RAM
+	uint32_t psx_ram[(2*1024*1024)/4];
+	uint32_t psx_scratch[0x400];
+	// backup image to restart songs
+	uint32_t initial_ram[(2*1024*1024)/4];
+	uint32_t initial_scratch[0x400];
+
+	int psf_refresh;
+
+	// where library files are loaded from (owned by the caller)
+	const char *dir;
+
+	// set by update() to make the engine's execute() return
+	volatile int stop_flag;
+
+	// receives each block of output; called with NULL when the song ends
+	void (*update)(PSFContext *ctx, unsigned char *buffer, long count);
+	void *user;
+
+	struct mips_cpu_context *cpu;	// psx.cc
+	struct psx_hw_state *hw;	// psx_hw.cc
+	struct spu_state *spu;		// peops/spu.cc
+	struct spu2_state *spu2;	// peops2/
+	struct psf_state *psf;		// eng_psf.cc
+	struct psf2_state *psf2;	// eng_psf2.cc
+	struct spx_state *spx;		// eng_spx.cc
+};
+
+// the context the engines and hardware run on in this thread
+//
+// It is read on nearly every emulated instruction and sample.  The default
+// TLS model of a shared object makes each read a call to __tls_get_addr;
+// initial-exec makes it a single load, at the cost of a few bytes of the
+// static TLS space reserved for modules loaded at run time.
+extern thread_local PSFContext *psf_ctx __attribute__((tls_model("initial-exec")));
+
+PSFContext *psf_context_new(void (*update)(PSFContext *, unsigned char *, long), void *user);
+void psf_context_free(PSFContext *ctx);
+
+struct mips_cpu_context *mips_state_new(void);
+struct psx_hw_state *psx_hw_state_new(void);
+struct spu_state *spu_state_new(void);
+struct spu2_state *spu2_state_new(void);
+struct psf_state *psf_state_new(void);
+struct psf2_state *psf2_state_new(void);
+struct spx_state *spx_state_new(void);
+
+extern const size_t mips_state_size, psx_hw_state_size, spu_state_size,
+ spu2_state_size, psf_state_size, psf2_state_size, spx_state_size;
+
+int psx_hw_files_open(void);
+
+// A copy of the emulation state of a context: RAM, CPU, hardware, SPU and
+// engine.  Snapshots are taken and restored from within update(), where the
+// engines are always at the same point of their loops, and only apply to
+// the context they were taken from.
+typedef struct PSFSnapshot PSFSnapshot;
+
+// NULL if the state cannot be saved right now
+PSFSnapshot *psf_snapshot_take(PSFContext *ctx);
+void psf_snapshot_restore(PSFContext *ctx, const PSFSnapshot *snap);
+size_t psf_snapshot_size(const PSFSnapshot *snap);
+void psf_snapshot_free(PSFSnapshot *snap);
+
+#endif // __CONTEXT_H
@@ -33,3 +33,11 @@ typedef struct {
 int corlett_decode(uint8_t *input, uint32_t input_len, uint8_t **output, uint64_t *size, corlett_t **c);
 uint32_t psfTimeToMS(char *str);
 
+// a library file decoded by corlett_decode(), as kept in the library cache
+typedef struct
+{
+	uint8_t *exe;		// program section (NULL if none)
+	uint64_t exe_len;
+	corlett_t *c;		// res_section points into the raw file
+} corlett_lib_t;
+
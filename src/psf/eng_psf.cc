@@ -42,22 +42,28 @@
 #include "peops/spu.h"
 
 #include "corlett.h"
+#include "context.h"
 
 #define DEBUG_LOADER	(0)
 
 #define LE32(x) FROM_LE32(x)
 
-static corlett_t	*c = NULL;
-static char 		psfby[256];
-int			psf_refresh  = -1;
+struct psf_state
+{
+	corlett_t	*c;
+	char 		psfby[256];
+	uint32_t	initialPC, initialGP, initialSP;
+	int		slice;	// position in the current frame
+};
 
+#define PSF (psf_ctx->psf)
 
-// main RAM
-extern uint32_t psx_ram[((2*1024*1024)/4)+4];
-extern uint32_t psx_scratch[0x400];
-extern uint32_t initial_ram[((2*1024*1024)/4)+4];
-extern uint32_t initial_scratch[0x400];
-static uint32_t initialPC, initialGP, initialSP;
+const size_t psf_state_size = sizeof(struct psf_state);
+
+struct psf_state *psf_state_new(void)
+{
+	return g_new0(struct psf_state, 1);
+}
 
 extern void mips_init( void );
 extern void mips_reset( void *param );
@@ -70,20 +76,21 @@ extern void setlength(int32_t stop, int32_t fade);
 
 int32_t psf_start(uint8_t *buffer, uint32_t length)
 {
-	uint8_t *file, *lib_decoded, *lib_raw_file, *alib_decoded;
+	uint8_t *file, *lib_decoded, *alib_decoded;
 	uint32_t offset, plength, PC, SP, GP, lengthMS, fadeMS;
-	uint64_t file_len, lib_len, lib_raw_length, alib_len;
-	corlett_t *lib;
+	uint64_t file_len, lib_len, alib_len;
+	const LibImage *image;
+	corlett_lib_t *lib;
 	int i;
 	union cpuinfo mipsinfo;
 
 	// clear PSX work RAM before we start scribbling in it
-	memset(psx_ram, 0, 2*1024*1024);
+	memset(psf_ctx->psx_ram, 0, 2*1024*1024);
 
 //	printf("Length = %d\n", length);
 
 	// Decode the current GSF
-	if (corlett_decode(buffer, length, &file, &file_len, &c) != AO_SUCCESS)
+	if (corlett_decode(buffer, length, &file, &file_len, &PSF->c) != AO_SUCCESS)
 	{
 		return AO_FAIL;
 	}
@@ -102,16 +109,16 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	offset = file[0x1c] | file[0x1d]<<8 | file[0x1e]<<16 | file[0x1f]<<24;
 	printf("Text section size: %x\n", offset);
 	printf("Region: [%s]\n", &file[0x4c]);
-	printf("refresh: [%s]\n", c->inf_refresh);
+	printf("refresh: [%s]\n", PSF->c->inf_refresh);
 	#endif
 
-	if (c->inf_refresh[0] == '5')
+	if (PSF->c->inf_refresh[0] == '5')
 	{
-		psf_refresh = 50;
+		psf_ctx->psf_refresh = 50;
 	}
-	if (c->inf_refresh[0] == '6')
+	if (PSF->c->inf_refresh[0] == '6')
 	{
-		psf_refresh = 60;
+		psf_ctx->psf_refresh = 60;
 	}
 
 	PC = file[0x10] | file[0x11]<<8 | file[0x12]<<16 | file[0x13]<<24;
@@ -123,35 +130,25 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	#endif
 
 	// Get the library file, if any
-	if (c->lib[0] != 0)
+	if (PSF->c->lib[0] != 0)
 	{
-		uint64_t tmp_length;
-
 		#if DEBUG_LOADER
-		printf("Loading library: %s\n", c->lib);
+		printf("Loading library: %s\n", PSF->c->lib);
 		#endif
-		if (ao_get_lib(c->lib, &lib_raw_file, &tmp_length) != AO_SUCCESS)
-		{
-			return AO_FAIL;
-		}
-		lib_raw_length = tmp_length;
-
-		if (lib_raw_file == NULL)
-			return AO_FAIL;
-
-		if (corlett_decode(lib_raw_file, lib_raw_length, &lib_decoded, &lib_len, &lib) != AO_SUCCESS)
+		// the decoded library comes from the cache, shared with other tracks
+		if ((image = ao_get_lib(PSF->c->lib)) == NULL)
 		{
-			free(lib_raw_file);
 			return AO_FAIL;
 		}
 
-		// Free up raw file
-		free(lib_raw_file);
+		lib = (corlett_lib_t *) image->decoded;
+		lib_decoded = lib->exe;
+		lib_len = lib->exe_len;
 
-		if (strncmp((char *)lib_decoded, "PS-X EXE", 8))
+		if (lib_decoded == NULL || lib_len < 8 || strncmp((char *)lib_decoded, "PS-X EXE", 8))
 		{
 			printf("Major error!  PSF was OK, but referenced library is not!\n");
-			free(lib);
+			libcache_release(image);
 			return AO_FAIL;
 		}
 
@@ -161,19 +158,19 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 		offset = lib_decoded[0x1c] | lib_decoded[0x1d]<<8 | lib_decoded[0x1e]<<16 | lib_decoded[0x1f]<<24;
 		printf("Text section size: %x\n", offset);
 		printf("Region: [%s]\n", &lib_decoded[0x4c]);
-		printf("refresh: [%s]\n", lib->inf_refresh);
+		printf("refresh: [%s]\n", lib->c->inf_refresh);
 		#endif
 
 		// if the original file had no refresh tag, give the lib a shot
-		if (psf_refresh == -1)
+		if (psf_ctx->psf_refresh == -1)
 		{
-			if (lib->inf_refresh[0] == '5')
+			if (lib->c->inf_refresh[0] == '5')
 			{
-				psf_refresh = 50;
+				psf_ctx->psf_refresh = 50;
 			}
-			if (lib->inf_refresh[0] == '6')
+			if (lib->c->inf_refresh[0] == '6')
 			{
-				psf_refresh = 60;
+				psf_ctx->psf_refresh = 60;
 			}
 		}
 
@@ -199,10 +196,9 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 		#if DEBUG_LOADER
 		printf("library offset: %x plength: %d\n", offset, plength);
 		#endif
-		memcpy(&psx_ram[offset/4], lib_decoded + 2048, plength);
+		memcpy(&psf_ctx->psx_ram[offset/4], lib_decoded + 2048, plength);
 
-		// Dispose the corlett structure for the lib - we don't use it
-		free(lib);
+		libcache_release(image);
 	}
 
 	// now patch the main file into RAM OVER the libraries (but not the aux lib)
@@ -214,41 +210,30 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	else
 		plength = file_len - 2048;
 
-	memcpy(&psx_ram[offset/4], file + 2048, plength);
+	memcpy(&psf_ctx->psx_ram[offset/4], file + 2048, plength);
 
 	// load any auxiliary libraries now
 	for (i = 0; i < 8; i++)
 	{
-		if (c->libaux[i][0] != 0)
+		if (PSF->c->libaux[i][0] != 0)
 		{
-			uint64_t tmp_length;
-
 			#if DEBUG_LOADER
-			printf("Loading aux library: %s\n", c->libaux[i]);
+			printf("Loading aux library: %s\n", PSF->c->libaux[i]);
 			#endif
 
-			if (ao_get_lib(c->libaux[i], &lib_raw_file, &tmp_length) != AO_SUCCESS)
-			{
-				return AO_FAIL;
-			}
-			lib_raw_length = tmp_length;
-
-			if (lib_raw_file == NULL)
-				return AO_FAIL;
-
-			if (corlett_decode(lib_raw_file, lib_raw_length, &alib_decoded, &alib_len, &lib) != AO_SUCCESS)
+			if ((image = ao_get_lib(PSF->c->libaux[i])) == NULL)
 			{
-				free(lib_raw_file);
 				return AO_FAIL;
 			}
 
-			// Free up raw file
-			free(lib_raw_file);
+			lib = (corlett_lib_t *) image->decoded;
+			alib_decoded = lib->exe;
+			alib_len = lib->exe_len;
 
-			if (strncmp((char *)alib_decoded, "PS-X EXE", 8))
+			if (alib_decoded == NULL || alib_len < 8 || strncmp((char *)alib_decoded, "PS-X EXE", 8))
 			{
 				printf("Major error!  PSF was OK, but referenced library is not!\n");
-				free(lib);
+				libcache_release(image);
 				return AO_FAIL;
 			}
 
@@ -269,10 +254,9 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 			else
 				plength = alib_len - 2048;
 
-			memcpy(&psx_ram[offset/4], alib_decoded + 2048, plength);
+			memcpy(&psf_ctx->psx_ram[offset/4], alib_decoded + 2048, plength);
 
-			// Dispose the corlett structure for the lib - we don't use it
-			free(lib);
+			libcache_release(image);
 		}
 	}
 
@@ -280,14 +264,14 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 //	free(lib_decoded);
 
 	// Finally, set psfby tag
-	strcpy(psfby, "n/a");
-	if (c)
+	strcpy(PSF->psfby, "n/a");
+	if (PSF->c)
 	{
 		int i;
 		for (i = 0; i < MAX_UNKNOWN_TAGS; i++)
 		{
-			if (!g_ascii_strcasecmp(c->tag_name[i], "psfby"))
-				strcpy(psfby, c->tag_data[i]);
+			if (!g_ascii_strcasecmp(PSF->c->tag_name[i], "psfby"))
+				strcpy(PSF->psfby, PSF->c->tag_data[i]);
 		}
 	}
 
@@ -297,7 +281,7 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	// set the initial PC, SP, GP
 	#if DEBUG_LOADER
 	printf("Initial PC %x, GP %x, SP %x\n", PC, GP, SP);
-	printf("Refresh = %d\n", psf_refresh);
+	printf("Refresh = %d\n", psf_ctx->psf_refresh);
 	#endif
 	mipsinfo.i = PC;
 	mips_set_info(CPUINFO_INT_PC, &mipsinfo);
@@ -320,7 +304,7 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 		FILE *f;
 
 		f = fopen("psxram.bin", "wb");
-		fwrite(psx_ram, 2*1024*1024, 1, f);
+		fwrite(psf_ctx->psx_ram, 2*1024*1024, 1, f);
 		fclose(f);
 	}
 	#endif
@@ -329,8 +313,8 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	SPUinit();
 	SPUopen();
 
-	lengthMS = psfTimeToMS(c->inf_length);
-	fadeMS = psfTimeToMS(c->inf_fade);
+	lengthMS = psfTimeToMS(PSF->c->inf_length);
+	fadeMS = psfTimeToMS(PSF->c->inf_fade);
 
 	#if DEBUG_LOADER
 	printf("length %d fade %d\n", lengthMS, fadeMS);
@@ -346,15 +330,15 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 	// patch illegal Chocobo Dungeon 2 code - CaitSith2 put a jump in the delay slot from a BNE
 	// and rely on Highly Experimental's buggy-ass CPU to rescue them.  Verified on real hardware
 	// that the initial code is wrong.
-	if (c->inf_game)
+	if (PSF->c->inf_game)
 	{
-		if (!strcmp(c->inf_game, "Chocobo Dungeon 2"))
+		if (!strcmp(PSF->c->inf_game, "Chocobo Dungeon 2"))
 		{
-			if (psx_ram[0xbc090/4] == LE32(0x0802f040))
+			if (psf_ctx->psx_ram[0xbc090/4] == LE32(0x0802f040))
 			{
-		 		psx_ram[0xbc090/4] = LE32(0);
-				psx_ram[0xbc094/4] = LE32(0x0802f040);
-				psx_ram[0xbc098/4] = LE32(0);
+		 		psf_ctx->psx_ram[0xbc090/4] = LE32(0);
+				psf_ctx->psx_ram[0xbc094/4] = LE32(0x0802f040);
+				psf_ctx->psx_ram[0xbc098/4] = LE32(0);
 			}
 		}
 	}
@@ -362,11 +346,11 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 //	psx_ram[0x118b8/4] = LE32(0);	// crash 2 hack
 
 	// backup the initial state for restart
-	memcpy(initial_ram, psx_ram, 2*1024*1024);
-	memcpy(initial_scratch, psx_scratch, 0x400);
-	initialPC = PC;
-	initialGP = GP;
-	initialSP = SP;
+	memcpy(psf_ctx->initial_ram, psf_ctx->psx_ram, 2*1024*1024);
+	memcpy(psf_ctx->initial_scratch, psf_ctx->psx_scratch, 0x400);
+	PSF->initialPC = PC;
+	PSF->initialGP = GP;
+	PSF->initialSP = SP;
 
 	mips_execute(5000);
 
@@ -375,14 +359,13 @@ int32_t psf_start(uint8_t *buffer, uint32_t length)
 
 int32_t psf_execute(void)
 {
-	int i;
-
-	while (!stop_flag) {
-		for (i = 0; i < 44100 / 60; i++) {
+	while (!psf_ctx->stop_flag) {
+		for (; PSF->slice < 44100 / 60; PSF->slice++) {
 			psx_hw_slice();
 			SPUasync(384);
 		}
 
+		PSF->slice = 0;
 		psx_hw_frame();
 	}
 
@@ -392,7 +375,7 @@ int32_t psf_execute(void)
 int32_t psf_stop(void)
 {
 	SPUclose();
-	free(c);
+	free(PSF->c);
 
 	return AO_SUCCESS;
 }
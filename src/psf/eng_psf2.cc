@@ -61,6 +61,7 @@
 #include "peops2/spu.h"
 
 #include "corlett.h"
+#include "context.h"
 
 #define DEBUG_LOADER	(0)
 #define MAX_FS		(32)	// maximum # of filesystems (libs and subdirectories)
@@ -71,18 +72,31 @@
 
 #define LE32(x) FROM_LE32(x)
 
-static corlett_t	*c = NULL;
+struct psf2_state
+{
+	corlett_t	*c;
+	uint32_t	initialPC, initialSP;
+	uint32_t	loadAddr, lengthMS, fadeMS;
+
+	uint8_t		*filesys[MAX_FS];
+	const LibImage	*lib_image;
+	uint32_t	fssize[MAX_FS];
+	int		num_fs;
+
+	// pending R_MIPS_HI16 relocation
+	uint32_t	hi16offs, hi16target;
 
-// main RAM
-extern uint32_t psx_ram[(2*1024*1024)/4];
-extern uint32_t initial_ram[(2*1024*1024)/4];
-static uint32_t initialPC, initialSP;
-static uint32_t loadAddr, lengthMS, fadeMS;
+	int		slice;	// position in the current frame
+};
 
-static uint8_t *filesys[MAX_FS];
-static uint8_t *lib_raw_file;
-static uint32_t fssize[MAX_FS];
-static int num_fs;
+#define PSF2 (psf_ctx->psf2)
+
+const size_t psf2_state_size = sizeof(struct psf2_state);
+
+struct psf2_state *psf2_state_new(void)
+{
+	return g_new0(struct psf2_state, 1);
+}
 
 extern void mips_init( void );
 extern void mips_reset( void *param );
@@ -121,14 +135,14 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 	int i, rec;
 //	FILE *f;
 
-	if (loadAddr & 3)
+	if (PSF2->loadAddr & 3)
 	{
-		loadAddr &= ~3;
-		loadAddr += 4;
+		PSF2->loadAddr &= ~3;
+		PSF2->loadAddr += 4;
 	}
 
 	#if DEBUG_LOADER
-	printf("psf2_load_elf: starting at %08x\n", loadAddr | 0x80000000);
+	printf("psf2_load_elf: starting at %08x\n", PSF2->loadAddr | 0x80000000);
 	#endif
 
 	if ((start[0] != 0x7f) || (start[1] != 'E') || (start[2] != 'L') || (start[3] != 'F'))
@@ -171,7 +185,7 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 				break;
 
 			case 1:			// PROGBITS: copy data to destination
-				memcpy(&psx_ram[(loadAddr + addr)/4], &start[offset], size);
+				memcpy(&psf_ctx->psx_ram[(PSF2->loadAddr + addr)/4], &start[offset], size);
 				totallen += size;
 				break;
 
@@ -182,7 +196,7 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 				break;
 
 			case 8:			// NOBITS: BSS region, zero out destination
-				memset(&psx_ram[(loadAddr + addr)/4], 0, size);
+				memset(&psf_ctx->psx_ram[(PSF2->loadAddr + addr)/4], 0, size);
 				totallen += size;
 				break;
 
@@ -190,50 +204,49 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 		  		for (rec = 0; rec < (size/8); rec++)
 				{
 					uint32_t offs, info, target, temp, val, vallo;
-					static uint32_t hi16offs = 0, hi16target = 0;
 
 					offs = start[offset+(rec*8)] | start[offset+1+(rec*8)]<<8 | start[offset+2+(rec*8)]<<16 | start[offset+3+(rec*8)]<<24;
 					info = start[offset+4+(rec*8)] | start[offset+5+(rec*8)]<<8 | start[offset+6+(rec*8)]<<16 | start[offset+7+(rec*8)]<<24;
-					target = LE32(psx_ram[(loadAddr+offs)/4]);
+					target = LE32(psf_ctx->psx_ram[(PSF2->loadAddr+offs)/4]);
 
 //					printf("[%04d] offs %08x type %02x info %08x => %08x\n", rec, offs, ELF32_R_TYPE(info), ELF32_R_SYM(info), target);
 
 					switch (ELF32_R_TYPE(info))
 					{
 						case 2:	      	// R_MIPS_32
-							target += loadAddr;
+							target += PSF2->loadAddr;
 //							target |= 0x80000000;
 							break;
 
 						case 4:		// R_MIPS_26
 							temp = (target & 0x03ffffff);
 							target &= 0xfc000000;
-							temp += (loadAddr>>2);
+							temp += (PSF2->loadAddr>>2);
 							target |= temp;
 							break;
 
 						case 5:		// R_MIPS_HI16
-							hi16offs = offs;
-							hi16target = target;
+							PSF2->hi16offs = offs;
+							PSF2->hi16target = target;
 							break;
 
 						case 6:		// R_MIPS_LO16
 							vallo = ((target & 0xffff) ^ 0x8000) - 0x8000;
 
-							val = ((hi16target & 0xffff) << 16) +	vallo;
-							val += loadAddr;
+							val = ((PSF2->hi16target & 0xffff) << 16) +	vallo;
+							val += PSF2->loadAddr;
 //							val |= 0x80000000;
 
 							/* Account for the sign extension that will happen in the low bits.  */
 							val = ((val >> 16) + ((val & 0x8000) != 0)) & 0xffff;
 
-							hi16target = (hi16target & ~0xffff) | val;
+							PSF2->hi16target = (PSF2->hi16target & ~0xffff) | val;
 
 							/* Ok, we're done with the HI16 relocs.  Now deal with the LO16.  */
-							val = loadAddr + vallo;
+							val = PSF2->loadAddr + vallo;
 							target = (target & ~0xffff) | (val & 0xffff);
 
-							psx_ram[(loadAddr+hi16offs)/4] = LE32(hi16target);
+							psf_ctx->psx_ram[(PSF2->loadAddr+PSF2->hi16offs)/4] = LE32(PSF2->hi16target);
 							break;
 
 						default:
@@ -242,7 +255,7 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 							break;
 					}
 
-					psx_ram[(loadAddr+offs)/4] = LE32(target);
+					psf_ctx->psx_ram[(PSF2->loadAddr+offs)/4] = LE32(target);
 				}
 				break;
 
@@ -260,9 +273,9 @@ uint32_t psf2_load_elf(uint8_t *start, uint32_t len)
 		shent += shentsize;
 	}
 
-	entry += loadAddr;
+	entry += PSF2->loadAddr;
 	entry |= 0x80000000;
-	loadAddr += totallen;
+	PSF2->loadAddr += totallen;
 
 	#if DEBUG_LOADER
 	printf("psf2_load_elf: entry PC %08x\n", entry);
@@ -351,7 +364,7 @@ static uint32_t load_file_ex(uint8_t *top, uint8_t *start, uint32_t len, const c
 
 static uint32_t load_file(int fs, const char *file, uint8_t *buf, uint32_t buflen)
 {
-	return load_file_ex(filesys[fs], filesys[fs], fssize[fs], file, buf, buflen);
+	return load_file_ex(PSF2->filesys[fs], PSF2->filesys[fs], PSF2->fssize[fs], file, buf, buflen);
 }
 
 #if 0
@@ -370,8 +383,8 @@ static dump_files(int fs, uint8_t *buf, uint32_t buflen)
 
 	printf("Dumping FS %d\n", fs);
 
-	start = filesys[fs];
-	len = fssize[fs];
+	start = PSF2->filesys[fs];
+	len = PSF2->fssize[fs];
 
 	cptr = start + 4;
 
@@ -433,7 +446,7 @@ uint32_t psf2_load_file(const char *file, uint8_t *buf, uint32_t buflen)
 	int i;
 	uint32_t flen;
 
-	for (i = 0; i < num_fs; i++)
+	for (i = 0; i < PSF2->num_fs; i++)
 	{
 		flen = load_file(i, file, buf, buflen);
 		if (flen != 0xffffffff)
@@ -447,21 +460,21 @@ uint32_t psf2_load_file(const char *file, uint8_t *buf, uint32_t buflen)
 
 int32_t psf2_start(uint8_t *buffer, uint32_t length)
 {
-	uint8_t *file, *lib_decoded;
+	uint8_t *file;
 	uint32_t irx_len;
-	uint64_t file_len, lib_raw_length, lib_len;
+	uint64_t file_len;
 	uint8_t *buf;
 	union cpuinfo mipsinfo;
 	corlett_t *lib;
 
-	loadAddr = 0x23f00;	// this value makes allocations work out similarly to how they would
+	PSF2->loadAddr = 0x23f00;	// this value makes allocations work out similarly to how they would
 				// in Highly Experimental (as per Shadow Hearts' hard-coded assumptions)
 
 	// clear IOP work RAM before we start scribbling in it
-	memset(psx_ram, 0, 2*1024*1024);
+	memset(psf_ctx->psx_ram, 0, 2*1024*1024);
 
 	// Decode the current PSF2
-	if (corlett_decode(buffer, length, &file, &file_len, &c) != AO_SUCCESS)
+	if (corlett_decode(buffer, length, &file, &file_len, &PSF2->c) != AO_SUCCESS)
 	{
 		return AO_FAIL;
 	}
@@ -470,50 +483,42 @@ int32_t psf2_start(uint8_t *buffer, uint32_t length)
 		printf ("ERROR: PSF2 can't have a program section!  ps %lx\n", (unsigned long) file_len);
 
 	#if DEBUG_LOADER
-	printf("FS section: size %x\n", c->res_size);
+	printf("FS section: size %x\n", PSF2->c->res_size);
 	#endif
 
-	num_fs = 1;
-	filesys[0] = (uint8_t *)c->res_section;
-	fssize[0] = c->res_size;
+	PSF2->num_fs = 1;
+	PSF2->filesys[0] = (uint8_t *)PSF2->c->res_section;
+	PSF2->fssize[0] = PSF2->c->res_size;
 
 	// Get the library file, if any
-	if (c->lib[0] != 0)
+	if (PSF2->c->lib[0] != 0)
 	{
-		uint64_t tmp_length;
-
 		#if DEBUG_LOADER
-		printf("Loading library: %s\n", c->lib);
+		printf("Loading library: %s\n", PSF2->c->lib);
 		#endif
-		if (ao_get_lib(c->lib, &lib_raw_file, &tmp_length) != AO_SUCCESS)
+		// the library's file system points into the cached raw file, so it
+		// is held until psf2_stop()
+		if ((PSF2->lib_image = ao_get_lib(PSF2->c->lib)) == NULL)
 		{
 			return AO_FAIL;
 		}
-		lib_raw_length = tmp_length;
 
-		if (lib_raw_file == NULL)
-			return AO_FAIL;
-
-		if (corlett_decode(lib_raw_file, lib_raw_length, &lib_decoded, &lib_len, &lib) != AO_SUCCESS)
-		{
-			free(lib_raw_file);
-			return AO_FAIL;
-		}
+		lib = ((corlett_lib_t *) PSF2->lib_image->decoded)->c;
 
 		#if DEBUG_LOADER
 		printf("Lib FS section: size %x bytes\n", lib->res_size);
 		#endif
 
-		num_fs++;
-		filesys[1] = (uint8_t *)lib->res_section;
- 		fssize[1] = lib->res_size;
+		PSF2->num_fs++;
+		PSF2->filesys[1] = (uint8_t *)lib->res_section;
+ 		PSF2->fssize[1] = lib->res_size;
 	}
 
 	// dump all files
 	#if 0
 	buf = (uint8_t *)malloc(16*1024*1024);
 	dump_files(0, buf, 16*1024*1024);
-	if (c->lib[0] != 0)
+	if (PSF2->c->lib[0] != 0)
 		dump_files(1, buf, 16*1024*1024);
 	free(buf);
 	#endif
@@ -524,31 +529,36 @@ int32_t psf2_start(uint8_t *buffer, uint32_t length)
 
 	if (irx_len != 0xffffffff)
 	{
-		initialPC = psf2_load_elf(buf, irx_len);
-		initialSP = 0x801ffff0;
+		PSF2->initialPC = psf2_load_elf(buf, irx_len);
+		PSF2->initialSP = 0x801ffff0;
 	}
 	free(buf);
 
-	if (initialPC == 0xffffffff)
+	if (PSF2->initialPC == 0xffffffff)
 	{
+		if (PSF2->lib_image)
+		{
+			libcache_release(PSF2->lib_image);
+			PSF2->lib_image = NULL;
+		}
 		return AO_FAIL;
 	}
 
-	lengthMS = psfTimeToMS(c->inf_length);
-	fadeMS = psfTimeToMS(c->inf_fade);
-	if (lengthMS == 0)
+	PSF2->lengthMS = psfTimeToMS(PSF2->c->inf_length);
+	PSF2->fadeMS = psfTimeToMS(PSF2->c->inf_fade);
+	if (PSF2->lengthMS == 0)
 	{
-		lengthMS = ~0;
+		PSF2->lengthMS = ~0;
 	}
-	setlength2(lengthMS, fadeMS);
+	setlength2(PSF2->lengthMS, PSF2->fadeMS);
 
 	mips_init();
 	mips_reset(NULL);
 
-	mipsinfo.i = initialPC;
+	mipsinfo.i = PSF2->initialPC;
 	mips_set_info(CPUINFO_INT_PC, &mipsinfo);
 
-	mipsinfo.i = initialSP;
+	mipsinfo.i = PSF2->initialSP;
 	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R29, &mipsinfo);
 	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R30, &mipsinfo);
 
@@ -562,15 +572,15 @@ int32_t psf2_start(uint8_t *buffer, uint32_t length)
 
 	mipsinfo.i = 0x80000004;	// argv
 	mips_set_info(CPUINFO_INT_REGISTER + MIPS_R5, &mipsinfo);
-	psx_ram[1] = LE32(0x80000008);
+	psf_ctx->psx_ram[1] = LE32(0x80000008);
 
-	buf = (uint8_t *)&psx_ram[2];
+	buf = (uint8_t *)&psf_ctx->psx_ram[2];
 	strcpy((char *)buf, "aofile:/");
 
-	psx_ram[0] = LE32(FUNCT_HLECALL);
+	psf_ctx->psx_ram[0] = LE32(FUNCT_HLECALL);
 
 	// back up initial RAM image to quickly restart songs
-	memcpy(initial_ram, psx_ram, 2*1024*1024);
+	memcpy(psf_ctx->initial_ram, psf_ctx->psx_ram, 2*1024*1024);
 
 	psx_hw_init();
 	SPU2init();
@@ -581,16 +591,15 @@ int32_t psf2_start(uint8_t *buffer, uint32_t length)
 
 int32_t psf2_execute(void)
 {
-	int i;
-
-	while (!stop_flag)
+	while (!psf_ctx->stop_flag)
 	{
-		for (i = 0; i < 44100 / 60; i++)
+		for (; PSF2->slice < 44100 / 60; PSF2->slice++)
 		{
 			SPU2async(1, NULL);
 			ps2_hw_slice();
 		}
 
+		PSF2->slice = 0;
 		ps2_hw_frame();
 	}
 
@@ -600,11 +609,12 @@ int32_t psf2_execute(void)
 int32_t psf2_stop(void)
 {
 	SPU2close();
-	if (c->lib[0] != 0)
+	if (PSF2->lib_image)
 	{
-		free(lib_raw_file);
+		libcache_release(PSF2->lib_image);
+		PSF2->lib_image = NULL;
 	}
-	free(c);
+	free(PSF2->c);
 
 	return AO_SUCCESS;
 }
@@ -612,14 +622,13 @@ int32_t psf2_stop(void)
 int32_t psf2_command(int32_t command, int32_t parameter)
 {
 	union cpuinfo mipsinfo;
-	uint32_t lengthMS, fadeMS;
 
 	switch (command)
 	{
 		case COMMAND_RESTART:
 			SPU2close();
 
-			memcpy(psx_ram, initial_ram, 2*1024*1024);
+			memcpy(psf_ctx->psx_ram, psf_ctx->initial_ram, 2*1024*1024);
 
 			mips_init();
 			mips_reset(NULL);
@@ -627,10 +636,10 @@ int32_t psf2_command(int32_t command, int32_t parameter)
 			SPU2init();
 			SPU2open(NULL);
 
-			mipsinfo.i = initialPC;
+			mipsinfo.i = PSF2->initialPC;
 			mips_set_info(CPUINFO_INT_PC, &mipsinfo);
 
-			mipsinfo.i = initialSP;
+			mipsinfo.i = PSF2->initialSP;
 			mips_set_info(CPUINFO_INT_REGISTER + MIPS_R29, &mipsinfo);
 			mips_set_info(CPUINFO_INT_REGISTER + MIPS_R30, &mipsinfo);
 
@@ -647,13 +656,13 @@ int32_t psf2_command(int32_t command, int32_t parameter)
 
 			psx_hw_init();
 
-			lengthMS = psfTimeToMS(c->inf_length);
-			fadeMS = psfTimeToMS(c->inf_fade);
-			if (lengthMS == 0)
+			PSF2->lengthMS = psfTimeToMS(PSF2->c->inf_length);
+			PSF2->fadeMS = psfTimeToMS(PSF2->c->inf_fade);
+			if (PSF2->lengthMS == 0)
 			{
-				lengthMS = ~0;
+				PSF2->lengthMS = ~0;
 			}
-			setlength2(lengthMS, fadeMS);
+			setlength2(PSF2->lengthMS, PSF2->fadeMS);
 
 			return AO_SUCCESS;
 
@@ -663,10 +672,10 @@ int32_t psf2_command(int32_t command, int32_t parameter)
 
 uint32_t psf2_get_loadaddr(void)
 {
-	return loadAddr;
+	return PSF2->loadAddr;
 }
 
 void psf2_set_loadaddr(uint32_t addr)
 {
-	loadAddr = addr;
+	PSF2->loadAddr = addr;
 }
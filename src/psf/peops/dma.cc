@@ -28,7 +28,6 @@
 
 #define _IN_DMA
 
-extern uint32_t psx_ram[(2*1024*1024)/4];
 
 //#include "externals.h"
 ////////////////////////////////////////////////////////////////////////
@@ -38,14 +37,14 @@ extern uint32_t psx_ram[(2*1024*1024)/4];
 void SPUreadDMAMem(u32 usPSXMem,int iSize)
 {
  int i;
- u16 *ram16 = (u16 *)&psx_ram[0];
+ u16 *ram16 = (u16 *)&psf_ctx->psx_ram[0];
 
  for(i=0;i<iSize;i++)
   {
-   ram16[usPSXMem>>1]=spuMem[spuAddr>>1];		// spu addr got by writeregister
+   ram16[usPSXMem>>1]=SPU->spuMem[SPU->spuAddr>>1];		// spu addr got by writeregister
    usPSXMem+=2;
-   spuAddr+=2;                                         // inc spu addr
-   if(spuAddr>0x7ffff) spuAddr=0;                      // wrap
+   SPU->spuAddr+=2;                                         // inc spu addr
+   if(SPU->spuAddr>0x7ffff) SPU->spuAddr=0;                      // wrap
   }
 }
 
@@ -64,15 +63,15 @@ void SPUreadDMAMem(u32 usPSXMem,int iSize)
 void SPUwriteDMAMem(u32 usPSXMem,int iSize)
 {
  int i;
- u16 *ram16 = (u16 *)&psx_ram[0];
+ u16 *ram16 = (u16 *)&psf_ctx->psx_ram[0];
 
  for(i=0;i<iSize;i++)
   {
 //  printf("main RAM %x => SPU %x\n", usPSXMem, spuAddr);
-   spuMem[spuAddr>>1] = ram16[usPSXMem>>1];
+   SPU->spuMem[SPU->spuAddr>>1] = ram16[usPSXMem>>1];
    usPSXMem+=2;                  			// spu addr got by writeregister
-   spuAddr+=2;                                         // inc spu addr
-   if(spuAddr>0x7ffff) spuAddr=0;                      // wrap
+   SPU->spuAddr+=2;                                         // inc spu addr
+   if(SPU->spuAddr>0x7ffff) SPU->spuAddr=0;                      // wrap
   }
 }
 
@@ -85,6 +85,10 @@
 #include "../peops/registers.h"
 #include "../peops/spu.h"
 
+#include <glib.h>
+
+#include "../context.h"
+
 // Enable experimental silence skipping
 // Currently it is too aggressive, destroying the rhythm of some songs
 // See http://redmine.audacious-media-player.org/issues/201
@@ -99,29 +103,63 @@ void SPUirq(void) ;
 // globals
 ////////////////////////////////////////////////////////////////////////
 
-// psx buffer / addresses
+struct spu_state
+{
+ // psx buffer / addresses
+
+ u16  regArea[0x200];
+ u16  spuMem[256*1024];
+ u8 * spuMemC;
+ u8 * pSpuIrq;
+ u8 * pSpuBuffer;
+ u8   spuBuffer[32768];                                 // mixing buffer, kept here to be part of snapshots
+
+ // user settings
+ int             iVolume;
+
+ // MAIN infos struct for each channel
 
-static u16  regArea[0x200];
-static u16  spuMem[256*1024];
-static u8 * spuMemC;
-static u8 * pSpuIrq=0;
-static u8 * pSpuBuffer;
+ SPUCHAN         s_chan[MAXCHAN+1];                     // channel + 1 infos (1 is security for fmod handling)
+ REVERBInfo      rvb;
 
-// user settings
-static int             iVolume;
+ u32   dwNoiseVal;                                      // global noise generator
 
-// MAIN infos struct for each channel
+ u16  spuCtrl;                                         // some vars to store psx reg infos
+ u16  spuStat;
+ u16  spuIrq;
+ u32  spuAddr;                                         // address into spu mem
+ int  bSPUIsOpen;
 
-static SPUCHAN         s_chan[MAXCHAN+1];                     // channel + 1 infos (1 is security for fmod handling)
-static REVERBInfo      rvb;
+ s16 * pS;
+ s32 ttemp;
 
-static u32   dwNoiseVal=1;                          // global noise generator
+ u32 sampcount;
+ u32 decaybegin;
+ u32 decayend;
+ u32 seektime;
 
-static u16  spuCtrl=0;                             // some vars to store psx reg infos
-static u16  spuStat=0;
-static u16  spuIrq=0;
-static u32  spuAddr=0xffffffff;                    // address into spu mem
-static int  bSPUIsOpen=0;
+ u32 RateTable[160];
+
+ // reverb resampling
+ s32 downbuf[2][8];
+ s32 upbuf[2][8];
+ int dbpos,ubpos;
+};
+
+// the SPU of the current thread's emulator
+#define SPU (psf_ctx->spu)
+
+const size_t spu_state_size=sizeof(struct spu_state);
+
+struct spu_state *spu_state_new(void)
+{
+ struct spu_state *spu=g_new0(struct spu_state,1);
+
+ spu->dwNoiseVal=1;
+ spu->spuAddr=0xffffffff;
+
+ return spu;
+}
 
 static const int f[5][2] = {
 			{    0,  0  },
@@ -129,10 +167,6 @@ static const int f[5][2] = {
                         {  115, -52 },
                         {   98, -55 },
                         {  122, -60 } };
-static s16 * pS;
-static s32 ttemp;
-
-extern void psf2_update(unsigned char *samples, long lBytes);
 
 ////////////////////////////////////////////////////////////////////////
 // CODE AREA
@@ -150,8 +184,8 @@ extern void psf2_update(unsigned char *samples, long lBytes);
 ////////////////////////////////////////////////////////////////////////
 // helpers for so-called "gauss interpolation"
 
-#define gval0 (((int *)(&s_chan[ch].SB[29]))[gpos])
-#define gval(x) (((int *)(&s_chan[ch].SB[29]))[(gpos+x)&3])
+#define gval0 (((int *)(&SPU->s_chan[ch].SB[29]))[gpos])
+#define gval(x) (((int *)(&SPU->s_chan[ch].SB[29]))[(gpos+x)&3])
 
 #include "gauss_i.h"
 
@@ -165,20 +199,20 @@ static inline void StartSound(int ch)
 {
  StartADSR(ch);
 
- s_chan[ch].pCurr=s_chan[ch].pStart;                   // set sample start
+ SPU->s_chan[ch].pCurr=SPU->s_chan[ch].pStart;                   // set sample start
 
- s_chan[ch].s_1=0;                                     // init mixing vars
- s_chan[ch].s_2=0;
- s_chan[ch].iSBPos=28;
+ SPU->s_chan[ch].s_1=0;                                     // init mixing vars
+ SPU->s_chan[ch].s_2=0;
+ SPU->s_chan[ch].iSBPos=28;
 
- s_chan[ch].bNew=0;                                    // init channel flags
- s_chan[ch].bStop=0;
- s_chan[ch].bOn=1;
+ SPU->s_chan[ch].bNew=0;                                    // init channel flags
+ SPU->s_chan[ch].bStop=0;
+ SPU->s_chan[ch].bOn=1;
 
- s_chan[ch].SB[29]=0;                                  // init our interpolation helpers
- s_chan[ch].SB[30]=0;
+ SPU->s_chan[ch].SB[29]=0;                                  // init our interpolation helpers
+ SPU->s_chan[ch].SB[30]=0;
 
- s_chan[ch].spos=0x40000L;s_chan[ch].SB[28]=0;  // -> start with more decoding
+ SPU->s_chan[ch].spos=0x40000L;SPU->s_chan[ch].SB[28]=0;  // -> start with more decoding
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -187,46 +221,52 @@ static inline void StartSound(int ch)
 // basically the whole sound processing is done in this fat func!
 ////////////////////////////////////////////////////////////////////////
 
-static u32 sampcount;
-static u32 decaybegin;
-static u32 decayend;
-
-static u32 seektime;
 int psf_seek(u32 t)
 {
- seektime=t*441/10;
- if(seektime>sampcount) return(1);
+ SPU->seektime=t*441/10;
+ if(SPU->seektime>SPU->sampcount) return(1);
  return(0);
 }
 
+// position of the emulation in milliseconds, counting skipped silence
+u32 psf_tell(void)
+{
+ return (u64)SPU->sampcount*10/441;
+}
+
 // Counting to 65536 results in full volume offage.
 void setlength(s32 stop, s32 fade)
 {
  if(stop==~0)
  {
-  decaybegin=~0;
+  SPU->decaybegin=~0;
  }
  else
  {
   stop=(stop*441)/10;
   fade=(fade*441)/10;
 
-  decaybegin=stop;
-  decayend=stop+fade;
+  SPU->decaybegin=stop;
+  SPU->decayend=stop+fade;
  }
 }
 
 #define CLIP(_x) {if(_x>32767) _x=32767; if(_x<-32767) _x=-32767;}
 int SPUasync(u32 cycles)
 {
- int volmul=iVolume;
- static s32 dosampies;
+ // the context cannot change while mixing: look it up once
+ struct spu_state *const spu_local=SPU;
+#undef SPU
+#define SPU spu_local
+
+ int volmul=SPU->iVolume;
+ s32 dosampies;
  s32 temp;
 
- ttemp+=cycles;
- dosampies=ttemp/384;
+ SPU->ttemp+=cycles;
+ dosampies=SPU->ttemp/384;
  if(!dosampies) return(1);
- ttemp-=dosampies*384;
+ SPU->ttemp-=dosampies*384;
  temp=dosampies;
 
  while(temp)
@@ -242,41 +282,41 @@ int SPUasync(u32 cycles)
     {
      for(ch=0;ch<MAXCHAN;ch++)                         // loop em all.
       {
-       if(s_chan[ch].bNew) StartSound(ch);             // start new sound
-       if(!s_chan[ch].bOn) continue;                   // channel not playing? next
+       if(SPU->s_chan[ch].bNew) StartSound(ch);             // start new sound
+       if(!SPU->s_chan[ch].bOn) continue;                   // channel not playing? next
 
 
-       if(s_chan[ch].iActFreq!=s_chan[ch].iUsedFreq)   // new psx frequency?
+       if(SPU->s_chan[ch].iActFreq!=SPU->s_chan[ch].iUsedFreq)   // new psx frequency?
         {
-         s_chan[ch].iUsedFreq=s_chan[ch].iActFreq;     // -> take it and calc steps
-         s_chan[ch].sinc=s_chan[ch].iRawPitch<<4;
-         if(!s_chan[ch].sinc) s_chan[ch].sinc=1;
+         SPU->s_chan[ch].iUsedFreq=SPU->s_chan[ch].iActFreq;     // -> take it and calc steps
+         SPU->s_chan[ch].sinc=SPU->s_chan[ch].iRawPitch<<4;
+         if(!SPU->s_chan[ch].sinc) SPU->s_chan[ch].sinc=1;
         }
 
-         while(s_chan[ch].spos>=0x10000L)
+         while(SPU->s_chan[ch].spos>=0x10000L)
           {
-           if(s_chan[ch].iSBPos==28)                   // 28 reached?
+           if(SPU->s_chan[ch].iSBPos==28)                   // 28 reached?
             {
 	     int predict_nr,shift_factor,flags,d,s;
 	     u8* start;unsigned int nSample;
 	     int s_1,s_2;
 
-             start=s_chan[ch].pCurr;                   // set up the current pos
+             start=SPU->s_chan[ch].pCurr;                   // set up the current pos
 
              if (start == (u8*)-1)          // special "stop" sign
               {
-               s_chan[ch].bOn=0;                       // -> turn everything off
-               s_chan[ch].ADSRX.lVolume=0;
-               s_chan[ch].ADSRX.EnvelopeVol=0;
+               SPU->s_chan[ch].bOn=0;                       // -> turn everything off
+               SPU->s_chan[ch].ADSRX.lVolume=0;
+               SPU->s_chan[ch].ADSRX.EnvelopeVol=0;
                goto ENDX;                              // -> and done for this channel
               }
 
-             s_chan[ch].iSBPos=0;	// Reset buffer play index.
+             SPU->s_chan[ch].iSBPos=0;	// Reset buffer play index.
 
              //////////////////////////////////////////// spu irq handler here? mmm... do it later
 
-             s_1=s_chan[ch].s_1;
-             s_2=s_chan[ch].s_2;
+             s_1=SPU->s_chan[ch].s_1;
+             s_2=SPU->s_chan[ch].s_2;
 
              predict_nr=(int)*start;start++;
              shift_factor=predict_nr&0xf;
@@ -296,28 +336,28 @@ int SPUasync(u32 cycles)
                s_2=s_1;s_1=fa;
                s=((d & 0xf0) << 8);
 
-               s_chan[ch].SB[nSample++]=fa;
+               SPU->s_chan[ch].SB[nSample++]=fa;
 
                if(s&0x8000) s|=0xffff0000;
                fa=(s>>shift_factor);
                fa=fa + ((s_1 * f[predict_nr][0])>>6) + ((s_2 * f[predict_nr][1])>>6);
                s_2=s_1;s_1=fa;
 
-               s_chan[ch].SB[nSample++]=fa;
+               SPU->s_chan[ch].SB[nSample++]=fa;
               }
 
              //////////////////////////////////////////// irq check
 
-             if(spuCtrl&0x40)         			// irq active?
+             if(SPU->spuCtrl&0x40)         			// irq active?
               {
-               if((pSpuIrq >  start-16 &&              // irq address reached?
-                   pSpuIrq <= start) ||
+               if((SPU->pSpuIrq >  start-16 &&              // irq address reached?
+                   SPU->pSpuIrq <= start) ||
                   ((flags&1) &&                        // special: irq on looping addr, when stop/loop flag is set
-                   (pSpuIrq >  s_chan[ch].pLoop-16 &&
-                    pSpuIrq <= s_chan[ch].pLoop)))
+                   (SPU->pSpuIrq >  SPU->s_chan[ch].pLoop-16 &&
+                    SPU->pSpuIrq <= SPU->s_chan[ch].pLoop)))
                {
 		 //extern s32 spuirqvoodoo;
-                 s_chan[ch].iIrqDone=1;                // -> debug flag
+                 SPU->s_chan[ch].iIrqDone=1;                // -> debug flag
 		 SPUirq();
 		//puts("IRQ");
 		 //if(spuirqvoodoo!=-1)
@@ -330,43 +370,43 @@ int SPUasync(u32 cycles)
 
              //////////////////////////////////////////// flag handler
 
-             if((flags&4) && (!s_chan[ch].bIgnoreLoop))
-              s_chan[ch].pLoop=start-16;               // loop adress
+             if((flags&4) && (!SPU->s_chan[ch].bIgnoreLoop))
+              SPU->s_chan[ch].pLoop=start-16;               // loop adress
 
              if(flags&1)                               // 1: stop/loop
               {
                // We play this block out first...
                //if(!(flags&2))                          // 1+2: do loop... otherwise: stop
-               if(flags!=3 || s_chan[ch].pLoop==NULL)  // PETE: if we don't check exactly for 3, loop hang ups will happen (DQ4, for example)
+               if(flags!=3 || SPU->s_chan[ch].pLoop==NULL)  // PETE: if we don't check exactly for 3, loop hang ups will happen (DQ4, for example)
                 {                                      // and checking if pLoop is set avoids crashes, yeah
                  start = (u8*)-1;
                 }
                else
                 {
-                 start = s_chan[ch].pLoop;
+                 start = SPU->s_chan[ch].pLoop;
                 }
               }
 
-             s_chan[ch].pCurr=start;                   // store values for next cycle
-             s_chan[ch].s_1=s_1;
-             s_chan[ch].s_2=s_2;
+             SPU->s_chan[ch].pCurr=start;                   // store values for next cycle
+             SPU->s_chan[ch].s_1=s_1;
+             SPU->s_chan[ch].s_2=s_2;
 
              ////////////////////////////////////////////
             }
 
-           fa=s_chan[ch].SB[s_chan[ch].iSBPos++];      // get sample data
+           fa=SPU->s_chan[ch].SB[SPU->s_chan[ch].iSBPos++];      // get sample data
 
-           if((spuCtrl&0x4000)==0) fa=0;               // muted?
+           if((SPU->spuCtrl&0x4000)==0) fa=0;               // muted?
 	   else CLIP(fa);
 
 	    {
 	     int gpos;
-             gpos = s_chan[ch].SB[28];
+             gpos = SPU->s_chan[ch].SB[28];
              gval0 = fa;
              gpos = (gpos+1) & 3;
-             s_chan[ch].SB[28] = gpos;
+             SPU->s_chan[ch].SB[28] = gpos;
 	    }
-           s_chan[ch].spos -= 0x10000L;
+           SPU->s_chan[ch].spos -= 0x10000L;
           }
 
          ////////////////////////////////////////////////
@@ -374,29 +414,29 @@ int SPUasync(u32 cycles)
          // surely wrong... and no noise frequency (spuCtrl&0x3f00) will be used...
          // and sometimes the noise will be used as fmod modulation... pfff
 
-         if(s_chan[ch].bNoise)
+         if(SPU->s_chan[ch].bNoise)
           {
 	   //puts("Noise");
-           if((dwNoiseVal<<=1)&0x80000000L)
+           if((SPU->dwNoiseVal<<=1)&0x80000000L)
             {
-             dwNoiseVal^=0x0040001L;
-             fa=((dwNoiseVal>>2)&0x7fff);
+             SPU->dwNoiseVal^=0x0040001L;
+             fa=((SPU->dwNoiseVal>>2)&0x7fff);
              fa=-fa;
             }
-           else fa=(dwNoiseVal>>2)&0x7fff;
+           else fa=(SPU->dwNoiseVal>>2)&0x7fff;
 
            // mmm... depending on the noise freq we allow bigger/smaller changes to the previous val
-           fa=s_chan[ch].iOldNoise+((fa-s_chan[ch].iOldNoise)/((0x001f-((spuCtrl&0x3f00)>>9))+1));
+           fa=SPU->s_chan[ch].iOldNoise+((fa-SPU->s_chan[ch].iOldNoise)/((0x001f-((SPU->spuCtrl&0x3f00)>>9))+1));
            if(fa>32767L)  fa=32767L;
            if(fa<-32767L) fa=-32767L;
-           s_chan[ch].iOldNoise=fa;
+           SPU->s_chan[ch].iOldNoise=fa;
 
           }                                            //----------------------------------------
          else                                         // NO NOISE (NORMAL SAMPLE DATA) HERE
           {
              int vl, vr, gpos;
-             vl = (s_chan[ch].spos >> 6) & ~3;
-             gpos = s_chan[ch].SB[28];
+             vl = (SPU->s_chan[ch].spos >> 6) & ~3;
+             gpos = SPU->s_chan[ch].SB[28];
              vr=(gauss[vl]*gval0)>>9;
              vr+=(gauss[vl+1]*gval(1))>>9;
              vr+=(gauss[vl+2]*gval(2))>>9;
@@ -404,11 +444,11 @@ int SPUasync(u32 cycles)
              fa = vr>>2;
           }
 
-         s_chan[ch].sval = (MixADSR(ch) * fa)>>10;     // / 1023;  // add adsr
-         if(s_chan[ch].bFMod==2)                       // fmod freq channel
+         SPU->s_chan[ch].sval = (MixADSR(ch) * fa)>>10;     // / 1023;  // add adsr
+         if(SPU->s_chan[ch].bFMod==2)                       // fmod freq channel
          {
-           int NP=s_chan[ch+1].iRawPitch;
-           NP=((32768L+s_chan[ch].sval)*NP)>>15; ///32768L;
+           int NP=SPU->s_chan[ch+1].iRawPitch;
+           NP=((32768L+SPU->s_chan[ch].sval)*NP)>>15; ///32768L;
 
            if(NP>0x3fff) NP=0x3fff;
            if(NP<0x1)    NP=0x1;
@@ -418,10 +458,10 @@ int SPUasync(u32 cycles)
 
            NP=(44100L*NP)/(4096L);                     // calc frequency
 
-           s_chan[ch+1].iActFreq=NP;
-           s_chan[ch+1].iUsedFreq=NP;
-           s_chan[ch+1].sinc=(((NP/10)<<16)/4410);
-           if(!s_chan[ch+1].sinc) s_chan[ch+1].sinc=1;
+           SPU->s_chan[ch+1].iActFreq=NP;
+           SPU->s_chan[ch+1].iUsedFreq=NP;
+           SPU->s_chan[ch+1].sinc=(((NP/10)<<16)/4410);
+           if(!SPU->s_chan[ch+1].sinc) SPU->s_chan[ch+1].sinc=1;
 
 		// mmmm... set up freq decoding positions?
 		//           s_chan[ch+1].iSBPos=28;
@@ -435,8 +475,8 @@ int SPUasync(u32 cycles)
 
 		if (1) //ao_channel_enable[ch+PSF_1]) {
 		{
-			tmpl=(s_chan[ch].sval*s_chan[ch].iLeftVolume)>>14;
-			tmpr=(s_chan[ch].sval*s_chan[ch].iRightVolume)>>14;
+			tmpl=(SPU->s_chan[ch].sval*SPU->s_chan[ch].iLeftVolume)>>14;
+			tmpr=(SPU->s_chan[ch].sval*SPU->s_chan[ch].iRightVolume)>>14;
 		} else {
 			tmpl = 0;
 			tmpr = 0;
@@ -444,14 +484,14 @@ int SPUasync(u32 cycles)
 	   sl+=tmpl;
 	   sr+=tmpr;
 
-	   if(((rvb.Enabled>>ch)&1) && (spuCtrl&0x80))
+	   if(((SPU->rvb.Enabled>>ch)&1) && (SPU->spuCtrl&0x80))
 	   {
 	    revLeft+=tmpl;
 	    revRight+=tmpr;
 	   }
           }
 
-         s_chan[ch].spos += s_chan[ch].sinc;
+         SPU->s_chan[ch].spos += SPU->s_chan[ch].sinc;
  ENDX:   ;
       }
     }
@@ -460,24 +500,24 @@ int SPUasync(u32 cycles)
   // mix all channels (including reverb) into one buffer
   MixREVERBLeftRight(&sl,&sr,revLeft,revRight);
 //  printf("sampcount %d decaybegin %d decayend %d\n", sampcount, decaybegin, decayend);
-  if(sampcount>=decaybegin)
+  if(SPU->sampcount>=SPU->decaybegin)
   {
    s32 dmul;
-   if(decaybegin!=~0) // Is anyone REALLY going to be playing a song
+   if(SPU->decaybegin!=~0) // Is anyone REALLY going to be playing a song
 		      // for 13 hours?
    {
-    if(sampcount>=decayend)
+    if(SPU->sampcount>=SPU->decayend)
     {
-	    psf2_update(NULL, 0);
+	    psf_ctx->update(psf_ctx, NULL, 0);
 	    return(0);
     }
-    dmul=256-(256*(sampcount-decaybegin)/(decayend-decaybegin));
+    dmul=256-(256*(SPU->sampcount-SPU->decaybegin)/(SPU->decayend-SPU->decaybegin));
     sl=(sl*dmul)>>8;
     sr=(sr*dmul)>>8;
    }
   }
 
-  sampcount++;
+  SPU->sampcount++;
   sl=(sl*volmul)>>8;
   sr=(sr*volmul)>>8;
 
@@ -498,21 +538,21 @@ int SPUasync(u32 cycles)
   if(sl>32767) sl=32767; if(sl<-32767) sl=-32767;
   if(sr>32767) sr=32767; if(sr<-32767) sr=-32767;
 
-  *pS++=sl;
-  *pS++=sr;
+  *SPU->pS++=sl;
+  *SPU->pS++=sr;
  }
 
- if (seektime != 0 && sampcount < seektime)
+ if (SPU->seektime != 0 && SPU->sampcount < SPU->seektime)
  {
-   pS=(short *)pSpuBuffer;
+   SPU->pS=(short *)SPU->pSpuBuffer;
  }
- else if ((((unsigned char *)pS)-((unsigned char *)pSpuBuffer)) == (735*4))
+ else if ((((unsigned char *)SPU->pS)-((unsigned char *)SPU->pSpuBuffer)) == (735*4))
  {
 #ifdef ENABLE_SILENCE_SKIPPING
-   short *pSilenceIter = (short *)pSpuBuffer;
+   short *pSilenceIter = (short *)SPU->pSpuBuffer;
    int iSilenceCount = 0;
 
-   for (; pSilenceIter < pS; pSilenceIter++)
+   for (; pSilenceIter < SPU->pS; pSilenceIter++)
    {
       if (*pSilenceIter == 0)
         iSilenceCount++;
@@ -523,14 +563,17 @@ int SPUasync(u32 cycles)
 
    if (iSilenceCount < 20)
 #endif
-     psf2_update((u8*)pSpuBuffer,(u8*)pS-(u8*)pSpuBuffer);
+     psf_ctx->update(psf_ctx, (u8*)SPU->pSpuBuffer,(u8*)SPU->pS-(u8*)SPU->pSpuBuffer);
 
-   pS=(short *)pSpuBuffer;
+   SPU->pS=(short *)SPU->pSpuBuffer;
  }
 
  return(1);
 }
 
+#undef SPU
+#define SPU (psf_ctx->spu)
+
 #ifdef TIMEO
 static u64 begintime;
 static u64 gettime64(void)
@@ -555,13 +598,13 @@ static u64 gettime64(void)
 
 int SPUinit(void)
 {
- spuMemC=(u8*)spuMem;                      // just small setup
- memset((void *)s_chan,0,MAXCHAN*sizeof(SPUCHAN));
- memset((void *)&rvb,0,sizeof(REVERBInfo));
- memset(regArea,0,sizeof(regArea));
- memset(spuMem,0,sizeof(spuMem));
+ SPU->spuMemC=(u8*)SPU->spuMem;                      // just small setup
+ memset((void *)SPU->s_chan,0,MAXCHAN*sizeof(SPUCHAN));
+ memset((void *)&SPU->rvb,0,sizeof(REVERBInfo));
+ memset(SPU->regArea,0,sizeof(SPU->regArea));
+ memset(SPU->spuMem,0,sizeof(SPU->spuMem));
  InitADSR();
- sampcount=ttemp=0;
+ SPU->sampcount=SPU->ttemp=0;
  #ifdef TIMEO
  begintime=gettime64();
  #endif
@@ -576,16 +619,16 @@ void SetupStreams(void)
 {
  int i;
 
- pSpuBuffer=(u8*)malloc(32768);            // alloc mixing buffer
- pS=(s16 *)pSpuBuffer;
+ SPU->pSpuBuffer=SPU->spuBuffer;                // set up mixing buffer
+ SPU->pS=(s16 *)SPU->pSpuBuffer;
 
  for(i=0;i<MAXCHAN;i++)                                // loop sound channels
   {
-   s_chan[i].ADSRX.SustainLevel = 1024;                // -> init sustain
-   s_chan[i].iIrqDone=0;
-   s_chan[i].pLoop=spuMemC;
-   s_chan[i].pStart=spuMemC;
-   s_chan[i].pCurr=spuMemC;
+   SPU->s_chan[i].ADSRX.SustainLevel = 1024;                // -> init sustain
+   SPU->s_chan[i].iIrqDone=0;
+   SPU->s_chan[i].pLoop=SPU->spuMemC;
+   SPU->s_chan[i].pStart=SPU->spuMemC;
+   SPU->s_chan[i].pCurr=SPU->spuMemC;
   }
 }
 
@@ -595,8 +638,7 @@ void SetupStreams(void)
 
 void RemoveStreams(void)
 {
- free(pSpuBuffer);                                     // free mixing buffer
- pSpuBuffer=NULL;
+ SPU->pSpuBuffer=NULL;
 
  #ifdef TIMEO
  {
@@ -604,7 +646,7 @@ void RemoveStreams(void)
   tmp=gettime64();
   tmp-=begintime;
   if(tmp)
-   tmp=(u64)sampcount*1000000/tmp;
+   tmp=(u64)SPU->sampcount*1000000/tmp;
   printf("%lld samples per second\n",tmp);
  }
  #endif
@@ -617,21 +659,21 @@ void RemoveStreams(void)
 
 int SPUopen(void)
 {
- if(bSPUIsOpen) return 0;                              // security for some stupid main emus
- spuIrq=0;
+ if(SPU->bSPUIsOpen) return 0;                              // security for some stupid main emus
+ SPU->spuIrq=0;
 
- spuStat=spuCtrl=0;
- spuAddr=0xffffffff;
- dwNoiseVal=1;
+ SPU->spuStat=SPU->spuCtrl=0;
+ SPU->spuAddr=0xffffffff;
+ SPU->dwNoiseVal=1;
 
- spuMemC=(u8*)spuMem;
- memset((void *)s_chan,0,(MAXCHAN+1)*sizeof(SPUCHAN));
- pSpuIrq=0;
+ SPU->spuMemC=(u8*)SPU->spuMem;
+ memset((void *)SPU->s_chan,0,(MAXCHAN+1)*sizeof(SPUCHAN));
+ SPU->pSpuIrq=0;
 
- iVolume=255; //85;
+ SPU->iVolume=255; //85;
  SetupStreams();                                       // prepare streaming
 
- bSPUIsOpen=1;
+ SPU->bSPUIsOpen=1;
 
  return 1;
 }
@@ -644,9 +686,9 @@ int SPUopen(void)
 
 int SPUclose(void)
 {
- if(!bSPUIsOpen) return 0;                             // some security
+ if(!SPU->bSPUIsOpen) return 0;                             // some security
 
- bSPUIsOpen=0;                                         // no more open
+ SPU->bSPUIsOpen=0;                                         // no more open
 
  RemoveStreams();                                      // no more streaming
 
@@ -668,6 +710,6 @@ void SPUinjectRAMImage(u16 *pIncoming)
 
 	for (i = 0; i < (256*1024); i++)
 	{
-		spuMem[i] = pIncoming[i];
+		SPU->spuMem[i] = pIncoming[i];
 	}
 }
@@ -250,62 +250,83 @@ typedef struct
 // SPU.C globals
 ///////////////////////////////////////////////////////////
 
-#ifndef _IN_SPU
-
-// psx buffers / addresses
-
-extern unsigned short  regArea[];
-extern unsigned short  spuMem[];
-extern unsigned char * spuMemC;
-extern unsigned char * pSpuIrq[];
-extern unsigned char * pSpuBuffer;
-
-// user settings
-
-extern int        iUseXA;
-extern int        iVolume;
-extern int        iXAPitch;
-extern int        iUseTimer;
-extern int        iSPUIRQWait;
-extern int        iDebugMode;
-extern int        iRecordMode;
-extern int        iUseReverb;
-extern int        iUseInterpolation;
-extern int        iDisStereo;
-// MISC
-
-extern SPUCHAN s_chan[];
-extern REVERBInfo rvb[];
-
-extern unsigned long dwNoiseVal;
-extern unsigned short spuCtrl2[];
-extern unsigned short spuStat2[];
-extern unsigned long  spuIrq2[];
-extern unsigned long  spuAddr2[];
-extern unsigned long   spuRvbAddr2[];
-extern unsigned long   spuRvbAEnd2[];
-
-extern int      bEndThread;
-extern int      bThreadEnded;
-extern int      bSpuInit;
-
-extern int      SSumR[];
-extern int      SSumL[];
-extern int      iCycle;
-extern short *  pS;
-extern unsigned long dwNewChannel2[];
-extern unsigned long dwEndChannel2[];
-
-extern int iSpuAsyncWait;
+// the state of one SPU2, kept in the emulator's context (see context.h)
 
-#ifdef _WINDOWS
-//extern HWND    hWMain;                               // window handle
-//extern HWND    hWDebug;
-#endif
+struct spu2_state
+{
+ // psx buffers / addresses
 
-extern void (CALLBACK *cddavCallback)(unsigned short,unsigned short);
+ unsigned short  regArea[32*1024];
+ unsigned short  spuMem[1*1024*1024];
+ unsigned char * spuMemC;
+ unsigned char * pSpuIrq[2];
+ unsigned char * pSpuBuffer;
+ unsigned char   spuBuffer[32768];                     // mixing buffer, kept here to be part of snapshots
 
-#endif
+ // user settings
+
+ int             iUseXA;
+ int             iXAPitch;
+ int             iUseTimer;
+ int             iSPUIRQWait;
+ int             iDebugMode;
+ int             iRecordMode;
+ int             iUseReverb;
+ int             iUseInterpolation;
+
+ // MAIN infos struct for each channel
+
+ SPUCHAN         s_chan[MAXCHAN+1];                     // channel + 1 infos (1 is security for fmod handling)
+ REVERBInfo      rvb[2];
+
+ unsigned long   dwNoiseVal;                            // global noise generator
+
+ unsigned short  spuCtrl2[2];                           // some vars to store psx reg infos
+ unsigned short  spuStat2[2];
+ unsigned long   spuIrq2[2];
+ unsigned long   spuAddr2[2];                           // address into spu mem
+ unsigned long   spuRvbAddr2[2];
+ unsigned long   spuRvbAEnd2[2];
+ int             bEndThread;                            // thread handlers
+ int             bThreadEnded;
+ int             bSpuInit;
+ int             bSPUIsOpen;
+
+ unsigned long dwNewChannel2[2];                        // flags for faster testing, if new channel starts
+ unsigned long dwEndChannel2[2];
+
+ // UNUSED IN PS2 YET
+ void (CALLBACK *irqCallback)(void);                    // func of main emu, called on spu irq
+ void (CALLBACK *cddavCallback)(unsigned short,unsigned short);
+
+ int SSumR[NSSIZE];
+ int SSumL[NSSIZE];
+ int iCycle;
+ short * pS;
+
+ int lastch;                                            // last channel processed on spu irq in timer mode
+ int iSecureStart;                                      // secure start counter
+ int iSpuAsyncWait;
+
+ u32 sampcount;
+ u32 decaybegin;
+ u32 decayend;
+ u32 seektime;
+
+ unsigned long RateTable[160];
+
+ // REVERB info and timing vars...
+
+ int *          sRVBPlay[2];
+ int *          sRVBEnd[2];
+ int *          sRVBStart[2];
+ int            sRVBBuffer[2][NSSIZE*2];
+};
+
+#include "../context.h"
+
+// the SPU2 of the current thread's emulator
+#define SPU2 (psf_ctx->spu2)
 
 ///////////////////////////////////////////////////////////
 // CFG.C globals
@@ -369,12 +390,5 @@ extern int           iRightXAVol;
 // REVERB.C globals
 ///////////////////////////////////////////////////////////
 
-#ifndef _IN_REVERB
-
-extern int *          sRVBPlay[];
-extern int *          sRVBEnd[];
-extern int *          sRVBStart[];
-
-#endif
 
 #endif // PEOPS2_EXTERNALS
@@ -79,7 +79,7 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
 {
  long r=reg&0xffff;
 
- regArea[r>>1] = val;
+ SPU2->regArea[r>>1] = val;
 
 //	printf("SPU2: %04x to %08x\n", val, reg);
 
@@ -107,15 +107,15 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
        {
         const unsigned long lval=val;unsigned long lx;
         //---------------------------------------------//
-        s_chan[ch].ADSRX.AttackModeExp=(lval&0x8000)?1:0;
-        s_chan[ch].ADSRX.AttackRate=(lval>>8) & 0x007f;
-        s_chan[ch].ADSRX.DecayRate=(lval>>4) & 0x000f;
-        s_chan[ch].ADSRX.SustainLevel=lval & 0x000f;
+        SPU2->s_chan[ch].ADSRX.AttackModeExp=(lval&0x8000)?1:0;
+        SPU2->s_chan[ch].ADSRX.AttackRate=(lval>>8) & 0x007f;
+        SPU2->s_chan[ch].ADSRX.DecayRate=(lval>>4) & 0x000f;
+        SPU2->s_chan[ch].ADSRX.SustainLevel=lval & 0x000f;
         //---------------------------------------------//
-        if(!iDebugMode) break;
+        if(!SPU2->iDebugMode) break;
         //---------------------------------------------// stuff below is only for debug mode
 
-        s_chan[ch].ADSR.AttackModeExp=(lval&0x8000)?1:0;        //0x007f
+        SPU2->s_chan[ch].ADSR.AttackModeExp=(lval&0x8000)?1:0;        //0x007f
 
         lx=(((lval>>8) & 0x007f)>>2);                  // attack time to run from 0 to 100% volume
         lx = (lx < 31) ? lx : 31;                      // no overflow on shift!
@@ -126,9 +126,9 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
           else           lx=(lx/10000L)*ATTACK_MS;
           if(!lx) lx=1;
          }
-        s_chan[ch].ADSR.AttackTime=lx;
+        SPU2->s_chan[ch].ADSR.AttackTime=lx;
 
-        s_chan[ch].ADSR.SustainLevel=                 // our adsr vol runs from 0 to 1024, so scale the sustain level
+        SPU2->s_chan[ch].ADSR.SustainLevel=                 // our adsr vol runs from 0 to 1024, so scale the sustain level
          (1024*((lval) & 0x000f))/15;
 
         lx=(lval>>4) & 0x000f;                         // decay:
@@ -137,8 +137,8 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
           lx = ((1<<(lx))*DECAY_MS)/10000L;
           if(!lx) lx=1;
          }
-        s_chan[ch].ADSR.DecayTime =                   // so calc how long does it take to run from 100% to the wanted sus level
-         (lx*(1024-s_chan[ch].ADSR.SustainLevel))/1024;
+        SPU2->s_chan[ch].ADSR.DecayTime =                   // so calc how long does it take to run from 100% to the wanted sus level
+         (lx*(1024-SPU2->s_chan[ch].ADSR.SustainLevel))/1024;
        }
       break;
      //------------------------------------------------// adsr times with pre-calcs
@@ -147,17 +147,17 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
        const unsigned long lval=val;unsigned long lx;
 
        //----------------------------------------------//
-       s_chan[ch].ADSRX.SustainModeExp = (lval&0x8000)?1:0;
-       s_chan[ch].ADSRX.SustainIncrease= (lval&0x4000)?0:1;
-       s_chan[ch].ADSRX.SustainRate = (lval>>6) & 0x007f;
-       s_chan[ch].ADSRX.ReleaseModeExp = (lval&0x0020)?1:0;
-       s_chan[ch].ADSRX.ReleaseRate = lval & 0x001f;
+       SPU2->s_chan[ch].ADSRX.SustainModeExp = (lval&0x8000)?1:0;
+       SPU2->s_chan[ch].ADSRX.SustainIncrease= (lval&0x4000)?0:1;
+       SPU2->s_chan[ch].ADSRX.SustainRate = (lval>>6) & 0x007f;
+       SPU2->s_chan[ch].ADSRX.ReleaseModeExp = (lval&0x0020)?1:0;
+       SPU2->s_chan[ch].ADSRX.ReleaseRate = lval & 0x001f;
        //----------------------------------------------//
-       if(!iDebugMode) break;
+       if(!SPU2->iDebugMode) break;
        //----------------------------------------------// stuff below is only for debug mode
 
-       s_chan[ch].ADSR.SustainModeExp = (lval&0x8000)?1:0;
-       s_chan[ch].ADSR.ReleaseModeExp = (lval&0x0020)?1:0;
+       SPU2->s_chan[ch].ADSR.SustainModeExp = (lval&0x8000)?1:0;
+       SPU2->s_chan[ch].ADSR.ReleaseModeExp = (lval&0x0020)?1:0;
 
        lx=((((lval>>6) & 0x007f)>>2));                 // sustain time... often very high
        lx = (lx < 31) ? lx : 31;                       // values are used to hold the volume
@@ -168,10 +168,10 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
          else           lx=(lx/10000L)*SUSTAIN_MS;     // should be enuff... if the stop doesn't
          if(!lx) lx=1;                                 // come in this time span, I don't care :)
         }
-       s_chan[ch].ADSR.SustainTime = lx;
+       SPU2->s_chan[ch].ADSR.SustainTime = lx;
 
        lx=(lval & 0x001f);
-       s_chan[ch].ADSR.ReleaseVal     =lx;
+       SPU2->s_chan[ch].ADSR.ReleaseVal     =lx;
        if(lx)                                          // release time from 100% to 0%
         {                                              // note: the release time will be
          lx = (1<<lx);                                 // adjusted when a stop is coming,
@@ -179,17 +179,17 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
          else           lx=(lx/10000L)*RELEASE_MS;     // run from (current volume) to 0%
          if(!lx) lx=1;
         }
-       s_chan[ch].ADSR.ReleaseTime=lx;
+       SPU2->s_chan[ch].ADSR.ReleaseTime=lx;
 
        if(lval & 0x4000)                               // add/dec flag
-            s_chan[ch].ADSR.SustainModeDec=-1;
-       else s_chan[ch].ADSR.SustainModeDec=1;
+            SPU2->s_chan[ch].ADSR.SustainModeDec=-1;
+       else SPU2->s_chan[ch].ADSR.SustainModeDec=1;
       }
      break;
      //------------------------------------------------//
     }
 
-   iSpuAsyncWait=0;
+   SPU2->iSpuAsyncWait=0;
 
    return;
   }
@@ -205,37 +205,37 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
     {
      //------------------------------------------------//
      case 0x1C0:
-      s_chan[ch].iStartAdr=(((unsigned long)val&0xf)<<16)|(s_chan[ch].iStartAdr&0xFFFF);
-      s_chan[ch].pStart=spuMemC+(s_chan[ch].iStartAdr<<1);
+      SPU2->s_chan[ch].iStartAdr=(((unsigned long)val&0xf)<<16)|(SPU2->s_chan[ch].iStartAdr&0xFFFF);
+      SPU2->s_chan[ch].pStart=SPU2->spuMemC+(SPU2->s_chan[ch].iStartAdr<<1);
       break;
      case 0x1C2:
-      s_chan[ch].iStartAdr=(s_chan[ch].iStartAdr & 0xF0000) | (val & 0xFFFF);
-      s_chan[ch].pStart=spuMemC+(s_chan[ch].iStartAdr<<1);
+      SPU2->s_chan[ch].iStartAdr=(SPU2->s_chan[ch].iStartAdr & 0xF0000) | (val & 0xFFFF);
+      SPU2->s_chan[ch].pStart=SPU2->spuMemC+(SPU2->s_chan[ch].iStartAdr<<1);
       break;
      //------------------------------------------------//
      case 0x1C4:
-      s_chan[ch].iLoopAdr=(((unsigned long)val&0xf)<<16)|(s_chan[ch].iLoopAdr&0xFFFF);
-      s_chan[ch].pLoop=spuMemC+(s_chan[ch].iLoopAdr<<1);
-      s_chan[ch].bIgnoreLoop=1;
+      SPU2->s_chan[ch].iLoopAdr=(((unsigned long)val&0xf)<<16)|(SPU2->s_chan[ch].iLoopAdr&0xFFFF);
+      SPU2->s_chan[ch].pLoop=SPU2->spuMemC+(SPU2->s_chan[ch].iLoopAdr<<1);
+      SPU2->s_chan[ch].bIgnoreLoop=1;
       break;
      case 0x1C6:
-      s_chan[ch].iLoopAdr=(s_chan[ch].iLoopAdr & 0xF0000) | (val & 0xFFFF);
-      s_chan[ch].pLoop=spuMemC+(s_chan[ch].iLoopAdr<<1);
-      s_chan[ch].bIgnoreLoop=1;
+      SPU2->s_chan[ch].iLoopAdr=(SPU2->s_chan[ch].iLoopAdr & 0xF0000) | (val & 0xFFFF);
+      SPU2->s_chan[ch].pLoop=SPU2->spuMemC+(SPU2->s_chan[ch].iLoopAdr<<1);
+      SPU2->s_chan[ch].bIgnoreLoop=1;
       break;
      //------------------------------------------------//
      case 0x1C8:
       // unused... check if it gets written as well
-      s_chan[ch].iNextAdr=(((unsigned long)val&0xf)<<16)|(s_chan[ch].iNextAdr&0xFFFF);
+      SPU2->s_chan[ch].iNextAdr=(((unsigned long)val&0xf)<<16)|(SPU2->s_chan[ch].iNextAdr&0xFFFF);
       break;
      case 0x1CA:
       // unused... check if it gets written as well
-      s_chan[ch].iNextAdr=(s_chan[ch].iNextAdr & 0xF0000) | (val & 0xFFFF);
+      SPU2->s_chan[ch].iNextAdr=(SPU2->s_chan[ch].iNextAdr & 0xF0000) | (val & 0xFFFF);
       break;
      //------------------------------------------------//
     }
 
-   iSpuAsyncWait=0;
+   SPU2->iSpuAsyncWait=0;
 
    return;
   }
@@ -244,113 +244,113 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
    {
     //-------------------------------------------------//
     case PS2_C0_SPUaddr_Hi:
-      spuAddr2[0] = (((unsigned long)val&0xf)<<16)|(spuAddr2[0]&0xFFFF);
+      SPU2->spuAddr2[0] = (((unsigned long)val&0xf)<<16)|(SPU2->spuAddr2[0]&0xFFFF);
       break;
     //-------------------------------------------------//
     case PS2_C0_SPUaddr_Lo:
-      spuAddr2[0] = (spuAddr2[0] & 0xF0000) | (val & 0xFFFF);
+      SPU2->spuAddr2[0] = (SPU2->spuAddr2[0] & 0xF0000) | (val & 0xFFFF);
       break;
     //-------------------------------------------------//
     case PS2_C1_SPUaddr_Hi:
-      spuAddr2[1] = (((unsigned long)val&0xf)<<16)|(spuAddr2[1]&0xFFFF);
+      SPU2->spuAddr2[1] = (((unsigned long)val&0xf)<<16)|(SPU2->spuAddr2[1]&0xFFFF);
       break;
     //-------------------------------------------------//
     case PS2_C1_SPUaddr_Lo:
-      spuAddr2[1] = (spuAddr2[1] & 0xF0000) | (val & 0xFFFF);
+      SPU2->spuAddr2[1] = (SPU2->spuAddr2[1] & 0xF0000) | (val & 0xFFFF);
       break;
     //-------------------------------------------------//
     case PS2_C0_SPUdata:
-      spuMem[spuAddr2[0]] = val;
-      spuAddr2[0]++;
-      if(spuAddr2[0]>0xfffff) spuAddr2[0]=0;
+      SPU2->spuMem[SPU2->spuAddr2[0]] = val;
+      SPU2->spuAddr2[0]++;
+      if(SPU2->spuAddr2[0]>0xfffff) SPU2->spuAddr2[0]=0;
       break;
     //-------------------------------------------------//
     case PS2_C1_SPUdata:
-      spuMem[spuAddr2[1]] = val;
-      spuAddr2[1]++;
-      if(spuAddr2[1]>0xfffff) spuAddr2[1]=0;
+      SPU2->spuMem[SPU2->spuAddr2[1]] = val;
+      SPU2->spuAddr2[1]++;
+      if(SPU2->spuAddr2[1]>0xfffff) SPU2->spuAddr2[1]=0;
       break;
     //-------------------------------------------------//
     case PS2_C0_ATTR:
-      spuCtrl2[0]=val;
+      SPU2->spuCtrl2[0]=val;
       break;
     //-------------------------------------------------//
     case PS2_C1_ATTR:
-      spuCtrl2[1]=val;
+      SPU2->spuCtrl2[1]=val;
       break;
     //-------------------------------------------------//
     case PS2_C0_SPUstat:
-      spuStat2[0]=val;
+      SPU2->spuStat2[0]=val;
       break;
     //-------------------------------------------------//
     case PS2_C1_SPUstat:
-      spuStat2[1]=val;
+      SPU2->spuStat2[1]=val;
       break;
     //-------------------------------------------------//
     case PS2_C0_ReverbAddr_Hi:
-      spuRvbAddr2[0] = (((unsigned long)val&0xf)<<16)|(spuRvbAddr2[0]&0xFFFF);
+      SPU2->spuRvbAddr2[0] = (((unsigned long)val&0xf)<<16)|(SPU2->spuRvbAddr2[0]&0xFFFF);
       SetReverbAddr(0);
       break;
     //-------------------------------------------------//
     case PS2_C0_ReverbAddr_Lo:
-      spuRvbAddr2[0] = (spuRvbAddr2[0] & 0xF0000) | (val & 0xFFFF);
+      SPU2->spuRvbAddr2[0] = (SPU2->spuRvbAddr2[0] & 0xF0000) | (val & 0xFFFF);
       SetReverbAddr(0);
       break;
     //-------------------------------------------------//
     case PS2_C0_ReverbAEnd_Hi:
-      spuRvbAEnd2[0] = (((unsigned long)val&0xf)<<16)|(/*spuRvbAEnd2[0]&*/0xFFFF);
-      rvb[0].EndAddr=spuRvbAEnd2[0];
+      SPU2->spuRvbAEnd2[0] = (((unsigned long)val&0xf)<<16)|(/*spuRvbAEnd2[0]&*/0xFFFF);
+      SPU2->rvb[0].EndAddr=SPU2->spuRvbAEnd2[0];
       break;
     //-------------------------------------------------//
     case PS2_C1_ReverbAEnd_Hi:
-      spuRvbAEnd2[1] = (((unsigned long)val&0xf)<<16)|(/*spuRvbAEnd2[1]&*/0xFFFF);
-      rvb[1].EndAddr=spuRvbAEnd2[1];
+      SPU2->spuRvbAEnd2[1] = (((unsigned long)val&0xf)<<16)|(/*spuRvbAEnd2[1]&*/0xFFFF);
+      SPU2->rvb[1].EndAddr=SPU2->spuRvbAEnd2[1];
       break;
     //-------------------------------------------------//
     case PS2_C1_ReverbAddr_Hi:
-      spuRvbAddr2[1] = (((unsigned long)val&0xf)<<16)|(spuRvbAddr2[1]&0xFFFF);
+      SPU2->spuRvbAddr2[1] = (((unsigned long)val&0xf)<<16)|(SPU2->spuRvbAddr2[1]&0xFFFF);
       SetReverbAddr(1);
       break;
     //-------------------------------------------------//
     case PS2_C1_ReverbAddr_Lo:
-      spuRvbAddr2[1] = (spuRvbAddr2[1] & 0xF0000) | (val & 0xFFFF);
+      SPU2->spuRvbAddr2[1] = (SPU2->spuRvbAddr2[1] & 0xF0000) | (val & 0xFFFF);
       SetReverbAddr(1);
       break;
     //-------------------------------------------------//
     case PS2_C0_SPUirqAddr_Hi:
-      spuIrq2[0] = (((unsigned long)val&0xf)<<16)|(spuIrq2[0]&0xFFFF);
-      pSpuIrq[0]=spuMemC+(spuIrq2[0]<<1);
+      SPU2->spuIrq2[0] = (((unsigned long)val&0xf)<<16)|(SPU2->spuIrq2[0]&0xFFFF);
+      SPU2->pSpuIrq[0]=SPU2->spuMemC+(SPU2->spuIrq2[0]<<1);
       break;
     //-------------------------------------------------//
     case PS2_C0_SPUirqAddr_Lo:
-      spuIrq2[0] = (spuIrq2[0] & 0xF0000) | (val & 0xFFFF);
-      pSpuIrq[0]=spuMemC+(spuIrq2[0]<<1);
+      SPU2->spuIrq2[0] = (SPU2->spuIrq2[0] & 0xF0000) | (val & 0xFFFF);
+      SPU2->pSpuIrq[0]=SPU2->spuMemC+(SPU2->spuIrq2[0]<<1);
       break;
     //-------------------------------------------------//
     case PS2_C1_SPUirqAddr_Hi:
-      spuIrq2[1] = (((unsigned long)val&0xf)<<16)|(spuIrq2[1]&0xFFFF);
-      pSpuIrq[1]=spuMemC+(spuIrq2[1]<<1);
+      SPU2->spuIrq2[1] = (((unsigned long)val&0xf)<<16)|(SPU2->spuIrq2[1]&0xFFFF);
+      SPU2->pSpuIrq[1]=SPU2->spuMemC+(SPU2->spuIrq2[1]<<1);
       break;
     //-------------------------------------------------//
     case PS2_C1_SPUirqAddr_Lo:
-      spuIrq2[1] = (spuIrq2[1] & 0xF0000) | (val & 0xFFFF);
-      pSpuIrq[1]=spuMemC+(spuIrq2[1]<<1);
+      SPU2->spuIrq2[1] = (SPU2->spuIrq2[1] & 0xF0000) | (val & 0xFFFF);
+      SPU2->pSpuIrq[1]=SPU2->spuMemC+(SPU2->spuIrq2[1]<<1);
       break;
     //-------------------------------------------------//
     case PS2_C0_SPUrvolL:
-      rvb[0].VolLeft=val;
+      SPU2->rvb[0].VolLeft=val;
       break;
     //-------------------------------------------------//
     case PS2_C0_SPUrvolR:
-      rvb[0].VolRight=val;
+      SPU2->rvb[0].VolRight=val;
       break;
     //-------------------------------------------------//
     case PS2_C1_SPUrvolL:
-      rvb[1].VolLeft=val;
+      SPU2->rvb[1].VolLeft=val;
       break;
     //-------------------------------------------------//
     case PS2_C1_SPUrvolR:
-      rvb[1].VolRight=val;
+      SPU2->rvb[1].VolRight=val;
       break;
     //-------------------------------------------------//
     case PS2_C0_SPUon1:
@@ -387,12 +387,12 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
     //-------------------------------------------------//
     case PS2_C0_SPUend1:
     case PS2_C0_SPUend2:
-      if(val) dwEndChannel2[0]=0;
+      if(val) SPU2->dwEndChannel2[0]=0;
       break;
     //-------------------------------------------------//
     case PS2_C1_SPUend1:
     case PS2_C1_SPUend2:
-      if(val) dwEndChannel2[1]=0;
+      if(val) SPU2->dwEndChannel2[1]=0;
       break;
     //-------------------------------------------------//
     case PS2_C0_FMod1:
@@ -492,293 +492,293 @@ EXPORT_GCC void CALLBACK SPU2write(unsigned long reg, unsigned short val)
       break;
     //-------------------------------------------------//
     case PS2_C0_Reverb+0:
-      rvb[0].FB_SRC_A=(((unsigned long)val&0xf)<<16)|(rvb[0].FB_SRC_A&0xFFFF);
+      SPU2->rvb[0].FB_SRC_A=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].FB_SRC_A&0xFFFF);
       break;
     case PS2_C0_Reverb+2:
-      rvb[0].FB_SRC_A=(rvb[0].FB_SRC_A & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].FB_SRC_A=(SPU2->rvb[0].FB_SRC_A & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+4:
-      rvb[0].FB_SRC_B=(((unsigned long)val&0xf)<<16)|(rvb[0].FB_SRC_B&0xFFFF);
+      SPU2->rvb[0].FB_SRC_B=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].FB_SRC_B&0xFFFF);
       break;
     case PS2_C0_Reverb+6:
-      rvb[0].FB_SRC_B=(rvb[0].FB_SRC_B & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].FB_SRC_B=(SPU2->rvb[0].FB_SRC_B & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+8:
-      rvb[0].IIR_DEST_A0=(((unsigned long)val&0xf)<<16)|(rvb[0].IIR_DEST_A0&0xFFFF);
+      SPU2->rvb[0].IIR_DEST_A0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].IIR_DEST_A0&0xFFFF);
       break;
     case PS2_C0_Reverb+10:
-      rvb[0].IIR_DEST_A0=(rvb[0].IIR_DEST_A0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].IIR_DEST_A0=(SPU2->rvb[0].IIR_DEST_A0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+12:
-      rvb[0].IIR_DEST_A1=(((unsigned long)val&0xf)<<16)|(rvb[0].IIR_DEST_A1&0xFFFF);
+      SPU2->rvb[0].IIR_DEST_A1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].IIR_DEST_A1&0xFFFF);
       break;
     case PS2_C0_Reverb+14:
-      rvb[0].IIR_DEST_A1=(rvb[0].IIR_DEST_A1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].IIR_DEST_A1=(SPU2->rvb[0].IIR_DEST_A1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+16:
-      rvb[0].ACC_SRC_A0=(((unsigned long)val&0xf)<<16)|(rvb[0].ACC_SRC_A0&0xFFFF);
+      SPU2->rvb[0].ACC_SRC_A0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].ACC_SRC_A0&0xFFFF);
       break;
     case PS2_C0_Reverb+18:
-      rvb[0].ACC_SRC_A0=(rvb[0].ACC_SRC_A0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].ACC_SRC_A0=(SPU2->rvb[0].ACC_SRC_A0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+20:
-      rvb[0].ACC_SRC_A1=(((unsigned long)val&0xf)<<16)|(rvb[0].ACC_SRC_A1&0xFFFF);
+      SPU2->rvb[0].ACC_SRC_A1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].ACC_SRC_A1&0xFFFF);
       break;
     case PS2_C0_Reverb+22:
-      rvb[0].ACC_SRC_A1=(rvb[0].ACC_SRC_A1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].ACC_SRC_A1=(SPU2->rvb[0].ACC_SRC_A1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+24:
-      rvb[0].ACC_SRC_B0=(((unsigned long)val&0xf)<<16)|(rvb[0].ACC_SRC_B0&0xFFFF);
+      SPU2->rvb[0].ACC_SRC_B0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].ACC_SRC_B0&0xFFFF);
       break;
     case PS2_C0_Reverb+26:
-      rvb[0].ACC_SRC_B0=(rvb[0].ACC_SRC_B0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].ACC_SRC_B0=(SPU2->rvb[0].ACC_SRC_B0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+28:
-      rvb[0].ACC_SRC_B1=(((unsigned long)val&0xf)<<16)|(rvb[0].ACC_SRC_B1&0xFFFF);
+      SPU2->rvb[0].ACC_SRC_B1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].ACC_SRC_B1&0xFFFF);
       break;
     case PS2_C0_Reverb+30:
-      rvb[0].ACC_SRC_B1=(rvb[0].ACC_SRC_B1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].ACC_SRC_B1=(SPU2->rvb[0].ACC_SRC_B1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+32:
-      rvb[0].IIR_SRC_A0=(((unsigned long)val&0xf)<<16)|(rvb[0].IIR_SRC_A0&0xFFFF);
+      SPU2->rvb[0].IIR_SRC_A0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].IIR_SRC_A0&0xFFFF);
       break;
     case PS2_C0_Reverb+34:
-      rvb[0].IIR_SRC_A0=(rvb[0].IIR_SRC_A0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].IIR_SRC_A0=(SPU2->rvb[0].IIR_SRC_A0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+36:
-      rvb[0].IIR_SRC_A1=(((unsigned long)val&0xf)<<16)|(rvb[0].IIR_SRC_A1&0xFFFF);
+      SPU2->rvb[0].IIR_SRC_A1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].IIR_SRC_A1&0xFFFF);
       break;
     case PS2_C0_Reverb+38:
-      rvb[0].IIR_SRC_A1=(rvb[0].IIR_SRC_A1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].IIR_SRC_A1=(SPU2->rvb[0].IIR_SRC_A1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+40:
-      rvb[0].IIR_DEST_B0=(((unsigned long)val&0xf)<<16)|(rvb[0].IIR_DEST_B0&0xFFFF);
+      SPU2->rvb[0].IIR_DEST_B0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].IIR_DEST_B0&0xFFFF);
       break;
     case PS2_C0_Reverb+42:
-      rvb[0].IIR_DEST_B0=(rvb[0].IIR_DEST_B0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].IIR_DEST_B0=(SPU2->rvb[0].IIR_DEST_B0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+44:
-      rvb[0].IIR_DEST_B1=(((unsigned long)val&0xf)<<16)|(rvb[0].IIR_DEST_B1&0xFFFF);
+      SPU2->rvb[0].IIR_DEST_B1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].IIR_DEST_B1&0xFFFF);
       break;
     case PS2_C0_Reverb+46:
-      rvb[0].IIR_DEST_B1=(rvb[0].IIR_DEST_B1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].IIR_DEST_B1=(SPU2->rvb[0].IIR_DEST_B1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+48:
-      rvb[0].ACC_SRC_C0=(((unsigned long)val&0xf)<<16)|(rvb[0].ACC_SRC_C0&0xFFFF);
+      SPU2->rvb[0].ACC_SRC_C0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].ACC_SRC_C0&0xFFFF);
       break;
     case PS2_C0_Reverb+50:
-      rvb[0].ACC_SRC_C0=(rvb[0].ACC_SRC_C0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].ACC_SRC_C0=(SPU2->rvb[0].ACC_SRC_C0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+52:
-      rvb[0].ACC_SRC_C1=(((unsigned long)val&0xf)<<16)|(rvb[0].ACC_SRC_C1&0xFFFF);
+      SPU2->rvb[0].ACC_SRC_C1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].ACC_SRC_C1&0xFFFF);
       break;
     case PS2_C0_Reverb+54:
-      rvb[0].ACC_SRC_C1=(rvb[0].ACC_SRC_C1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].ACC_SRC_C1=(SPU2->rvb[0].ACC_SRC_C1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+56:
-      rvb[0].ACC_SRC_D0=(((unsigned long)val&0xf)<<16)|(rvb[0].ACC_SRC_D0&0xFFFF);
+      SPU2->rvb[0].ACC_SRC_D0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].ACC_SRC_D0&0xFFFF);
       break;
     case PS2_C0_Reverb+58:
-      rvb[0].ACC_SRC_D0=(rvb[0].ACC_SRC_D0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].ACC_SRC_D0=(SPU2->rvb[0].ACC_SRC_D0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+60:
-      rvb[0].ACC_SRC_D1=(((unsigned long)val&0xf)<<16)|(rvb[0].ACC_SRC_D1&0xFFFF);
+      SPU2->rvb[0].ACC_SRC_D1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].ACC_SRC_D1&0xFFFF);
       break;
     case PS2_C0_Reverb+62:
-      rvb[0].ACC_SRC_D1=(rvb[0].ACC_SRC_D1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].ACC_SRC_D1=(SPU2->rvb[0].ACC_SRC_D1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+64:
-      rvb[0].IIR_SRC_B1=(((unsigned long)val&0xf)<<16)|(rvb[0].IIR_SRC_B1&0xFFFF);
+      SPU2->rvb[0].IIR_SRC_B1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].IIR_SRC_B1&0xFFFF);
       break;
     case PS2_C0_Reverb+66:
-      rvb[0].IIR_SRC_B1=(rvb[0].IIR_SRC_B1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].IIR_SRC_B1=(SPU2->rvb[0].IIR_SRC_B1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+68:
-      rvb[0].IIR_SRC_B0=(((unsigned long)val&0xf)<<16)|(rvb[0].IIR_SRC_B0&0xFFFF);
+      SPU2->rvb[0].IIR_SRC_B0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].IIR_SRC_B0&0xFFFF);
       break;
     case PS2_C0_Reverb+70:
-      rvb[0].IIR_SRC_B0=(rvb[0].IIR_SRC_B0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].IIR_SRC_B0=(SPU2->rvb[0].IIR_SRC_B0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+72:
-      rvb[0].MIX_DEST_A0=(((unsigned long)val&0xf)<<16)|(rvb[0].MIX_DEST_A0&0xFFFF);
+      SPU2->rvb[0].MIX_DEST_A0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].MIX_DEST_A0&0xFFFF);
       break;
     case PS2_C0_Reverb+74:
-      rvb[0].MIX_DEST_A0=(rvb[0].MIX_DEST_A0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].MIX_DEST_A0=(SPU2->rvb[0].MIX_DEST_A0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+76:
-      rvb[0].MIX_DEST_A1=(((unsigned long)val&0xf)<<16)|(rvb[0].MIX_DEST_A1&0xFFFF);
+      SPU2->rvb[0].MIX_DEST_A1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].MIX_DEST_A1&0xFFFF);
       break;
     case PS2_C0_Reverb+78:
-      rvb[0].MIX_DEST_A1=(rvb[0].MIX_DEST_A1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].MIX_DEST_A1=(SPU2->rvb[0].MIX_DEST_A1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+80:
-      rvb[0].MIX_DEST_B0=(((unsigned long)val&0xf)<<16)|(rvb[0].MIX_DEST_B0&0xFFFF);
+      SPU2->rvb[0].MIX_DEST_B0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].MIX_DEST_B0&0xFFFF);
       break;
     case PS2_C0_Reverb+82:
-      rvb[0].MIX_DEST_B0=(rvb[0].MIX_DEST_B0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[0].MIX_DEST_B0=(SPU2->rvb[0].MIX_DEST_B0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C0_Reverb+84:
-      rvb[0].MIX_DEST_B1=(((unsigned long)val&0xf)<<16)|(rvb[0].MIX_DEST_B1&0xFFFF);
+      SPU2->rvb[0].MIX_DEST_B1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[0].MIX_DEST_B1&0xFFFF);
       break;
     case PS2_C0_Reverb+86:
-      rvb[0].MIX_DEST_B1=(rvb[0].MIX_DEST_B1 & 0xF0000) | ((val) & 0xFFFF);
-      break;
-    case PS2_C0_ReverbX+0:  rvb[0].IIR_ALPHA=(short)val;      break;
-    case PS2_C0_ReverbX+2:  rvb[0].ACC_COEF_A=(short)val;     break;
-    case PS2_C0_ReverbX+4:  rvb[0].ACC_COEF_B=(short)val;     break;
-    case PS2_C0_ReverbX+6:  rvb[0].ACC_COEF_C=(short)val;     break;
-    case PS2_C0_ReverbX+8:  rvb[0].ACC_COEF_D=(short)val;     break;
-    case PS2_C0_ReverbX+10: rvb[0].IIR_COEF=(short)val;       break;
-    case PS2_C0_ReverbX+12: rvb[0].FB_ALPHA=(short)val;       break;
-    case PS2_C0_ReverbX+14: rvb[0].FB_X=(short)val;           break;
-    case PS2_C0_ReverbX+16: rvb[0].IN_COEF_L=(short)val;      break;
-    case PS2_C0_ReverbX+18: rvb[0].IN_COEF_R=(short)val;      break;
+      SPU2->rvb[0].MIX_DEST_B1=(SPU2->rvb[0].MIX_DEST_B1 & 0xF0000) | ((val) & 0xFFFF);
+      break;
+    case PS2_C0_ReverbX+0:  SPU2->rvb[0].IIR_ALPHA=(short)val;      break;
+    case PS2_C0_ReverbX+2:  SPU2->rvb[0].ACC_COEF_A=(short)val;     break;
+    case PS2_C0_ReverbX+4:  SPU2->rvb[0].ACC_COEF_B=(short)val;     break;
+    case PS2_C0_ReverbX+6:  SPU2->rvb[0].ACC_COEF_C=(short)val;     break;
+    case PS2_C0_ReverbX+8:  SPU2->rvb[0].ACC_COEF_D=(short)val;     break;
+    case PS2_C0_ReverbX+10: SPU2->rvb[0].IIR_COEF=(short)val;       break;
+    case PS2_C0_ReverbX+12: SPU2->rvb[0].FB_ALPHA=(short)val;       break;
+    case PS2_C0_ReverbX+14: SPU2->rvb[0].FB_X=(short)val;           break;
+    case PS2_C0_ReverbX+16: SPU2->rvb[0].IN_COEF_L=(short)val;      break;
+    case PS2_C0_ReverbX+18: SPU2->rvb[0].IN_COEF_R=(short)val;      break;
     //-------------------------------------------------//
     case PS2_C1_Reverb+0:
-      rvb[1].FB_SRC_A=(((unsigned long)val&0xf)<<16)|(rvb[1].FB_SRC_A&0xFFFF);
+      SPU2->rvb[1].FB_SRC_A=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].FB_SRC_A&0xFFFF);
       break;
     case PS2_C1_Reverb+2:
-      rvb[1].FB_SRC_A=(rvb[1].FB_SRC_A & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].FB_SRC_A=(SPU2->rvb[1].FB_SRC_A & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+4:
-      rvb[1].FB_SRC_B=(((unsigned long)val&0xf)<<16)|(rvb[1].FB_SRC_B&0xFFFF);
+      SPU2->rvb[1].FB_SRC_B=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].FB_SRC_B&0xFFFF);
       break;
     case PS2_C1_Reverb+6:
-      rvb[1].FB_SRC_B=(rvb[1].FB_SRC_B & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].FB_SRC_B=(SPU2->rvb[1].FB_SRC_B & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+8:
-      rvb[1].IIR_DEST_A0=(((unsigned long)val&0xf)<<16)|(rvb[1].IIR_DEST_A0&0xFFFF);
+      SPU2->rvb[1].IIR_DEST_A0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].IIR_DEST_A0&0xFFFF);
       break;
     case PS2_C1_Reverb+10:
-      rvb[1].IIR_DEST_A0=(rvb[1].IIR_DEST_A0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].IIR_DEST_A0=(SPU2->rvb[1].IIR_DEST_A0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+12:
-      rvb[1].IIR_DEST_A1=(((unsigned long)val&0xf)<<16)|(rvb[1].IIR_DEST_A1&0xFFFF);
+      SPU2->rvb[1].IIR_DEST_A1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].IIR_DEST_A1&0xFFFF);
       break;
     case PS2_C1_Reverb+14:
-      rvb[1].IIR_DEST_A1=(rvb[1].IIR_DEST_A1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].IIR_DEST_A1=(SPU2->rvb[1].IIR_DEST_A1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+16:
-      rvb[1].ACC_SRC_A0=(((unsigned long)val&0xf)<<16)|(rvb[1].ACC_SRC_A0&0xFFFF);
+      SPU2->rvb[1].ACC_SRC_A0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].ACC_SRC_A0&0xFFFF);
       break;
     case PS2_C1_Reverb+18:
-      rvb[1].ACC_SRC_A0=(rvb[1].ACC_SRC_A0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].ACC_SRC_A0=(SPU2->rvb[1].ACC_SRC_A0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+20:
-      rvb[1].ACC_SRC_A1=(((unsigned long)val&0xf)<<16)|(rvb[1].ACC_SRC_A1&0xFFFF);
+      SPU2->rvb[1].ACC_SRC_A1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].ACC_SRC_A1&0xFFFF);
       break;
     case PS2_C1_Reverb+22:
-      rvb[1].ACC_SRC_A1=(rvb[1].ACC_SRC_A1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].ACC_SRC_A1=(SPU2->rvb[1].ACC_SRC_A1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+24:
-      rvb[1].ACC_SRC_B0=(((unsigned long)val&0xf)<<16)|(rvb[1].ACC_SRC_B0&0xFFFF);
+      SPU2->rvb[1].ACC_SRC_B0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].ACC_SRC_B0&0xFFFF);
       break;
     case PS2_C1_Reverb+26:
-      rvb[1].ACC_SRC_B0=(rvb[1].ACC_SRC_B0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].ACC_SRC_B0=(SPU2->rvb[1].ACC_SRC_B0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+28:
-      rvb[1].ACC_SRC_B1=(((unsigned long)val&0xf)<<16)|(rvb[1].ACC_SRC_B1&0xFFFF);
+      SPU2->rvb[1].ACC_SRC_B1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].ACC_SRC_B1&0xFFFF);
       break;
     case PS2_C1_Reverb+30:
-      rvb[1].ACC_SRC_B1=(rvb[1].ACC_SRC_B1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].ACC_SRC_B1=(SPU2->rvb[1].ACC_SRC_B1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+32:
-      rvb[1].IIR_SRC_A0=(((unsigned long)val&0xf)<<16)|(rvb[1].IIR_SRC_A0&0xFFFF);
+      SPU2->rvb[1].IIR_SRC_A0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].IIR_SRC_A0&0xFFFF);
       break;
     case PS2_C1_Reverb+34:
-      rvb[1].IIR_SRC_A0=(rvb[1].IIR_SRC_A0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].IIR_SRC_A0=(SPU2->rvb[1].IIR_SRC_A0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+36:
-      rvb[1].IIR_SRC_A1=(((unsigned long)val&0xf)<<16)|(rvb[1].IIR_SRC_A1&0xFFFF);
+      SPU2->rvb[1].IIR_SRC_A1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].IIR_SRC_A1&0xFFFF);
       break;
     case PS2_C1_Reverb+38:
-      rvb[1].IIR_SRC_A1=(rvb[1].IIR_SRC_A1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].IIR_SRC_A1=(SPU2->rvb[1].IIR_SRC_A1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+40:
-      rvb[1].IIR_DEST_B0=(((unsigned long)val&0xf)<<16)|(rvb[1].IIR_DEST_B0&0xFFFF);
+      SPU2->rvb[1].IIR_DEST_B0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].IIR_DEST_B0&0xFFFF);
       break;
     case PS2_C1_Reverb+42:
-      rvb[1].IIR_DEST_B0=(rvb[1].IIR_DEST_B0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].IIR_DEST_B0=(SPU2->rvb[1].IIR_DEST_B0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+44:
-      rvb[1].IIR_DEST_B1=(((unsigned long)val&0xf)<<16)|(rvb[1].IIR_DEST_B1&0xFFFF);
+      SPU2->rvb[1].IIR_DEST_B1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].IIR_DEST_B1&0xFFFF);
       break;
     case PS2_C1_Reverb+46:
-      rvb[1].IIR_DEST_B1=(rvb[1].IIR_DEST_B1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].IIR_DEST_B1=(SPU2->rvb[1].IIR_DEST_B1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+48:
-      rvb[1].ACC_SRC_C0=(((unsigned long)val&0xf)<<16)|(rvb[1].ACC_SRC_C0&0xFFFF);
+      SPU2->rvb[1].ACC_SRC_C0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].ACC_SRC_C0&0xFFFF);
       break;
     case PS2_C1_Reverb+50:
-      rvb[1].ACC_SRC_C0=(rvb[1].ACC_SRC_C0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].ACC_SRC_C0=(SPU2->rvb[1].ACC_SRC_C0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+52:
-      rvb[1].ACC_SRC_C1=(((unsigned long)val&0xf)<<16)|(rvb[1].ACC_SRC_C1&0xFFFF);
+      SPU2->rvb[1].ACC_SRC_C1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].ACC_SRC_C1&0xFFFF);
       break;
     case PS2_C1_Reverb+54:
-      rvb[1].ACC_SRC_C1=(rvb[1].ACC_SRC_C1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].ACC_SRC_C1=(SPU2->rvb[1].ACC_SRC_C1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+56:
-      rvb[1].ACC_SRC_D0=(((unsigned long)val&0xf)<<16)|(rvb[1].ACC_SRC_D0&0xFFFF);
+      SPU2->rvb[1].ACC_SRC_D0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].ACC_SRC_D0&0xFFFF);
       break;
     case PS2_C1_Reverb+58:
-      rvb[1].ACC_SRC_D0=(rvb[1].ACC_SRC_D0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].ACC_SRC_D0=(SPU2->rvb[1].ACC_SRC_D0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+60:
-      rvb[1].ACC_SRC_D1=(((unsigned long)val&0xf)<<16)|(rvb[1].ACC_SRC_D1&0xFFFF);
+      SPU2->rvb[1].ACC_SRC_D1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].ACC_SRC_D1&0xFFFF);
       break;
     case PS2_C1_Reverb+62:
-      rvb[1].ACC_SRC_D1=(rvb[1].ACC_SRC_D1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].ACC_SRC_D1=(SPU2->rvb[1].ACC_SRC_D1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+64:
-      rvb[1].IIR_SRC_B1=(((unsigned long)val&0xf)<<16)|(rvb[1].IIR_SRC_B1&0xFFFF);
+      SPU2->rvb[1].IIR_SRC_B1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].IIR_SRC_B1&0xFFFF);
       break;
     case PS2_C1_Reverb+66:
-      rvb[1].IIR_SRC_B1=(rvb[1].IIR_SRC_B1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].IIR_SRC_B1=(SPU2->rvb[1].IIR_SRC_B1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+68:
-      rvb[1].IIR_SRC_B0=(((unsigned long)val&0xf)<<16)|(rvb[1].IIR_SRC_B0&0xFFFF);
+      SPU2->rvb[1].IIR_SRC_B0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].IIR_SRC_B0&0xFFFF);
       break;
     case PS2_C1_Reverb+70:
-      rvb[1].IIR_SRC_B0=(rvb[1].IIR_SRC_B0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].IIR_SRC_B0=(SPU2->rvb[1].IIR_SRC_B0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+72:
-      rvb[1].MIX_DEST_A0=(((unsigned long)val&0xf)<<16)|(rvb[1].MIX_DEST_A0&0xFFFF);
+      SPU2->rvb[1].MIX_DEST_A0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].MIX_DEST_A0&0xFFFF);
       break;
     case PS2_C1_Reverb+74:
-      rvb[1].MIX_DEST_A0=(rvb[1].MIX_DEST_A0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].MIX_DEST_A0=(SPU2->rvb[1].MIX_DEST_A0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+76:
-      rvb[1].MIX_DEST_A1=(((unsigned long)val&0xf)<<16)|(rvb[1].MIX_DEST_A1&0xFFFF);
+      SPU2->rvb[1].MIX_DEST_A1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].MIX_DEST_A1&0xFFFF);
       break;
     case PS2_C1_Reverb+78:
-      rvb[1].MIX_DEST_A1=(rvb[1].MIX_DEST_A1 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].MIX_DEST_A1=(SPU2->rvb[1].MIX_DEST_A1 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+80:
-      rvb[1].MIX_DEST_B0=(((unsigned long)val&0xf)<<16)|(rvb[1].MIX_DEST_B0&0xFFFF);
+      SPU2->rvb[1].MIX_DEST_B0=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].MIX_DEST_B0&0xFFFF);
       break;
     case PS2_C1_Reverb+82:
-      rvb[1].MIX_DEST_B0=(rvb[1].MIX_DEST_B0 & 0xF0000) | ((val) & 0xFFFF);
+      SPU2->rvb[1].MIX_DEST_B0=(SPU2->rvb[1].MIX_DEST_B0 & 0xF0000) | ((val) & 0xFFFF);
       break;
     case PS2_C1_Reverb+84:
-      rvb[1].MIX_DEST_B1=(((unsigned long)val&0xf)<<16)|(rvb[1].MIX_DEST_B1&0xFFFF);
+      SPU2->rvb[1].MIX_DEST_B1=(((unsigned long)val&0xf)<<16)|(SPU2->rvb[1].MIX_DEST_B1&0xFFFF);
       break;
     case PS2_C1_Reverb+86:
-      rvb[1].MIX_DEST_B1=(rvb[1].MIX_DEST_B1 & 0xF0000) | ((val) & 0xFFFF);
-      break;
-    case PS2_C1_ReverbX+0:  rvb[1].IIR_ALPHA=(short)val;      break;
-    case PS2_C1_ReverbX+2:  rvb[1].ACC_COEF_A=(short)val;     break;
-    case PS2_C1_ReverbX+4:  rvb[1].ACC_COEF_B=(short)val;     break;
-    case PS2_C1_ReverbX+6:  rvb[1].ACC_COEF_C=(short)val;     break;
-    case PS2_C1_ReverbX+8:  rvb[1].ACC_COEF_D=(short)val;     break;
-    case PS2_C1_ReverbX+10: rvb[1].IIR_COEF=(short)val;       break;
-    case PS2_C1_ReverbX+12: rvb[1].FB_ALPHA=(short)val;       break;
-    case PS2_C1_ReverbX+14: rvb[1].FB_X=(short)val;           break;
-    case PS2_C1_ReverbX+16: rvb[1].IN_COEF_L=(short)val;      break;
-    case PS2_C1_ReverbX+18: rvb[1].IN_COEF_R=(short)val;      break;
+      SPU2->rvb[1].MIX_DEST_B1=(SPU2->rvb[1].MIX_DEST_B1 & 0xF0000) | ((val) & 0xFFFF);
+      break;
+    case PS2_C1_ReverbX+0:  SPU2->rvb[1].IIR_ALPHA=(short)val;      break;
+    case PS2_C1_ReverbX+2:  SPU2->rvb[1].ACC_COEF_A=(short)val;     break;
+    case PS2_C1_ReverbX+4:  SPU2->rvb[1].ACC_COEF_B=(short)val;     break;
+    case PS2_C1_ReverbX+6:  SPU2->rvb[1].ACC_COEF_C=(short)val;     break;
+    case PS2_C1_ReverbX+8:  SPU2->rvb[1].ACC_COEF_D=(short)val;     break;
+    case PS2_C1_ReverbX+10: SPU2->rvb[1].IIR_COEF=(short)val;       break;
+    case PS2_C1_ReverbX+12: SPU2->rvb[1].FB_ALPHA=(short)val;       break;
+    case PS2_C1_ReverbX+14: SPU2->rvb[1].FB_X=(short)val;           break;
+    case PS2_C1_ReverbX+16: SPU2->rvb[1].IN_COEF_L=(short)val;      break;
+    case PS2_C1_ReverbX+18: SPU2->rvb[1].IN_COEF_R=(short)val;      break;
    }
 
- iSpuAsyncWait=0;
+ SPU2->iSpuAsyncWait=0;
 
 }
 
@@ -794,7 +794,7 @@ EXPORT_GCC unsigned short CALLBACK SPU2read(unsigned long reg)
 // if(iDebugMode==1) logprintf("R_REG %X\r\n",reg&0xFFFF);
 #endif
 
- iSpuAsyncWait=0;
+ SPU2->iSpuAsyncWait=0;
 
  if((r>=0x0000 && r<0x0180)||(r>=0x0400 && r<0x0580))  // some channel info?
   {
@@ -805,11 +805,11 @@ EXPORT_GCC unsigned short CALLBACK SPU2read(unsigned long reg)
       {
        int ch=(r>>4)&0x1f;
        if(r>=0x400) ch+=24;
-       if(s_chan[ch].bNew) return 1;                   // we are started, but not processed? return 1
-       if(s_chan[ch].ADSRX.lVolume &&                  // same here... we haven't decoded one sample yet, so no envelope yet. return 1 as well
-          !s_chan[ch].ADSRX.EnvelopeVol)
+       if(SPU2->s_chan[ch].bNew) return 1;                   // we are started, but not processed? return 1
+       if(SPU2->s_chan[ch].ADSRX.lVolume &&                  // same here... we haven't decoded one sample yet, so no envelope yet. return 1 as well
+          !SPU2->s_chan[ch].ADSRX.EnvelopeVol)
         return 1;
-       return (unsigned short)(s_chan[ch].ADSRX.EnvelopeVol>>16);
+       return (unsigned short)(SPU2->s_chan[ch].ADSRX.EnvelopeVol>>16);
       }break;
     }
   }
@@ -826,17 +826,17 @@ EXPORT_GCC unsigned short CALLBACK SPU2read(unsigned long reg)
     {
      //------------------------------------------------//
      case 0x1C4:
-      return (((s_chan[ch].pLoop-spuMemC)>>17)&0xF);
+      return (((SPU2->s_chan[ch].pLoop-SPU2->spuMemC)>>17)&0xF);
       break;
      case 0x1C6:
-      return (((s_chan[ch].pLoop-spuMemC)>>1)&0xFFFF);
+      return (((SPU2->s_chan[ch].pLoop-SPU2->spuMemC)>>1)&0xFFFF);
       break;
      //------------------------------------------------//
      case 0x1C8:
-      return (((s_chan[ch].pCurr-spuMemC)>>17)&0xF);
+      return (((SPU2->s_chan[ch].pCurr-SPU2->spuMemC)>>17)&0xF);
       break;
      case 0x1CA:
-      return (((s_chan[ch].pCurr-spuMemC)>>1)&0xFFFF);
+      return (((SPU2->s_chan[ch].pCurr-SPU2->spuMemC)>>1)&0xFFFF);
       break;
      //------------------------------------------------//
     }
@@ -846,64 +846,64 @@ EXPORT_GCC unsigned short CALLBACK SPU2read(unsigned long reg)
   {
    //--------------------------------------------------//
    case PS2_C0_SPUend1:
-     return (unsigned short)((dwEndChannel2[0]&0xFFFF));
+     return (unsigned short)((SPU2->dwEndChannel2[0]&0xFFFF));
    case PS2_C0_SPUend2:
-     return (unsigned short)((dwEndChannel2[0]>>16));
+     return (unsigned short)((SPU2->dwEndChannel2[0]>>16));
    //--------------------------------------------------//
    case PS2_C1_SPUend1:
-     return (unsigned short)((dwEndChannel2[1]&0xFFFF));
+     return (unsigned short)((SPU2->dwEndChannel2[1]&0xFFFF));
    case PS2_C1_SPUend2:
-     return (unsigned short)((dwEndChannel2[1]>>16));
+     return (unsigned short)((SPU2->dwEndChannel2[1]>>16));
    //--------------------------------------------------//
    case PS2_C0_ATTR:
-     return spuCtrl2[0];
+     return SPU2->spuCtrl2[0];
      break;
    //--------------------------------------------------//
    case PS2_C1_ATTR:
-     return spuCtrl2[1];
+     return SPU2->spuCtrl2[1];
      break;
    //--------------------------------------------------//
    case PS2_C0_SPUstat:
-     return spuStat2[0];
+     return SPU2->spuStat2[0];
      break;
    //--------------------------------------------------//
    case PS2_C1_SPUstat:
-     return spuStat2[1];
+     return SPU2->spuStat2[1];
      break;
    //--------------------------------------------------//
    case PS2_C0_SPUdata:
      {
-      unsigned short s=spuMem[spuAddr2[0]];
-      spuAddr2[0]++;
-      if(spuAddr2[0]>0xfffff) spuAddr2[0]=0;
+      unsigned short s=SPU2->spuMem[SPU2->spuAddr2[0]];
+      SPU2->spuAddr2[0]++;
+      if(SPU2->spuAddr2[0]>0xfffff) SPU2->spuAddr2[0]=0;
       return s;
      }
    //--------------------------------------------------//
    case PS2_C1_SPUdata:
      {
-      unsigned short s=spuMem[spuAddr2[1]];
-      spuAddr2[1]++;
-      if(spuAddr2[1]>0xfffff) spuAddr2[1]=0;
+      unsigned short s=SPU2->spuMem[SPU2->spuAddr2[1]];
+      SPU2->spuAddr2[1]++;
+      if(SPU2->spuAddr2[1]>0xfffff) SPU2->spuAddr2[1]=0;
       return s;
      }
    //--------------------------------------------------//
    case PS2_C0_SPUaddr_Hi:
-     return (unsigned short)((spuAddr2[0]>>16)&0xF);
+     return (unsigned short)((SPU2->spuAddr2[0]>>16)&0xF);
      break;
    case PS2_C0_SPUaddr_Lo:
-     return (unsigned short)((spuAddr2[0]&0xFFFF));
+     return (unsigned short)((SPU2->spuAddr2[0]&0xFFFF));
      break;
    //--------------------------------------------------//
    case PS2_C1_SPUaddr_Hi:
-     return (unsigned short)((spuAddr2[1]>>16)&0xF);
+     return (unsigned short)((SPU2->spuAddr2[1]>>16)&0xF);
      break;
    case PS2_C1_SPUaddr_Lo:
-     return (unsigned short)((spuAddr2[1]&0xFFFF));
+     return (unsigned short)((SPU2->spuAddr2[1]&0xFFFF));
      break;
    //--------------------------------------------------//
   }
 
- return regArea[r>>1];
+ return SPU2->regArea[r>>1];
 }
 
 EXPORT_GCC void CALLBACK SPU2writePS1Port(unsigned long reg, unsigned short val)
@@ -920,13 +920,13 @@ EXPORT_GCC void CALLBACK SPU2writePS1Port(unsigned long reg, unsigned short val)
    {
     //-------------------------------------------------//
     case H_SPUaddr:
-      spuAddr2[0] = (u32) val<<2;
+      SPU2->spuAddr2[0] = (u32) val<<2;
       break;
     //-------------------------------------------------//
     case H_SPUdata:
-      spuMem[spuAddr2[0]] = BFLIP16(val);
-      spuAddr2[0]++;
-      if(spuAddr2[0]>0xfffff) spuAddr2[0]=0;
+      SPU2->spuMem[SPU2->spuAddr2[0]] = BFLIP16(val);
+      SPU2->spuAddr2[0]++;
+      if(SPU2->spuAddr2[0]>0xfffff) SPU2->spuAddr2[0]=0;
       break;
     //-------------------------------------------------//
     case H_SPUctrl:
@@ -934,17 +934,17 @@ EXPORT_GCC void CALLBACK SPU2writePS1Port(unsigned long reg, unsigned short val)
       break;
     //-------------------------------------------------//
     case H_SPUstat:
-      spuStat2[0]=val & 0xf800;
+      SPU2->spuStat2[0]=val & 0xf800;
       break;
     //-------------------------------------------------//
     case H_SPUReverbAddr:
-      spuRvbAddr2[0] = val;
+      SPU2->spuRvbAddr2[0] = val;
       SetReverbAddr(0);
       break;
     //-------------------------------------------------//
     case H_SPUirqAddr:
-      spuIrq2[0] = val<<2;
-      pSpuIrq[0]=spuMemC+((u32) val<<1);
+      SPU2->spuIrq2[0] = val<<2;
+      SPU2->pSpuIrq[0]=SPU2->spuMemC+((u32) val<<1);
       break;
     //-------------------------------------------------//
     /* Volume settings appear to be at least 15-bit unsigned in this case.
@@ -952,12 +952,12 @@ EXPORT_GCC void CALLBACK SPU2writePS1Port(unsigned long reg, unsigned short val)
        Check out "Chrono Cross:  Shadow's End Forest"
     */
     case H_SPUrvolL:
-      rvb[0].VolLeft=(s16)val;
+      SPU2->rvb[0].VolLeft=(s16)val;
       //printf("%d\n",val);
       break;
     //-------------------------------------------------//
     case H_SPUrvolR:
-      rvb[0].VolRight=(s16)val;
+      SPU2->rvb[0].VolRight=(s16)val;
       //printf("%d\n",val);
       break;
     //-------------------------------------------------//
@@ -1033,40 +1033,40 @@ EXPORT_GCC void CALLBACK SPU2writePS1Port(unsigned long reg, unsigned short val)
 
     //-------------------------------------------------//
     case H_Reverb+0:
-      rvb[0].FB_SRC_A=val;
-      break;
-
-    case H_Reverb+2   : rvb[0].FB_SRC_B=(s16)val;       break;
-    case H_Reverb+4   : rvb[0].IIR_ALPHA=(s16)val;      break;
-    case H_Reverb+6   : rvb[0].ACC_COEF_A=(s16)val;     break;
-    case H_Reverb+8   : rvb[0].ACC_COEF_B=(s16)val;     break;
-    case H_Reverb+10  : rvb[0].ACC_COEF_C=(s16)val;     break;
-    case H_Reverb+12  : rvb[0].ACC_COEF_D=(s16)val;     break;
-    case H_Reverb+14  : rvb[0].IIR_COEF=(s16)val;       break;
-    case H_Reverb+16  : rvb[0].FB_ALPHA=(s16)val;       break;
-    case H_Reverb+18  : rvb[0].FB_X=(s16)val;           break;
-    case H_Reverb+20  : rvb[0].IIR_DEST_A0=(s16)val;    break;
-    case H_Reverb+22  : rvb[0].IIR_DEST_A1=(s16)val;    break;
-    case H_Reverb+24  : rvb[0].ACC_SRC_A0=(s16)val;     break;
-    case H_Reverb+26  : rvb[0].ACC_SRC_A1=(s16)val;     break;
-    case H_Reverb+28  : rvb[0].ACC_SRC_B0=(s16)val;     break;
-    case H_Reverb+30  : rvb[0].ACC_SRC_B1=(s16)val;     break;
-    case H_Reverb+32  : rvb[0].IIR_SRC_A0=(s16)val;     break;
-    case H_Reverb+34  : rvb[0].IIR_SRC_A1=(s16)val;     break;
-    case H_Reverb+36  : rvb[0].IIR_DEST_B0=(s16)val;    break;
-    case H_Reverb+38  : rvb[0].IIR_DEST_B1=(s16)val;    break;
-    case H_Reverb+40  : rvb[0].ACC_SRC_C0=(s16)val;     break;
-    case H_Reverb+42  : rvb[0].ACC_SRC_C1=(s16)val;     break;
-    case H_Reverb+44  : rvb[0].ACC_SRC_D0=(s16)val;     break;
-    case H_Reverb+46  : rvb[0].ACC_SRC_D1=(s16)val;     break;
-    case H_Reverb+48  : rvb[0].IIR_SRC_B1=(s16)val;     break;
-    case H_Reverb+50  : rvb[0].IIR_SRC_B0=(s16)val;     break;
-    case H_Reverb+52  : rvb[0].MIX_DEST_A0=(s16)val;    break;
-    case H_Reverb+54  : rvb[0].MIX_DEST_A1=(s16)val;    break;
-    case H_Reverb+56  : rvb[0].MIX_DEST_B0=(s16)val;    break;
-    case H_Reverb+58  : rvb[0].MIX_DEST_B1=(s16)val;    break;
-    case H_Reverb+60  : rvb[0].IN_COEF_L=(s16)val;      break;
-    case H_Reverb+62  : rvb[0].IN_COEF_R=(s16)val;      break;
+      SPU2->rvb[0].FB_SRC_A=val;
+      break;
+
+    case H_Reverb+2   : SPU2->rvb[0].FB_SRC_B=(s16)val;       break;
+    case H_Reverb+4   : SPU2->rvb[0].IIR_ALPHA=(s16)val;      break;
+    case H_Reverb+6   : SPU2->rvb[0].ACC_COEF_A=(s16)val;     break;
+    case H_Reverb+8   : SPU2->rvb[0].ACC_COEF_B=(s16)val;     break;
+    case H_Reverb+10  : SPU2->rvb[0].ACC_COEF_C=(s16)val;     break;
+    case H_Reverb+12  : SPU2->rvb[0].ACC_COEF_D=(s16)val;     break;
+    case H_Reverb+14  : SPU2->rvb[0].IIR_COEF=(s16)val;       break;
+    case H_Reverb+16  : SPU2->rvb[0].FB_ALPHA=(s16)val;       break;
+    case H_Reverb+18  : SPU2->rvb[0].FB_X=(s16)val;           break;
+    case H_Reverb+20  : SPU2->rvb[0].IIR_DEST_A0=(s16)val;    break;
+    case H_Reverb+22  : SPU2->rvb[0].IIR_DEST_A1=(s16)val;    break;
+    case H_Reverb+24  : SPU2->rvb[0].ACC_SRC_A0=(s16)val;     break;
+    case H_Reverb+26  : SPU2->rvb[0].ACC_SRC_A1=(s16)val;     break;
+    case H_Reverb+28  : SPU2->rvb[0].ACC_SRC_B0=(s16)val;     break;
+    case H_Reverb+30  : SPU2->rvb[0].ACC_SRC_B1=(s16)val;     break;
+    case H_Reverb+32  : SPU2->rvb[0].IIR_SRC_A0=(s16)val;     break;
+    case H_Reverb+34  : SPU2->rvb[0].IIR_SRC_A1=(s16)val;     break;
+    case H_Reverb+36  : SPU2->rvb[0].IIR_DEST_B0=(s16)val;    break;
+    case H_Reverb+38  : SPU2->rvb[0].IIR_DEST_B1=(s16)val;    break;
+    case H_Reverb+40  : SPU2->rvb[0].ACC_SRC_C0=(s16)val;     break;
+    case H_Reverb+42  : SPU2->rvb[0].ACC_SRC_C1=(s16)val;     break;
+    case H_Reverb+44  : SPU2->rvb[0].ACC_SRC_D0=(s16)val;     break;
+    case H_Reverb+46  : SPU2->rvb[0].ACC_SRC_D1=(s16)val;     break;
+    case H_Reverb+48  : SPU2->rvb[0].IIR_SRC_B1=(s16)val;     break;
+    case H_Reverb+50  : SPU2->rvb[0].IIR_SRC_B0=(s16)val;     break;
+    case H_Reverb+52  : SPU2->rvb[0].MIX_DEST_A0=(s16)val;    break;
+    case H_Reverb+54  : SPU2->rvb[0].MIX_DEST_A1=(s16)val;    break;
+    case H_Reverb+56  : SPU2->rvb[0].MIX_DEST_B0=(s16)val;    break;
+    case H_Reverb+58  : SPU2->rvb[0].MIX_DEST_B1=(s16)val;    break;
+    case H_Reverb+60  : SPU2->rvb[0].IN_COEF_L=(s16)val;      break;
+    case H_Reverb+62  : SPU2->rvb[0].IN_COEF_R=(s16)val;      break;
    }
 }
 
@@ -1086,24 +1086,24 @@ EXPORT_GCC unsigned short CALLBACK SPU2readPS1Port(unsigned long reg)
      break;
 
     case H_SPUstat:
-     return spuStat2[0];
+     return SPU2->spuStat2[0];
      break;
 
     case H_SPUaddr:
-     return (u16)(spuAddr2[0]>>2);
+     return (u16)(SPU2->spuAddr2[0]>>2);
      break;
 
     case H_SPUdata:
      {
-      u16 s=BFLIP16(spuMem[spuAddr2[0]]);
-      spuAddr2[0]++;
-      if(spuAddr2[0]>0xfffff) spuAddr2[0]=0;
+      u16 s=BFLIP16(SPU2->spuMem[SPU2->spuAddr2[0]]);
+      SPU2->spuAddr2[0]++;
+      if(SPU2->spuAddr2[0]>0xfffff) SPU2->spuAddr2[0]=0;
       return s;
      }
      break;
 
     case H_SPUirqAddr:
-     return spuIrq2[0]>>2;
+     return SPU2->spuIrq2[0]>>2;
      break;
   }
 
@@ -1120,11 +1120,11 @@ void SoundOn(int start,int end,unsigned short val)     // SOUND ON PSX COMAND
 
  for(ch=start;ch<end;ch++,val>>=1)                     // loop channels
   {
-   if((val&1) && s_chan[ch].pStart)                    // mmm... start has to be set before key on !?!
+   if((val&1) && SPU2->s_chan[ch].pStart)                    // mmm... start has to be set before key on !?!
     {
-     s_chan[ch].bIgnoreLoop=0;
-     s_chan[ch].bNew=1;
-     dwNewChannel2[ch/24]|=(1<<(ch%24));               // bitfield for faster testing
+     SPU2->s_chan[ch].bIgnoreLoop=0;
+     SPU2->s_chan[ch].bNew=1;
+     SPU2->dwNewChannel2[ch/24]|=(1<<(ch%24));               // bitfield for faster testing
     }
   }
 }
@@ -1140,7 +1140,7 @@ void SoundOff(int start,int end,unsigned short val)    // SOUND OFF PSX COMMAND
   {
    if(val&1)                                           // && s_chan[i].bOn)  mmm...
     {
-     s_chan[ch].bStop=1;
+     SPU2->s_chan[ch].bStop=1;
     }
   }
 }
@@ -1159,13 +1159,13 @@ void FModOn(int start,int end,unsigned short val)      // FMOD ON PSX COMMAND
     {
      if(ch>0)
       {
-       s_chan[ch].bFMod=1;                             // --> sound channel
-       s_chan[ch-1].bFMod=2;                           // --> freq channel
+       SPU2->s_chan[ch].bFMod=1;                             // --> sound channel
+       SPU2->s_chan[ch-1].bFMod=2;                           // --> freq channel
       }
     }
    else
     {
-     s_chan[ch].bFMod=0;                               // --> turn off fmod
+     SPU2->s_chan[ch].bFMod=0;                               // --> turn off fmod
     }
   }
 }
@@ -1182,11 +1182,11 @@ void NoiseOn(int start,int end,unsigned short val)     // NOISE ON PSX COMMAND
   {
    if(val&1)                                           // -> noise on/off
     {
-     s_chan[ch].bNoise=1;
+     SPU2->s_chan[ch].bNoise=1;
     }
    else
     {
-     s_chan[ch].bNoise=0;
+     SPU2->s_chan[ch].bNoise=0;
     }
   }
 }
@@ -1200,7 +1200,7 @@ void NoiseOn(int start,int end,unsigned short val)     // NOISE ON PSX COMMAND
 
 void SetVolumeL(unsigned char ch,short vol)            // LEFT VOLUME
 {
- s_chan[ch].iLeftVolRaw=vol;
+ SPU2->s_chan[ch].iLeftVolRaw=vol;
 
  if(vol&0x8000)                                        // sweep?
   {
@@ -1219,7 +1219,7 @@ void SetVolumeL(unsigned char ch,short vol)            // LEFT VOLUME
   }
 
  vol&=0x3fff;
- s_chan[ch].iLeftVolume=vol;                           // store volume
+ SPU2->s_chan[ch].iLeftVolume=vol;                           // store volume
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1228,7 +1228,7 @@ void SetVolumeL(unsigned char ch,short vol)            // LEFT VOLUME
 
 void SetVolumeR(unsigned char ch,short vol)            // RIGHT VOLUME
 {
- s_chan[ch].iRightVolRaw=vol;
+ SPU2->s_chan[ch].iRightVolRaw=vol;
 
  if(vol&0x8000)                                        // comments... see above :)
   {
@@ -1246,7 +1246,7 @@ void SetVolumeR(unsigned char ch,short vol)            // RIGHT VOLUME
   }
 
  vol&=0x3fff;
- s_chan[ch].iRightVolume=vol;
+ SPU2->s_chan[ch].iRightVolume=vol;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1264,12 +1264,12 @@ void SetPitch(int ch,unsigned short val)               // SET PITCH
  intr = (double)48000.0f / (double)44100.0f * (double)NP;
  NP = (uint32_t)intr;
 
- s_chan[ch].iRawPitch=NP;
+ SPU2->s_chan[ch].iRawPitch=NP;
 
  NP=(44100L*NP)/4096L;                                 // calc frequency
 
  if(NP<1) NP=1;                                        // some security
- s_chan[ch].iActFreq=NP;                               // store frequency
+ SPU2->s_chan[ch].iActFreq=NP;                               // store frequency
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1284,13 +1284,13 @@ void ReverbOn(int start,int end,unsigned short val,int iRight)  // REVERB ON PSX
   {
    if(val&1)                                           // -> reverb on/off
     {
-     if(iRight) s_chan[ch].bReverbR=1;
-     else       s_chan[ch].bReverbL=1;
+     if(iRight) SPU2->s_chan[ch].bReverbR=1;
+     else       SPU2->s_chan[ch].bReverbL=1;
     }
    else
     {
-     if(iRight) s_chan[ch].bReverbR=0;
-     else       s_chan[ch].bReverbL=0;
+     if(iRight) SPU2->s_chan[ch].bReverbR=0;
+     else       SPU2->s_chan[ch].bReverbL=0;
     }
   }
 }
@@ -1301,18 +1301,18 @@ void ReverbOn(int start,int end,unsigned short val,int iRight)  // REVERB ON PSX
 
 void SetReverbAddr(int core)
 {
- long val=spuRvbAddr2[core];
+ long val=SPU2->spuRvbAddr2[core];
 
- if(rvb[core].StartAddr!=val)
+ if(SPU2->rvb[core].StartAddr!=val)
   {
    if(val<=0x27ff)
     {
-     rvb[core].StartAddr=rvb[core].CurrAddr=0;
+     SPU2->rvb[core].StartAddr=SPU2->rvb[core].CurrAddr=0;
     }
    else
     {
-     rvb[core].StartAddr=val;
-     rvb[core].CurrAddr=rvb[core].StartAddr;
+     SPU2->rvb[core].StartAddr=val;
+     SPU2->rvb[core].CurrAddr=SPU2->rvb[core].StartAddr;
     }
   }
 }
@@ -1329,13 +1329,13 @@ void VolumeOn(int start,int end,unsigned short val,int iRight)  // VOLUME ON PSX
   {
    if(val&1)                                           // -> reverb on/off
     {
-     if(iRight) s_chan[ch].bVolumeR=1;
-     else       s_chan[ch].bVolumeL=1;
+     if(iRight) SPU2->s_chan[ch].bVolumeR=1;
+     else       SPU2->s_chan[ch].bVolumeL=1;
     }
    else
     {
-     if(iRight) s_chan[ch].bVolumeR=0;
-     else       s_chan[ch].bVolumeL=0;
+     if(iRight) SPU2->s_chan[ch].bVolumeR=0;
+     else       SPU2->s_chan[ch].bVolumeL=0;
     }
   }
 }
@@ -103,70 +103,36 @@
 #include "../peops2/regs.h"
 #include "../peops2/dma.h"
 
+#include <glib.h>
+
 ////////////////////////////////////////////////////////////////////////
 // globals
 ////////////////////////////////////////////////////////////////////////
 
-// psx buffer / addresses
-
-unsigned short  regArea[32*1024];
-unsigned short  spuMem[1*1024*1024];
-unsigned char * spuMemC;
-unsigned char * pSpuIrq[2];
-unsigned char * pSpuBuffer;
-
-// user settings
-
-int             iUseXA=0;
-int             iXAPitch=1;
-int             iUseTimer=2;
-int             iSPUIRQWait=1;
-int             iDebugMode=0;
-int             iRecordMode=0;
-int             iUseReverb=1;
-int             iUseInterpolation=2;
-
-// MAIN infos struct for each channel
+// all state is in struct spu2_state (externals.h)
 
-SPUCHAN         s_chan[MAXCHAN+1];                     // channel + 1 infos (1 is security for fmod handling)
-REVERBInfo      rvb[2];
+const size_t spu2_state_size=sizeof(struct spu2_state);
 
-unsigned long   dwNoiseVal=1;                          // global noise generator
-
-unsigned short  spuCtrl2[2];                           // some vars to store psx reg infos
-unsigned short  spuStat2[2];
-unsigned long   spuIrq2[2];
-unsigned long   spuAddr2[2];                           // address into spu mem
-unsigned long   spuRvbAddr2[2];
-unsigned long   spuRvbAEnd2[2];
-int             bEndThread=0;                          // thread handlers
-int             bThreadEnded=0;
-int             bSpuInit=0;
-int             bSPUIsOpen=0;
-
-unsigned long dwNewChannel2[2];                        // flags for faster testing, if new channel starts
-unsigned long dwEndChannel2[2];
+struct spu2_state *spu2_state_new(void)
+{
+ struct spu2_state *spu=g_new0(struct spu2_state,1);
 
-// UNUSED IN PS2 YET
-void (CALLBACK *irqCallback)(void)=0;                  // func of main emu, called on spu irq
-void (CALLBACK *cddavCallback)(unsigned short,unsigned short)=0;
+ spu->iXAPitch=1;
+ spu->iUseTimer=2;
+ spu->iSPUIRQWait=1;
+ spu->iUseReverb=1;
+ spu->iUseInterpolation=2;
+ spu->dwNoiseVal=1;
+ spu->lastch=-1;
 
-// certain globals (were local before, but with the new timeproc I need em global)
+ return spu;
+}
 
 const int f[5][2] = {   {    0,  0  },
                         {   60,  0  },
                         {  115, -52 },
                         {   98, -55 },
                         {  122, -60 } };
-int SSumR[NSSIZE];
-int SSumL[NSSIZE];
-int iCycle=0;
-short * pS;
-
-static int lastch=-1;      // last channel processed on spu irq in timer mode
-static int iSecureStart=0; // secure start counter
-
-extern void psf2_update(unsigned char *samples, long lBytes);
 
 ////////////////////////////////////////////////////////////////////////
 // CODE AREA
@@ -222,46 +188,46 @@ extern void psf2_update(unsigned char *samples, long lBytes);
 
 static inline void InterpolateUp(int ch)
 {
- if(s_chan[ch].SB[32]==1)                              // flag == 1? calc step and set flag... and don't change the value in this pass
+ if(SPU2->s_chan[ch].SB[32]==1)                              // flag == 1? calc step and set flag... and don't change the value in this pass
   {
-   const int id1=s_chan[ch].SB[30]-s_chan[ch].SB[29];  // curr delta to next val
-   const int id2=s_chan[ch].SB[31]-s_chan[ch].SB[30];  // and next delta to next-next val :)
+   const int id1=SPU2->s_chan[ch].SB[30]-SPU2->s_chan[ch].SB[29];  // curr delta to next val
+   const int id2=SPU2->s_chan[ch].SB[31]-SPU2->s_chan[ch].SB[30];  // and next delta to next-next val :)
 
-   s_chan[ch].SB[32]=0;
+   SPU2->s_chan[ch].SB[32]=0;
 
    if(id1>0)                                           // curr delta positive
     {
      if(id2<id1)
-      {s_chan[ch].SB[28]=id1;s_chan[ch].SB[32]=2;}
+      {SPU2->s_chan[ch].SB[28]=id1;SPU2->s_chan[ch].SB[32]=2;}
      else
      if(id2<(id1<<1))
-      s_chan[ch].SB[28]=(id1*s_chan[ch].sinc)/0x10000L;
+      SPU2->s_chan[ch].SB[28]=(id1*SPU2->s_chan[ch].sinc)/0x10000L;
      else
-      s_chan[ch].SB[28]=(id1*s_chan[ch].sinc)/0x20000L;
+      SPU2->s_chan[ch].SB[28]=(id1*SPU2->s_chan[ch].sinc)/0x20000L;
     }
    else                                                // curr delta negative
     {
      if(id2>id1)
-      {s_chan[ch].SB[28]=id1;s_chan[ch].SB[32]=2;}
+      {SPU2->s_chan[ch].SB[28]=id1;SPU2->s_chan[ch].SB[32]=2;}
      else
      if(id2>(id1<<1))
-      s_chan[ch].SB[28]=(id1*s_chan[ch].sinc)/0x10000L;
+      SPU2->s_chan[ch].SB[28]=(id1*SPU2->s_chan[ch].sinc)/0x10000L;
      else
-      s_chan[ch].SB[28]=(id1*s_chan[ch].sinc)/0x20000L;
+      SPU2->s_chan[ch].SB[28]=(id1*SPU2->s_chan[ch].sinc)/0x20000L;
     }
   }
  else
- if(s_chan[ch].SB[32]==2)                              // flag 1: calc step and set flag... and don't change the value in this pass
+ if(SPU2->s_chan[ch].SB[32]==2)                              // flag 1: calc step and set flag... and don't change the value in this pass
   {
-   s_chan[ch].SB[32]=0;
+   SPU2->s_chan[ch].SB[32]=0;
 
-   s_chan[ch].SB[28]=(s_chan[ch].SB[28]*s_chan[ch].sinc)/0x20000L;
-   if(s_chan[ch].sinc<=0x8000)
-        s_chan[ch].SB[29]=s_chan[ch].SB[30]-(s_chan[ch].SB[28]*((0x10000/s_chan[ch].sinc)-1));
-   else s_chan[ch].SB[29]+=s_chan[ch].SB[28];
+   SPU2->s_chan[ch].SB[28]=(SPU2->s_chan[ch].SB[28]*SPU2->s_chan[ch].sinc)/0x20000L;
+   if(SPU2->s_chan[ch].sinc<=0x8000)
+        SPU2->s_chan[ch].SB[29]=SPU2->s_chan[ch].SB[30]-(SPU2->s_chan[ch].SB[28]*((0x10000/SPU2->s_chan[ch].sinc)-1));
+   else SPU2->s_chan[ch].SB[29]+=SPU2->s_chan[ch].SB[28];
   }
  else                                                  // no flags? add bigger val (if possible), calc smaller step, set flag1
-  s_chan[ch].SB[29]+=s_chan[ch].SB[28];
+  SPU2->s_chan[ch].SB[29]+=SPU2->s_chan[ch].SB[28];
 }
 
 //
@@ -270,19 +236,19 @@ static inline void InterpolateUp(int ch)
 
 static inline void InterpolateDown(int ch)
 {
- if(s_chan[ch].sinc>=0x20000L)                                 // we would skip at least one val?
+ if(SPU2->s_chan[ch].sinc>=0x20000L)                                 // we would skip at least one val?
   {
-   s_chan[ch].SB[29]+=(s_chan[ch].SB[30]-s_chan[ch].SB[29])/2; // add easy weight
-   if(s_chan[ch].sinc>=0x30000L)                               // we would skip even more vals?
-    s_chan[ch].SB[29]+=(s_chan[ch].SB[31]-s_chan[ch].SB[30])/2;// add additional next weight
+   SPU2->s_chan[ch].SB[29]+=(SPU2->s_chan[ch].SB[30]-SPU2->s_chan[ch].SB[29])/2; // add easy weight
+   if(SPU2->s_chan[ch].sinc>=0x30000L)                               // we would skip even more vals?
+    SPU2->s_chan[ch].SB[29]+=(SPU2->s_chan[ch].SB[31]-SPU2->s_chan[ch].SB[30])/2;// add additional next weight
   }
 }
 
 ////////////////////////////////////////////////////////////////////////
 // helpers for gauss interpolation
 
-#define gval0 (((short*)(&s_chan[ch].SB[29]))[gpos])
-#define gval(x) (((short*)(&s_chan[ch].SB[29]))[(gpos+x)&3])
+#define gval0 (((short*)(&SPU2->s_chan[ch].SB[29]))[gpos])
+#define gval(x) (((short*)(&SPU2->s_chan[ch].SB[29]))[(gpos+x)&3])
 
 #include "gauss_i.h"
 
@@ -296,28 +262,28 @@ static inline void InterpolateDown(int ch)
 
 static inline void StartSound(int ch)
 {
- dwNewChannel2[ch/24]&=~(1<<(ch%24));                  // clear new channel bit
- dwEndChannel2[ch/24]&=~(1<<(ch%24));                  // clear end channel bit
+ SPU2->dwNewChannel2[ch/24]&=~(1<<(ch%24));                  // clear new channel bit
+ SPU2->dwEndChannel2[ch/24]&=~(1<<(ch%24));                  // clear end channel bit
 
  StartADSR(ch);
  StartREVERB(ch);
 
- s_chan[ch].pCurr=s_chan[ch].pStart;                   // set sample start
+ SPU2->s_chan[ch].pCurr=SPU2->s_chan[ch].pStart;                   // set sample start
 
- s_chan[ch].s_1=0;                                     // init mixing vars
- s_chan[ch].s_2=0;
- s_chan[ch].iSBPos=28;
+ SPU2->s_chan[ch].s_1=0;                                     // init mixing vars
+ SPU2->s_chan[ch].s_2=0;
+ SPU2->s_chan[ch].iSBPos=28;
 
- s_chan[ch].bNew=0;                                    // init channel flags
- s_chan[ch].bStop=0;
- s_chan[ch].bOn=1;
+ SPU2->s_chan[ch].bNew=0;                                    // init channel flags
+ SPU2->s_chan[ch].bStop=0;
+ SPU2->s_chan[ch].bOn=1;
 
- s_chan[ch].SB[29]=0;                                  // init our interpolation helpers
- s_chan[ch].SB[30]=0;
+ SPU2->s_chan[ch].SB[29]=0;                                  // init our interpolation helpers
+ SPU2->s_chan[ch].SB[30]=0;
 
- if(iUseInterpolation>=2)                              // gauss interpolation?
-      {s_chan[ch].spos=0x30000L;s_chan[ch].SB[28]=0;}  // -> start with more decoding
- else {s_chan[ch].spos=0x10000L;s_chan[ch].SB[31]=0;}  // -> no/simple interpolation starts with one 44100 decoding
+ if(SPU2->iUseInterpolation>=2)                              // gauss interpolation?
+      {SPU2->s_chan[ch].spos=0x30000L;SPU2->s_chan[ch].SB[28]=0;}  // -> start with more decoding
+ else {SPU2->s_chan[ch].spos=0x10000L;SPU2->s_chan[ch].SB[31]=0;}  // -> no/simple interpolation starts with one 44100 decoding
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -326,33 +292,34 @@ static inline void StartSound(int ch)
 // basically the whole sound processing is done in this fat func!
 ////////////////////////////////////////////////////////////////////////
 
-static u32 sampcount;
-static u32 decaybegin;
-static u32 decayend;
-
-static u32 seektime;
 int psf2_seek(u32 t)
 {
- seektime=t*441/10;
- if(seektime>sampcount) return(1);
+ SPU2->seektime=t*441/10;
+ if(SPU2->seektime>SPU2->sampcount) return(1);
  return(0);
 }
 
+// position of the emulation in milliseconds, counting skipped silence
+u32 psf2_tell(void)
+{
+ return (u64)SPU2->sampcount*10/441;
+}
+
 // Counting to 65536 results in full volume offage.
 void setlength2(s32 stop, s32 fade)
 {
- seektime = 0;
+ SPU2->seektime = 0;
  if(stop==~0)
  {
-  decaybegin=~0;
+  SPU2->decaybegin=~0;
  }
  else
  {
   stop=(stop*441)/10;
   fade=(fade*441)/10;
 
-  decaybegin=stop;
-  decayend=stop+fade;
+  SPU2->decaybegin=stop;
+  SPU2->decayend=stop+fade;
  }
 }
 // 5 ms waiting phase, if buffer is full and no new sound has to get started
@@ -364,10 +331,13 @@ void setlength2(s32 stop, s32 fade)
 
 ////////////////////////////////////////////////////////////////////////
 
-int iSpuAsyncWait=0;
-
 static void *MAINThread(int samp2run, void *data)
 {
+ // the context cannot change while mixing: look it up once
+ struct spu2_state *const spu2_local=SPU2;
+#undef SPU2
+#define SPU2 spu2_local
+
  int s_1,s_2,fa;
  unsigned char * start;unsigned int nSample;
  int ch,predict_nr,shift_factor,flags,d,d2,s;
@@ -383,12 +353,12 @@ static void *MAINThread(int samp2run, void *data)
    // until enuff free place is available/a new channel gets
    // started
 
-   if(dwNewChannel2[0] || dwNewChannel2[1])            // new channel should start immedately?
+   if(SPU2->dwNewChannel2[0] || SPU2->dwNewChannel2[1])            // new channel should start immedately?
     {                                                  // (at least one bit 0 ... MAXCHANNEL is set?)
-     iSecureStart++;                                   // -> set iSecure
-     if(iSecureStart>5) iSecureStart=0;                //    (if it is set 5 times - that means on 5 tries a new samples has been started - in a row, we will reset it, to give the sound update a chance)
+     SPU2->iSecureStart++;                                   // -> set iSecure
+     if(SPU2->iSecureStart>5) SPU2->iSecureStart=0;                //    (if it is set 5 times - that means on 5 tries a new samples has been started - in a row, we will reset it, to give the sound update a chance)
     }
-   else iSecureStart=0;                                // 0: no new channel should start
+   else SPU2->iSecureStart=0;                                // 0: no new channel should start
 
 /*	if (!iSecureStart)
 	{
@@ -397,23 +367,23 @@ static void *MAINThread(int samp2run, void *data)
 	}*/
 
 #if 0
-   while(!iSecureStart && !bEndThread) // &&               // no new start? no thread end?
+   while(!SPU2->iSecureStart && !SPU2->bEndThread) // &&               // no new start? no thread end?
 //         (SoundGetBytesBuffered()>TESTSIZE))           // and still enuff data in sound buffer?
     {
-     iSecureStart=0;                                   // reset secure
+     SPU2->iSecureStart=0;                                   // reset secure
 
-     if(iUseTimer) return 0;                           // linux no-thread mode? bye
+     if(SPU2->iUseTimer) return 0;                           // linux no-thread mode? bye
 
-     if(dwNewChannel2[0] || dwNewChannel2[1])
-      iSecureStart=1;                                  // if a new channel kicks in (or, of course, sound buffer runs low), we will leave the loop
+     if(SPU2->dwNewChannel2[0] || SPU2->dwNewChannel2[1])
+      SPU2->iSecureStart=1;                                  // if a new channel kicks in (or, of course, sound buffer runs low), we will leave the loop
     }
 #endif
 
    //--------------------------------------------------// continue from irq handling in timer mode?
 
-   if(lastch>=0)                                       // will be -1 if no continue is pending
+   if(SPU2->lastch>=0)                                       // will be -1 if no continue is pending
     {
-     ch=lastch; lastch=-1;                  // -> setup all kind of vars to continue
+     ch=SPU2->lastch; SPU2->lastch=-1;                  // -> setup all kind of vars to continue
      goto GOON;                                        // -> directly jump to the continue point
     }
 
@@ -423,39 +393,39 @@ static void *MAINThread(int samp2run, void *data)
     {
      for(ch=0;ch<MAXCHAN;ch++)                         // loop em all... we will collect 1 ms of sound of each playing channel
       {
-       if(s_chan[ch].bNew) StartSound(ch);             // start new sound
-       if(!s_chan[ch].bOn) continue;                   // channel not playing? next
+       if(SPU2->s_chan[ch].bNew) StartSound(ch);             // start new sound
+       if(!SPU2->s_chan[ch].bOn) continue;                   // channel not playing? next
 
-       if(s_chan[ch].iActFreq!=s_chan[ch].iUsedFreq)   // new psx frequency?
+       if(SPU2->s_chan[ch].iActFreq!=SPU2->s_chan[ch].iUsedFreq)   // new psx frequency?
         {
-         s_chan[ch].iUsedFreq=s_chan[ch].iActFreq;     // -> take it and calc steps
-         s_chan[ch].sinc=s_chan[ch].iRawPitch<<4;
-         if(!s_chan[ch].sinc) s_chan[ch].sinc=1;
-         if(iUseInterpolation==1) s_chan[ch].SB[32]=1; // -> freq change in simle imterpolation mode: set flag
+         SPU2->s_chan[ch].iUsedFreq=SPU2->s_chan[ch].iActFreq;     // -> take it and calc steps
+         SPU2->s_chan[ch].sinc=SPU2->s_chan[ch].iRawPitch<<4;
+         if(!SPU2->s_chan[ch].sinc) SPU2->s_chan[ch].sinc=1;
+         if(SPU2->iUseInterpolation==1) SPU2->s_chan[ch].SB[32]=1; // -> freq change in simle imterpolation mode: set flag
         }
 //       ns=0;
 //       while(ns<NSSIZE)                                // loop until 1 ms of data is reached
         {
-         while(s_chan[ch].spos>=0x10000L)
+         while(SPU2->s_chan[ch].spos>=0x10000L)
           {
-           if(s_chan[ch].iSBPos==28)                   // 28 reached?
+           if(SPU2->s_chan[ch].iSBPos==28)                   // 28 reached?
             {
-             start=s_chan[ch].pCurr;                   // set up the current pos
+             start=SPU2->s_chan[ch].pCurr;                   // set up the current pos
 
              if (start == (unsigned char*)-1)          // special "stop" sign
               {
-               s_chan[ch].bOn=0;                       // -> turn everything off
-               s_chan[ch].ADSRX.lVolume=0;
-               s_chan[ch].ADSRX.EnvelopeVol=0;
+               SPU2->s_chan[ch].bOn=0;                       // -> turn everything off
+               SPU2->s_chan[ch].ADSRX.lVolume=0;
+               SPU2->s_chan[ch].ADSRX.EnvelopeVol=0;
                goto ENDX;                              // -> and done for this channel
               }
 
-             s_chan[ch].iSBPos=0;
+             SPU2->s_chan[ch].iSBPos=0;
 
              //////////////////////////////////////////// spu irq handler here? mmm... do it later
 
-             s_1=s_chan[ch].s_1;
-             s_2=s_chan[ch].s_2;
+             s_1=SPU2->s_chan[ch].s_1;
+             s_2=SPU2->s_chan[ch].s_2;
 
              predict_nr=(int)*start;start++;
              shift_factor=predict_nr&0xf;
@@ -475,38 +445,38 @@ static void *MAINThread(int samp2run, void *data)
                s_2=s_1;s_1=fa;
                s=((d & 0xf0) << 8);
 
-               s_chan[ch].SB[nSample++]=fa;
+               SPU2->s_chan[ch].SB[nSample++]=fa;
 
                if(s&0x8000) s|=0xffff0000;
                fa=(s>>shift_factor);
                fa=fa + ((s_1 * f[predict_nr][0])>>6) + ((s_2 * f[predict_nr][1])>>6);
                s_2=s_1;s_1=fa;
 
-               s_chan[ch].SB[nSample++]=fa;
+               SPU2->s_chan[ch].SB[nSample++]=fa;
               }
 
              //////////////////////////////////////////// irq check
 
-             if(spuCtrl2[ch/24]&0x40)                  // some irq active?
+             if(SPU2->spuCtrl2[ch/24]&0x40)                  // some irq active?
               {
-               if((pSpuIrq[ch/24] >  start-16 &&       // irq address reached?
-                   pSpuIrq[ch/24] <= start) ||
+               if((SPU2->pSpuIrq[ch/24] >  start-16 &&       // irq address reached?
+                   SPU2->pSpuIrq[ch/24] <= start) ||
                   ((flags&1) &&                        // special: irq on looping addr, when stop/loop flag is set
-                   (pSpuIrq[ch/24] >  s_chan[ch].pLoop-16 &&
-                    pSpuIrq[ch/24] <= s_chan[ch].pLoop)))
+                   (SPU2->pSpuIrq[ch/24] >  SPU2->s_chan[ch].pLoop-16 &&
+                    SPU2->pSpuIrq[ch/24] <= SPU2->s_chan[ch].pLoop)))
                 {
-                 s_chan[ch].iIrqDone=1;                // -> debug flag
+                 SPU2->s_chan[ch].iIrqDone=1;                // -> debug flag
 
-                 if(irqCallback) irqCallback();        // -> call main emu (not supported in SPU2 right now)
+                 if(SPU2->irqCallback) SPU2->irqCallback();        // -> call main emu (not supported in SPU2 right now)
                  else
                   {
                    if(ch<24) InterruptDMA4();            // -> let's see what is happening if we call our irqs instead ;)
                    else      InterruptDMA7();
                   }
 
-                 if(iSPUIRQWait)                       // -> option: wait after irq for main emu
+                 if(SPU2->iSPUIRQWait)                       // -> option: wait after irq for main emu
                   {
-                   iSpuAsyncWait=1;
+                   SPU2->iSpuAsyncWait=1;
                    bIRQReturn=1;
                   }
                 }
@@ -514,29 +484,29 @@ static void *MAINThread(int samp2run, void *data)
 
              //////////////////////////////////////////// flag handler
 
-             if((flags&4) && (!s_chan[ch].bIgnoreLoop))
-              s_chan[ch].pLoop=start-16;               // loop adress
+             if((flags&4) && (!SPU2->s_chan[ch].bIgnoreLoop))
+              SPU2->s_chan[ch].pLoop=start-16;               // loop adress
 
              if(flags&1)                               // 1: stop/loop
               {
-               dwEndChannel2[ch/24]|=(1<<(ch%24));
+               SPU2->dwEndChannel2[ch/24]|=(1<<(ch%24));
 
                // We play this block out first...
                //if(!(flags&2)|| s_chan[ch].pLoop==NULL)
                                                        // 1+2: do loop... otherwise: stop
-               if(flags!=3 || s_chan[ch].pLoop==NULL)  // PETE: if we don't check exactly for 3, loop hang ups will happen (DQ4, for example)
+               if(flags!=3 || SPU2->s_chan[ch].pLoop==NULL)  // PETE: if we don't check exactly for 3, loop hang ups will happen (DQ4, for example)
                 {                                      // and checking if pLoop is set avoids crashes, yeah
                  start = (unsigned char*)-1;
                 }
                else
                 {
-                 start = s_chan[ch].pLoop;
+                 start = SPU2->s_chan[ch].pLoop;
                 }
               }
 
-             s_chan[ch].pCurr=start;                   // store values for next cycle
-             s_chan[ch].s_1=s_1;
-             s_chan[ch].s_2=s_2;
+             SPU2->s_chan[ch].pCurr=start;                   // store values for next cycle
+             SPU2->s_chan[ch].s_1=s_1;
+             SPU2->s_chan[ch].s_2=s_2;
 
              ////////////////////////////////////////////
 
@@ -544,7 +514,7 @@ static void *MAINThread(int samp2run, void *data)
               {
                bIRQReturn=0;
                 {
-                 lastch=ch;
+                 SPU2->lastch=ch;
 //                 lastns=ns;	// changemeback
 
                  return NULL;
@@ -557,7 +527,7 @@ GOON: ;
 
             }
 
-           fa=s_chan[ch].SB[s_chan[ch].iSBPos++];      // get sample data
+           fa=SPU2->s_chan[ch].SB[SPU2->s_chan[ch].iSBPos++];      // get sample data
 
 //           if((spuCtrl2[ch/24]&0x4000)==0) fa=0;       // muted?
 //           else                                        // else adjust
@@ -566,25 +536,25 @@ GOON: ;
              if(fa<-32767L) fa=-32767L;
             }
 
-           if(iUseInterpolation>=2)                    // gauss/cubic interpolation
+           if(SPU2->iUseInterpolation>=2)                    // gauss/cubic interpolation
             {
-             gpos = s_chan[ch].SB[28];
+             gpos = SPU2->s_chan[ch].SB[28];
              gval0 = fa;
              gpos = (gpos+1) & 3;
-             s_chan[ch].SB[28] = gpos;
+             SPU2->s_chan[ch].SB[28] = gpos;
             }
            else
-           if(iUseInterpolation==1)                    // simple interpolation
+           if(SPU2->iUseInterpolation==1)                    // simple interpolation
             {
-             s_chan[ch].SB[28] = 0;
-             s_chan[ch].SB[29] = s_chan[ch].SB[30];    // -> helpers for simple linear interpolation: delay real val for two slots, and calc the two deltas, for a 'look at the future behaviour'
-             s_chan[ch].SB[30] = s_chan[ch].SB[31];
-             s_chan[ch].SB[31] = fa;
-             s_chan[ch].SB[32] = 1;                    // -> flag: calc new interolation
+             SPU2->s_chan[ch].SB[28] = 0;
+             SPU2->s_chan[ch].SB[29] = SPU2->s_chan[ch].SB[30];    // -> helpers for simple linear interpolation: delay real val for two slots, and calc the two deltas, for a 'look at the future behaviour'
+             SPU2->s_chan[ch].SB[30] = SPU2->s_chan[ch].SB[31];
+             SPU2->s_chan[ch].SB[31] = fa;
+             SPU2->s_chan[ch].SB[32] = 1;                    // -> flag: calc new interolation
             }
-           else s_chan[ch].SB[29]=fa;                  // no interpolation
+           else SPU2->s_chan[ch].SB[29]=fa;                  // no interpolation
 
-           s_chan[ch].spos -= 0x10000L;
+           SPU2->s_chan[ch].spos -= 0x10000L;
           }
 
          ////////////////////////////////////////////////
@@ -592,32 +562,32 @@ GOON: ;
          // surely wrong... and no noise frequency (spuCtrl&0x3f00) will be used...
          // and sometimes the noise will be used as fmod modulation... pfff
 
-         if(s_chan[ch].bNoise)
+         if(SPU2->s_chan[ch].bNoise)
           {
-           if((dwNoiseVal<<=1)&0x80000000L)
+           if((SPU2->dwNoiseVal<<=1)&0x80000000L)
             {
-             dwNoiseVal^=0x0040001L;
-             fa=((dwNoiseVal>>2)&0x7fff);
+             SPU2->dwNoiseVal^=0x0040001L;
+             fa=((SPU2->dwNoiseVal>>2)&0x7fff);
              fa=-fa;
             }
-           else fa=(dwNoiseVal>>2)&0x7fff;
+           else fa=(SPU2->dwNoiseVal>>2)&0x7fff;
 
            // mmm... depending on the noise freq we allow bigger/smaller changes to the previous val
-           fa=s_chan[ch].iOldNoise+((fa-s_chan[ch].iOldNoise)/((0x001f-((spuCtrl2[ch/24]&0x3f00)>>9))+1));
+           fa=SPU2->s_chan[ch].iOldNoise+((fa-SPU2->s_chan[ch].iOldNoise)/((0x001f-((SPU2->spuCtrl2[ch/24]&0x3f00)>>9))+1));
            if(fa>32767L)  fa=32767L;
            if(fa<-32767L) fa=-32767L;
-           s_chan[ch].iOldNoise=fa;
+           SPU2->s_chan[ch].iOldNoise=fa;
 
-           if(iUseInterpolation<2)                     // no gauss/cubic interpolation?
-            s_chan[ch].SB[29] = fa;                    // -> store noise val in "current sample" slot
+           if(SPU2->iUseInterpolation<2)                     // no gauss/cubic interpolation?
+            SPU2->s_chan[ch].SB[29] = fa;                    // -> store noise val in "current sample" slot
           }                                            //----------------------------------------
          else                                          // NO NOISE (NORMAL SAMPLE DATA) HERE
           {//------------------------------------------//
-           if(iUseInterpolation==3)                    // cubic interpolation
+           if(SPU2->iUseInterpolation==3)                    // cubic interpolation
             {
              long xd;
-             xd = ((s_chan[ch].spos) >> 1)+1;
-             gpos = s_chan[ch].SB[28];
+             xd = ((SPU2->s_chan[ch].spos) >> 1)+1;
+             gpos = SPU2->s_chan[ch].SB[28];
 
              fa  = gval(3) - 3*gval(2) + 3*gval(1) - gval0;
              fa *= (xd - (2<<15)) / 6;
@@ -632,11 +602,11 @@ GOON: ;
             }
            //------------------------------------------//
            else
-           if(iUseInterpolation==2)                    // gauss interpolation
+           if(SPU2->iUseInterpolation==2)                    // gauss interpolation
             {
              int vl, vr;
-             vl = (s_chan[ch].spos >> 6) & ~3;
-             gpos = s_chan[ch].SB[28];
+             vl = (SPU2->s_chan[ch].spos >> 6) & ~3;
+             gpos = SPU2->s_chan[ch].SB[28];
              vr=(gauss[vl]*gval0)&~2047;
              vr+=(gauss[vl+1]*gval(1))&~2047;
              vr+=(gauss[vl+2]*gval(2))&~2047;
@@ -652,25 +622,25 @@ GOON: ;
             }
            //------------------------------------------//
            else
-           if(iUseInterpolation==1)                    // simple interpolation
+           if(SPU2->iUseInterpolation==1)                    // simple interpolation
             {
-             if(s_chan[ch].sinc<0x10000L)              // -> upsampling?
+             if(SPU2->s_chan[ch].sinc<0x10000L)              // -> upsampling?
                   InterpolateUp(ch);                   // --> interpolate up
              else InterpolateDown(ch);                 // --> else down
-             fa=s_chan[ch].SB[29];
+             fa=SPU2->s_chan[ch].SB[29];
             }
            //------------------------------------------//
-           else fa=s_chan[ch].SB[29];                  // no interpolation
+           else fa=SPU2->s_chan[ch].SB[29];                  // no interpolation
           }
 
-         s_chan[ch].sval = (MixADSR(ch) * fa) / 1023;  // add adsr
+         SPU2->s_chan[ch].sval = (MixADSR(ch) * fa) / 1023;  // add adsr
 
-         if(s_chan[ch].bFMod==2)                       // fmod freq channel
+         if(SPU2->s_chan[ch].bFMod==2)                       // fmod freq channel
           {
-           int NP=s_chan[ch+1].iRawPitch;
+           int NP=SPU2->s_chan[ch+1].iRawPitch;
            double intr;
 
-           NP=((32768L+s_chan[ch].sval)*NP)/32768L;    // mmm... I still need to adjust that to 1/48 khz... we will wait for the first game/demo using it to decide how to do it :)
+           NP=((32768L+SPU2->s_chan[ch].sval)*NP)/32768L;    // mmm... I still need to adjust that to 1/48 khz... we will wait for the first game/demo using it to decide how to do it :)
 
            if(NP>0x3fff) NP=0x3fff;
            if(NP<0x1)    NP=0x1;
@@ -680,12 +650,12 @@ GOON: ;
 
            NP=(44100L*NP)/(4096L);                     // calc frequency
 
-           s_chan[ch+1].iActFreq=NP;
-           s_chan[ch+1].iUsedFreq=NP;
-           s_chan[ch+1].sinc=(((NP/10)<<16)/4410);
-           if(!s_chan[ch+1].sinc) s_chan[ch+1].sinc=1;
-           if(iUseInterpolation==1)                    // freq change in sipmle interpolation mode
-            s_chan[ch+1].SB[32]=1;
+           SPU2->s_chan[ch+1].iActFreq=NP;
+           SPU2->s_chan[ch+1].iUsedFreq=NP;
+           SPU2->s_chan[ch+1].sinc=(((NP/10)<<16)/4410);
+           if(!SPU2->s_chan[ch+1].sinc) SPU2->s_chan[ch+1].sinc=1;
+           if(SPU2->iUseInterpolation==1)                    // freq change in sipmle interpolation mode
+            SPU2->s_chan[ch+1].SB[32]=1;
 
 // mmmm... set up freq decoding positions?
 //           s_chan[ch+1].iSBPos=28;
@@ -696,26 +666,26 @@ GOON: ;
            //////////////////////////////////////////////
            // ok, left/right sound volume (psx volume goes from 0 ... 0x3fff)
 
-           if(s_chan[ch].iMute)
-            s_chan[ch].sval=0;                         // debug mute
+           if(SPU2->s_chan[ch].iMute)
+            SPU2->s_chan[ch].sval=0;                         // debug mute
            else
             {
-             if(s_chan[ch].bVolumeL)
-              SSumL[0]+=(s_chan[ch].sval*s_chan[ch].iLeftVolume)/0x4000L;
-             if(s_chan[ch].bVolumeR)
-              SSumR[0]+=(s_chan[ch].sval*s_chan[ch].iRightVolume)/0x4000L;
+             if(SPU2->s_chan[ch].bVolumeL)
+              SPU2->SSumL[0]+=(SPU2->s_chan[ch].sval*SPU2->s_chan[ch].iLeftVolume)/0x4000L;
+             if(SPU2->s_chan[ch].bVolumeR)
+              SPU2->SSumR[0]+=(SPU2->s_chan[ch].sval*SPU2->s_chan[ch].iRightVolume)/0x4000L;
             }
 
            //////////////////////////////////////////////
            // now let us store sound data for reverb
 
-           if(s_chan[ch].bRVBActive) StoreREVERB(ch,0);
+           if(SPU2->s_chan[ch].bRVBActive) StoreREVERB(ch,0);
           }
 
          ////////////////////////////////////////////////
          // ok, go on until 1 ms data of this channel is collected
 
-         s_chan[ch].spos += s_chan[ch].sinc;
+         SPU2->s_chan[ch].spos += SPU2->s_chan[ch].sinc;
 
         }
 ENDX:   ;
@@ -729,54 +699,54 @@ ENDX:   ;
   ///////////////////////////////////////////////////////
   // mix all channels (including reverb) into one buffer
 
-    SSumL[0]+=MixREVERBLeft(0,0);
-    SSumL[0]+=MixREVERBLeft(0,1);
-    SSumR[0]+=MixREVERBRight(0);
-    SSumR[0]+=MixREVERBRight(1);
+    SPU2->SSumL[0]+=MixREVERBLeft(0,0);
+    SPU2->SSumL[0]+=MixREVERBLeft(0,1);
+    SPU2->SSumR[0]+=MixREVERBRight(0);
+    SPU2->SSumR[0]+=MixREVERBRight(1);
 
-    d=SSumL[0];SSumL[0]=0;
-    d2=SSumR[0];SSumR[0]=0;
+    d=SPU2->SSumL[0];SPU2->SSumL[0]=0;
+    d2=SPU2->SSumR[0];SPU2->SSumR[0]=0;
 
     if(d<-32767) d=-32767;if(d>32767) d=32767;
     if(d2<-32767) d2=-32767;if(d2>32767) d2=32767;
 
-    if(sampcount>=decaybegin)
+    if(SPU2->sampcount>=SPU2->decaybegin)
     {
 	s32 dmul;
-	if(decaybegin!=~0) // Is anyone REALLY going to be playing a song
+	if(SPU2->decaybegin!=~0) // Is anyone REALLY going to be playing a song
 		      // for 13 hours?
     	{
-		if(sampcount>=decayend)
+		if(SPU2->sampcount>=SPU2->decayend)
 		{
-			psf2_update(NULL, 0);
+			psf_ctx->update(psf_ctx, NULL, 0);
 		        return(0);
 		}
 
-		dmul=256-(256*(sampcount-decaybegin)/(decayend-decaybegin));
+		dmul=256-(256*(SPU2->sampcount-SPU2->decaybegin)/(SPU2->decayend-SPU2->decaybegin));
 		d=(d*dmul)>>8;
 		d2=(d2*dmul)>>8;
 	}
     }
-    sampcount++;
+    SPU2->sampcount++;
 
-    *pS++=d;
-    *pS++=d2;
+    *SPU2->pS++=d;
+    *SPU2->pS++=d2;
 
     InitREVERB();
 
   //////////////////////////////////////////////////////
   // feed the sound
   // wanna have around 1/60 sec (16.666 ms) updates
-	if (seektime != 0 && sampcount < seektime)
+	if (SPU2->seektime != 0 && SPU2->sampcount < SPU2->seektime)
 	{
-		pS=(short *)pSpuBuffer;
+		SPU2->pS=(short *)SPU2->pSpuBuffer;
 	}
-	else if ((((unsigned char *)pS)-((unsigned char *)pSpuBuffer)) == (735*4))
+	else if ((((unsigned char *)SPU2->pS)-((unsigned char *)SPU2->pSpuBuffer)) == (735*4))
 	{
-		short *pSilenceIter = (short *)pSpuBuffer;
+		short *pSilenceIter = (short *)SPU2->pSpuBuffer;
 		int iSilenceCount = 0;
 
-		for (; pSilenceIter < pS; pSilenceIter++)
+		for (; pSilenceIter < SPU2->pS; pSilenceIter++)
 		{
 			if (*pSilenceIter == 0)
 				iSilenceCount++;
@@ -786,19 +756,22 @@ ENDX:   ;
 		}
 
 		if (iSilenceCount < 20)
-		    	psf2_update((u8*)pSpuBuffer,(u8*)pS-(u8*)pSpuBuffer);
+		    	psf_ctx->update(psf_ctx, (u8*)SPU2->pSpuBuffer,(u8*)SPU2->pS-(u8*)SPU2->pSpuBuffer);
 
-	        pS=(short *)pSpuBuffer;
+	        SPU2->pS=(short *)SPU2->pSpuBuffer;
 	}
  }
 
  // end of big main loop...
 
- bThreadEnded=1;
+ SPU2->bThreadEnded=1;
 
  return 0;
 }
 
+#undef SPU2
+#define SPU2 (psf_ctx->spu2)
+
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////
@@ -810,11 +783,11 @@ ENDX:   ;
 
 EXPORT_GCC void CALLBACK SPU2async(unsigned long cycle, void *data)
 {
- if(iSpuAsyncWait)
+ if(SPU2->iSpuAsyncWait)
   {
-   iSpuAsyncWait++;
-   if(iSpuAsyncWait<=64) return;
-   iSpuAsyncWait=0;
+   SPU2->iSpuAsyncWait++;
+   if(SPU2->iSpuAsyncWait<=64) return;
+   SPU2->iSpuAsyncWait=0;
   }
  MAINThread(0, data);                                      // -> linux high-compat mode
 }
@@ -830,11 +803,11 @@ EXPORT_GCC void CALLBACK SPU2async(unsigned long cycle, void *data)
 
 EXPORT_GCC long CALLBACK SPU2init(void)
 {
- spuMemC=(unsigned char *)spuMem;                      // just small setup
- memset((void *)s_chan,0,MAXCHAN*sizeof(SPUCHAN));
- memset(rvb,0,2*sizeof(REVERBInfo));
+ SPU2->spuMemC=(unsigned char *)SPU2->spuMem;                      // just small setup
+ memset((void *)SPU2->s_chan,0,MAXCHAN*sizeof(SPUCHAN));
+ memset(SPU2->rvb,0,2*sizeof(REVERBInfo));
 
- sampcount = 0;
+ SPU2->sampcount = 0;
 
  InitADSR();
 
@@ -847,13 +820,13 @@ EXPORT_GCC long CALLBACK SPU2init(void)
 
 static void SetupTimer(void)
 {
- memset(SSumR,0,NSSIZE*sizeof(int));                   // init some mixing buffers
- memset(SSumL,0,NSSIZE*sizeof(int));
- pS=(short *)pSpuBuffer;                               // setup soundbuffer pointer
+ memset(SPU2->SSumR,0,NSSIZE*sizeof(int));                   // init some mixing buffers
+ memset(SPU2->SSumL,0,NSSIZE*sizeof(int));
+ SPU2->pS=(short *)SPU2->pSpuBuffer;                               // setup soundbuffer pointer
 
- bEndThread=0;                                         // init thread vars
- bThreadEnded=0;
- bSpuInit=1;                                           // flag: we are inited
+ SPU2->bEndThread=0;                                         // init thread vars
+ SPU2->bThreadEnded=0;
+ SPU2->bSpuInit=1;                                           // flag: we are inited
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -862,9 +835,9 @@ static void SetupTimer(void)
 
 static void RemoveTimer(void)
 {
- bEndThread=1;                                         // raise flag to end thread
- bThreadEnded=0;                                       // no more spu is running
- bSpuInit=0;
+ SPU2->bEndThread=1;                                         // raise flag to end thread
+ SPU2->bThreadEnded=0;                                       // no more spu is running
+ SPU2->bSpuInit=0;
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -875,30 +848,30 @@ static void SetupStreams(void)
 {
  int i;
 
- pSpuBuffer=(unsigned char *)malloc(32768);            // alloc mixing buffer
+ SPU2->pSpuBuffer=SPU2->spuBuffer;                           // set up mixing buffer
 
  i=NSSIZE*2;
 
- sRVBStart[0] = (int *)malloc(i*4);                    // alloc reverb buffer
- memset(sRVBStart[0],0,i*4);
- sRVBEnd[0]  = sRVBStart[0] + i;
- sRVBPlay[0] = sRVBStart[0];
- sRVBStart[1] = (int *)malloc(i*4);                    // alloc reverb buffer
- memset(sRVBStart[1],0,i*4);
- sRVBEnd[1]  = sRVBStart[1] + i;
- sRVBPlay[1] = sRVBStart[1];
+ SPU2->sRVBStart[0] = SPU2->sRVBBuffer[0];                   // set up reverb buffer
+ memset(SPU2->sRVBStart[0],0,i*4);
+ SPU2->sRVBEnd[0]  = SPU2->sRVBStart[0] + i;
+ SPU2->sRVBPlay[0] = SPU2->sRVBStart[0];
+ SPU2->sRVBStart[1] = SPU2->sRVBBuffer[1];                   // set up reverb buffer
+ memset(SPU2->sRVBStart[1],0,i*4);
+ SPU2->sRVBEnd[1]  = SPU2->sRVBStart[1] + i;
+ SPU2->sRVBPlay[1] = SPU2->sRVBStart[1];
 
  for(i=0;i<MAXCHAN;i++)                                // loop sound channels
   {
 // we don't use mutex sync... not needed, would only
 // slow us down:
 //   s_chan[i].hMutex=CreateMutex(NULL,FALSE,NULL);
-   s_chan[i].ADSRX.SustainLevel = 1024;                // -> init sustain
-   s_chan[i].iMute=0;
-   s_chan[i].iIrqDone=0;
-   s_chan[i].pLoop=spuMemC;
-   s_chan[i].pStart=spuMemC;
-   s_chan[i].pCurr=spuMemC;
+   SPU2->s_chan[i].ADSRX.SustainLevel = 1024;                // -> init sustain
+   SPU2->s_chan[i].iMute=0;
+   SPU2->s_chan[i].iIrqDone=0;
+   SPU2->s_chan[i].pLoop=SPU2->spuMemC;
+   SPU2->s_chan[i].pStart=SPU2->spuMemC;
+   SPU2->s_chan[i].pCurr=SPU2->spuMemC;
   }
 }
 
@@ -908,12 +881,9 @@ static void SetupStreams(void)
 
 static void RemoveStreams(void)
 {
- free(pSpuBuffer);                                     // free mixing buffer
- pSpuBuffer=NULL;
- free(sRVBStart[0]);                                   // free reverb buffer
- sRVBStart[0]=0;
- free(sRVBStart[1]);                                   // free reverb buffer
- sRVBStart[1]=0;
+ SPU2->pSpuBuffer=NULL;
+ SPU2->sRVBStart[0]=0;
+ SPU2->sRVBStart[1]=0;
 
 /*
  int i;
@@ -934,32 +904,32 @@ static void RemoveStreams(void)
 
 EXPORT_GCC long CALLBACK SPU2open(void *pDsp)
 {
- if(bSPUIsOpen) return 0;                              // security for some stupid main emus
-
- iUseXA=0;                                             // just small setup
- bEndThread=0;
- bThreadEnded=0;
- spuMemC=(unsigned char *)spuMem;
- memset((void *)s_chan,0,(MAXCHAN+1)*sizeof(SPUCHAN));
- pSpuIrq[0]=0;
- pSpuIrq[1]=0;
- iSPUIRQWait=1;
- dwNewChannel2[0]=0;
- dwNewChannel2[1]=0;
- dwEndChannel2[0]=0;
- dwEndChannel2[1]=0;
- spuCtrl2[0]=0;
- spuCtrl2[1]=0;
- spuStat2[0]=0;
- spuStat2[1]=0;
- spuIrq2[0]=0;
- spuIrq2[1]=0;
- spuAddr2[0]=0xffffffff;
- spuAddr2[1]=0xffffffff;
- spuRvbAddr2[0]=0;
- spuRvbAddr2[1]=0;
- spuRvbAEnd2[0]=0;
- spuRvbAEnd2[1]=0;
+ if(SPU2->bSPUIsOpen) return 0;                              // security for some stupid main emus
+
+ SPU2->iUseXA=0;                                             // just small setup
+ SPU2->bEndThread=0;
+ SPU2->bThreadEnded=0;
+ SPU2->spuMemC=(unsigned char *)SPU2->spuMem;
+ memset((void *)SPU2->s_chan,0,(MAXCHAN+1)*sizeof(SPUCHAN));
+ SPU2->pSpuIrq[0]=0;
+ SPU2->pSpuIrq[1]=0;
+ SPU2->iSPUIRQWait=1;
+ SPU2->dwNewChannel2[0]=0;
+ SPU2->dwNewChannel2[1]=0;
+ SPU2->dwEndChannel2[0]=0;
+ SPU2->dwEndChannel2[1]=0;
+ SPU2->spuCtrl2[0]=0;
+ SPU2->spuCtrl2[1]=0;
+ SPU2->spuStat2[0]=0;
+ SPU2->spuStat2[1]=0;
+ SPU2->spuIrq2[0]=0;
+ SPU2->spuIrq2[1]=0;
+ SPU2->spuAddr2[0]=0xffffffff;
+ SPU2->spuAddr2[1]=0xffffffff;
+ SPU2->spuRvbAddr2[0]=0;
+ SPU2->spuRvbAddr2[1]=0;
+ SPU2->spuRvbAEnd2[0]=0;
+ SPU2->spuRvbAEnd2[1]=0;
 
 // ReadConfig();                                         // read user stuff
 
@@ -969,7 +939,7 @@ EXPORT_GCC long CALLBACK SPU2open(void *pDsp)
 
  SetupTimer();                                         // timer for feeding data
 
- bSPUIsOpen=1;
+ SPU2->bSPUIsOpen=1;
 
  return 0;
 }
@@ -982,9 +952,9 @@ EXPORT_GCC long CALLBACK SPU2open(void *pDsp)
 
 EXPORT_GCC void CALLBACK SPU2close(void)
 {
- if(!bSPUIsOpen) return;                               // some security
+ if(!SPU2->bSPUIsOpen) return;                               // some security
 
- bSPUIsOpen=0;                                         // no more open
+ SPU2->bSPUIsOpen=0;                                         // no more open
 
  RemoveTimer();                                        // no more feeding
 
@@ -1020,17 +990,17 @@ EXPORT_GCC long CALLBACK SPU2test(void)
 // not used yet
 EXPORT_GCC void CALLBACK SPU2irqCallback(void (CALLBACK *callback)(void))
 {
- irqCallback = callback;
+ SPU2->irqCallback = callback;
 }
 
 // not used yet
 EXPORT_GCC void CALLBACK SPU2registerCallback(void (CALLBACK *callback)(void))
 {
- irqCallback = callback;
+ SPU2->irqCallback = callback;
 }
 
 // not used yet
 EXPORT_GCC void CALLBACK SPU2registerCDDAVolume(void (CALLBACK *CDDAVcallback)(unsigned short,unsigned short))
 {
- cddavCallback = CDDAVcallback;
+ SPU2->cddavCallback = CDDAVcallback;
 }
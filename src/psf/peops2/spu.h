@@ -37,3 +37,4 @@ EXPORT_GCC long CALLBACK SPU2open(void *pDsp);
 EXPORT_GCC void CALLBACK SPU2async(unsigned long cycle, void *data);
 EXPORT_GCC void CALLBACK SPU2close(void);
 EXPORT_GCC int  CALLBACK psf2_seek(u32 t);
+EXPORT_GCC u32  CALLBACK psf2_tell(void);
@@ -28,14 +28,18 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <glib.h>
+
 #include <libaudcore/i18n.h>
 #include <libaudcore/input.h>
 #include <libaudcore/plugin.h>
 #include <libaudcore/audstrings.h>
 
 #include "ao.h"
+#include "context.h"
 #include "corlett.h"
 #include "eng_protos.h"
+#include "../libemu/snappool.h"
 
 typedef enum {
     ENG_NONE = 0,
@@ -49,20 +53,25 @@ typedef struct {
     int32_t (*start)(uint8_t *buffer, uint32_t length);
     int32_t (*stop)(void);
     int32_t (*seek)(uint32_t);
+    uint32_t (*tell)(void);     /* milliseconds emulated, silent or not */
     int32_t (*execute)(void);
 } PSFEngineFunctors;
 
 static PSFEngineFunctors psf_functor_map[ENG_COUNT] = {
-    {NULL, NULL, NULL, NULL},
-    {psf_start, psf_stop, psf_seek, psf_execute},
-    {psf2_start, psf2_stop, psf2_seek, psf2_execute},
-    {spx_start, spx_stop, psf_seek, spx_execute},
+    {NULL, NULL, NULL, NULL, NULL},
+    {psf_start, psf_stop, psf_seek, psf_tell, psf_execute},
+    {psf2_start, psf2_stop, psf2_seek, psf2_tell, psf2_execute},
+    {spx_start, spx_stop, psf_seek, psf_tell, spx_execute},
 };
 
-static PSFEngineFunctors *f;
-static String dirpath;
+/* memory given to the snapshots of one song, and their initial interval */
+#define SNAPSHOT_LIMIT (64 * 1024 * 1024)
+#define SNAPSHOT_INTERVAL 10000
 
-bool_t stop_flag = FALSE;
+typedef struct {
+    PSFEngineFunctors *f;
+    SnapPool *snapshots;
+} PSFPlayback;
 
 static PSFEngine psf_probe(uint8_t *buffer)
 {
@@ -81,19 +90,36 @@ static PSFEngine psf_probe(uint8_t *buffer)
 	return ENG_NONE;
 }
 
-/* ao_get_lib: called to load secondary files */
-int ao_get_lib(char *filename, uint8_t **buffer, uint64_t *length)
+static bool_t decode_lib(LibImage *image)
 {
-	void *filebuf;
-	int64_t size;
+	corlett_lib_t *lib = g_new0(corlett_lib_t, 1);
+
+	if (corlett_decode((uint8_t *) image->raw, image->raw_len, &lib->exe, &lib->exe_len, &lib->c) != AO_SUCCESS)
+	{
+		g_free(lib);
+		return FALSE;
+	}
 
-	StringBuf path = filename_build ({dirpath, filename});
-	vfs_file_get_contents(path, &filebuf, &size);
+	image->decoded = lib;
+	image->decoded_len = lib->exe_len + sizeof(corlett_t);
 
-	*buffer = (uint8_t *) filebuf;
-	*length = (uint64_t)size;
+	return TRUE;
+}
+
+static void free_lib(LibImage *image)
+{
+	corlett_lib_t *lib = (corlett_lib_t *) image->decoded;
+
+	free(lib->exe);
+	free(lib->c);
+	g_free(lib);
+}
 
-	return AO_SUCCESS;
+/* ao_get_lib: called to load secondary files */
+const LibImage *ao_get_lib(char *filename)
+{
+	StringBuf path = filename_build ({psf_ctx->dir, filename});
+	return libcache_get(path, decode_lib, free_lib);
 }
 
 Tuple psf2_tuple(const char *filename, VFSFile *file)
@@ -127,18 +153,65 @@ Tuple psf2_tuple(const char *filename, VFSFile *file)
 	return t;
 }
 
+static void free_snapshot(void *snap)
+{
+	psf_snapshot_free((PSFSnapshot *) snap);
+}
+
+static void psf2_update(PSFContext *ctx, unsigned char *buffer, long count)
+{
+	PSFPlayback *p = (PSFPlayback *) ctx->user;
+
+	if (! buffer || aud_input_check_stop ())
+	{
+		ctx->stop_flag = TRUE;
+		return;
+	}
+
+	int seek = aud_input_check_seek ();
+
+	if (seek >= 0)
+	{
+		/* silent blocks never reach update(), so only the engine knows
+		 * where it is */
+		int now = p->f->tell ();
+		int snap_time;
+		PSFSnapshot *snap = (PSFSnapshot *) snappool_find(p->snapshots, seek, &snap_time);
+
+		/* the engines only run forward; go back, or skip ahead, to a snapshot */
+		if (snap && (seek < now || snap_time > now))
+			psf_snapshot_restore(ctx, snap);
+
+		p->f->seek (seek);
+		return;
+	}
+
+	aud_input_write_audio (buffer, count);
+
+	int time = p->f->tell ();
+
+	if (snappool_due(p->snapshots, time))
+	{
+		PSFSnapshot *snap = psf_snapshot_take(ctx);
+		if (snap)
+			snappool_add(p->snapshots, time, snap, psf_snapshot_size(snap));
+	}
+}
+
 static bool_t psf2_play(const char * filename, VFSFile * file)
 {
 	void *buffer;
 	int64_t size;
 	PSFEngine eng;
+	PSFEngineFunctors *f;
+	PSFPlayback playback;
 	bool_t error = FALSE;
 
 	const char * slash = strrchr (filename, '/');
 	if (! slash)
 		return FALSE;
 
-	dirpath = String (str_copy (filename, slash + 1 - filename));
+	String dirpath = String (str_copy (filename, slash + 1 - filename));
 
 	vfs_file_get_contents (filename, & buffer, & size);
 
@@ -150,8 +223,18 @@ static bool_t psf2_play(const char * filename, VFSFile * file)
 	}
 
 	f = &psf_functor_map[eng];
+
+	playback.f = f;
+	playback.snapshots = snappool_new(SNAPSHOT_INTERVAL, SNAPSHOT_LIMIT, free_snapshot);
+
+	/* the emulator runs in this thread, on a context of its own */
+	psf_ctx = psf_context_new(psf2_update, &playback);
+	psf_ctx->dir = dirpath;
+
 	if (f->start((uint8_t *) buffer, size) != AO_SUCCESS)
 	{
+		psf_context_free(psf_ctx);
+		snappool_free(playback.snapshots);
 		free(buffer);
 		return FALSE;
 	}
@@ -160,37 +243,17 @@ static bool_t psf2_play(const char * filename, VFSFile * file)
 
 	aud_input_set_bitrate(44100*2*2*8);
 
-	stop_flag = FALSE;
-
 	f->execute();
 	f->stop();
 
-	f = NULL;
-	dirpath = String ();
+	psf_context_free(psf_ctx);
+	snappool_free(playback.snapshots);
+
 	free(buffer);
 
 	return ! error;
 }
 
-void psf2_update(unsigned char *buffer, long count)
-{
-	if (! buffer || aud_input_check_stop ())
-	{
-		stop_flag = TRUE;
-		return;
-	}
-
-	int seek = aud_input_check_seek ();
-
-	if (seek >= 0)
-	{
-		f->seek (seek);
-		return;
-	}
-
-	aud_input_write_audio (buffer, count);
-}
-
 int psf2_is_our_fd(const char *filename, VFSFile *file)
 {
 	uint8_t magic[4];
@@ -203,6 +266,7 @@ int psf2_is_our_fd(const char *filename, VFSFile *file)
 static const char *psf2_fmts[] = { "psf", "minipsf", "psf2", "minipsf2", "spu", "spx", NULL };
 
 #define AUD_PLUGIN_NAME        N_("OpenPSF PSF1/PSF2 Decoder")
+#define AUD_PLUGIN_CLEANUP     libcache_cleanup
 #define AUD_INPUT_PLAY         psf2_play
 #define AUD_INPUT_READ_TUPLE   psf2_tuple
 #define AUD_INPUT_IS_OUR_FILE  psf2_is_our_fd
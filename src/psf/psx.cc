@@ -15,9 +15,13 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+
+#include <glib.h>
+
 #include "ao.h"
 #include "cpuintrf.h"
 #include "psx.h"
+#include "context.h"
 
 #define EXC_INT ( 0 )
 #define EXC_ADEL ( 4 )
@@ -156,7 +160,7 @@ static uint8_t mips_win_layout[] = {
 
 #define REGPC ( 32 )
 
-typedef struct
+typedef struct mips_cpu_context
 {
 	uint32_t op;
 	uint32_t pc;
@@ -170,11 +174,18 @@ typedef struct
 	PAIR cp2cr[ 32 ];
 	PAIR cp2dr[ 32 ];
 	int (*irq_callback)(int irqline);
+	int icount;
 } mips_cpu_context;
 
-static mips_cpu_context mipscpu;
+// the CPU of the current thread's emulator
+#define CPU (psf_ctx->cpu)
 
-static int mips_ICount = 0;
+const size_t mips_state_size = sizeof(mips_cpu_context);
+
+mips_cpu_context *mips_state_new(void)
+{
+	return g_new0(mips_cpu_context, 1);
+}
 
 static uint32_t mips_mtc0_writemask[]=
 {
@@ -220,7 +231,7 @@ void GTELOG(const char *a,...)
 	va_start( va, a );
 	vsprintf( s_text, a, va );
 	va_end( va );
-	logerror( "%08x: GTE: %08x %s\n", mipscpu.pc, INS_COFUN( mipscpu.op ), s_text );
+	logerror( "%08x: GTE: %08x %s\n", CPU->pc, INS_COFUN( CPU->op ), s_text );
 }
 #else
 static inline void GTELOG(const char *a, ...) {}
@@ -244,34 +255,34 @@ void mips_stop( void )
 
 static inline void mips_set_cp0r( int reg, uint32_t value )
 {
-	mipscpu.cp0r[ reg ] = value;
+	CPU->cp0r[ reg ] = value;
 	if( reg == CP0_SR || reg == CP0_CAUSE )
 	{
-		if( ( mipscpu.cp0r[ CP0_SR ] & SR_IEC ) != 0 && ( mipscpu.cp0r[ CP0_SR ] & mipscpu.cp0r[ CP0_CAUSE ] & CAUSE_IP ) != 0 )
+		if( ( CPU->cp0r[ CP0_SR ] & SR_IEC ) != 0 && ( CPU->cp0r[ CP0_SR ] & CPU->cp0r[ CP0_CAUSE ] & CAUSE_IP ) != 0 )
 		{
 			mips_exception( EXC_INT );
 		}
-		else if( mipscpu.delayr != REGPC && ( mipscpu.pc & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
+		else if( CPU->delayr != REGPC && ( CPU->pc & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
 		{
 			mips_exception( EXC_ADEL );
-			mips_set_cp0r( CP0_BADVADDR, mipscpu.pc );
+			mips_set_cp0r( CP0_BADVADDR, CPU->pc );
 		}
 	}
 }
 
 static inline void mips_commit_delayed_load( void )
 {
-	if( mipscpu.delayr != 0 )
+	if( CPU->delayr != 0 )
 	{
-		mipscpu.r[ mipscpu.delayr ] = mipscpu.delayv;
-		mipscpu.delayr = 0;
-		mipscpu.delayv = 0;
+		CPU->r[ CPU->delayr ] = CPU->delayv;
+		CPU->delayr = 0;
+		CPU->delayv = 0;
 	}
 }
 
 static inline void mips_delayed_branch( uint32_t n_adr )
 {
-	if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
+	if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
 	{
 		mips_exception( EXC_ADEL );
 		mips_set_cp0r( CP0_BADVADDR, n_adr );
@@ -279,30 +290,30 @@ static inline void mips_delayed_branch( uint32_t n_adr )
 	else
 	{
 		mips_commit_delayed_load();
-		mipscpu.delayr = REGPC;
-		mipscpu.delayv = n_adr;
-		mipscpu.pc += 4;
+		CPU->delayr = REGPC;
+		CPU->delayv = n_adr;
+		CPU->pc += 4;
 	}
 }
 
 static inline void mips_set_pc( unsigned val )
 {
-	mipscpu.pc = val;
+	CPU->pc = val;
 	change_pc( val );
-	mipscpu.delayr = 0;
-	mipscpu.delayv = 0;
+	CPU->delayr = 0;
+	CPU->delayv = 0;
 }
 
 static inline void mips_advance_pc( void )
 {
-	if( mipscpu.delayr == REGPC )
+	if( CPU->delayr == REGPC )
 	{
-		mips_set_pc( mipscpu.delayv );
+		mips_set_pc( CPU->delayv );
 	}
 	else
 	{
 		mips_commit_delayed_load();
-		mipscpu.pc += 4;
+		CPU->pc += 4;
 	}
 }
 
@@ -311,44 +322,44 @@ static inline void mips_load( uint32_t n_r, uint32_t n_v )
 	mips_advance_pc();
 	if( n_r != 0 )
 	{
-		mipscpu.r[ n_r ] = n_v;
+		CPU->r[ n_r ] = n_v;
 	}
 }
 
 static inline void mips_delayed_load( uint32_t n_r, uint32_t n_v )
 {
-	if( mipscpu.delayr == REGPC )
+	if( CPU->delayr == REGPC )
 	{
-		mips_set_pc( mipscpu.delayv );
-		mipscpu.delayr = n_r;
-		mipscpu.delayv = n_v;
+		mips_set_pc( CPU->delayv );
+		CPU->delayr = n_r;
+		CPU->delayv = n_v;
 	}
 	else
 	{
 		mips_commit_delayed_load();
-		mipscpu.pc += 4;
+		CPU->pc += 4;
 		if( n_r != 0 )
 		{
-			mipscpu.r[ n_r ] = n_v;
+			CPU->r[ n_r ] = n_v;
 		}
 	}
 }
 
 static void mips_exception( int exception )
 {
-	mips_set_cp0r( CP0_SR, ( mipscpu.cp0r[ CP0_SR ] & ~0x3f ) | ( ( mipscpu.cp0r[ CP0_SR ] << 2 ) & 0x3f ) );
-	if( mipscpu.delayr == REGPC )
+	mips_set_cp0r( CP0_SR, ( CPU->cp0r[ CP0_SR ] & ~0x3f ) | ( ( CPU->cp0r[ CP0_SR ] << 2 ) & 0x3f ) );
+	if( CPU->delayr == REGPC )
 	{
-		mips_set_cp0r( CP0_EPC, mipscpu.pc - 4 );
-		mips_set_cp0r( CP0_CAUSE, ( mipscpu.cp0r[ CP0_CAUSE ] & ~CAUSE_EXC ) | CAUSE_BD | ( exception << 2 ) );
+		mips_set_cp0r( CP0_EPC, CPU->pc - 4 );
+		mips_set_cp0r( CP0_CAUSE, ( CPU->cp0r[ CP0_CAUSE ] & ~CAUSE_EXC ) | CAUSE_BD | ( exception << 2 ) );
 	}
 	else
 	{
 		mips_commit_delayed_load();
-		mips_set_cp0r( CP0_EPC, mipscpu.pc );
-		mips_set_cp0r( CP0_CAUSE, ( mipscpu.cp0r[ CP0_CAUSE ] & ~( CAUSE_EXC | CAUSE_BD ) ) | ( exception << 2 ) );
+		mips_set_cp0r( CP0_EPC, CPU->pc );
+		mips_set_cp0r( CP0_CAUSE, ( CPU->cp0r[ CP0_CAUSE ] & ~( CAUSE_EXC | CAUSE_BD ) ) | ( exception << 2 ) );
 	}
-	if( mipscpu.cp0r[ CP0_SR ] & SR_BEV )
+	if( CPU->cp0r[ CP0_SR ] & SR_BEV )
 	{
 		mips_set_pc( 0xbfc00180 );
 	}
@@ -363,26 +374,26 @@ void mips_init( void )
 #if 0
 	int cpu = cpu_getactivecpu();
 
-	state_save_register_UINT32( "psxcpu", cpu, "op", &mipscpu.op, 1 );
-	state_save_register_UINT32( "psxcpu", cpu, "pc", &mipscpu.pc, 1 );
-	state_save_register_UINT32( "psxcpu", cpu, "delayv", &mipscpu.delayv, 1 );
-	state_save_register_UINT32( "psxcpu", cpu, "delayr", &mipscpu.delayr, 1 );
-	state_save_register_UINT32( "psxcpu", cpu, "hi", &mipscpu.hi, 1 );
-	state_save_register_UINT32( "psxcpu", cpu, "lo", &mipscpu.lo, 1 );
-	state_save_register_UINT32( "psxcpu", cpu, "r", &mipscpu.r[ 0 ], 32 );
-	state_save_register_UINT32( "psxcpu", cpu, "cp0r", &mipscpu.cp0r[ 0 ], 32 );
-	state_save_register_UINT32( "psxcpu", cpu, "cp2cr", &mipscpu.cp2cr[ 0 ].d, 32 );
-	state_save_register_UINT32( "psxcpu", cpu, "cp2dr", &mipscpu.cp2dr[ 0 ].d, 32 );
+	state_save_register_UINT32( "psxcpu", cpu, "op", &CPU->op, 1 );
+	state_save_register_UINT32( "psxcpu", cpu, "pc", &CPU->pc, 1 );
+	state_save_register_UINT32( "psxcpu", cpu, "delayv", &CPU->delayv, 1 );
+	state_save_register_UINT32( "psxcpu", cpu, "delayr", &CPU->delayr, 1 );
+	state_save_register_UINT32( "psxcpu", cpu, "hi", &CPU->hi, 1 );
+	state_save_register_UINT32( "psxcpu", cpu, "lo", &CPU->lo, 1 );
+	state_save_register_UINT32( "psxcpu", cpu, "r", &CPU->r[ 0 ], 32 );
+	state_save_register_UINT32( "psxcpu", cpu, "cp0r", &CPU->cp0r[ 0 ], 32 );
+	state_save_register_UINT32( "psxcpu", cpu, "cp2cr", &CPU->cp2cr[ 0 ].d, 32 );
+	state_save_register_UINT32( "psxcpu", cpu, "cp2dr", &CPU->cp2dr[ 0 ].d, 32 );
 #endif
 }
 
 void mips_reset( void *param )
 {
-	mips_set_cp0r( CP0_SR, ( mipscpu.cp0r[ CP0_SR ] & ~( SR_TS | SR_SWC | SR_KUC | SR_IEC ) ) | SR_BEV );
+	mips_set_cp0r( CP0_SR, ( CPU->cp0r[ CP0_SR ] & ~( SR_TS | SR_SWC | SR_KUC | SR_IEC ) ) | SR_BEV );
 	mips_set_cp0r( CP0_RANDOM, 63 ); /* todo: */
 	mips_set_cp0r( CP0_PRID, 0x00000200 ); /* todo: */
 	mips_set_pc( 0xbfc00000 );
-	mipscpu.prevpc = 0xffffffff;
+	CPU->prevpc = 0xffffffff;
 }
 
 static void mips_exit( void )
@@ -391,474 +402,549 @@ static void mips_exit( void )
 
 void mips_shorten_frame(void)
 {
-	mips_ICount = 0;
+	CPU->icount = 0;
 }
 
 void psx_hw_runcounters(void);
 
+/*
+ * Instructions are dispatched through a single switch on an index that
+ * folds the SPECIAL and REGIMM sub-opcodes into the primary one.  The index
+ * comes from a table lookup on the primary opcode, followed by one on the
+ * function or rt field for SPECIAL and REGIMM; it depends on nothing but the
+ * opcode word, so there is nothing to cache or invalidate.
+ */
+
+enum
+{
+	DEC_SUB = 0,				// look up INS_FUNCT or INS_RT
+	DEC_OP = 1,					// + INS_OP
+	DEC_SPECIAL = DEC_OP + 64,	// + INS_FUNCT
+	DEC_SPECIAL_RI = DEC_SPECIAL + 64,
+	DEC_REGIMM,					// + INS_RT
+	DEC_REGIMM_NONE = DEC_REGIMM + 32
+};
+
+#define D_OP( n ) DEC_OP + ( n )
+#define D_OP8( n ) D_OP( n ), D_OP( n + 1 ), D_OP( n + 2 ), D_OP( n + 3 ), \
+	D_OP( n + 4 ), D_OP( n + 5 ), D_OP( n + 6 ), D_OP( n + 7 )
+
+static const uint8_t mips_op_table[ 64 ] =
+{
+	DEC_SUB, DEC_SUB, D_OP( 2 ), D_OP( 3 ), D_OP( 4 ), D_OP( 5 ), D_OP( 6 ), D_OP( 7 ),
+	D_OP8( 8 ), D_OP8( 16 ), D_OP8( 24 ), D_OP8( 32 ), D_OP8( 40 ), D_OP8( 48 ), D_OP8( 56 )
+};
+
+#define D_SP( n ) DEC_SPECIAL + ( n )
+#define D_RI DEC_SPECIAL_RI
+
+static const uint8_t mips_special_table[ 64 ] =
+{
+	D_SP( 0 ), D_RI, D_SP( 2 ), D_SP( 3 ), D_SP( 4 ), D_RI, D_SP( 6 ), D_SP( 7 ),
+	D_SP( 8 ), D_SP( 9 ), D_RI, D_SP( 11 ), D_SP( 12 ), D_SP( 13 ), D_RI, D_RI,
+	D_SP( 16 ), D_SP( 17 ), D_SP( 18 ), D_SP( 19 ), D_RI, D_RI, D_RI, D_RI,
+	D_SP( 24 ), D_SP( 25 ), D_SP( 26 ), D_SP( 27 ), D_RI, D_RI, D_RI, D_RI,
+	D_SP( 32 ), D_SP( 33 ), D_SP( 34 ), D_SP( 35 ), D_SP( 36 ), D_SP( 37 ), D_SP( 38 ), D_SP( 39 ),
+	D_RI, D_RI, D_SP( 42 ), D_SP( 43 ), D_RI, D_RI, D_RI, D_RI,
+	D_RI, D_RI, D_RI, D_RI, D_RI, D_RI, D_RI, D_RI,
+	D_RI, D_RI, D_RI, D_RI, D_RI, D_RI, D_RI, D_RI
+};
+
+#define D_RN DEC_REGIMM_NONE
+
+static const uint8_t mips_regimm_table[ 32 ] =
+{
+	DEC_REGIMM + RT_BLTZ, DEC_REGIMM + RT_BGEZ, D_RN, D_RN, D_RN, D_RN, D_RN, D_RN,
+	D_RN, D_RN, D_RN, D_RN, D_RN, D_RN, D_RN, D_RN,
+	DEC_REGIMM + RT_BLTZAL, DEC_REGIMM + RT_BGEZAL, D_RN, D_RN, D_RN, D_RN, D_RN, D_RN,
+	D_RN, D_RN, D_RN, D_RN, D_RN, D_RN, D_RN, D_RN
+};
+
+#undef D_OP
+#undef D_OP8
+#undef D_SP
+#undef D_RI
+#undef D_RN
+
+static inline int mips_decode( uint32_t op )
+{
+	int dispatch = mips_op_table[ INS_OP( op ) ];
+
+	if( dispatch == DEC_SUB )
+		dispatch = ( INS_OP( op ) == OP_SPECIAL ) ?
+		 mips_special_table[ INS_FUNCT( op ) ] : mips_regimm_table[ INS_RT( op ) ];
+
+	return dispatch;
+}
+
 int psxcpu_verbose = 0;
 
 int mips_execute( int cycles )
 {
+	// the context cannot change while executing: look it up once
+	PSFContext *const ctx = psf_ctx;
+	mips_cpu_context *const cpu_local = ctx->cpu;
+#undef CPU
+#define CPU cpu_local
+
 	uint32_t n_res;
+	int dispatch;
 
-	mips_ICount = cycles;
+	CPU->icount = cycles;
 	do
 	{
 //		CALL_MAME_DEBUG;
 
 //		psx_hw_runcounters();
 
-		mipscpu.op = cpu_readop32( mipscpu.pc );
+		// fetch from main RAM directly; anything else goes through the bus
+		if( ( CPU->pc & 0x7f800000 ) == 0 )
+			CPU->op = FROM_LE32( ctx->psx_ram[ ( CPU->pc & 0x1fffff ) >> 2 ] );
+		else
+			CPU->op = cpu_readop32( CPU->pc );
+
+		dispatch = mips_decode( CPU->op );
 
 #if 0
-		while (mipscpu.prevpc == mipscpu.pc)
+		while (CPU->prevpc == CPU->pc)
 		{
 			psx_hw_runcounters();
-			mips_ICount--;
+			CPU->icount--;
 
-			if (mips_ICount == 0) return cycles;
+			if (CPU->icount == 0) return cycles;
 		}
 #endif
 
 		// if we're not in a delay slot, update
 		// if we're in a delay slot and the delay instruction is not NOP, update
-		if (( mipscpu.delayr == 0 ) || ((mipscpu.delayr != 0) && (mipscpu.op != 0)))
+		if (( CPU->delayr == 0 ) || ((CPU->delayr != 0) && (CPU->op != 0)))
 		{
-			mipscpu.prevpc = mipscpu.pc;
+			CPU->prevpc = CPU->pc;
 		}
 #if 0
 		if (1) //psxcpu_verbose)
 		{
-			printf("[%08x: %08x] [SP %08x RA %08x V0 %08x V1 %08x A0 %08x S0 %08x S1 %08x]\n", mipscpu.pc, mipscpu.op, mipscpu.r[29], mipscpu.r[31], mipscpu.r[2], mipscpu.r[3], mipscpu.r[4], mipscpu.r[ 16 ], mipscpu.r[ 17 ]);
+			printf("[%08x: %08x] [SP %08x RA %08x V0 %08x V1 %08x A0 %08x S0 %08x S1 %08x]\n", CPU->pc, CPU->op, CPU->r[29], CPU->r[31], CPU->r[2], CPU->r[3], CPU->r[4], CPU->r[ 16 ], CPU->r[ 17 ]);
 //			psxcpu_verbose--;
 		}
 #endif
-		switch( INS_OP( mipscpu.op ) )
+		switch( dispatch )
 		{
-		case OP_SPECIAL:
-			switch( INS_FUNCT( mipscpu.op ) )
-			{
-			case FUNCT_HLECALL:
-//				printf("HLECALL, PC = %08x\n", mipscpu.pc);
-				psx_bios_hle(mipscpu.pc);
-				break;
-			case FUNCT_SLL:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RT( mipscpu.op ) ] << INS_SHAMT( mipscpu.op ) );
-				break;
-			case FUNCT_SRL:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RT( mipscpu.op ) ] >> INS_SHAMT( mipscpu.op ) );
-				break;
-			case FUNCT_SRA:
-				mips_load( INS_RD( mipscpu.op ), (int32_t)mipscpu.r[ INS_RT( mipscpu.op ) ] >> INS_SHAMT( mipscpu.op ) );
-				break;
-			case FUNCT_SLLV:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RT( mipscpu.op ) ] << ( mipscpu.r[ INS_RS( mipscpu.op ) ] & 31 ) );
-				break;
-			case FUNCT_SRLV:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RT( mipscpu.op ) ] >> ( mipscpu.r[ INS_RS( mipscpu.op ) ] & 31 ) );
-				break;
-			case FUNCT_SRAV:
-				mips_load( INS_RD( mipscpu.op ), (int32_t)mipscpu.r[ INS_RT( mipscpu.op ) ] >> ( mipscpu.r[ INS_RS( mipscpu.op ) ] & 31 ) );
-				break;
-			case FUNCT_JR:
-				if( INS_RD( mipscpu.op ) != 0 )
-				{
-					mips_exception( EXC_RI );
-				}
-				else
-				{
-					mips_delayed_branch( mipscpu.r[ INS_RS( mipscpu.op ) ] );
-				}
-				break;
-			case FUNCT_JALR:
-				n_res = mipscpu.pc + 8;
-				mips_delayed_branch( mipscpu.r[ INS_RS( mipscpu.op ) ] );
-				if( INS_RD( mipscpu.op ) != 0 )
-				{
-					mipscpu.r[ INS_RD( mipscpu.op ) ] = n_res;
-				}
-				break;
-			case FUNCT_SYSCALL:
-				mips_exception( EXC_SYS );
-				break;
-			case FUNCT_BREAK:
-				printf("BREAK!\n");
-				exit(-1);
+		case DEC_SPECIAL + FUNCT_HLECALL:
+//				printf("HLECALL, PC = %08x\n", CPU->pc);
+			psx_bios_hle(CPU->pc);
+			break;
+		case DEC_SPECIAL + FUNCT_SLL:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RT( CPU->op ) ] << INS_SHAMT( CPU->op ) );
+			break;
+		case DEC_SPECIAL + FUNCT_SRL:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RT( CPU->op ) ] >> INS_SHAMT( CPU->op ) );
+			break;
+		case DEC_SPECIAL + FUNCT_SRA:
+			mips_load( INS_RD( CPU->op ), (int32_t)CPU->r[ INS_RT( CPU->op ) ] >> INS_SHAMT( CPU->op ) );
+			break;
+		case DEC_SPECIAL + FUNCT_SLLV:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RT( CPU->op ) ] << ( CPU->r[ INS_RS( CPU->op ) ] & 31 ) );
+			break;
+		case DEC_SPECIAL + FUNCT_SRLV:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RT( CPU->op ) ] >> ( CPU->r[ INS_RS( CPU->op ) ] & 31 ) );
+			break;
+		case DEC_SPECIAL + FUNCT_SRAV:
+			mips_load( INS_RD( CPU->op ), (int32_t)CPU->r[ INS_RT( CPU->op ) ] >> ( CPU->r[ INS_RS( CPU->op ) ] & 31 ) );
+			break;
+		case DEC_SPECIAL + FUNCT_JR:
+			if( INS_RD( CPU->op ) != 0 )
+			{
+				mips_exception( EXC_RI );
+			}
+			else
+			{
+				mips_delayed_branch( CPU->r[ INS_RS( CPU->op ) ] );
+			}
+			break;
+		case DEC_SPECIAL + FUNCT_JALR:
+			n_res = CPU->pc + 8;
+			mips_delayed_branch( CPU->r[ INS_RS( CPU->op ) ] );
+			if( INS_RD( CPU->op ) != 0 )
+			{
+				CPU->r[ INS_RD( CPU->op ) ] = n_res;
+			}
+			break;
+		case DEC_SPECIAL + FUNCT_SYSCALL:
+			mips_exception( EXC_SYS );
+			break;
+		case DEC_SPECIAL + FUNCT_BREAK:
+			printf("BREAK!\n");
+			exit(-1);
 //				mips_exception( EXC_BP );
+			mips_advance_pc();
+			break;
+		case DEC_SPECIAL + FUNCT_MFHI:
+			mips_load( INS_RD( CPU->op ), CPU->hi );
+			break;
+		case DEC_SPECIAL + FUNCT_MTHI:
+			if( INS_RD( CPU->op ) != 0 )
+			{
+				mips_exception( EXC_RI );
+			}
+			else
+			{
 				mips_advance_pc();
-				break;
-			case FUNCT_MFHI:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.hi );
-				break;
-			case FUNCT_MTHI:
-				if( INS_RD( mipscpu.op ) != 0 )
-				{
-					mips_exception( EXC_RI );
-				}
-				else
+				CPU->hi = CPU->r[ INS_RS( CPU->op ) ];
+			}
+			break;
+		case DEC_SPECIAL + FUNCT_MFLO:
+			mips_load( INS_RD( CPU->op ),  CPU->lo );
+			break;
+		case DEC_SPECIAL + FUNCT_MTLO:
+			if( INS_RD( CPU->op ) != 0 )
+			{
+				mips_exception( EXC_RI );
+			}
+			else
+			{
+				mips_advance_pc();
+				CPU->lo = CPU->r[ INS_RS( CPU->op ) ];
+			}
+			break;
+		case DEC_SPECIAL + FUNCT_MULT:
+			if( INS_RD( CPU->op ) != 0 )
+			{
+				mips_exception( EXC_RI );
+			}
+			else
+			{
+				int64_t n_res64;
+				n_res64 = MUL_64_32_32( (int32_t)CPU->r[ INS_RS( CPU->op ) ], (int32_t)CPU->r[ INS_RT( CPU->op ) ] );
+				mips_advance_pc();
+				CPU->lo = LO32_32_64( n_res64 );
+				CPU->hi = HI32_32_64( n_res64 );
+			}
+			break;
+		case DEC_SPECIAL + FUNCT_MULTU:
+			if( INS_RD( CPU->op ) != 0 )
+			{
+				mips_exception( EXC_RI );
+			}
+			else
+			{
+				uint64_t n_res64;
+				n_res64 = MUL_U64_U32_U32( CPU->r[ INS_RS( CPU->op ) ], CPU->r[ INS_RT( CPU->op ) ] );
+				mips_advance_pc();
+				CPU->lo = LO32_U32_U64( n_res64 );
+				CPU->hi = HI32_U32_U64( n_res64 );
+			}
+			break;
+		case DEC_SPECIAL + FUNCT_DIV:
+			if( INS_RD( CPU->op ) != 0 )
+			{
+				mips_exception( EXC_RI );
+			}
+			else
+			{
+				uint32_t n_div;
+				uint32_t n_mod;
+				if( CPU->r[ INS_RT( CPU->op ) ] != 0 )
 				{
+					n_div = (int32_t)CPU->r[ INS_RS( CPU->op ) ] / (int32_t)CPU->r[ INS_RT( CPU->op ) ];
+					n_mod = (int32_t)CPU->r[ INS_RS( CPU->op ) ] % (int32_t)CPU->r[ INS_RT( CPU->op ) ];
 					mips_advance_pc();
-					mipscpu.hi = mipscpu.r[ INS_RS( mipscpu.op ) ];
-				}
-				break;
-			case FUNCT_MFLO:
-				mips_load( INS_RD( mipscpu.op ),  mipscpu.lo );
-				break;
-			case FUNCT_MTLO:
-				if( INS_RD( mipscpu.op ) != 0 )
-				{
-					mips_exception( EXC_RI );
+					CPU->lo = n_div;
+					CPU->hi = n_mod;
 				}
 				else
 				{
 					mips_advance_pc();
-					mipscpu.lo = mipscpu.r[ INS_RS( mipscpu.op ) ];
-				}
-				break;
-			case FUNCT_MULT:
-				if( INS_RD( mipscpu.op ) != 0 )
-				{
-					mips_exception( EXC_RI );
 				}
-				else
+			}
+			break;
+		case DEC_SPECIAL + FUNCT_DIVU:
+			if( INS_RD( CPU->op ) != 0 )
+			{
+				mips_exception( EXC_RI );
+			}
+			else
+			{
+				uint32_t n_div;
+				uint32_t n_mod;
+				if( CPU->r[ INS_RT( CPU->op ) ] != 0 )
 				{
-					int64_t n_res64;
-					n_res64 = MUL_64_32_32( (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ], (int32_t)mipscpu.r[ INS_RT( mipscpu.op ) ] );
+					n_div = CPU->r[ INS_RS( CPU->op ) ] / CPU->r[ INS_RT( CPU->op ) ];
+					n_mod = CPU->r[ INS_RS( CPU->op ) ] % CPU->r[ INS_RT( CPU->op ) ];
 					mips_advance_pc();
-					mipscpu.lo = LO32_32_64( n_res64 );
-					mipscpu.hi = HI32_32_64( n_res64 );
-				}
-				break;
-			case FUNCT_MULTU:
-				if( INS_RD( mipscpu.op ) != 0 )
-				{
-					mips_exception( EXC_RI );
+					CPU->lo = n_div;
+					CPU->hi = n_mod;
 				}
 				else
 				{
-					uint64_t n_res64;
-					n_res64 = MUL_U64_U32_U32( mipscpu.r[ INS_RS( mipscpu.op ) ], mipscpu.r[ INS_RT( mipscpu.op ) ] );
 					mips_advance_pc();
-					mipscpu.lo = LO32_U32_U64( n_res64 );
-					mipscpu.hi = HI32_U32_U64( n_res64 );
 				}
-				break;
-			case FUNCT_DIV:
-				if( INS_RD( mipscpu.op ) != 0 )
-				{
-					mips_exception( EXC_RI );
-				}
-				else
-				{
-					uint32_t n_div;
-					uint32_t n_mod;
-					if( mipscpu.r[ INS_RT( mipscpu.op ) ] != 0 )
-					{
-						n_div = (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] / (int32_t)mipscpu.r[ INS_RT( mipscpu.op ) ];
-						n_mod = (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] % (int32_t)mipscpu.r[ INS_RT( mipscpu.op ) ];
-						mips_advance_pc();
-						mipscpu.lo = n_div;
-						mipscpu.hi = n_mod;
-					}
-					else
-					{
-						mips_advance_pc();
-					}
-				}
-				break;
-			case FUNCT_DIVU:
-				if( INS_RD( mipscpu.op ) != 0 )
-				{
-					mips_exception( EXC_RI );
-				}
-				else
-				{
-					uint32_t n_div;
-					uint32_t n_mod;
-					if( mipscpu.r[ INS_RT( mipscpu.op ) ] != 0 )
-					{
-						n_div = mipscpu.r[ INS_RS( mipscpu.op ) ] / mipscpu.r[ INS_RT( mipscpu.op ) ];
-						n_mod = mipscpu.r[ INS_RS( mipscpu.op ) ] % mipscpu.r[ INS_RT( mipscpu.op ) ];
-						mips_advance_pc();
-						mipscpu.lo = n_div;
-						mipscpu.hi = n_mod;
-					}
-					else
-					{
-						mips_advance_pc();
-					}
-				}
-				break;
-			case FUNCT_ADD:
-				{
-					n_res = mipscpu.r[ INS_RS( mipscpu.op ) ] + mipscpu.r[ INS_RT( mipscpu.op ) ];
-					if( (int32_t)( ~( mipscpu.r[ INS_RS( mipscpu.op ) ] ^ mipscpu.r[ INS_RT( mipscpu.op ) ] ) & ( mipscpu.r[ INS_RS( mipscpu.op ) ] ^ n_res ) ) < 0 )
-					{
-						mips_exception( EXC_OVF );
-					}
-					else
-					{
-						mips_load( INS_RD( mipscpu.op ), n_res );
-					}
-				}
-				break;
-			case FUNCT_ADDU:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] + mipscpu.r[ INS_RT( mipscpu.op ) ] );
-				break;
-			case FUNCT_SUB:
-				n_res = mipscpu.r[ INS_RS( mipscpu.op ) ] - mipscpu.r[ INS_RT( mipscpu.op ) ];
-				if( (int32_t)( ( mipscpu.r[ INS_RS( mipscpu.op ) ] ^ mipscpu.r[ INS_RT( mipscpu.op ) ] ) & ( mipscpu.r[ INS_RS( mipscpu.op ) ] ^ n_res ) ) < 0 )
+			}
+			break;
+		case DEC_SPECIAL + FUNCT_ADD:
+			{
+				n_res = CPU->r[ INS_RS( CPU->op ) ] + CPU->r[ INS_RT( CPU->op ) ];
+				if( (int32_t)( ~( CPU->r[ INS_RS( CPU->op ) ] ^ CPU->r[ INS_RT( CPU->op ) ] ) & ( CPU->r[ INS_RS( CPU->op ) ] ^ n_res ) ) < 0 )
 				{
 					mips_exception( EXC_OVF );
 				}
 				else
 				{
-					mips_load( INS_RD( mipscpu.op ), n_res );
+					mips_load( INS_RD( CPU->op ), n_res );
 				}
-				break;
-			case FUNCT_SUBU:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] - mipscpu.r[ INS_RT( mipscpu.op ) ] );
-				break;
-			case FUNCT_AND:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] & mipscpu.r[ INS_RT( mipscpu.op ) ] );
-				break;
-			case FUNCT_OR:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] | mipscpu.r[ INS_RT( mipscpu.op ) ] );
-				break;
-			case FUNCT_XOR:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] ^ mipscpu.r[ INS_RT( mipscpu.op ) ] );
-				break;
-			case FUNCT_NOR:
-				mips_load( INS_RD( mipscpu.op ), ~( mipscpu.r[ INS_RS( mipscpu.op ) ] | mipscpu.r[ INS_RT( mipscpu.op ) ] ) );
-				break;
-			case FUNCT_SLT:
-				mips_load( INS_RD( mipscpu.op ), (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] < (int32_t)mipscpu.r[ INS_RT( mipscpu.op ) ] );
-				break;
-			case FUNCT_SLTU:
-				mips_load( INS_RD( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] < mipscpu.r[ INS_RT( mipscpu.op ) ] );
-				break;
-			default:
-				mips_exception( EXC_RI );
-				break;
 			}
 			break;
-		case OP_REGIMM:
-			switch( INS_RT( mipscpu.op ) )
+		case DEC_SPECIAL + FUNCT_ADDU:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] + CPU->r[ INS_RT( CPU->op ) ] );
+			break;
+		case DEC_SPECIAL + FUNCT_SUB:
+			n_res = CPU->r[ INS_RS( CPU->op ) ] - CPU->r[ INS_RT( CPU->op ) ];
+			if( (int32_t)( ( CPU->r[ INS_RS( CPU->op ) ] ^ CPU->r[ INS_RT( CPU->op ) ] ) & ( CPU->r[ INS_RS( CPU->op ) ] ^ n_res ) ) < 0 )
 			{
-			case RT_BLTZ:
-				if( (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] < 0 )
-				{
-					mips_delayed_branch( mipscpu.pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) << 2 ) );
-				}
-				else
-				{
-					mips_advance_pc();
-				}
-				break;
-			case RT_BGEZ:
-				if( (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] >= 0 )
-				{
-					mips_delayed_branch( mipscpu.pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) << 2 ) );
-				}
-				else
-				{
-					mips_advance_pc();
-				}
-				break;
-			case RT_BLTZAL:
-				n_res = mipscpu.pc + 8;
-				if( (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] < 0 )
-				{
-					mips_delayed_branch( mipscpu.pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) << 2 ) );
-				}
-				else
-				{
-					mips_advance_pc();
-				}
-				mipscpu.r[ 31 ] = n_res;
-				break;
-			case RT_BGEZAL:
-				n_res = mipscpu.pc + 8;
-				if( (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] >= 0 )
-				{
-					mips_delayed_branch( mipscpu.pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) << 2 ) );
-				}
-				else
-				{
-					mips_advance_pc();
-				}
-				mipscpu.r[ 31 ] = n_res;
-				break;
+				mips_exception( EXC_OVF );
+			}
+			else
+			{
+				mips_load( INS_RD( CPU->op ), n_res );
 			}
 			break;
-		case OP_J:
-			mips_delayed_branch( ( ( mipscpu.pc + 4 ) & 0xf0000000 ) + ( INS_TARGET( mipscpu.op ) << 2 ) );
+		case DEC_SPECIAL + FUNCT_SUBU:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] - CPU->r[ INS_RT( CPU->op ) ] );
 			break;
-		case OP_JAL:
-			n_res = mipscpu.pc + 8;
-			mips_delayed_branch( ( ( mipscpu.pc + 4 ) & 0xf0000000 ) + ( INS_TARGET( mipscpu.op ) << 2 ) );
-			mipscpu.r[ 31 ] = n_res;
+		case DEC_SPECIAL + FUNCT_AND:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] & CPU->r[ INS_RT( CPU->op ) ] );
 			break;
-		case OP_BEQ:
-			if( mipscpu.r[ INS_RS( mipscpu.op ) ] == mipscpu.r[ INS_RT( mipscpu.op ) ] )
+		case DEC_SPECIAL + FUNCT_OR:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] | CPU->r[ INS_RT( CPU->op ) ] );
+			break;
+		case DEC_SPECIAL + FUNCT_XOR:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] ^ CPU->r[ INS_RT( CPU->op ) ] );
+			break;
+		case DEC_SPECIAL + FUNCT_NOR:
+			mips_load( INS_RD( CPU->op ), ~( CPU->r[ INS_RS( CPU->op ) ] | CPU->r[ INS_RT( CPU->op ) ] ) );
+			break;
+		case DEC_SPECIAL + FUNCT_SLT:
+			mips_load( INS_RD( CPU->op ), (int32_t)CPU->r[ INS_RS( CPU->op ) ] < (int32_t)CPU->r[ INS_RT( CPU->op ) ] );
+			break;
+		case DEC_SPECIAL + FUNCT_SLTU:
+			mips_load( INS_RD( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] < CPU->r[ INS_RT( CPU->op ) ] );
+			break;
+		case DEC_SPECIAL_RI:
+			mips_exception( EXC_RI );
+			break;
+		case DEC_REGIMM + RT_BLTZ:
+			if( (int32_t)CPU->r[ INS_RS( CPU->op ) ] < 0 )
 			{
-				mips_delayed_branch( mipscpu.pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) << 2 ) );
+				mips_delayed_branch( CPU->pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) << 2 ) );
 			}
 			else
 			{
 				mips_advance_pc();
 			}
 			break;
-		case OP_BNE:
-			if( mipscpu.r[ INS_RS( mipscpu.op ) ] != mipscpu.r[ INS_RT( mipscpu.op ) ] )
+		case DEC_REGIMM + RT_BGEZ:
+			if( (int32_t)CPU->r[ INS_RS( CPU->op ) ] >= 0 )
 			{
-				mips_delayed_branch( mipscpu.pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) << 2 ) );
+				mips_delayed_branch( CPU->pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) << 2 ) );
 			}
 			else
 			{
 				mips_advance_pc();
 			}
 			break;
-		case OP_BLEZ:
-			if( INS_RT( mipscpu.op ) != 0 )
+		case DEC_REGIMM + RT_BLTZAL:
+			n_res = CPU->pc + 8;
+			if( (int32_t)CPU->r[ INS_RS( CPU->op ) ] < 0 )
+			{
+				mips_delayed_branch( CPU->pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) << 2 ) );
+			}
+			else
+			{
+				mips_advance_pc();
+			}
+			CPU->r[ 31 ] = n_res;
+			break;
+		case DEC_REGIMM + RT_BGEZAL:
+			n_res = CPU->pc + 8;
+			if( (int32_t)CPU->r[ INS_RS( CPU->op ) ] >= 0 )
+			{
+				mips_delayed_branch( CPU->pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) << 2 ) );
+			}
+			else
+			{
+				mips_advance_pc();
+			}
+			CPU->r[ 31 ] = n_res;
+			break;
+		case DEC_REGIMM_NONE:
+			break;
+		case DEC_OP + OP_J:
+			mips_delayed_branch( ( ( CPU->pc + 4 ) & 0xf0000000 ) + ( INS_TARGET( CPU->op ) << 2 ) );
+			break;
+		case DEC_OP + OP_JAL:
+			n_res = CPU->pc + 8;
+			mips_delayed_branch( ( ( CPU->pc + 4 ) & 0xf0000000 ) + ( INS_TARGET( CPU->op ) << 2 ) );
+			CPU->r[ 31 ] = n_res;
+			break;
+		case DEC_OP + OP_BEQ:
+			if( CPU->r[ INS_RS( CPU->op ) ] == CPU->r[ INS_RT( CPU->op ) ] )
+			{
+				mips_delayed_branch( CPU->pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) << 2 ) );
+			}
+			else
+			{
+				mips_advance_pc();
+			}
+			break;
+		case DEC_OP + OP_BNE:
+			if( CPU->r[ INS_RS( CPU->op ) ] != CPU->r[ INS_RT( CPU->op ) ] )
+			{
+				mips_delayed_branch( CPU->pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) << 2 ) );
+			}
+			else
+			{
+				mips_advance_pc();
+			}
+			break;
+		case DEC_OP + OP_BLEZ:
+			if( INS_RT( CPU->op ) != 0 )
 			{
 				mips_exception( EXC_RI );
 			}
-			else if( (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] <= 0 )
+			else if( (int32_t)CPU->r[ INS_RS( CPU->op ) ] <= 0 )
 			{
-				mips_delayed_branch( mipscpu.pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) << 2 ) );
+				mips_delayed_branch( CPU->pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) << 2 ) );
 			}
 			else
 			{
 				mips_advance_pc();
 			}
 			break;
-		case OP_BGTZ:
-			if( INS_RT( mipscpu.op ) != 0 )
+		case DEC_OP + OP_BGTZ:
+			if( INS_RT( CPU->op ) != 0 )
 			{
 				mips_exception( EXC_RI );
 			}
-			else if( (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] > 0 )
+			else if( (int32_t)CPU->r[ INS_RS( CPU->op ) ] > 0 )
 			{
-				mips_delayed_branch( mipscpu.pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) << 2 ) );
+				mips_delayed_branch( CPU->pc + 4 + ( MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) << 2 ) );
 			}
 			else
 			{
 				mips_advance_pc();
 			}
 			break;
-		case OP_ADDI:
+		case DEC_OP + OP_ADDI:
 			{
 				uint32_t n_imm;
-				n_imm = MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				n_res = mipscpu.r[ INS_RS( mipscpu.op ) ] + n_imm;
-				if( (int32_t)( ~( mipscpu.r[ INS_RS( mipscpu.op ) ] ^ n_imm ) & ( mipscpu.r[ INS_RS( mipscpu.op ) ] ^ n_res ) ) < 0 )
+				n_imm = MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				n_res = CPU->r[ INS_RS( CPU->op ) ] + n_imm;
+				if( (int32_t)( ~( CPU->r[ INS_RS( CPU->op ) ] ^ n_imm ) & ( CPU->r[ INS_RS( CPU->op ) ] ^ n_res ) ) < 0 )
 				{
 					mips_exception( EXC_OVF );
 				}
 				else
 				{
-					mips_load( INS_RT( mipscpu.op ), n_res );
+					mips_load( INS_RT( CPU->op ), n_res );
 				}
 			}
 			break;
-		case OP_ADDIU:
-			if (INS_RT( mipscpu.op ) == 0)
+		case DEC_OP + OP_ADDIU:
+			if (INS_RT( CPU->op ) == 0)
 			{
-				psx_iop_call(mipscpu.pc, INS_IMMEDIATE(mipscpu.op));
+				psx_iop_call(CPU->pc, INS_IMMEDIATE(CPU->op));
 				mips_advance_pc();
 			}
 			else
 			{
-				mips_load( INS_RT( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) );
+				mips_load( INS_RT( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) );
 			}
 			break;
-		case OP_SLTI:
-			mips_load( INS_RT( mipscpu.op ), (int32_t)mipscpu.r[ INS_RS( mipscpu.op ) ] < MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) );
+		case DEC_OP + OP_SLTI:
+			mips_load( INS_RT( CPU->op ), (int32_t)CPU->r[ INS_RS( CPU->op ) ] < MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) );
 			break;
-		case OP_SLTIU:
-			mips_load( INS_RT( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] < (uint32_t)MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) ) );
+		case DEC_OP + OP_SLTIU:
+			mips_load( INS_RT( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] < (uint32_t)MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) ) );
 			break;
-		case OP_ANDI:
-			mips_load( INS_RT( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] & INS_IMMEDIATE( mipscpu.op ) );
+		case DEC_OP + OP_ANDI:
+			mips_load( INS_RT( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] & INS_IMMEDIATE( CPU->op ) );
 			break;
-		case OP_ORI:
-			mips_load( INS_RT( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] | INS_IMMEDIATE( mipscpu.op ) );
+		case DEC_OP + OP_ORI:
+			mips_load( INS_RT( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] | INS_IMMEDIATE( CPU->op ) );
 			break;
-		case OP_XORI:
-			mips_load( INS_RT( mipscpu.op ), mipscpu.r[ INS_RS( mipscpu.op ) ] ^ INS_IMMEDIATE( mipscpu.op ) );
+		case DEC_OP + OP_XORI:
+			mips_load( INS_RT( CPU->op ), CPU->r[ INS_RS( CPU->op ) ] ^ INS_IMMEDIATE( CPU->op ) );
 			break;
-		case OP_LUI:
-			mips_load( INS_RT( mipscpu.op ), INS_IMMEDIATE( mipscpu.op ) << 16 );
+		case DEC_OP + OP_LUI:
+			mips_load( INS_RT( CPU->op ), INS_IMMEDIATE( CPU->op ) << 16 );
 			break;
-		case OP_COP0:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) != 0 && ( mipscpu.cp0r[ CP0_SR ] & SR_CU0 ) == 0 )
+		case DEC_OP + OP_COP0:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) != 0 && ( CPU->cp0r[ CP0_SR ] & SR_CU0 ) == 0 )
 			{
 				mips_exception( EXC_CPU );
-				mips_set_cp0r( CP0_CAUSE, ( mipscpu.cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE0 );
+				mips_set_cp0r( CP0_CAUSE, ( CPU->cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE0 );
 			}
 			else
 			{
-				switch( INS_RS( mipscpu.op ) )
+				switch( INS_RS( CPU->op ) )
 				{
 				case RS_MFC:
-					mips_delayed_load( INS_RT( mipscpu.op ), mipscpu.cp0r[ INS_RD( mipscpu.op ) ] );
+					mips_delayed_load( INS_RT( CPU->op ), CPU->cp0r[ INS_RD( CPU->op ) ] );
 					break;
 				case RS_CFC:
 					/* todo: */
-					logerror( "%08x: COP0 CFC not supported\n", mipscpu.pc );
+					logerror( "%08x: COP0 CFC not supported\n", CPU->pc );
 					mips_stop();
 					mips_advance_pc();
 					break;
 				case RS_MTC:
-					n_res = ( mipscpu.cp0r[ INS_RD( mipscpu.op ) ] & ~mips_mtc0_writemask[ INS_RD( mipscpu.op ) ] ) |
-						( mipscpu.r[ INS_RT( mipscpu.op ) ] & mips_mtc0_writemask[ INS_RD( mipscpu.op ) ] );
+					n_res = ( CPU->cp0r[ INS_RD( CPU->op ) ] & ~mips_mtc0_writemask[ INS_RD( CPU->op ) ] ) |
+						( CPU->r[ INS_RT( CPU->op ) ] & mips_mtc0_writemask[ INS_RD( CPU->op ) ] );
 					mips_advance_pc();
-					mips_set_cp0r( INS_RD( mipscpu.op ), n_res );
+					mips_set_cp0r( INS_RD( CPU->op ), n_res );
 					break;
 				case RS_CTC:
 					/* todo: */
-					logerror( "%08x: COP0 CTC not supported\n", mipscpu.pc );
+					logerror( "%08x: COP0 CTC not supported\n", CPU->pc );
 					mips_stop();
 					mips_advance_pc();
 					break;
 				case RS_BC:
-					switch( INS_RT( mipscpu.op ) )
+					switch( INS_RT( CPU->op ) )
 					{
 					case RT_BCF:
 						/* todo: */
-						logerror( "%08x: COP0 BCF not supported\n", mipscpu.pc );
+						logerror( "%08x: COP0 BCF not supported\n", CPU->pc );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					case RT_BCT:
 						/* todo: */
-						logerror( "%08x: COP0 BCT not supported\n", mipscpu.pc );
+						logerror( "%08x: COP0 BCT not supported\n", CPU->pc );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					default:
 						/* todo: */
-						logerror( "%08x: COP0 unknown command %08x\n", mipscpu.pc, mipscpu.op );
+						logerror( "%08x: COP0 unknown command %08x\n", CPU->pc, CPU->op );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					}
 					break;
 				default:
-					switch( INS_CO( mipscpu.op ) )
+					switch( INS_CO( CPU->op ) )
 					{
 					case 1:
-						switch( INS_CF( mipscpu.op ) )
+						switch( INS_CF( CPU->op ) )
 						{
 						case CF_RFE:
 							mips_advance_pc();
-							mips_set_cp0r( CP0_SR, ( mipscpu.cp0r[ CP0_SR ] & ~0xf ) | ( ( mipscpu.cp0r[ CP0_SR ] >> 2 ) & 0xf ) );
+							mips_set_cp0r( CP0_SR, ( CPU->cp0r[ CP0_SR ] & ~0xf ) | ( ( CPU->cp0r[ CP0_SR ] >> 2 ) & 0xf ) );
 							break;
 						default:
 							/* todo: */
-							logerror( "%08x: COP0 unknown command %08x\n", mipscpu.pc, mipscpu.op );
+							logerror( "%08x: COP0 unknown command %08x\n", CPU->pc, CPU->op );
 							mips_stop();
 							mips_advance_pc();
 							break;
@@ -866,7 +952,7 @@ int mips_execute( int cycles )
 						break;
 					default:
 						/* todo: */
-						logerror( "%08x: COP0 unknown command %08x\n", mipscpu.pc, mipscpu.op );
+						logerror( "%08x: COP0 unknown command %08x\n", CPU->pc, CPU->op );
 						mips_stop();
 						mips_advance_pc();
 						break;
@@ -875,75 +961,75 @@ int mips_execute( int cycles )
 				}
 			}
 			break;
-		case OP_COP1:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_CU1 ) == 0 )
+		case DEC_OP + OP_COP1:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_CU1 ) == 0 )
 			{
 				mips_exception( EXC_CPU );
-				mips_set_cp0r( CP0_CAUSE, ( mipscpu.cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE1 );
+				mips_set_cp0r( CP0_CAUSE, ( CPU->cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE1 );
 			}
 			else
 			{
-				switch( INS_RS( mipscpu.op ) )
+				switch( INS_RS( CPU->op ) )
 				{
 				case RS_MFC:
 					/* todo: */
-					logerror( "%08x: COP1 BCT not supported\n", mipscpu.pc );
+					logerror( "%08x: COP1 BCT not supported\n", CPU->pc );
 					mips_stop();
 					mips_advance_pc();
 					break;
 				case RS_CFC:
 					/* todo: */
-					logerror( "%08x: COP1 CFC not supported\n", mipscpu.pc );
+					logerror( "%08x: COP1 CFC not supported\n", CPU->pc );
 					mips_stop();
 					mips_advance_pc();
 					break;
 				case RS_MTC:
 					/* todo: */
-					logerror( "%08x: COP1 MTC not supported\n", mipscpu.pc );
+					logerror( "%08x: COP1 MTC not supported\n", CPU->pc );
 					mips_stop();
 					mips_advance_pc();
 					break;
 				case RS_CTC:
 					/* todo: */
-					logerror( "%08x: COP1 CTC not supported\n", mipscpu.pc );
+					logerror( "%08x: COP1 CTC not supported\n", CPU->pc );
 					mips_stop();
 					mips_advance_pc();
 					break;
 				case RS_BC:
-					switch( INS_RT( mipscpu.op ) )
+					switch( INS_RT( CPU->op ) )
 					{
 					case RT_BCF:
 						/* todo: */
-						logerror( "%08x: COP1 BCF not supported\n", mipscpu.pc );
+						logerror( "%08x: COP1 BCF not supported\n", CPU->pc );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					case RT_BCT:
 						/* todo: */
-						logerror( "%08x: COP1 BCT not supported\n", mipscpu.pc );
+						logerror( "%08x: COP1 BCT not supported\n", CPU->pc );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					default:
 						/* todo: */
-						logerror( "%08x: COP1 unknown command %08x\n", mipscpu.pc, mipscpu.op );
+						logerror( "%08x: COP1 unknown command %08x\n", CPU->pc, CPU->op );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					}
 					break;
 				default:
-					switch( INS_CO( mipscpu.op ) )
+					switch( INS_CO( CPU->op ) )
 					{
 					case 1:
 						/* todo: */
-						logerror( "%08x: COP1 unknown command %08x\n", mipscpu.pc, mipscpu.op );
+						logerror( "%08x: COP1 unknown command %08x\n", CPU->pc, CPU->op );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					default:
 						/* todo: */
-						logerror( "%08x: COP1 unknown command %08x\n", mipscpu.pc, mipscpu.op );
+						logerror( "%08x: COP1 unknown command %08x\n", CPU->pc, CPU->op );
 						mips_stop();
 						mips_advance_pc();
 						break;
@@ -952,63 +1038,63 @@ int mips_execute( int cycles )
 				}
 			}
 			break;
-		case OP_COP2:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_CU2 ) == 0 )
+		case DEC_OP + OP_COP2:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_CU2 ) == 0 )
 			{
 				mips_exception( EXC_CPU );
-				mips_set_cp0r( CP0_CAUSE, ( mipscpu.cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE2 );
+				mips_set_cp0r( CP0_CAUSE, ( CPU->cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE2 );
 			}
 			else
 			{
-				switch( INS_RS( mipscpu.op ) )
+				switch( INS_RS( CPU->op ) )
 				{
 				case RS_MFC:
-					mips_delayed_load( INS_RT( mipscpu.op ), getcp2dr( INS_RD( mipscpu.op ) ) );
+					mips_delayed_load( INS_RT( CPU->op ), getcp2dr( INS_RD( CPU->op ) ) );
 					break;
 				case RS_CFC:
-					mips_delayed_load( INS_RT( mipscpu.op ), getcp2cr( INS_RD( mipscpu.op ) ) );
+					mips_delayed_load( INS_RT( CPU->op ), getcp2cr( INS_RD( CPU->op ) ) );
 					break;
 				case RS_MTC:
-					setcp2dr( INS_RD( mipscpu.op ), mipscpu.r[ INS_RT( mipscpu.op ) ] );
+					setcp2dr( INS_RD( CPU->op ), CPU->r[ INS_RT( CPU->op ) ] );
 					mips_advance_pc();
 					break;
 				case RS_CTC:
-					setcp2cr( INS_RD( mipscpu.op ), mipscpu.r[ INS_RT( mipscpu.op ) ] );
+					setcp2cr( INS_RD( CPU->op ), CPU->r[ INS_RT( CPU->op ) ] );
 					mips_advance_pc();
 					break;
 				case RS_BC:
-					switch( INS_RT( mipscpu.op ) )
+					switch( INS_RT( CPU->op ) )
 					{
 					case RT_BCF:
 						/* todo: */
-						logerror( "%08x: COP2 BCF not supported\n", mipscpu.pc );
+						logerror( "%08x: COP2 BCF not supported\n", CPU->pc );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					case RT_BCT:
 						/* todo: */
-						logerror( "%08x: COP2 BCT not supported\n", mipscpu.pc );
+						logerror( "%08x: COP2 BCT not supported\n", CPU->pc );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					default:
 						/* todo: */
-						logerror( "%08x: COP2 unknown command %08x\n", mipscpu.pc, mipscpu.op );
+						logerror( "%08x: COP2 unknown command %08x\n", CPU->pc, CPU->op );
 						mips_stop();
 						mips_advance_pc();
 						break;
 					}
 					break;
 				default:
-					switch( INS_CO( mipscpu.op ) )
+					switch( INS_CO( CPU->op ) )
 					{
 					case 1:
-						docop2( INS_COFUN( mipscpu.op ) );
+						docop2( INS_COFUN( CPU->op ) );
 						mips_advance_pc();
 						break;
 					default:
 						/* todo: */
-						logerror( "%08x: COP2 unknown command %08x\n", mipscpu.pc, mipscpu.op );
+						logerror( "%08x: COP2 unknown command %08x\n", CPU->pc, CPU->op );
 						mips_stop();
 						mips_advance_pc();
 						break;
@@ -1017,93 +1103,93 @@ int mips_execute( int cycles )
 				}
 			}
 			break;
-		case OP_LB:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_LB:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: LB SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: LB SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					mips_delayed_load( INS_RT( mipscpu.op ), MIPS_BYTE_EXTEND( program_read_byte_32le( n_adr ^ 3 ) ) );
+					mips_delayed_load( INS_RT( CPU->op ), MIPS_BYTE_EXTEND( program_read_byte_32le( n_adr ^ 3 ) ) );
 				}
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					mips_delayed_load( INS_RT( mipscpu.op ), MIPS_BYTE_EXTEND( program_read_byte_32le( n_adr ) ) );
+					mips_delayed_load( INS_RT( CPU->op ), MIPS_BYTE_EXTEND( program_read_byte_32le( n_adr ) ) );
 				}
 			}
 			break;
-		case OP_LH:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_LH:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: LH SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: LH SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					mips_delayed_load( INS_RT( mipscpu.op ), MIPS_WORD_EXTEND( program_read_word_32le( n_adr ^ 2 ) ) );
+					mips_delayed_load( INS_RT( CPU->op ), MIPS_WORD_EXTEND( program_read_word_32le( n_adr ^ 2 ) ) );
 				}
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					mips_delayed_load( INS_RT( mipscpu.op ), MIPS_WORD_EXTEND( program_read_word_32le( n_adr ) ) );
+					mips_delayed_load( INS_RT( CPU->op ), MIPS_WORD_EXTEND( program_read_word_32le( n_adr ) ) );
 				}
 			}
 			break;
-		case OP_LWL:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_LWL:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: LWL SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: LWL SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
@@ -1113,26 +1199,26 @@ int mips_execute( int cycles )
 					switch( n_adr & 3 )
 					{
 					case 0:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0x00ffffff ) | ( (uint32_t)program_read_byte_32le( n_adr + 3 ) << 24 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0x00ffffff ) | ( (uint32_t)program_read_byte_32le( n_adr + 3 ) << 24 );
 						break;
 					case 1:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0x0000ffff ) | ( (uint32_t)program_read_word_32le( n_adr + 1 ) << 16 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0x0000ffff ) | ( (uint32_t)program_read_word_32le( n_adr + 1 ) << 16 );
 						break;
 					case 2:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0x000000ff ) | ( (uint32_t)program_read_byte_32le( n_adr - 1 ) << 8 ) | ( (uint32_t)program_read_word_32le( n_adr ) << 16 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0x000000ff ) | ( (uint32_t)program_read_byte_32le( n_adr - 1 ) << 8 ) | ( (uint32_t)program_read_word_32le( n_adr ) << 16 );
 						break;
 					default:
 						n_res = program_read_dword_32le( n_adr - 3 );
 						break;
 					}
-					mips_delayed_load( INS_RT( mipscpu.op ), n_res );
+					mips_delayed_load( INS_RT( CPU->op ), n_res );
 				}
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
@@ -1142,36 +1228,36 @@ int mips_execute( int cycles )
 					switch( n_adr & 3 )
 					{
 					case 0:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0x00ffffff ) | ( (uint32_t)program_read_byte_32le( n_adr ) << 24 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0x00ffffff ) | ( (uint32_t)program_read_byte_32le( n_adr ) << 24 );
 						break;
 					case 1:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0x0000ffff ) | ( (uint32_t)program_read_word_32le( n_adr - 1 ) << 16 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0x0000ffff ) | ( (uint32_t)program_read_word_32le( n_adr - 1 ) << 16 );
 						break;
 					case 2:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0x000000ff ) | ( (uint32_t)program_read_word_32le( n_adr - 2 ) << 8 ) | ( (uint32_t)program_read_byte_32le( n_adr ) << 24 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0x000000ff ) | ( (uint32_t)program_read_word_32le( n_adr - 2 ) << 8 ) | ( (uint32_t)program_read_byte_32le( n_adr ) << 24 );
 						break;
 					default:
 						n_res = program_read_dword_32le( n_adr - 3 );
 						break;
 					}
-					mips_delayed_load( INS_RT( mipscpu.op ), n_res );
+					mips_delayed_load( INS_RT( CPU->op ), n_res );
 				}
 			}
 			break;
-		case OP_LW:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_LW:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: LW SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: LW SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
 #if 0
-				if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
+				if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
 				{
 					printf("ADEL\n");
 					mips_exception( EXC_ADEL );
@@ -1180,97 +1266,97 @@ int mips_execute( int cycles )
 				else
 #endif
 				{
-					mips_delayed_load( INS_RT( mipscpu.op ), program_read_dword_32le( n_adr ) );
+					mips_delayed_load( INS_RT( CPU->op ), program_read_dword_32le( n_adr ) );
 				}
 			}
 			break;
-		case OP_LBU:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_LBU:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: LBU SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: LBU SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					mips_delayed_load( INS_RT( mipscpu.op ), program_read_byte_32le( n_adr ^ 3 ) );
+					mips_delayed_load( INS_RT( CPU->op ), program_read_byte_32le( n_adr ^ 3 ) );
 				}
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					mips_delayed_load( INS_RT( mipscpu.op ), program_read_byte_32le( n_adr ) );
+					mips_delayed_load( INS_RT( CPU->op ), program_read_byte_32le( n_adr ) );
 				}
 			}
 			break;
-		case OP_LHU:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_LHU:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: LHU SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: LHU SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					mips_delayed_load( INS_RT( mipscpu.op ), program_read_word_32le( n_adr ^ 2 ) );
+					mips_delayed_load( INS_RT( CPU->op ), program_read_word_32le( n_adr ^ 2 ) );
 				}
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					mips_delayed_load( INS_RT( mipscpu.op ), program_read_word_32le( n_adr ) );
+					mips_delayed_load( INS_RT( CPU->op ), program_read_word_32le( n_adr ) );
 				}
 			}
 			break;
-		case OP_LWR:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_LWR:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: LWR SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: LWR SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
@@ -1280,26 +1366,26 @@ int mips_execute( int cycles )
 					switch( n_adr & 3 )
 					{
 					case 3:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0xffffff00 ) | program_read_byte_32le( n_adr - 3 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0xffffff00 ) | program_read_byte_32le( n_adr - 3 );
 						break;
 					case 2:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0xffff0000 ) | program_read_word_32le( n_adr - 2 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0xffff0000 ) | program_read_word_32le( n_adr - 2 );
 						break;
 					case 1:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0xff000000 ) | program_read_word_32le( n_adr - 1 ) | ( (uint32_t)program_read_byte_32le( n_adr + 1 ) << 16 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0xff000000 ) | program_read_word_32le( n_adr - 1 ) | ( (uint32_t)program_read_byte_32le( n_adr + 1 ) << 16 );
 						break;
 					default:
 						n_res = program_read_dword_32le( n_adr );
 						break;
 					}
-					mips_delayed_load( INS_RT( mipscpu.op ), n_res );
+					mips_delayed_load( INS_RT( CPU->op ), n_res );
 				}
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
@@ -1309,114 +1395,114 @@ int mips_execute( int cycles )
 					switch( n_adr & 3 )
 					{
 					case 3:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0xffffff00 ) | program_read_byte_32le( n_adr );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0xffffff00 ) | program_read_byte_32le( n_adr );
 						break;
 					case 2:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0xffff0000 ) | program_read_word_32le( n_adr );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0xffff0000 ) | program_read_word_32le( n_adr );
 						break;
 					case 1:
-						n_res = ( mipscpu.r[ INS_RT( mipscpu.op ) ] & 0xff000000 ) | program_read_byte_32le( n_adr ) | ( (uint32_t)program_read_word_32le( n_adr + 1 ) << 8 );
+						n_res = ( CPU->r[ INS_RT( CPU->op ) ] & 0xff000000 ) | program_read_byte_32le( n_adr ) | ( (uint32_t)program_read_word_32le( n_adr + 1 ) << 8 );
 						break;
 					default:
 						n_res = program_read_dword_32le( n_adr );
 						break;
 					}
-					mips_delayed_load( INS_RT( mipscpu.op ), n_res );
+					mips_delayed_load( INS_RT( CPU->op ), n_res );
 				}
 			}
 			break;
-		case OP_SB:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_SB:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: SB SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: SB SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADES );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					program_write_byte_32le( n_adr ^ 3, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+					program_write_byte_32le( n_adr ^ 3, CPU->r[ INS_RT( CPU->op ) ] );
 					mips_advance_pc();
 				}
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADES );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					program_write_byte_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+					program_write_byte_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] );
 					mips_advance_pc();
 				}
 			}
 			break;
-		case OP_SH:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_SH:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: SH SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: SH SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
 				{
 					mips_exception( EXC_ADES );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					program_write_word_32le( n_adr ^ 2, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+					program_write_word_32le( n_adr ^ 2, CPU->r[ INS_RT( CPU->op ) ] );
 					mips_advance_pc();
 				}
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 1 ) ) != 0 )
 				{
 					mips_exception( EXC_ADES );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					program_write_word_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+					program_write_word_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] );
 					mips_advance_pc();
 				}
 			}
 			break;
-		case OP_SWL:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_SWL:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
 				printf("SR_ISC not supported\n");
-				logerror( "%08x: SWL SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: SWL SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					printf("permission violation?\n");
 					mips_exception( EXC_ADES );
@@ -1427,17 +1513,17 @@ int mips_execute( int cycles )
 					switch( n_adr & 3 )
 					{
 					case 0:
-						program_write_byte_32le( n_adr + 3, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 24 );
+						program_write_byte_32le( n_adr + 3, CPU->r[ INS_RT( CPU->op ) ] >> 24 );
 						break;
 					case 1:
-						program_write_word_32le( n_adr + 1, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 16 );
+						program_write_word_32le( n_adr + 1, CPU->r[ INS_RT( CPU->op ) ] >> 16 );
 						break;
 					case 2:
-						program_write_byte_32le( n_adr - 1, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 8 );
-						program_write_word_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 16 );
+						program_write_byte_32le( n_adr - 1, CPU->r[ INS_RT( CPU->op ) ] >> 8 );
+						program_write_word_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] >> 16 );
 						break;
 					case 3:
-						program_write_dword_32le( n_adr - 3, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+						program_write_dword_32le( n_adr - 3, CPU->r[ INS_RT( CPU->op ) ] );
 						break;
 					}
 					mips_advance_pc();
@@ -1446,8 +1532,8 @@ int mips_execute( int cycles )
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					printf("permission violation 2\n");
 					mips_exception( EXC_ADES );
@@ -1458,29 +1544,29 @@ int mips_execute( int cycles )
 					switch( n_adr & 3 )
 					{
 					case 0:
-						program_write_byte_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 24 );
+						program_write_byte_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] >> 24 );
 						break;
 					case 1:
-						program_write_word_32le( n_adr - 1, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 16 );
+						program_write_word_32le( n_adr - 1, CPU->r[ INS_RT( CPU->op ) ] >> 16 );
 						break;
 					case 2:
-						program_write_word_32le( n_adr - 2, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 8 );
-						program_write_byte_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 24 );
+						program_write_word_32le( n_adr - 2, CPU->r[ INS_RT( CPU->op ) ] >> 8 );
+						program_write_byte_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] >> 24 );
 						break;
 					case 3:
-						program_write_dword_32le( n_adr - 3, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+						program_write_dword_32le( n_adr - 3, CPU->r[ INS_RT( CPU->op ) ] );
 						break;
 					}
 					mips_advance_pc();
 				}
 			}
 			break;
-		case OP_SW:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_SW:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
 /* used by bootstrap
-				logerror( "%08x: SW SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: SW SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 */
 				mips_advance_pc();
@@ -1488,32 +1574,32 @@ int mips_execute( int cycles )
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if(0) // ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if(0) // ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
 				{
 					mips_exception( EXC_ADES );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					program_write_dword_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+					program_write_dword_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] );
 					mips_advance_pc();
 				}
 			}
 			break;
-		case OP_SWR:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+		case DEC_OP + OP_SWR:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: SWR SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: SWR SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
+			else if( ( CPU->cp0r[ CP0_SR ] & ( SR_RE | SR_KUC ) ) == ( SR_RE | SR_KUC ) )
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADES );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
@@ -1523,17 +1609,17 @@ int mips_execute( int cycles )
 					switch( n_adr & 3 )
 					{
 					case 0:
-						program_write_dword_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+						program_write_dword_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] );
 						break;
 					case 1:
-						program_write_word_32le( n_adr - 1, mipscpu.r[ INS_RT( mipscpu.op ) ] );
-						program_write_byte_32le( n_adr + 1, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 16 );
+						program_write_word_32le( n_adr - 1, CPU->r[ INS_RT( CPU->op ) ] );
+						program_write_byte_32le( n_adr + 1, CPU->r[ INS_RT( CPU->op ) ] >> 16 );
 						break;
 					case 2:
-						program_write_word_32le( n_adr - 2, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+						program_write_word_32le( n_adr - 2, CPU->r[ INS_RT( CPU->op ) ] );
 						break;
 					case 3:
-						program_write_byte_32le( n_adr - 3, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+						program_write_byte_32le( n_adr - 3, CPU->r[ INS_RT( CPU->op ) ] );
 						break;
 					}
 					mips_advance_pc();
@@ -1542,8 +1628,8 @@ int mips_execute( int cycles )
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) ) != 0 )
 				{
 					mips_exception( EXC_ADES );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
@@ -1553,47 +1639,47 @@ int mips_execute( int cycles )
 					switch( n_adr & 3 )
 					{
 					case 0:
-						program_write_dword_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+						program_write_dword_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] );
 						break;
 					case 1:
-						program_write_byte_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] );
-						program_write_word_32le( n_adr + 1, mipscpu.r[ INS_RT( mipscpu.op ) ] >> 8 );
+						program_write_byte_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] );
+						program_write_word_32le( n_adr + 1, CPU->r[ INS_RT( CPU->op ) ] >> 8 );
 						break;
 					case 2:
-						program_write_word_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+						program_write_word_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] );
 						break;
 					case 3:
-						program_write_byte_32le( n_adr, mipscpu.r[ INS_RT( mipscpu.op ) ] );
+						program_write_byte_32le( n_adr, CPU->r[ INS_RT( CPU->op ) ] );
 						break;
 					}
 					mips_advance_pc();
 				}
 			}
 			break;
-		case OP_LWC1:
+		case DEC_OP + OP_LWC1:
 			/* todo: */
-			logerror( "%08x: COP1 LWC not supported\n", mipscpu.pc );
+			logerror( "%08x: COP1 LWC not supported\n", CPU->pc );
 			mips_stop();
 			mips_advance_pc();
 			break;
-		case OP_LWC2:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_CU2 ) == 0 )
+		case DEC_OP + OP_LWC2:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_CU2 ) == 0 )
 			{
 				mips_exception( EXC_CPU );
-				mips_set_cp0r( CP0_CAUSE, ( mipscpu.cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE2 );
+				mips_set_cp0r( CP0_CAUSE, ( CPU->cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE2 );
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+			else if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: LWC2 SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: LWC2 SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
 				{
 					mips_exception( EXC_ADEL );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
@@ -1601,63 +1687,66 @@ int mips_execute( int cycles )
 				else
 				{
 					/* todo: delay? */
-					setcp2dr( INS_RT( mipscpu.op ), program_read_dword_32le( n_adr ) );
+					setcp2dr( INS_RT( CPU->op ), program_read_dword_32le( n_adr ) );
 					mips_advance_pc();
 				}
 			}
 			break;
-		case OP_SWC1:
+		case DEC_OP + OP_SWC1:
 			/* todo: */
-			logerror( "%08x: COP1 SWC not supported\n", mipscpu.pc );
+			logerror( "%08x: COP1 SWC not supported\n", CPU->pc );
 			mips_stop();
 			mips_advance_pc();
 			break;
-		case OP_SWC2:
-			if( ( mipscpu.cp0r[ CP0_SR ] & SR_CU2 ) == 0 )
+		case DEC_OP + OP_SWC2:
+			if( ( CPU->cp0r[ CP0_SR ] & SR_CU2 ) == 0 )
 			{
 				mips_exception( EXC_CPU );
-				mips_set_cp0r( CP0_CAUSE, ( mipscpu.cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE2 );
+				mips_set_cp0r( CP0_CAUSE, ( CPU->cp0r[ CP0_CAUSE ] & ~CAUSE_CE ) | CAUSE_CE2 );
 			}
-			else if( ( mipscpu.cp0r[ CP0_SR ] & SR_ISC ) != 0 )
+			else if( ( CPU->cp0r[ CP0_SR ] & SR_ISC ) != 0 )
 			{
 				/* todo: */
-				logerror( "%08x: SWC2 SR_ISC not supported\n", mipscpu.pc );
+				logerror( "%08x: SWC2 SR_ISC not supported\n", CPU->pc );
 				mips_stop();
 				mips_advance_pc();
 			}
 			else
 			{
 				uint32_t n_adr;
-				n_adr = mipscpu.r[ INS_RS( mipscpu.op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( mipscpu.op ) );
-				if( ( n_adr & ( ( ( mipscpu.cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
+				n_adr = CPU->r[ INS_RS( CPU->op ) ] + MIPS_WORD_EXTEND( INS_IMMEDIATE( CPU->op ) );
+				if( ( n_adr & ( ( ( CPU->cp0r[ CP0_SR ] & SR_KUC ) << 30 ) | 3 ) ) != 0 )
 				{
 					mips_exception( EXC_ADES );
 					mips_set_cp0r( CP0_BADVADDR, n_adr );
 				}
 				else
 				{
-					program_write_dword_32le( n_adr, getcp2dr( INS_RT( mipscpu.op ) ) );
+					program_write_dword_32le( n_adr, getcp2dr( INS_RT( CPU->op ) ) );
 					mips_advance_pc();
 				}
 			}
 			break;
 		default:
-			printf( "%08x: unknown opcode %08x (prev %08x, RA %08x)\n", mipscpu.pc, mipscpu.op, mipscpu.prevpc,  mipscpu.r[31] );
+			printf( "%08x: unknown opcode %08x (prev %08x, RA %08x)\n", CPU->pc, CPU->op, CPU->prevpc,  CPU->r[31] );
 			mips_stop();
 			mips_exception( EXC_RI );
   			break;
 		}
-		mips_ICount--;
-	} while( mips_ICount > 0 );
+		CPU->icount--;
+	} while( CPU->icount > 0 );
 
-	return cycles - mips_ICount;
+	return cycles - CPU->icount;
 }
 
+#undef CPU
+#define CPU (psf_ctx->cpu)
+
 static void mips_get_context( void *dst )
 {
 	if( dst )
 	{
-		*(mips_cpu_context *)dst = mipscpu;
+		*(mips_cpu_context *)dst = *CPU;
 	}
 }
 
@@ -1665,8 +1754,8 @@ static void mips_set_context( void *src )
 {
 	if( src )
 	{
-		mipscpu = *(mips_cpu_context *)src;
-		change_pc( mipscpu.pc );
+		*CPU = *(mips_cpu_context *)src;
+		change_pc( CPU->pc );
 	}
 }
 
@@ -1701,11 +1790,11 @@ static void set_irq_line( int irqline, int state )
 	switch( state )
 	{
 	case CLEAR_LINE:
-		mips_set_cp0r( CP0_CAUSE, mipscpu.cp0r[ CP0_CAUSE ] & ~ip );
+		mips_set_cp0r( CP0_CAUSE, CPU->cp0r[ CP0_CAUSE ] & ~ip );
 		break;
 	case ASSERT_LINE:
-		mips_set_cp0r( CP0_CAUSE, mipscpu.cp0r[ CP0_CAUSE ] |= ip );
-		if( mipscpu.irq_callback )
+		mips_set_cp0r( CP0_CAUSE, CPU->cp0r[ CP0_CAUSE ] |= ip );
+		if( CPU->irq_callback )
 		{
 			/* HOLD_LINE interrupts are not supported by the architecture.
 			By acknowledging the interupt here they are treated like PULSE_LINE
@@ -1713,7 +1802,7 @@ static void set_irq_line( int irqline, int state )
 			There is also a problem with PULSE_LINE interrupts as the interrupt
 			pending bits aren't latched the emulated code won't know what caused
 			the interrupt. */
-			(*mipscpu.irq_callback)( irqline );
+			(*CPU->irq_callback)( irqline );
 		}
 		break;
 	}
@@ -1733,145 +1822,145 @@ offs_t mips_dasm( char *buffer, offs_t pc )
 	sprintf( buffer, "$%08x", cpu_readop32( pc ) );
 	ret = 4;
 #endif
-	change_pc( mipscpu.pc );
+	change_pc( CPU->pc );
 	return ret;
 }
 
 /* preliminary gte code */
 
-#define VXY0 ( mipscpu.cp2dr[ 0 ].d )
-#define VX0  ( mipscpu.cp2dr[ 0 ].w.l )
-#define VY0  ( mipscpu.cp2dr[ 0 ].w.h )
-#define VZ0  ( mipscpu.cp2dr[ 1 ].w.l )
-#define VXY1 ( mipscpu.cp2dr[ 2 ].d )
-#define VX1  ( mipscpu.cp2dr[ 2 ].w.l )
-#define VY1  ( mipscpu.cp2dr[ 2 ].w.h )
-#define VZ1  ( mipscpu.cp2dr[ 3 ].w.l )
-#define VXY2 ( mipscpu.cp2dr[ 4 ].d )
-#define VX2  ( mipscpu.cp2dr[ 4 ].w.l )
-#define VY2  ( mipscpu.cp2dr[ 4 ].w.h )
-#define VZ2  ( mipscpu.cp2dr[ 5 ].w.l )
-#define RGB  ( mipscpu.cp2dr[ 6 ].d )
-#define R    ( mipscpu.cp2dr[ 6 ].b.l )
-#define G    ( mipscpu.cp2dr[ 6 ].b.h )
-#define B    ( mipscpu.cp2dr[ 6 ].b.h2 )
-#define CODE ( mipscpu.cp2dr[ 6 ].b.h3 )
-#define OTZ  ( mipscpu.cp2dr[ 7 ].w.l )
-#define IR0  ( mipscpu.cp2dr[ 8 ].d )
-#define IR1  ( mipscpu.cp2dr[ 9 ].d )
-#define IR2  ( mipscpu.cp2dr[ 10 ].d )
-#define IR3  ( mipscpu.cp2dr[ 11 ].d )
-#define SXY0 ( mipscpu.cp2dr[ 12 ].d )
-#define SX0  ( mipscpu.cp2dr[ 12 ].w.l )
-#define SY0  ( mipscpu.cp2dr[ 12 ].w.h )
-#define SXY1 ( mipscpu.cp2dr[ 13 ].d )
-#define SX1  ( mipscpu.cp2dr[ 13 ].w.l )
-#define SY1  ( mipscpu.cp2dr[ 13 ].w.h )
-#define SXY2 ( mipscpu.cp2dr[ 14 ].d )
-#define SX2  ( mipscpu.cp2dr[ 14 ].w.l )
-#define SY2  ( mipscpu.cp2dr[ 14 ].w.h )
-#define SXYP ( mipscpu.cp2dr[ 15 ].d )
-#define SXP  ( mipscpu.cp2dr[ 15 ].w.l )
-#define SYP  ( mipscpu.cp2dr[ 15 ].w.h )
-#define SZ0  ( mipscpu.cp2dr[ 16 ].w.l )
-#define SZ1  ( mipscpu.cp2dr[ 17 ].w.l )
-#define SZ2  ( mipscpu.cp2dr[ 18 ].w.l )
-#define SZ3  ( mipscpu.cp2dr[ 19 ].w.l )
-#define RGB0 ( mipscpu.cp2dr[ 20 ].d )
-#define R0   ( mipscpu.cp2dr[ 20 ].b.l )
-#define G0   ( mipscpu.cp2dr[ 20 ].b.h )
-#define B0   ( mipscpu.cp2dr[ 20 ].b.h2 )
-#define CD0  ( mipscpu.cp2dr[ 20 ].b.h3 )
-#define RGB1 ( mipscpu.cp2dr[ 21 ].d )
-#define R1   ( mipscpu.cp2dr[ 21 ].b.l )
-#define G1   ( mipscpu.cp2dr[ 21 ].b.h )
-#define B1   ( mipscpu.cp2dr[ 21 ].b.h2 )
-#define CD1  ( mipscpu.cp2dr[ 21 ].b.h3 )
-#define RGB2 ( mipscpu.cp2dr[ 22 ].d )
-#define R2   ( mipscpu.cp2dr[ 22 ].b.l )
-#define G2   ( mipscpu.cp2dr[ 22 ].b.h )
-#define B2   ( mipscpu.cp2dr[ 22 ].b.h2 )
-#define CD2  ( mipscpu.cp2dr[ 22 ].b.h3 )
-#define RES1 ( mipscpu.cp2dr[ 23 ].d )
-#define MAC0 ( mipscpu.cp2dr[ 24 ].d )
-#define MAC1 ( mipscpu.cp2dr[ 25 ].d )
-#define MAC2 ( mipscpu.cp2dr[ 26 ].d )
-#define MAC3 ( mipscpu.cp2dr[ 27 ].d )
-#define IRGB ( mipscpu.cp2dr[ 28 ].d )
-#define ORGB ( mipscpu.cp2dr[ 29 ].d )
-#define LZCS ( mipscpu.cp2dr[ 30 ].d )
-#define LZCR ( mipscpu.cp2dr[ 31 ].d )
-
-#define D1  ( mipscpu.cp2cr[ 0 ].d )
-#define R11 ( mipscpu.cp2cr[ 0 ].w.l )
-#define R12 ( mipscpu.cp2cr[ 0 ].w.h )
-#define R13 ( mipscpu.cp2cr[ 1 ].w.l )
-#define R21 ( mipscpu.cp2cr[ 1 ].w.h )
-#define D2  ( mipscpu.cp2cr[ 2 ].d )
-#define R22 ( mipscpu.cp2cr[ 2 ].w.l )
-#define R23 ( mipscpu.cp2cr[ 2 ].w.h )
-#define R31 ( mipscpu.cp2cr[ 3 ].w.l )
-#define R32 ( mipscpu.cp2cr[ 3 ].w.h )
-#define D3  ( mipscpu.cp2cr[ 4 ].d )
-#define R33 ( mipscpu.cp2cr[ 4 ].w.l )
-#define TRX ( mipscpu.cp2cr[ 5 ].d )
-#define TRY ( mipscpu.cp2cr[ 6 ].d )
-#define TRZ ( mipscpu.cp2cr[ 7 ].d )
-#define L11 ( mipscpu.cp2cr[ 8 ].w.l )
-#define L12 ( mipscpu.cp2cr[ 8 ].w.h )
-#define L13 ( mipscpu.cp2cr[ 9 ].w.l )
-#define L21 ( mipscpu.cp2cr[ 9 ].w.h )
-#define L22 ( mipscpu.cp2cr[ 10 ].w.l )
-#define L23 ( mipscpu.cp2cr[ 10 ].w.h )
-#define L31 ( mipscpu.cp2cr[ 11 ].w.l )
-#define L32 ( mipscpu.cp2cr[ 11 ].w.h )
-#define L33 ( mipscpu.cp2cr[ 12 ].w.l )
-#define RBK ( mipscpu.cp2cr[ 13 ].d )
-#define GBK ( mipscpu.cp2cr[ 14 ].d )
-#define BBK ( mipscpu.cp2cr[ 15 ].d )
-#define LR1 ( mipscpu.cp2cr[ 16 ].w.l )
-#define LR2 ( mipscpu.cp2cr[ 16 ].w.h )
-#define LR3 ( mipscpu.cp2cr[ 17 ].w.l )
-#define LG1 ( mipscpu.cp2cr[ 17 ].w.h )
-#define LG2 ( mipscpu.cp2cr[ 18 ].w.l )
-#define LG3 ( mipscpu.cp2cr[ 18 ].w.h )
-#define LB1 ( mipscpu.cp2cr[ 19 ].w.l )
-#define LB2 ( mipscpu.cp2cr[ 19 ].w.h )
-#define LB3 ( mipscpu.cp2cr[ 20 ].w.l )
-#define RFC ( mipscpu.cp2cr[ 21 ].d )
-#define GFC ( mipscpu.cp2cr[ 22 ].d )
-#define BFC ( mipscpu.cp2cr[ 23 ].d )
-#define OFX ( mipscpu.cp2cr[ 24 ].d )
-#define OFY ( mipscpu.cp2cr[ 25 ].d )
-#define H   ( mipscpu.cp2cr[ 26 ].w.l )
-#define DQA ( mipscpu.cp2cr[ 27 ].w.l )
-#define DQB ( mipscpu.cp2cr[ 28 ].d )
-#define ZSF3 ( mipscpu.cp2cr[ 29 ].w.l )
-#define ZSF4 ( mipscpu.cp2cr[ 30 ].w.l )
-#define FLAG ( mipscpu.cp2cr[ 31 ].d )
+#define VXY0 ( CPU->cp2dr[ 0 ].d )
+#define VX0  ( CPU->cp2dr[ 0 ].w.l )
+#define VY0  ( CPU->cp2dr[ 0 ].w.h )
+#define VZ0  ( CPU->cp2dr[ 1 ].w.l )
+#define VXY1 ( CPU->cp2dr[ 2 ].d )
+#define VX1  ( CPU->cp2dr[ 2 ].w.l )
+#define VY1  ( CPU->cp2dr[ 2 ].w.h )
+#define VZ1  ( CPU->cp2dr[ 3 ].w.l )
+#define VXY2 ( CPU->cp2dr[ 4 ].d )
+#define VX2  ( CPU->cp2dr[ 4 ].w.l )
+#define VY2  ( CPU->cp2dr[ 4 ].w.h )
+#define VZ2  ( CPU->cp2dr[ 5 ].w.l )
+#define RGB  ( CPU->cp2dr[ 6 ].d )
+#define R    ( CPU->cp2dr[ 6 ].b.l )
+#define G    ( CPU->cp2dr[ 6 ].b.h )
+#define B    ( CPU->cp2dr[ 6 ].b.h2 )
+#define CODE ( CPU->cp2dr[ 6 ].b.h3 )
+#define OTZ  ( CPU->cp2dr[ 7 ].w.l )
+#define IR0  ( CPU->cp2dr[ 8 ].d )
+#define IR1  ( CPU->cp2dr[ 9 ].d )
+#define IR2  ( CPU->cp2dr[ 10 ].d )
+#define IR3  ( CPU->cp2dr[ 11 ].d )
+#define SXY0 ( CPU->cp2dr[ 12 ].d )
+#define SX0  ( CPU->cp2dr[ 12 ].w.l )
+#define SY0  ( CPU->cp2dr[ 12 ].w.h )
+#define SXY1 ( CPU->cp2dr[ 13 ].d )
+#define SX1  ( CPU->cp2dr[ 13 ].w.l )
+#define SY1  ( CPU->cp2dr[ 13 ].w.h )
+#define SXY2 ( CPU->cp2dr[ 14 ].d )
+#define SX2  ( CPU->cp2dr[ 14 ].w.l )
+#define SY2  ( CPU->cp2dr[ 14 ].w.h )
+#define SXYP ( CPU->cp2dr[ 15 ].d )
+#define SXP  ( CPU->cp2dr[ 15 ].w.l )
+#define SYP  ( CPU->cp2dr[ 15 ].w.h )
+#define SZ0  ( CPU->cp2dr[ 16 ].w.l )
+#define SZ1  ( CPU->cp2dr[ 17 ].w.l )
+#define SZ2  ( CPU->cp2dr[ 18 ].w.l )
+#define SZ3  ( CPU->cp2dr[ 19 ].w.l )
+#define RGB0 ( CPU->cp2dr[ 20 ].d )
+#define R0   ( CPU->cp2dr[ 20 ].b.l )
+#define G0   ( CPU->cp2dr[ 20 ].b.h )
+#define B0   ( CPU->cp2dr[ 20 ].b.h2 )
+#define CD0  ( CPU->cp2dr[ 20 ].b.h3 )
+#define RGB1 ( CPU->cp2dr[ 21 ].d )
+#define R1   ( CPU->cp2dr[ 21 ].b.l )
+#define G1   ( CPU->cp2dr[ 21 ].b.h )
+#define B1   ( CPU->cp2dr[ 21 ].b.h2 )
+#define CD1  ( CPU->cp2dr[ 21 ].b.h3 )
+#define RGB2 ( CPU->cp2dr[ 22 ].d )
+#define R2   ( CPU->cp2dr[ 22 ].b.l )
+#define G2   ( CPU->cp2dr[ 22 ].b.h )
+#define B2   ( CPU->cp2dr[ 22 ].b.h2 )
+#define CD2  ( CPU->cp2dr[ 22 ].b.h3 )
+#define RES1 ( CPU->cp2dr[ 23 ].d )
+#define MAC0 ( CPU->cp2dr[ 24 ].d )
+#define MAC1 ( CPU->cp2dr[ 25 ].d )
+#define MAC2 ( CPU->cp2dr[ 26 ].d )
+#define MAC3 ( CPU->cp2dr[ 27 ].d )
+#define IRGB ( CPU->cp2dr[ 28 ].d )
+#define ORGB ( CPU->cp2dr[ 29 ].d )
+#define LZCS ( CPU->cp2dr[ 30 ].d )
+#define LZCR ( CPU->cp2dr[ 31 ].d )
+
+#define D1  ( CPU->cp2cr[ 0 ].d )
+#define R11 ( CPU->cp2cr[ 0 ].w.l )
+#define R12 ( CPU->cp2cr[ 0 ].w.h )
+#define R13 ( CPU->cp2cr[ 1 ].w.l )
+#define R21 ( CPU->cp2cr[ 1 ].w.h )
+#define D2  ( CPU->cp2cr[ 2 ].d )
+#define R22 ( CPU->cp2cr[ 2 ].w.l )
+#define R23 ( CPU->cp2cr[ 2 ].w.h )
+#define R31 ( CPU->cp2cr[ 3 ].w.l )
+#define R32 ( CPU->cp2cr[ 3 ].w.h )
+#define D3  ( CPU->cp2cr[ 4 ].d )
+#define R33 ( CPU->cp2cr[ 4 ].w.l )
+#define TRX ( CPU->cp2cr[ 5 ].d )
+#define TRY ( CPU->cp2cr[ 6 ].d )
+#define TRZ ( CPU->cp2cr[ 7 ].d )
+#define L11 ( CPU->cp2cr[ 8 ].w.l )
+#define L12 ( CPU->cp2cr[ 8 ].w.h )
+#define L13 ( CPU->cp2cr[ 9 ].w.l )
+#define L21 ( CPU->cp2cr[ 9 ].w.h )
+#define L22 ( CPU->cp2cr[ 10 ].w.l )
+#define L23 ( CPU->cp2cr[ 10 ].w.h )
+#define L31 ( CPU->cp2cr[ 11 ].w.l )
+#define L32 ( CPU->cp2cr[ 11 ].w.h )
+#define L33 ( CPU->cp2cr[ 12 ].w.l )
+#define RBK ( CPU->cp2cr[ 13 ].d )
+#define GBK ( CPU->cp2cr[ 14 ].d )
+#define BBK ( CPU->cp2cr[ 15 ].d )
+#define LR1 ( CPU->cp2cr[ 16 ].w.l )
+#define LR2 ( CPU->cp2cr[ 16 ].w.h )
+#define LR3 ( CPU->cp2cr[ 17 ].w.l )
+#define LG1 ( CPU->cp2cr[ 17 ].w.h )
+#define LG2 ( CPU->cp2cr[ 18 ].w.l )
+#define LG3 ( CPU->cp2cr[ 18 ].w.h )
+#define LB1 ( CPU->cp2cr[ 19 ].w.l )
+#define LB2 ( CPU->cp2cr[ 19 ].w.h )
+#define LB3 ( CPU->cp2cr[ 20 ].w.l )
+#define RFC ( CPU->cp2cr[ 21 ].d )
+#define GFC ( CPU->cp2cr[ 22 ].d )
+#define BFC ( CPU->cp2cr[ 23 ].d )
+#define OFX ( CPU->cp2cr[ 24 ].d )
+#define OFY ( CPU->cp2cr[ 25 ].d )
+#define H   ( CPU->cp2cr[ 26 ].w.l )
+#define DQA ( CPU->cp2cr[ 27 ].w.l )
+#define DQB ( CPU->cp2cr[ 28 ].d )
+#define ZSF3 ( CPU->cp2cr[ 29 ].w.l )
+#define ZSF4 ( CPU->cp2cr[ 30 ].w.l )
+#define FLAG ( CPU->cp2cr[ 31 ].d )
 
 static uint32_t getcp2dr( int n_reg )
 {
 	if( n_reg == 1 || n_reg == 3 || n_reg == 5 || n_reg == 8 || n_reg == 9 || n_reg == 10 || n_reg == 11 )
 	{
-		mipscpu.cp2dr[ n_reg ].d = (int32_t)(int16_t)mipscpu.cp2dr[ n_reg ].d;
+		CPU->cp2dr[ n_reg ].d = (int32_t)(int16_t)CPU->cp2dr[ n_reg ].d;
 	}
 	else if( n_reg == 17 || n_reg == 18 || n_reg == 19 )
 	{
-		mipscpu.cp2dr[ n_reg ].d = (uint32_t)(uint16_t)mipscpu.cp2dr[ n_reg ].d;
+		CPU->cp2dr[ n_reg ].d = (uint32_t)(uint16_t)CPU->cp2dr[ n_reg ].d;
 	}
 	else if( n_reg == 29 )
 	{
 		ORGB = ( ( IR1 >> 7 ) & 0x1f ) | ( ( IR2 >> 2 ) & 0x3e0 ) | ( ( IR3 << 3 ) & 0x7c00 );
 	}
-	GTELOG( "get CP2DR%u=%08x", n_reg, mipscpu.cp2dr[ n_reg ].d );
-	return mipscpu.cp2dr[ n_reg ].d;
+	GTELOG( "get CP2DR%u=%08x", n_reg, CPU->cp2dr[ n_reg ].d );
+	return CPU->cp2dr[ n_reg ].d;
 }
 
 static void setcp2dr( int n_reg, uint32_t n_value )
 {
 	GTELOG( "set CP2DR%u=%08x", n_reg, n_value );
-	mipscpu.cp2dr[ n_reg ].d = n_value;
+	CPU->cp2dr[ n_reg ].d = n_value;
 
 	if( n_reg == 15 )
 	{
@@ -1905,14 +1994,14 @@ static void setcp2dr( int n_reg, uint32_t n_value )
 
 static uint32_t getcp2cr( int n_reg )
 {
-	GTELOG( "get CP2CR%u=%08x", n_reg, mipscpu.cp2cr[ n_reg ].d );
-	return mipscpu.cp2cr[ n_reg ].d;
+	GTELOG( "get CP2CR%u=%08x", n_reg, CPU->cp2cr[ n_reg ].d );
+	return CPU->cp2cr[ n_reg ].d;
 }
 
 static void setcp2cr( int n_reg, uint32_t n_value )
 {
 	GTELOG( "set CP2CR%u=%08x", n_reg, n_value );
-	mipscpu.cp2cr[ n_reg ].d = n_value;
+	CPU->cp2cr[ n_reg ].d = n_value;
 }
 
 static inline int32_t LIM( int32_t n_value, int32_t n_max, int32_t n_min, uint32_t n_flag )
@@ -1986,19 +2075,19 @@ static void docop2( int gteop )
 	const uint32_t **p_n_cv;
 	static const uint16_t n_zm = 0;
 	static const uint32_t n_zc = 0;
-	static const uint16_t *p_n_vx[] = { &VX0, &VX1, &VX2 };
-	static const uint16_t *p_n_vy[] = { &VY0, &VY1, &VY2 };
-	static const uint16_t *p_n_vz[] = { &VZ0, &VZ1, &VZ2 };
-	static const uint16_t *p_n_rm[] = { &R11, &R12, &R13, &R21, &R22, &R23, &R31, &R32, &R33 };
-	static const uint16_t *p_n_lm[] = { &L11, &L12, &L13, &L21, &L22, &L23, &L31, &L32, &L33 };
-	static const uint16_t *p_n_cm[] = { &LR1, &LR2, &LR3, &LG1, &LG2, &LG3, &LB1, &LB2, &LB3 };
+	const uint16_t *p_n_vx[] = { &VX0, &VX1, &VX2 };
+	const uint16_t *p_n_vy[] = { &VY0, &VY1, &VY2 };
+	const uint16_t *p_n_vz[] = { &VZ0, &VZ1, &VZ2 };
+	const uint16_t *p_n_rm[] = { &R11, &R12, &R13, &R21, &R22, &R23, &R31, &R32, &R33 };
+	const uint16_t *p_n_lm[] = { &L11, &L12, &L13, &L21, &L22, &L23, &L31, &L32, &L33 };
+	const uint16_t *p_n_cm[] = { &LR1, &LR2, &LR3, &LG1, &LG2, &LG3, &LB1, &LB2, &LB3 };
 	static const uint16_t *p_n_zm[] = { &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm, &n_zm };
-	static const uint16_t **p_p_n_mx[] = { p_n_rm, p_n_lm, p_n_cm, p_n_zm };
-	static const uint32_t *p_n_tr[] = { &TRX, &TRY, &TRZ };
-	static const uint32_t *p_n_bk[] = { &RBK, &GBK, &BBK };
-	static const uint32_t *p_n_fc[] = { &RFC, &GFC, &BFC };
+	const uint16_t **p_p_n_mx[] = { p_n_rm, p_n_lm, p_n_cm, p_n_zm };
+	const uint32_t *p_n_tr[] = { &TRX, &TRY, &TRZ };
+	const uint32_t *p_n_bk[] = { &RBK, &GBK, &BBK };
+	const uint32_t *p_n_fc[] = { &RFC, &GFC, &BFC };
 	static const uint32_t *p_n_zc[] = { &n_zc, &n_zc, &n_zc };
-	static const uint32_t **p_p_n_cv[] = { p_n_tr, p_n_bk, p_n_fc, p_n_zc };
+	const uint32_t **p_p_n_cv[] = { p_n_tr, p_n_bk, p_n_fc, p_n_zc };
 
 	switch( GTE_FUNCT( gteop ) )
 	{
@@ -2596,7 +2685,7 @@ static void docop2( int gteop )
 		break;
 	}
 //	usrintf_showmessage_secs( 1, "unknown GTE op %08x", gteop );
-	logerror( "%08x: unknown GTE op %08x\n", mipscpu.pc, gteop );
+	logerror( "%08x: unknown GTE op %08x\n", CPU->pc, gteop );
 	mips_stop();
 }
 
@@ -2619,42 +2708,42 @@ void mips_set_info(uint32_t state, union cpuinfo *info)
 		case CPUINFO_INT_PC:							mips_set_pc( info->i );					break;
 		case CPUINFO_INT_REGISTER + MIPS_PC:			mips_set_pc( info->i );					break;
 		case CPUINFO_INT_SP:							/* no stack */							break;
-		case CPUINFO_INT_REGISTER + MIPS_DELAYV:		mipscpu.delayv = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_DELAYR:		if( info->i <= REGPC ) mipscpu.delayr = info->i; break;
-		case CPUINFO_INT_REGISTER + MIPS_HI:			mipscpu.hi = info->i;					break;
-		case CPUINFO_INT_REGISTER + MIPS_LO:			mipscpu.lo = info->i;					break;
-		case CPUINFO_INT_REGISTER + MIPS_R0:			mipscpu.r[ 0 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R1:			mipscpu.r[ 1 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R2:			mipscpu.r[ 2 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R3:			mipscpu.r[ 3 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R4:			mipscpu.r[ 4 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R5:			mipscpu.r[ 5 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R6:			mipscpu.r[ 6 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R7:			mipscpu.r[ 7 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R8:			mipscpu.r[ 8 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R9:			mipscpu.r[ 9 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R10:			mipscpu.r[ 10 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R11:			mipscpu.r[ 11 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R12:			mipscpu.r[ 12 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R13:			mipscpu.r[ 13 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R14:			mipscpu.r[ 14 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R15:			mipscpu.r[ 15 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R16:			mipscpu.r[ 16 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R17:			mipscpu.r[ 17 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R18:			mipscpu.r[ 18 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R19:			mipscpu.r[ 19 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R20:			mipscpu.r[ 20 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R21:			mipscpu.r[ 21 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R22:			mipscpu.r[ 22 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R23:			mipscpu.r[ 23 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R24:			mipscpu.r[ 24 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R25:			mipscpu.r[ 25 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R26:			mipscpu.r[ 26 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R27:			mipscpu.r[ 27 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R28:			mipscpu.r[ 28 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R29:			mipscpu.r[ 29 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R30:			mipscpu.r[ 30 ] = info->i;				break;
-		case CPUINFO_INT_REGISTER + MIPS_R31:			mipscpu.r[ 31 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_DELAYV:		CPU->delayv = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_DELAYR:		if( info->i <= REGPC ) CPU->delayr = info->i; break;
+		case CPUINFO_INT_REGISTER + MIPS_HI:			CPU->hi = info->i;					break;
+		case CPUINFO_INT_REGISTER + MIPS_LO:			CPU->lo = info->i;					break;
+		case CPUINFO_INT_REGISTER + MIPS_R0:			CPU->r[ 0 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R1:			CPU->r[ 1 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R2:			CPU->r[ 2 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R3:			CPU->r[ 3 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R4:			CPU->r[ 4 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R5:			CPU->r[ 5 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R6:			CPU->r[ 6 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R7:			CPU->r[ 7 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R8:			CPU->r[ 8 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R9:			CPU->r[ 9 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R10:			CPU->r[ 10 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R11:			CPU->r[ 11 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R12:			CPU->r[ 12 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R13:			CPU->r[ 13 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R14:			CPU->r[ 14 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R15:			CPU->r[ 15 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R16:			CPU->r[ 16 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R17:			CPU->r[ 17 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R18:			CPU->r[ 18 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R19:			CPU->r[ 19 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R20:			CPU->r[ 20 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R21:			CPU->r[ 21 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R22:			CPU->r[ 22 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R23:			CPU->r[ 23 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R24:			CPU->r[ 24 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R25:			CPU->r[ 25 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R26:			CPU->r[ 26 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R27:			CPU->r[ 27 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R28:			CPU->r[ 28 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R29:			CPU->r[ 29 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R30:			CPU->r[ 30 ] = info->i;				break;
+		case CPUINFO_INT_REGISTER + MIPS_R31:			CPU->r[ 31 ] = info->i;				break;
 		case CPUINFO_INT_REGISTER + MIPS_CP0R0:			mips_set_cp0r( 0, info->i );			break;
 		case CPUINFO_INT_REGISTER + MIPS_CP0R1:			mips_set_cp0r( 1, info->i );			break;
 		case CPUINFO_INT_REGISTER + MIPS_CP0R2:			mips_set_cp0r( 2, info->i );			break;
@@ -2687,73 +2776,73 @@ void mips_set_info(uint32_t state, union cpuinfo *info)
 		case CPUINFO_INT_REGISTER + MIPS_CP0R29:		mips_set_cp0r( 29, info->i );			break;
 		case CPUINFO_INT_REGISTER + MIPS_CP0R30:		mips_set_cp0r( 30, info->i );			break;
 		case CPUINFO_INT_REGISTER + MIPS_CP0R31:		mips_set_cp0r( 31, info->i );			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR0:		mipscpu.cp2dr[ 0 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR1:		mipscpu.cp2dr[ 1 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR2:		mipscpu.cp2dr[ 2 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR3:		mipscpu.cp2dr[ 3 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR4:		mipscpu.cp2dr[ 4 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR5:		mipscpu.cp2dr[ 5 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR6:		mipscpu.cp2dr[ 6 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR7:		mipscpu.cp2dr[ 7 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR8:		mipscpu.cp2dr[ 8 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR9:		mipscpu.cp2dr[ 9 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR10:		mipscpu.cp2dr[ 10 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR11:		mipscpu.cp2dr[ 11 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR12:		mipscpu.cp2dr[ 12 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR13:		mipscpu.cp2dr[ 13 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR14:		mipscpu.cp2dr[ 14 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR15:		mipscpu.cp2dr[ 15 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR16:		mipscpu.cp2dr[ 16 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR17:		mipscpu.cp2dr[ 17 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR18:		mipscpu.cp2dr[ 18 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR19:		mipscpu.cp2dr[ 19 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR20:		mipscpu.cp2dr[ 20 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR21:		mipscpu.cp2dr[ 21 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR22:		mipscpu.cp2dr[ 22 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR23:		mipscpu.cp2dr[ 23 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR24:		mipscpu.cp2dr[ 24 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR25:		mipscpu.cp2dr[ 25 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR26:		mipscpu.cp2dr[ 26 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR27:		mipscpu.cp2dr[ 27 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR28:		mipscpu.cp2dr[ 28 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR29:		mipscpu.cp2dr[ 29 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR30:		mipscpu.cp2dr[ 30 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR31:		mipscpu.cp2dr[ 31 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR0:		mipscpu.cp2cr[ 0 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR1:		mipscpu.cp2cr[ 1 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR2:		mipscpu.cp2cr[ 2 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR3:		mipscpu.cp2cr[ 3 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR4:		mipscpu.cp2cr[ 4 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR5:		mipscpu.cp2cr[ 5 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR6:		mipscpu.cp2cr[ 6 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR7:		mipscpu.cp2cr[ 7 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR8:		mipscpu.cp2cr[ 8 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR9:		mipscpu.cp2cr[ 9 ].d = info->i;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR10:		mipscpu.cp2cr[ 10 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR11:		mipscpu.cp2cr[ 11 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR12:		mipscpu.cp2cr[ 12 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR13:		mipscpu.cp2cr[ 13 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR14:		mipscpu.cp2cr[ 14 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR15:		mipscpu.cp2cr[ 15 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR16:		mipscpu.cp2cr[ 16 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR17:		mipscpu.cp2cr[ 17 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR18:		mipscpu.cp2cr[ 18 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR19:		mipscpu.cp2cr[ 19 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR20:		mipscpu.cp2cr[ 20 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR21:		mipscpu.cp2cr[ 21 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR22:		mipscpu.cp2cr[ 22 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR23:		mipscpu.cp2cr[ 23 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR24:		mipscpu.cp2cr[ 24 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR25:		mipscpu.cp2cr[ 25 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR26:		mipscpu.cp2cr[ 26 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR27:		mipscpu.cp2cr[ 27 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR28:		mipscpu.cp2cr[ 28 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR29:		mipscpu.cp2cr[ 29 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR30:		mipscpu.cp2cr[ 30 ].d = info->i;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR31:		mipscpu.cp2cr[ 31 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR0:		CPU->cp2dr[ 0 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR1:		CPU->cp2dr[ 1 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR2:		CPU->cp2dr[ 2 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR3:		CPU->cp2dr[ 3 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR4:		CPU->cp2dr[ 4 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR5:		CPU->cp2dr[ 5 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR6:		CPU->cp2dr[ 6 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR7:		CPU->cp2dr[ 7 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR8:		CPU->cp2dr[ 8 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR9:		CPU->cp2dr[ 9 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR10:		CPU->cp2dr[ 10 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR11:		CPU->cp2dr[ 11 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR12:		CPU->cp2dr[ 12 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR13:		CPU->cp2dr[ 13 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR14:		CPU->cp2dr[ 14 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR15:		CPU->cp2dr[ 15 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR16:		CPU->cp2dr[ 16 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR17:		CPU->cp2dr[ 17 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR18:		CPU->cp2dr[ 18 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR19:		CPU->cp2dr[ 19 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR20:		CPU->cp2dr[ 20 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR21:		CPU->cp2dr[ 21 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR22:		CPU->cp2dr[ 22 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR23:		CPU->cp2dr[ 23 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR24:		CPU->cp2dr[ 24 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR25:		CPU->cp2dr[ 25 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR26:		CPU->cp2dr[ 26 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR27:		CPU->cp2dr[ 27 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR28:		CPU->cp2dr[ 28 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR29:		CPU->cp2dr[ 29 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR30:		CPU->cp2dr[ 30 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR31:		CPU->cp2dr[ 31 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR0:		CPU->cp2cr[ 0 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR1:		CPU->cp2cr[ 1 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR2:		CPU->cp2cr[ 2 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR3:		CPU->cp2cr[ 3 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR4:		CPU->cp2cr[ 4 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR5:		CPU->cp2cr[ 5 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR6:		CPU->cp2cr[ 6 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR7:		CPU->cp2cr[ 7 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR8:		CPU->cp2cr[ 8 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR9:		CPU->cp2cr[ 9 ].d = info->i;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR10:		CPU->cp2cr[ 10 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR11:		CPU->cp2cr[ 11 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR12:		CPU->cp2cr[ 12 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR13:		CPU->cp2cr[ 13 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR14:		CPU->cp2cr[ 14 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR15:		CPU->cp2cr[ 15 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR16:		CPU->cp2cr[ 16 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR17:		CPU->cp2cr[ 17 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR18:		CPU->cp2cr[ 18 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR19:		CPU->cp2cr[ 19 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR20:		CPU->cp2cr[ 20 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR21:		CPU->cp2cr[ 21 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR22:		CPU->cp2cr[ 22 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR23:		CPU->cp2cr[ 23 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR24:		CPU->cp2cr[ 24 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR25:		CPU->cp2cr[ 25 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR26:		CPU->cp2cr[ 26 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR27:		CPU->cp2cr[ 27 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR28:		CPU->cp2cr[ 28 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR29:		CPU->cp2cr[ 29 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR30:		CPU->cp2cr[ 30 ].d = info->i;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR31:		CPU->cp2cr[ 31 ].d = info->i;		break;
 
 		/* --- the following bits of info are set as pointers to data or functions --- */
-		case CPUINFO_PTR_IRQ_CALLBACK:					mipscpu.irq_callback = info->irqcallback;			break;
+		case CPUINFO_PTR_IRQ_CALLBACK:					CPU->irq_callback = info->irqcallback;			break;
 	}
 }
 
@@ -2768,7 +2857,7 @@ void mips_get_info(uint32_t state, union cpuinfo *info)
 	switch (state)
 	{
 		/* --- the following bits of info are returned as 64-bit signed integers --- */
-		case CPUINFO_INT_CONTEXT_SIZE:					info->i = sizeof(mipscpu);				break;
+		case CPUINFO_INT_CONTEXT_SIZE:					info->i = sizeof(mips_cpu_context);				break;
 		case CPUINFO_INT_INPUT_LINES:					info->i = 6;							break;
 		case CPUINFO_INT_DEFAULT_IRQ_VECTOR:			info->i = 0;							break;
 		case CPUINFO_INT_ENDIANNESS:					info->i = CPU_IS_LE;					break;
@@ -2788,154 +2877,154 @@ void mips_get_info(uint32_t state, union cpuinfo *info)
 		case CPUINFO_INT_ADDRBUS_WIDTH + ADDRESS_SPACE_IO: 		info->i = 0;					break;
 		case CPUINFO_INT_ADDRBUS_SHIFT + ADDRESS_SPACE_IO: 		info->i = 0;					break;
 
-		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ0:		info->i = (mipscpu.cp0r[ CP0_CAUSE ] & 0x400) ? ASSERT_LINE : CLEAR_LINE; break;
-		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ1:		info->i = (mipscpu.cp0r[ CP0_CAUSE ] & 0x800) ? ASSERT_LINE : CLEAR_LINE; break;
-		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ2:		info->i = (mipscpu.cp0r[ CP0_CAUSE ] & 0x1000) ? ASSERT_LINE : CLEAR_LINE; break;
-		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ3:		info->i = (mipscpu.cp0r[ CP0_CAUSE ] & 0x2000) ? ASSERT_LINE : CLEAR_LINE; break;
-		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ4:		info->i = (mipscpu.cp0r[ CP0_CAUSE ] & 0x4000) ? ASSERT_LINE : CLEAR_LINE; break;
-		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ5:		info->i = (mipscpu.cp0r[ CP0_CAUSE ] & 0x8000) ? ASSERT_LINE : CLEAR_LINE; break;
+		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ0:		info->i = (CPU->cp0r[ CP0_CAUSE ] & 0x400) ? ASSERT_LINE : CLEAR_LINE; break;
+		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ1:		info->i = (CPU->cp0r[ CP0_CAUSE ] & 0x800) ? ASSERT_LINE : CLEAR_LINE; break;
+		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ2:		info->i = (CPU->cp0r[ CP0_CAUSE ] & 0x1000) ? ASSERT_LINE : CLEAR_LINE; break;
+		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ3:		info->i = (CPU->cp0r[ CP0_CAUSE ] & 0x2000) ? ASSERT_LINE : CLEAR_LINE; break;
+		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ4:		info->i = (CPU->cp0r[ CP0_CAUSE ] & 0x4000) ? ASSERT_LINE : CLEAR_LINE; break;
+		case CPUINFO_INT_INPUT_STATE + MIPS_IRQ5:		info->i = (CPU->cp0r[ CP0_CAUSE ] & 0x8000) ? ASSERT_LINE : CLEAR_LINE; break;
 
 		case CPUINFO_INT_PREVIOUSPC:					/* not implemented */					break;
 
-		case CPUINFO_INT_PC:							info->i = mipscpu.pc;					break;
-		case CPUINFO_INT_REGISTER + MIPS_PC:			info->i = mipscpu.pc;					break;
+		case CPUINFO_INT_PC:							info->i = CPU->pc;					break;
+		case CPUINFO_INT_REGISTER + MIPS_PC:			info->i = CPU->pc;					break;
 		case CPUINFO_INT_SP:
 			/* because there is no hardware stack and the pipeline causes the cpu to execute the
 			instruction after a subroutine call before the subroutine is executed there is little
 			chance of cmd_step_over() in mamedbg.c working. */
 								info->i = 0;													break;
-		case CPUINFO_INT_REGISTER + MIPS_DELAYV:		info->i = mipscpu.delayv;				break;
-		case CPUINFO_INT_REGISTER + MIPS_DELAYR:		info->i = mipscpu.delayr;				break;
-		case CPUINFO_INT_REGISTER + MIPS_HI:			info->i = mipscpu.hi;					break;
-		case CPUINFO_INT_REGISTER + MIPS_LO:			info->i = mipscpu.lo;					break;
-		case CPUINFO_INT_REGISTER + MIPS_R0:			info->i = mipscpu.r[ 0 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R1:			info->i = mipscpu.r[ 1 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R2:			info->i = mipscpu.r[ 2 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R3:			info->i = mipscpu.r[ 3 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R4:			info->i = mipscpu.r[ 4 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R5:			info->i = mipscpu.r[ 5 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R6:			info->i = mipscpu.r[ 6 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R7:			info->i = mipscpu.r[ 7 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R8:			info->i = mipscpu.r[ 8 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R9:			info->i = mipscpu.r[ 9 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R10:			info->i = mipscpu.r[ 10 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R11:			info->i = mipscpu.r[ 11 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R12:			info->i = mipscpu.r[ 12 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R13:			info->i = mipscpu.r[ 13 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R14:			info->i = mipscpu.r[ 14 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R15:			info->i = mipscpu.r[ 15 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R16:			info->i = mipscpu.r[ 16 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R17:			info->i = mipscpu.r[ 17 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R18:			info->i = mipscpu.r[ 18 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R19:			info->i = mipscpu.r[ 19 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R20:			info->i = mipscpu.r[ 20 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R21:			info->i = mipscpu.r[ 21 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R22:			info->i = mipscpu.r[ 22 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R23:			info->i = mipscpu.r[ 23 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R24:			info->i = mipscpu.r[ 24 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R25:			info->i = mipscpu.r[ 25 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R26:			info->i = mipscpu.r[ 26 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R27:			info->i = mipscpu.r[ 27 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R28:			info->i = mipscpu.r[ 28 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R29:			info->i = mipscpu.r[ 29 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R30:			info->i = mipscpu.r[ 30 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_R31:			info->i = mipscpu.r[ 31 ];				break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R0:			info->i = mipscpu.cp0r[ 0 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R1:			info->i = mipscpu.cp0r[ 1 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R2:			info->i = mipscpu.cp0r[ 2 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R3:			info->i = mipscpu.cp0r[ 3 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R4:			info->i = mipscpu.cp0r[ 4 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R5:			info->i = mipscpu.cp0r[ 5 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R6:			info->i = mipscpu.cp0r[ 6 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R7:			info->i = mipscpu.cp0r[ 7 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R8:			info->i = mipscpu.cp0r[ 8 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R9:			info->i = mipscpu.cp0r[ 9 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R10:		info->i = mipscpu.cp0r[ 10 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R11:		info->i = mipscpu.cp0r[ 11 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R12:		info->i = mipscpu.cp0r[ 12 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R13:		info->i = mipscpu.cp0r[ 13 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R14:		info->i = mipscpu.cp0r[ 14 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R15:		info->i = mipscpu.cp0r[ 15 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R16:		info->i = mipscpu.cp0r[ 16 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R17:		info->i = mipscpu.cp0r[ 17 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R18:		info->i = mipscpu.cp0r[ 18 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R19:		info->i = mipscpu.cp0r[ 19 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R20:		info->i = mipscpu.cp0r[ 20 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R21:		info->i = mipscpu.cp0r[ 21 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R22:		info->i = mipscpu.cp0r[ 22 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R23:		info->i = mipscpu.cp0r[ 23 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R24:		info->i = mipscpu.cp0r[ 24 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R25:		info->i = mipscpu.cp0r[ 25 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R26:		info->i = mipscpu.cp0r[ 26 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R27:		info->i = mipscpu.cp0r[ 27 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R28:		info->i = mipscpu.cp0r[ 28 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R29:		info->i = mipscpu.cp0r[ 29 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R30:		info->i = mipscpu.cp0r[ 30 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP0R31:		info->i = mipscpu.cp0r[ 31 ];			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR0:		info->i = mipscpu.cp2dr[ 0 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR1:		info->i = mipscpu.cp2dr[ 1 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR2:		info->i = mipscpu.cp2dr[ 2 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR3:		info->i = mipscpu.cp2dr[ 3 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR4:		info->i = mipscpu.cp2dr[ 4 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR5:		info->i = mipscpu.cp2dr[ 5 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR6:		info->i = mipscpu.cp2dr[ 6 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR7:		info->i = mipscpu.cp2dr[ 7 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR8:		info->i = mipscpu.cp2dr[ 8 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR9:		info->i = mipscpu.cp2dr[ 9 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR10:		info->i = mipscpu.cp2dr[ 10 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR11:		info->i = mipscpu.cp2dr[ 11 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR12:		info->i = mipscpu.cp2dr[ 12 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR13:		info->i = mipscpu.cp2dr[ 13 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR14:		info->i = mipscpu.cp2dr[ 14 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR15:		info->i = mipscpu.cp2dr[ 15 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR16:		info->i = mipscpu.cp2dr[ 16 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR17:		info->i = mipscpu.cp2dr[ 17 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR18:		info->i = mipscpu.cp2dr[ 18 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR19:		info->i = mipscpu.cp2dr[ 19 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR20:		info->i = mipscpu.cp2dr[ 20 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR21:		info->i = mipscpu.cp2dr[ 21 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR22:		info->i = mipscpu.cp2dr[ 22 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR23:		info->i = mipscpu.cp2dr[ 23 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR24:		info->i = mipscpu.cp2dr[ 24 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR25:		info->i = mipscpu.cp2dr[ 25 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR26:		info->i = mipscpu.cp2dr[ 26 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR27:		info->i = mipscpu.cp2dr[ 27 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR28:		info->i = mipscpu.cp2dr[ 28 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR29:		info->i = mipscpu.cp2dr[ 29 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR30:		info->i = mipscpu.cp2dr[ 30 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2DR31:		info->i = mipscpu.cp2dr[ 31 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR0:		info->i = mipscpu.cp2cr[ 0 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR1:		info->i = mipscpu.cp2cr[ 1 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR2:		info->i = mipscpu.cp2cr[ 2 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR3:		info->i = mipscpu.cp2cr[ 3 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR4:		info->i = mipscpu.cp2cr[ 4 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR5:		info->i = mipscpu.cp2cr[ 5 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR6:		info->i = mipscpu.cp2cr[ 6 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR7:		info->i = mipscpu.cp2cr[ 7 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR8:		info->i = mipscpu.cp2cr[ 8 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR9:		info->i = mipscpu.cp2cr[ 9 ].d;			break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR10:		info->i = mipscpu.cp2cr[ 10 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR11:		info->i = mipscpu.cp2cr[ 11 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR12:		info->i = mipscpu.cp2cr[ 12 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR13:		info->i = mipscpu.cp2cr[ 13 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR14:		info->i = mipscpu.cp2cr[ 14 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR15:		info->i = mipscpu.cp2cr[ 15 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR16:		info->i = mipscpu.cp2cr[ 16 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR17:		info->i = mipscpu.cp2cr[ 17 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR18:		info->i = mipscpu.cp2cr[ 18 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR19:		info->i = mipscpu.cp2cr[ 19 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR20:		info->i = mipscpu.cp2cr[ 20 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR21:		info->i = mipscpu.cp2cr[ 21 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR22:		info->i = mipscpu.cp2cr[ 22 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR23:		info->i = mipscpu.cp2cr[ 23 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR24:		info->i = mipscpu.cp2cr[ 24 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR25:		info->i = mipscpu.cp2cr[ 25 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR26:		info->i = mipscpu.cp2cr[ 26 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR27:		info->i = mipscpu.cp2cr[ 27 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR28:		info->i = mipscpu.cp2cr[ 28 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR29:		info->i = mipscpu.cp2cr[ 29 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR30:		info->i = mipscpu.cp2cr[ 30 ].d;		break;
-		case CPUINFO_INT_REGISTER + MIPS_CP2CR31:		info->i = mipscpu.cp2cr[ 31 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_DELAYV:		info->i = CPU->delayv;				break;
+		case CPUINFO_INT_REGISTER + MIPS_DELAYR:		info->i = CPU->delayr;				break;
+		case CPUINFO_INT_REGISTER + MIPS_HI:			info->i = CPU->hi;					break;
+		case CPUINFO_INT_REGISTER + MIPS_LO:			info->i = CPU->lo;					break;
+		case CPUINFO_INT_REGISTER + MIPS_R0:			info->i = CPU->r[ 0 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R1:			info->i = CPU->r[ 1 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R2:			info->i = CPU->r[ 2 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R3:			info->i = CPU->r[ 3 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R4:			info->i = CPU->r[ 4 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R5:			info->i = CPU->r[ 5 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R6:			info->i = CPU->r[ 6 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R7:			info->i = CPU->r[ 7 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R8:			info->i = CPU->r[ 8 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R9:			info->i = CPU->r[ 9 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R10:			info->i = CPU->r[ 10 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R11:			info->i = CPU->r[ 11 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R12:			info->i = CPU->r[ 12 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R13:			info->i = CPU->r[ 13 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R14:			info->i = CPU->r[ 14 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R15:			info->i = CPU->r[ 15 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R16:			info->i = CPU->r[ 16 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R17:			info->i = CPU->r[ 17 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R18:			info->i = CPU->r[ 18 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R19:			info->i = CPU->r[ 19 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R20:			info->i = CPU->r[ 20 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R21:			info->i = CPU->r[ 21 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R22:			info->i = CPU->r[ 22 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R23:			info->i = CPU->r[ 23 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R24:			info->i = CPU->r[ 24 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R25:			info->i = CPU->r[ 25 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R26:			info->i = CPU->r[ 26 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R27:			info->i = CPU->r[ 27 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R28:			info->i = CPU->r[ 28 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R29:			info->i = CPU->r[ 29 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R30:			info->i = CPU->r[ 30 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_R31:			info->i = CPU->r[ 31 ];				break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R0:			info->i = CPU->cp0r[ 0 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R1:			info->i = CPU->cp0r[ 1 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R2:			info->i = CPU->cp0r[ 2 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R3:			info->i = CPU->cp0r[ 3 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R4:			info->i = CPU->cp0r[ 4 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R5:			info->i = CPU->cp0r[ 5 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R6:			info->i = CPU->cp0r[ 6 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R7:			info->i = CPU->cp0r[ 7 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R8:			info->i = CPU->cp0r[ 8 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R9:			info->i = CPU->cp0r[ 9 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R10:		info->i = CPU->cp0r[ 10 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R11:		info->i = CPU->cp0r[ 11 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R12:		info->i = CPU->cp0r[ 12 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R13:		info->i = CPU->cp0r[ 13 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R14:		info->i = CPU->cp0r[ 14 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R15:		info->i = CPU->cp0r[ 15 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R16:		info->i = CPU->cp0r[ 16 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R17:		info->i = CPU->cp0r[ 17 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R18:		info->i = CPU->cp0r[ 18 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R19:		info->i = CPU->cp0r[ 19 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R20:		info->i = CPU->cp0r[ 20 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R21:		info->i = CPU->cp0r[ 21 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R22:		info->i = CPU->cp0r[ 22 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R23:		info->i = CPU->cp0r[ 23 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R24:		info->i = CPU->cp0r[ 24 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R25:		info->i = CPU->cp0r[ 25 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R26:		info->i = CPU->cp0r[ 26 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R27:		info->i = CPU->cp0r[ 27 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R28:		info->i = CPU->cp0r[ 28 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R29:		info->i = CPU->cp0r[ 29 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R30:		info->i = CPU->cp0r[ 30 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP0R31:		info->i = CPU->cp0r[ 31 ];			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR0:		info->i = CPU->cp2dr[ 0 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR1:		info->i = CPU->cp2dr[ 1 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR2:		info->i = CPU->cp2dr[ 2 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR3:		info->i = CPU->cp2dr[ 3 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR4:		info->i = CPU->cp2dr[ 4 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR5:		info->i = CPU->cp2dr[ 5 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR6:		info->i = CPU->cp2dr[ 6 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR7:		info->i = CPU->cp2dr[ 7 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR8:		info->i = CPU->cp2dr[ 8 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR9:		info->i = CPU->cp2dr[ 9 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR10:		info->i = CPU->cp2dr[ 10 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR11:		info->i = CPU->cp2dr[ 11 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR12:		info->i = CPU->cp2dr[ 12 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR13:		info->i = CPU->cp2dr[ 13 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR14:		info->i = CPU->cp2dr[ 14 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR15:		info->i = CPU->cp2dr[ 15 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR16:		info->i = CPU->cp2dr[ 16 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR17:		info->i = CPU->cp2dr[ 17 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR18:		info->i = CPU->cp2dr[ 18 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR19:		info->i = CPU->cp2dr[ 19 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR20:		info->i = CPU->cp2dr[ 20 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR21:		info->i = CPU->cp2dr[ 21 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR22:		info->i = CPU->cp2dr[ 22 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR23:		info->i = CPU->cp2dr[ 23 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR24:		info->i = CPU->cp2dr[ 24 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR25:		info->i = CPU->cp2dr[ 25 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR26:		info->i = CPU->cp2dr[ 26 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR27:		info->i = CPU->cp2dr[ 27 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR28:		info->i = CPU->cp2dr[ 28 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR29:		info->i = CPU->cp2dr[ 29 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR30:		info->i = CPU->cp2dr[ 30 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2DR31:		info->i = CPU->cp2dr[ 31 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR0:		info->i = CPU->cp2cr[ 0 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR1:		info->i = CPU->cp2cr[ 1 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR2:		info->i = CPU->cp2cr[ 2 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR3:		info->i = CPU->cp2cr[ 3 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR4:		info->i = CPU->cp2cr[ 4 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR5:		info->i = CPU->cp2cr[ 5 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR6:		info->i = CPU->cp2cr[ 6 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR7:		info->i = CPU->cp2cr[ 7 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR8:		info->i = CPU->cp2cr[ 8 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR9:		info->i = CPU->cp2cr[ 9 ].d;			break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR10:		info->i = CPU->cp2cr[ 10 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR11:		info->i = CPU->cp2cr[ 11 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR12:		info->i = CPU->cp2cr[ 12 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR13:		info->i = CPU->cp2cr[ 13 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR14:		info->i = CPU->cp2cr[ 14 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR15:		info->i = CPU->cp2cr[ 15 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR16:		info->i = CPU->cp2cr[ 16 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR17:		info->i = CPU->cp2cr[ 17 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR18:		info->i = CPU->cp2cr[ 18 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR19:		info->i = CPU->cp2cr[ 19 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR20:		info->i = CPU->cp2cr[ 20 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR21:		info->i = CPU->cp2cr[ 21 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR22:		info->i = CPU->cp2cr[ 22 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR23:		info->i = CPU->cp2cr[ 23 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR24:		info->i = CPU->cp2cr[ 24 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR25:		info->i = CPU->cp2cr[ 25 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR26:		info->i = CPU->cp2cr[ 26 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR27:		info->i = CPU->cp2cr[ 27 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR28:		info->i = CPU->cp2cr[ 28 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR29:		info->i = CPU->cp2cr[ 29 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR30:		info->i = CPU->cp2cr[ 30 ].d;		break;
+		case CPUINFO_INT_REGISTER + MIPS_CP2CR31:		info->i = CPU->cp2cr[ 31 ].d;		break;
 
 		/* --- the following bits of info are returned as pointers to data or functions --- */
 		case CPUINFO_PTR_SET_INFO:						info->setinfo = mips_set_info;			break;
@@ -2947,8 +3036,8 @@ void mips_get_info(uint32_t state, union cpuinfo *info)
 		case CPUINFO_PTR_EXECUTE:						info->execute = mips_execute;			break;
 		case CPUINFO_PTR_BURN:							info->burn = NULL;						break;
 		case CPUINFO_PTR_DISASSEMBLE:					info->disassemble = mips_dasm;			break;
-		case CPUINFO_PTR_IRQ_CALLBACK:					info->irqcallback = mipscpu.irq_callback; break;
-		case CPUINFO_PTR_INSTRUCTION_COUNTER:			info->icount = &mips_ICount;			break;
+		case CPUINFO_PTR_IRQ_CALLBACK:					info->irqcallback = CPU->irq_callback; break;
+		case CPUINFO_PTR_INSTRUCTION_COUNTER:			info->icount = &CPU->icount;			break;
 		case CPUINFO_PTR_REGISTER_LAYOUT:				info->p = mips_reg_layout;				break;
 		case CPUINFO_PTR_WINDOW_LAYOUT:					info->p = mips_win_layout;				break;
 	}
@@ -2956,32 +3045,32 @@ void mips_get_info(uint32_t state, union cpuinfo *info)
 
 uint32_t mips_get_cause(void)
 {
-	return mipscpu.cp0r[ CP0_CAUSE ];
+	return CPU->cp0r[ CP0_CAUSE ];
 }
 
 uint32_t mips_get_status(void)
 {
-	return mipscpu.cp0r[ CP0_SR ];
+	return CPU->cp0r[ CP0_SR ];
 }
 
 void mips_set_status(uint32_t status)
 {
-	mipscpu.cp0r[ CP0_SR ] = status;
+	CPU->cp0r[ CP0_SR ] = status;
 }
 
 uint32_t mips_get_ePC(void)
 {
-	return mipscpu.cp0r[ CP0_EPC ];
+	return CPU->cp0r[ CP0_EPC ];
 }
 
 int mips_get_icount(void)
 {
-	return mips_ICount;
+	return CPU->icount;
 }
 
 void mips_set_icount(int count)
 {
-	mips_ICount = count;
+	CPU->icount = count;
 }
 
 
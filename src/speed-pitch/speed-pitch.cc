@@ -18,6 +18,7 @@
  */
 
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -30,6 +31,8 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/preferences.h>
 
+#include "../libdsp/dsp.h"
+
 /* The general idea of the speed change algorithm is to divide the input signal
  * into pieces, spaced at a time interval A, using a cosine-shaped window
  * function.  The pieces are then reassembled by adding them together again,
@@ -37,10 +40,13 @@
  * speed of the audio.  To get better results at the two ends of a song, we add
  * a short period of silence (half the width of the cosine window, to be exact)
  * to each end of the input signal beforehand and afterwards trim the same
- * amount from each end of the output signal. */
-
-#define FREQ    10
-#define OVERLAP  3
+ * amount from each end of the output signal.
+ *
+ * Plain overlap-add sounds "phasey" because the pieces do not line up with one
+ * another.  In the higher quality modes (WSOLA), each piece is taken not
+ * exactly at its nominal position but at the nearby position where it best
+ * matches the audio that followed the previous piece, so that consecutive
+ * pieces add up in phase. */
 
 #define CFGSECT "speed-pitch"
 #define MINSPEED 0.5
@@ -48,157 +54,406 @@
 #define MINPITCH 0.5
 #define MAXPITCH 2.0
 
+/* length of audio compared when searching for the best match */
+#define MATCH_MSEC 10
+
 #define BYTES(frames) ((frames) * curchans * sizeof (float))
 #define OFFSET(buf,frames) ((buf) + (frames) * curchans)
 
+enum {
+    QUALITY_FAST,
+    QUALITY_GOOD,
+    QUALITY_BEST,
+    N_QUALITIES
+};
+
+typedef struct {
+    int freq, overlap;      /* output pieces per second, window width in pieces */
+    int search_msec;        /* WSOLA search range either way (0 = off) */
+    int search_step;        /* coarse search step, refined afterward */
+    int converter;          /* libsamplerate converter for pitch changes */
+} Quality;
+
+static const Quality qualities[N_QUALITIES] = {
+    {10, 3, 0, 1, SRC_LINEAR},
+    {50, 2, 10, 4, SRC_SINC_FASTEST},
+    {40, 2, 15, 2, SRC_SINC_MEDIUM_QUALITY}
+};
+
+/* Ring buffer of audio frames, addressed by absolute position.  The first
+ * "guard" frames are mirrored past the end, so that up to that many frames
+ * can be read from any position without wrapping around. */
 typedef struct {
     float * mem;
-    int size, len;
-} Buffer;
+    int size, guard;        /* in frames; size is a power of two */
+    int64_t start, end;     /* absolute positions of the frames held */
+} Ring;
+
+#define RING_AT(r,pos) OFFSET ((r)->mem, (pos) & ((r)->size - 1))
 
 static int curchans, currate;
 static SRC_STATE * srcstate;
-static int outstep, width;
-static double * cosine;
-static Buffer in, out;
-static int trim, written;
+static int outstep, width, search, search_step, match_len;
+static float * window;
+static Ring in;
+static int64_t in_pos, natural;
+static bool_t have_natural;
+static float * acc;             /* overlap-add accumulator, a ring */
+static int acc_size;
+static int64_t acc_pos, acc_end;
+static float * out;
+static int out_size, out_len;
+static int trim;
 static bool_t ending;
 
-static void bufgrow (Buffer * b, int len)
+/* settings, reloaded when changed in the preferences window */
+static double speed = 1, pitch = 1;
+static int quality;
+static int config_changed;
+
+static void ring_reserve (Ring * r, int frames, int guard)
 {
-    if (len > b->size)
-    {
-        b->mem = (float *) g_realloc (b->mem, BYTES (len));
-        b->size = len;
-    }
+    int need = r->end - r->start + frames;
+    guard = MAX (guard, r->guard);
+
+    if (need <= r->size && guard <= r->guard)
+        return;
 
-    if (len > b->len)
+    int size = MAX (r->size, 1024);
+    while (size < need || size < guard)
+        size *= 2;
+
+    float * mem = (float *) g_malloc (BYTES (size + guard));
+
+    /* copy the frames held to their places in the new ring */
+    for (int64_t pos = r->start; pos < r->end; )
     {
-        memset (OFFSET (b->mem, b->len), 0, BYTES (len - b->len));
-        b->len = len;
+        int len = r->end - pos;
+        len = MIN (len, r->size - (int) (pos & (r->size - 1)));
+        len = MIN (len, size - (int) (pos & (size - 1)));
+
+        memcpy (OFFSET (mem, pos & (size - 1)), RING_AT (r, pos), BYTES (len));
+        pos += len;
     }
+
+    memcpy (OFFSET (mem, size), mem, BYTES (guard));
+
+    g_free (r->mem);
+    r->mem = mem;
+    r->size = size;
+    r->guard = guard;
 }
 
-static void bufcut (Buffer * b, int len)
+/* Updates the mirrored copy after frames have been written to the ring.  The
+ * frames written must not wrap around. */
+static void ring_mirror (Ring * r, int64_t pos, int len)
 {
-    memmove (b->mem, OFFSET (b->mem, len), BYTES (b->len - len));
-    b->len -= len;
+    int offset = pos & (r->size - 1);
+
+    if (offset < r->guard)
+        memcpy (OFFSET (r->mem, r->size + offset), OFFSET (r->mem, offset),
+         BYTES (MIN (len, r->guard - offset)));
 }
 
-static void bufadd (Buffer * b, float * data, int len, double ratio)
+/* Appends frames to the ring, or silence if data is NULL. */
+static void ring_write (Ring * r, const float * data, int len)
+{
+    ring_reserve (r, len, r->guard);
+
+    while (len > 0)
+    {
+        int offset = r->end & (r->size - 1);
+        int part = MIN (len, r->size - offset);
+
+        if (data)
+        {
+            memcpy (OFFSET (r->mem, offset), data, BYTES (part));
+            data = OFFSET (data, part);
+        }
+        else
+            memset (OFFSET (r->mem, offset), 0, BYTES (part));
+
+        ring_mirror (r, r->end, part);
+        r->end += part;
+        len -= part;
+    }
+}
+
+/* Appends frames to the ring, resampled to adjust pitch. */
+static void ring_resample (Ring * r, const float * data, int len, double ratio)
 {
-    int oldlen = b->len;
     int max = len * ratio + 100;
-    bufgrow (b, oldlen + max);
+    ring_reserve (r, max, r->guard);
 
     SRC_DATA d;
 
     d.data_in = data;
     d.input_frames = len;
-    d.data_out = OFFSET (b->mem, oldlen);
-    d.output_frames = max;
     d.src_ratio = ratio;
+    d.end_of_input = 0;
+
+    while (max > 0)
+    {
+        int offset = r->end & (r->size - 1);
+
+        d.data_out = OFFSET (r->mem, offset);
+        d.output_frames = MIN (max, r->size - offset);
+
+        src_process (srcstate, & d);
+
+        ring_mirror (r, r->end, d.output_frames_gen);
+        r->end += d.output_frames_gen;
+        max -= d.output_frames_gen;
+
+        /* continue at the start of the ring only if we ran out of room */
+        if (d.output_frames_gen < d.output_frames)
+            break;
+
+        d.data_in = OFFSET (d.data_in, d.input_frames_used);
+        d.input_frames -= d.input_frames_used;
+    }
+}
+
+/* Overlap-adds one windowed piece of input at the accumulator position. */
+static void acc_add (const float * piece)
+{
+    for (int done = 0; done < width; )
+    {
+        int offset = (acc_pos + done) & (acc_size - 1);
+        int part = MIN (width - done, acc_size - offset);
+
+        dsp_mix_mul (OFFSET (acc, offset), OFFSET (piece, done),
+         OFFSET (window, done), part * curchans);
+
+        done += part;
+    }
+
+    acc_end = acc_pos + width;
+}
+
+/* Moves finished frames from the accumulator to the output buffer, less any
+ * silence still to be trimmed from the beginning. */
+static void acc_take (int len)
+{
+    if (out_len + len > out_size)
+    {
+        out_size = out_len + len;
+        out = (float *) g_realloc (out, BYTES (out_size));
+    }
+
+    while (len > 0)
+    {
+        int offset = acc_pos & (acc_size - 1);
+        int part = MIN (len, acc_size - offset);
+        int skip = MIN (trim, part);
+
+        memcpy (OFFSET (out, out_len), OFFSET (acc, offset + skip), BYTES (part - skip));
+        memset (OFFSET (acc, offset), 0, BYTES (part));
+
+        out_len += part - skip;
+        trim -= skip;
+        acc_pos += part;
+        len -= part;
+    }
+}
+
+static double match_score (const float * ref, const float * piece)
+{
+    int len = match_len * curchans;
+    double energy = dsp_dot (piece, piece, len);
+
+    if (energy < 1e-9)
+        return 0;
 
-    src_process (srcstate, & d);
-    b->len = oldlen + d.output_frames_gen;
+    return dsp_dot (ref, piece, len) / sqrt (energy);
+}
+
+/* Finds the position near pos where the input best continues the audio that
+ * followed the previous piece. */
+static int64_t find_match (int64_t pos)
+{
+    const float * ref = RING_AT (& in, natural);
+    int64_t first = pos - search / search_step * search_step;
+    int64_t last = pos + search;
+    int64_t best = pos;
+    double best_score = -HUGE_VAL;
+
+    /* keep the nominal position on the coarse grid */
+    while (first < in.start)
+        first += search_step;
+
+    for (int64_t p = first; p <= last; p += search_step)
+    {
+        double score = match_score (ref, RING_AT (& in, p));
+
+        if (score > best_score)
+        {
+            best = p;
+            best_score = score;
+        }
+    }
+
+    int64_t center = best;
+    first = MAX (center - search_step + 1, in.start);
+    last = MIN (center + search_step - 1, pos + search);
+
+    for (int64_t p = first; p <= last; p ++)
+    {
+        if (p == center)
+            continue;
+
+        double score = match_score (ref, RING_AT (& in, p));
+
+        if (score > best_score)
+        {
+            best = p;
+            best_score = score;
+        }
+    }
+
+    return best;
+}
+
+static void load_config (void)
+{
+    speed = aud_get_double (CFGSECT, "speed");
+    speed = CLAMP (speed, MINSPEED, MAXSPEED);
+    pitch = aud_get_double (CFGSECT, "pitch");
+    pitch = CLAMP (pitch, MINPITCH, MAXPITCH);
+    quality = aud_get_int (CFGSECT, "quality");
+    quality = CLAMP (quality, 0, N_QUALITIES - 1);
+}
+
+static void config_changed_cb (void)
+{
+    g_atomic_int_set (& config_changed, TRUE);
 }
 
 static void speed_flush (void)
 {
     src_reset (srcstate);
 
-    in.len = 0;
-    out.len = 0;
-
     /* Add silence to the beginning of the input signal. */
-    bufgrow (& in, width / 2);
+    in.start = in.end = 0;
+    ring_write (& in, NULL, width / 2);
 
+    in_pos = 0;
+    have_natural = FALSE;
+
+    memset (acc, 0, BYTES (acc_size));
+    acc_pos = acc_end = 0;
+
+    out_len = 0;
     trim = width / 2;
-    written = 0;
     ending = FALSE;
 }
 
-static void speed_start (int * chans, int * rate)
+static void setup (void)
 {
-    curchans = * chans;
-    currate = * rate;
+    const Quality * q = & qualities[quality];
 
     if (srcstate)
         src_delete (srcstate);
 
-    srcstate = src_new (SRC_LINEAR, curchans, NULL);
+    srcstate = src_new (q->converter, curchans, NULL);
 
     /* Calculate the width of the cosine window and the spacing interval for
      * output. */
-    outstep = currate / FREQ;
-    width = outstep * OVERLAP;
+    outstep = currate / q->freq;
+    width = outstep * q->overlap;
+    search = currate * q->search_msec / 1000;
+    search_step = q->search_step;
+    match_len = MIN (outstep, currate * MATCH_MSEC / 1000);
 
     /* Generate the cosine window, scaled vertically to compensate for the
-     * overlap of the reassembled pieces of audio. */
-    cosine = g_renew (double, cosine, width);
+     * overlap of the reassembled pieces of audio.  It is stored interleaved so
+     * that pieces can be windowed and added in one pass. */
+    window = g_renew (float, window, width * curchans);
     for (int i = 0; i < width; i ++)
-        cosine[i] = (1.0 - cos (2.0 * M_PI * i / width)) / OVERLAP;
+    {
+        float value = (1.0 - cos (2.0 * M_PI * i / width)) / q->overlap;
+        for (int c = 0; c < curchans; c ++)
+            OFFSET (window, i)[c] = value;
+    }
+
+    for (acc_size = 1024; acc_size < width; acc_size *= 2)
+        ;
+
+    g_free (acc);
+    acc = (float *) g_malloc (BYTES (acc_size));
+
+    g_free (in.mem);
+    memset (& in, 0, sizeof in);
+    ring_reserve (& in, width + 2 * search, width);
 
     speed_flush ();
 }
 
+static void speed_start (int * chans, int * rate)
+{
+    curchans = * chans;
+    currate = * rate;
+
+    g_atomic_int_set (& config_changed, FALSE);
+    load_config ();
+    setup ();
+}
+
 static void speed_process (float * * data, int * samples)
 {
-    double pitch = aud_get_double (CFGSECT, "pitch");
-    double speed = aud_get_double (CFGSECT, "speed");
+    if (g_atomic_int_compare_and_exchange (& config_changed, TRUE, FALSE))
+    {
+        int old_quality = quality;
 
-    /* Remove audio that has already been played from the output buffer. */
-    bufcut (& out, written);
+        load_config ();
+
+        if (quality != old_quality)
+            setup ();
+    }
+
+    /* Audio returned on the last call has been played. */
+    out_len = 0;
 
     /* Copy the passed audio to the input buffer, scaled to adjust pitch. */
-    bufadd (& in, * data, * samples / curchans, 1.0 / pitch);
+    if (pitch == 1)
+        ring_write (& in, * data, * samples / curchans);
+    else
+        ring_resample (& in, * data, * samples / curchans, 1.0 / pitch);
 
     /* If we are ending, add silence to the end of the input signal. */
     if (ending)
-        bufgrow (& in, in.len + width / 2);
+        ring_write (& in, NULL, width / 2 + search);
 
     /* Calculate the spacing interval for input. */
     int instep = round (outstep * speed / pitch);
 
     /* Run the speed change algorithm. */
-    int src = 0;
-    int dst = 0;
-
-    while (src + MAX (width, instep) <= in.len)
+    while (in_pos + search + MAX (width, instep) <= in.end)
     {
-        bufgrow (& out, dst + width);
-        out.len = dst + width;
+        int64_t pos = (search && have_natural) ? find_match (in_pos) : in_pos;
 
-        for (int i = 0; i < width; i ++)
-        for (int c = 0; c < curchans; c ++)
-            OFFSET (out.mem, dst + i)[c] += OFFSET (in.mem, src + i)[c] * cosine[i];
+        acc_add (RING_AT (& in, pos));
+        acc_take (outstep);
 
-        src += instep;
-        dst += outstep;
+        natural = pos + outstep;
+        have_natural = TRUE;
+        in_pos += instep;
     }
 
-    /* Remove processed audio from the input buffer. */
-    bufcut (& in, src);
+    /* Forget input that will not be looked at again. */
+    int64_t keep = in_pos - search;
+    if (have_natural)
+        keep = MIN (keep, natural);
 
-    /* Trim silence from the beginning of the output buffer. */
-    if (trim > 0)
-    {
-        int cut = MIN (trim, dst);
-        bufcut (& out, cut);
-        dst -= cut;
-        trim -= cut;
-    }
+    in.start = CLAMP (keep, in.start, in.end);
 
-    /* If we are ending, return all of the output buffer except the silence that
+    /* If we are ending, return the rest of the output except the silence that
      * we trim from the end of it. */
-    if (ending)
-        dst = out.len - width / 2;
+    if (ending && acc_end - width / 2 > acc_pos)
+        acc_take (acc_end - width / 2 - acc_pos);
 
-    /* Return processed audio in the output buffer and mark it to be removed on
-     * the next call. */
-    * data = out.mem;
-    * samples = dst * curchans;
-    written = dst;
+    * data = out;
+    * samples = out_len * curchans;
 }
 
 static void speed_finish (float * * data, int * samples)
@@ -215,23 +470,31 @@ static void speed_finish (float * * data, int * samples)
 static int speed_adjust_delay (int delay)
 {
     /* Not sample-accurate, but should be a decent estimate. */
-    double speed = aud_get_double (CFGSECT, "speed");
     return delay * speed + width * 1000 / currate;
 }
 
 static const char * const speed_defaults[] = {
  "speed", "1",
  "pitch", "1",
+ "quality", "0",
  NULL};
 
+static const ComboBoxElements quality_list[] = {
+ {"0", N_("Fast (overlap-add)")},
+ {"1", N_("Good (WSOLA)")},
+ {"2", N_("Best (WSOLA, wider search)")}};
+
 static const PreferencesWidget speed_widgets[] = {
     WidgetLabel (N_("<b>Speed and Pitch</b>")),
     WidgetSpin (N_("Speed:"),
-        {VALUE_FLOAT, 0, CFGSECT, "speed"},
+        {VALUE_FLOAT, 0, CFGSECT, "speed", config_changed_cb},
         {MINSPEED, MAXSPEED, 0.05}),
     WidgetSpin (N_("Pitch:"),
-        {VALUE_FLOAT, 0, CFGSECT, "pitch"},
-        {MINPITCH, MAXPITCH, 0.05})
+        {VALUE_FLOAT, 0, CFGSECT, "pitch", config_changed_cb},
+        {MINPITCH, MAXPITCH, 0.05}),
+    WidgetCombo (N_("Quality:"),
+        {VALUE_STRING, 0, CFGSECT, "quality", config_changed_cb},
+        {quality_list, ARRAY_LEN (quality_list)})
 };
 
 static const PluginPreferences speed_prefs = {
@@ -242,6 +505,7 @@ static const PluginPreferences speed_prefs = {
 static bool_t speed_init (void)
 {
     aud_config_set_defaults (CFGSECT, speed_defaults);
+    dsp_init ();
     return TRUE;
 }
 
@@ -252,16 +516,19 @@ static void speed_cleanup (void)
 
     srcstate = NULL;
 
-    g_free (cosine);
-    cosine = NULL;
+    g_free (window);
+    window = NULL;
 
     g_free (in.mem);
-    in.mem = NULL;
-    in.size = 0;
+    memset (& in, 0, sizeof in);
+
+    g_free (acc);
+    acc = NULL;
+    acc_size = 0;
 
-    g_free (out.mem);
-    out.mem = NULL;
-    out.size = 0;
+    g_free (out);
+    out = NULL;
+    out_size = 0;
 }
 
 #define AUD_PLUGIN_NAME        N_("Speed and Pitch")
@@ -7,6 +7,8 @@
 #include <libaudcore/plugin.h>
 #include <libaudcore/preferences.h>
 
+#include "../libdsp/dsp.h"
+
 static bool_t init (void);
 
 static void stereo_start (int * channels, int * rate);
@@ -48,6 +50,7 @@ static const PluginPreferences stereo_prefs = {
 static bool_t init (void)
 {
     aud_config_set_defaults ("extra_stereo", stereo_defaults);
+    dsp_init ();
     return TRUE;
 }
 
@@ -61,20 +64,12 @@ static void stereo_start (int * channels, int * rate)
 static void stereo_process (float * * data, int * samples)
 {
     float value = aud_get_double ("extra_stereo", "intensity");
-    float * f, * end;
-    float center;
 
     if (stereo_channels != 2 || samples == 0)
         return;
 
-    end = (* data) + (* samples);
-
-    for (f = * data; f < end; f += 2)
-    {
-        center = (f[0] + f[1]) / 2;
-        f[0] = center + (f[0] - center) * value;
-        f[1] = center + (f[1] - center) * value;
-    }
+    /* keep the center, scale the difference from it by value */
+    dsp_mid_side (* data, (* samples) / 2, 1, value);
 }
 
 static void stereo_finish (float * * data, int * samples)
@@ -21,8 +21,16 @@
 #include <libaudcore/i18n.h>
 #include <libaudcore/plugin.h>
 
+#include "../libdsp/dsp.h"
+
 static int voice_channels;
 
+static bool_t voice_init(void)
+{
+	dsp_init();
+	return TRUE;
+}
+
 static void voice_start(int *channels, int *rate)
 {
 	voice_channels = *channels;
@@ -30,17 +38,11 @@ static void voice_start(int *channels, int *rate)
 
 static void voice_process(float **d, int *samples)
 {
-	float *f = *d, *end;
-	end = *d + *samples;
-
 	if (voice_channels != 2)
 		return;
 
-	for (f = *d; f < end; f += 2)
-	{
-		f[0] -= f[1];
-		f[1] = f[0];
-	}
+	/* both channels become L - R */
+	dsp_stereo_matrix(*d, *samples / 2, 1, -1, 1, -1);
 }
 
 static void voice_finish(float **d, int *samples)
@@ -49,6 +51,7 @@ static void voice_finish(float **d, int *samples)
 }
 
 #define AUD_PLUGIN_NAME        N_("Voice Removal")
+#define AUD_PLUGIN_INIT        voice_init
 #define AUD_EFFECT_START       voice_start
 #define AUD_EFFECT_PROCESS     voice_process
 #define AUD_EFFECT_FINISH      voice_finish
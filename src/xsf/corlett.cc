@@ -107,12 +107,13 @@ int corlett_decode(uint8_t *input, uint32_t input_len, uint8_t **output, uint64_
 	comp_length = LE32(buf[2]);
 	comp_crc = LE32(buf[3]);
 
-	if (comp_length > 0)
-	{
-		// Check length
-		if (input_len < comp_length + 16)
-			return AO_FAIL;
+	// Check length
+	if (comp_length > 0 && input_len < comp_length + 16)
+		return AO_FAIL;
 
+	// only decompress if the caller wants the data (not just the tags)
+	if (comp_length > 0 && output != NULL && size != NULL)
+	{
 		// Check CRC is correct
 		actual_crc = crc32(0, (unsigned char *)&buf[4+(res_area/4)], comp_length);
 		if (actual_crc != comp_crc)
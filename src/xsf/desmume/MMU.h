@@ -29,6 +29,7 @@
 
 #include "ARM9.h"
 #include "mc.h"
+#include "mem.h"
 
 extern char szRomPath[512];
 extern char szRomBaseName[512];
@@ -146,9 +147,9 @@ u32 FASTCALL MMU_read32(u32 proc, u32 adr);
 	u16 FASTCALL MMU_read16_acl(u32 proc, u32 adr, u32 access);
 	u32 FASTCALL MMU_read32_acl(u32 proc, u32 adr, u32 access);
 #else
-	#define MMU_read8_acl(proc,adr,access)  MMU_read8(proc,adr)
-	#define MMU_read16_acl(proc,adr,access)  MMU_read16(proc,adr)
-	#define MMU_read32_acl(proc,adr,access)  MMU_read32(proc,adr)
+	#define MMU_read8_acl(proc,adr,access)  MMU_fast_read8(proc,adr)
+	#define MMU_read16_acl(proc,adr,access)  MMU_fast_read16(proc,adr)
+	#define MMU_read32_acl(proc,adr,access)  MMU_fast_read32(proc,adr)
 #endif
 
 /**
@@ -170,6 +171,70 @@ void FASTCALL MMU_write32(u32 proc, u32 adr, u32 val);
 
 void FASTCALL MMU_doDMA(u32 proc, u32 num);
 
+/**
+ * Fast path for plain memory
+ *
+ * Every region but the I/O registers (0x4) and the cartridge (0x8, 0x9) is
+ * accessed straight through the memory map, apart from the ARM9's DTCM.
+ * The interpreters go through these to skip the call and the register
+ * decoding of the functions above for such addresses.
+ */
+#define MMU_PLAIN_REGIONS 0xFCEF
+
+static INLINE BOOL MMU_isPlain(u32 proc, u32 adr)
+{
+	return ((MMU_PLAIN_REGIONS >> ((adr >> 24) & 0xF)) & 1) &&
+	 (proc != 0 /* ARMCPU_ARM9 */ || (adr & ~0x3FFF) != MMU.DTCMRegion);
+}
+
+#define MMU_PLAIN_MEM(proc, adr) MMU.MMU_MEM[proc][((adr) >> 20) & 0xFF]
+#define MMU_PLAIN_ADR(proc, adr) ((adr) & MMU.MMU_MASK[proc][((adr) >> 20) & 0xFF])
+
+static INLINE u8 MMU_fast_read8(u32 proc, u32 adr)
+{
+	if (MMU_isPlain(proc, adr))
+		return MMU_PLAIN_MEM(proc, adr)[MMU_PLAIN_ADR(proc, adr)];
+	return MMU_read8(proc, adr);
+}
+
+static INLINE u16 MMU_fast_read16(u32 proc, u32 adr)
+{
+	if (MMU_isPlain(proc, adr))
+		return T1ReadWord(MMU_PLAIN_MEM(proc, adr), MMU_PLAIN_ADR(proc, adr));
+	return MMU_read16(proc, adr);
+}
+
+static INLINE u32 MMU_fast_read32(u32 proc, u32 adr)
+{
+	if (MMU_isPlain(proc, adr))
+		return T1ReadLong(MMU_PLAIN_MEM(proc, adr), MMU_PLAIN_ADR(proc, adr));
+	return MMU_read32(proc, adr);
+}
+
+static INLINE void MMU_fast_write8(u32 proc, u32 adr, u8 val)
+{
+	if (MMU_isPlain(proc, adr))
+		MMU_PLAIN_MEM(proc, adr)[MMU_PLAIN_ADR(proc, adr)] = val;
+	else
+		MMU_write8(proc, adr, val);
+}
+
+static INLINE void MMU_fast_write16(u32 proc, u32 adr, u16 val)
+{
+	if (MMU_isPlain(proc, adr))
+		T1WriteWord(MMU_PLAIN_MEM(proc, adr), MMU_PLAIN_ADR(proc, adr), val);
+	else
+		MMU_write16(proc, adr, val);
+}
+
+static INLINE void MMU_fast_write32(u32 proc, u32 adr, u32 val)
+{
+	if (MMU_isPlain(proc, adr))
+		T1WriteLong(MMU_PLAIN_MEM(proc, adr), MMU_PLAIN_ADR(proc, adr), val);
+	else
+		MMU_write32(proc, adr, val);
+}
+
 
 /*
  * The base ARM memory interfaces
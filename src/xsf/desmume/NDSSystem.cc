@@ -24,6 +24,7 @@
 
 #include "NDSSystem.h"
 #include "MMU.h"
+#include "cp15.h"
 //#include "cflash.h"
 
 //#include "ROMReader.h"
@@ -193,6 +194,43 @@ void NDS_DeInit(void) {
      MMU_DeInit();
 }
 
+/* hardware registers kept outside of MMU (MMU.cc) */
+extern u16 SPI_CNT, SPI_CMD, AUX_SPI_CNT, AUX_SPI_CMD, partie;
+extern u32 DMASrc[2][4], DMADst[2][4];
+
+int NDS_GetStateRegions(NDS_StateRegion *regions)
+{
+     int n = 0;
+
+#define ADD_REGION(p, s) do { regions[n].data = (p); regions[n].size = (s); n++; } while (0)
+
+     ADD_REGION(&ARM9Mem, sizeof(ARM9Mem));
+     ADD_REGION(&MMU, sizeof(MMU));
+     ADD_REGION(&nds, sizeof(nds));
+     ADD_REGION(&NDS_ARM7, sizeof(NDS_ARM7));
+     ADD_REGION(&NDS_ARM9, sizeof(NDS_ARM9));
+     ADD_REGION(NDS_ARM9.coproc[15], sizeof(armcp15_t));
+     ADD_REGION(DMASrc, sizeof(DMASrc));
+     ADD_REGION(DMADst, sizeof(DMADst));
+     ADD_REGION(&SPI_CNT, sizeof(SPI_CNT));
+     ADD_REGION(&SPI_CMD, sizeof(SPI_CMD));
+     ADD_REGION(&AUX_SPI_CNT, sizeof(AUX_SPI_CNT));
+     ADD_REGION(&AUX_SPI_CMD, sizeof(AUX_SPI_CMD));
+     ADD_REGION(&partie, sizeof(partie));
+
+     if (MMU.fw.data)
+          ADD_REGION(MMU.fw.data, MMU.fw.size);
+     if (MMU.bupmem.data)
+          ADD_REGION(MMU.bupmem.data, MMU.bupmem.size);
+
+     regions[n].data = SPU_GetState(&regions[n].size);
+     n++;
+
+#undef ADD_REGION
+
+     return n;
+}
+
 BOOL NDS_SetROM(u8 * rom, u32 mask)
 {
      MMU_setRom(rom, mask);
@@ -171,6 +171,18 @@ int NDS_Init ( void);
 #endif
 
 void NDS_DeInit(void);
+
+/* Memory holding the state of the emulated system, for snapshots.  The
+ * regions stay the same from NDS_Init() to NDS_DeInit(). */
+typedef struct
+{
+       void *data;
+       u32 size;
+} NDS_StateRegion;
+
+#define NDS_MAX_STATE_REGIONS 16
+
+int NDS_GetStateRegions(NDS_StateRegion *regions);
 void
 NDS_FillDefaultFirmwareConfigData( struct NDS_fw_config_data *fw_config);
 
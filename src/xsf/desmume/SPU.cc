@@ -146,6 +146,13 @@ void SPU_SetVolume(int volume)
 	if (SNDCore)
 		SNDCore->SetVolume(volume);
 }
+/* the mixing buffers only hold data during SPU_EmulateSamples() */
+void *SPU_GetState(u32 *size)
+{
+	*size = sizeof(spu.ch);
+	return spu.ch;
+}
+
 void SPU_DeInit(void)
 {
 	spu.buflen = 0;
@@ -46,6 +46,7 @@ void SPU_Pause(int pause);
 void SPU_SetVolume(int volume);
 void SPU_Reset(void);
 void SPU_DeInit(void);
+void *SPU_GetState(u32 *size);
 void SPU_KeyOn(int channel);
 void SPU_WriteByte(u32 addr, u8 val);
 void SPU_WriteWord(u32 addr, u16 val);
@@ -35,23 +35,20 @@
 
 #include "ao.h"
 #include "corlett.h"
+#include "../libemu/snappool.h"
 #include "vio2sf.h"
 
+/* memory given to the snapshots of one song, and their initial interval */
+#define SNAPSHOT_LIMIT (64 * 1024 * 1024)
+#define SNAPSHOT_INTERVAL 10000
+
 /* xsf_get_lib: called to load secondary files */
 static String dirpath;
 
-int xsf_get_lib(char *filename, void **buffer, unsigned int *length)
+const LibImage *xsf_get_lib(char *filename, LibDecodeFunc decode, LibFreeFunc free_decoded)
 {
-	void *filebuf;
-	int64_t size;
-
 	StringBuf path = filename_build ({dirpath, filename});
-	vfs_file_get_contents(path, &filebuf, &size);
-
-	*buffer = filebuf;
-	*length = (uint64_t)size;
-
-	return AO_SUCCESS;
+	return libcache_get(path, decode, free_decoded);
 }
 
 Tuple xsf_tuple(const char *filename, VFSFile *fd)
@@ -110,6 +107,11 @@ static int xsf_get_length(const char *filename)
 	return length;
 }
 
+static void free_snapshot(void *snap)
+{
+	xsf_snapshot_free((xsf_snapshot *) snap);
+}
+
 static bool_t xsf_play(const char * filename, VFSFile * file)
 {
 	void *buffer;
@@ -118,6 +120,8 @@ static bool_t xsf_play(const char * filename, VFSFile * file)
 	int16_t samples[44100*2];
 	int seglen = 44100 / 60;
 	float pos;
+	SnapPool *snapshots;
+	xsf_snapshot *snap;
 	bool_t error = FALSE;
 
 	const char * slash = strrchr (filename, '/');
@@ -142,51 +146,56 @@ static bool_t xsf_play(const char * filename, VFSFile * file)
 
 	aud_input_set_bitrate(44100*2*2*8);
 
+	snapshots = snappool_new(SNAPSHOT_INTERVAL, SNAPSHOT_LIMIT, free_snapshot);
+
+	/* the state at the start, so that there is always a snapshot to go back
+	 * to; restarting the emulator would invalidate the others */
+	snap = xsf_snapshot_take();
+	snappool_add(snapshots, 0, snap, xsf_snapshot_size(snap));
+
 	while (! aud_input_check_stop ())
 	{
 		int seek_value = aud_input_check_seek ();
 
 		if (seek_value >= 0)
 		{
-			if (seek_value > aud_input_written_time ())
-			{
-				pos = aud_input_written_time ();
+			int now = aud_input_written_time ();
+			int snap_time;
+			snap = (xsf_snapshot *) snappool_find (snapshots, seek_value, &snap_time);
 
-				while (pos < seek_value)
-				{
-					xsf_gen(samples, seglen);
-					pos += 16.666;
-				}
+			/* go back, or skip ahead, to the last snapshot before the target */
+			if (seek_value < now || snap_time > now)
+			{
+				xsf_snapshot_restore(snap);
+				pos = snap_time;
 			}
-			else if (seek_value < aud_input_written_time ())
+			else
+				pos = now;
+
+			while (pos < seek_value)
 			{
-				xsf_term();
-
-				if (xsf_start(buffer, size) == AO_SUCCESS)
-				{
-					pos = 0;
-					while (pos < seek_value)
-					{
-						xsf_gen(samples, seglen);
-						pos += 16.666; /* each segment is 16.666ms */
-					}
-				}
-			   	else
-				{
-					error = TRUE;
-					goto CLEANUP;
-				}
+				xsf_gen(samples, seglen);
+				pos += 16.666; /* each segment is 16.666ms */
 			}
 		}
 
 		xsf_gen(samples, seglen);
 		aud_input_write_audio((uint8_t *)samples, seglen * 4);
 
-		if (aud_input_written_time() >= length)
+		int time = aud_input_written_time();
+
+		if (time >= length)
 			goto CLEANUP;
+
+		if (snappool_due(snapshots, time))
+		{
+			snap = xsf_snapshot_take();
+			snappool_add(snapshots, time, snap, xsf_snapshot_size(snap));
+		}
 	}
 
 CLEANUP:
+	snappool_free(snapshots);
 	xsf_term();
 
 ERR_NO_CLOSE:
@@ -211,6 +220,7 @@ int xsf_is_our_fd(const char *filename, VFSFile *file)
 static const char *xsf_fmts[] = { "2sf", "mini2sf", NULL };
 
 #define AUD_PLUGIN_NAME        N_("2SF Decoder")
+#define AUD_PLUGIN_CLEANUP     libcache_cleanup
 #define AUD_INPUT_PLAY         xsf_play
 #define AUD_INPUT_READ_TUPLE   xsf_tuple
 #define AUD_INPUT_IS_OUR_FILE  xsf_is_our_fd
@@ -106,9 +106,8 @@ static int load_map(int issave, unsigned char *udata, unsigned usize)
 	return XSF_TRUE;
 }
 
-static int load_mapz(int issave, unsigned char *zdata, unsigned zsize, unsigned zcrc)
+static int inflate_map(unsigned char *zdata, unsigned zsize, unsigned zcrc, unsigned char **pdata, unsigned *psize)
 {
-	int ret;
 	int zerr;
 	uLongf usize = 8;
 	uLongf rsize = usize;
@@ -159,15 +158,79 @@ static int load_mapz(int issave, unsigned char *zdata, unsigned zsize, unsigned
 	{
 		unsigned ccrc = crc32(crc32(0L, Z_NULL, 0), rdata, usize);
 		if (ccrc != zcrc)
+		{
+			free(rdata);
 			return XSF_FALSE;
+		}
 	}
 
-	ret = load_map(issave, rdata, usize);
-	free(rdata);
-	return ret;
+	*pdata = rdata;
+	*psize = usize;
+	return XSF_TRUE;
 }
 
-static int load_psf_one(unsigned char *pfile, unsigned bytes)
+/* The inflated sections of one 2SF file, in the order they are loaded.  A
+ * library is kept in this form by the library cache, so that playing the
+ * next track of a set only copies its maps into place. */
+typedef struct
+{
+	int issave;
+	unsigned char *data;
+	unsigned size;
+} xsf_map_t;
+
+typedef struct
+{
+	xsf_map_t *maps;
+	int count;
+} xsf_maps_t;
+
+static void free_maps(xsf_maps_t *list)
+{
+	int i;
+	for (i = 0; i < list->count; i++)
+		free(list->maps[i].data);
+	free(list->maps);
+	list->maps = 0;
+	list->count = 0;
+}
+
+static int add_map(xsf_maps_t *list, int issave, unsigned char *zdata, unsigned zsize, unsigned zcrc)
+{
+	xsf_map_t *maps;
+	unsigned char *data;
+	unsigned size;
+
+	if (!inflate_map(zdata, zsize, zcrc, &data, &size))
+		return XSF_FALSE;
+
+	maps = (xsf_map_t *) realloc(list->maps, (list->count + 1) * sizeof(xsf_map_t));
+	if (!maps)
+	{
+		free(data);
+		return XSF_FALSE;
+	}
+
+	maps[list->count].issave = issave;
+	maps[list->count].data = data;
+	maps[list->count].size = size;
+	list->maps = maps;
+	list->count++;
+	return XSF_TRUE;
+}
+
+static int apply_maps(const xsf_maps_t *list)
+{
+	int i;
+	for (i = 0; i < list->count; i++)
+	{
+		if (!load_map(list->maps[i].issave, list->maps[i].data, list->maps[i].size))
+			return XSF_FALSE;
+	}
+	return XSF_TRUE;
+}
+
+static int decode_psf(unsigned char *pfile, unsigned bytes, xsf_maps_t *list)
 {
 	unsigned char *ptr = pfile;
 	unsigned code_size;
@@ -194,7 +257,7 @@ static int load_psf_one(unsigned char *pfile, unsigned bytes)
 			{
 				if (resv_pos + 12 + save_size > resv_size)
 					return XSF_FALSE;
-				if (!load_mapz(1, ptr + resv_pos + 12, save_size, save_crc))
+				if (!add_map(list, 1, ptr + resv_pos + 12, save_size, save_crc))
 					return XSF_FALSE;
 			}
 			resv_pos += 12 + save_size;
@@ -206,13 +269,52 @@ static int load_psf_one(unsigned char *pfile, unsigned bytes)
 		ptr = pfile + 16 + resv_size;
 		if (16 + resv_size + code_size > bytes)
 			return XSF_FALSE;
-		if (!load_mapz(0, ptr, code_size, code_crc))
+		if (!add_map(list, 0, ptr, code_size, code_crc))
 			return XSF_FALSE;
 	}
 
 	return XSF_TRUE;
 }
 
+static int load_psf_one(unsigned char *pfile, unsigned bytes)
+{
+	xsf_maps_t list = {0, 0};
+	int ret = decode_psf(pfile, bytes, &list) && apply_maps(&list);
+	free_maps(&list);
+	return ret;
+}
+
+static bool_t decode_lib(LibImage *image)
+{
+	xsf_maps_t *list = (xsf_maps_t *) calloc(1, sizeof(xsf_maps_t));
+	int64_t len = 0;
+	int i;
+
+	if (!list)
+		return FALSE;
+
+	if (!decode_psf((unsigned char *) image->raw, image->raw_len, list))
+	{
+		free_maps(list);
+		free(list);
+		return FALSE;
+	}
+
+	for (i = 0; i < list->count; i++)
+		len += list->maps[i].size;
+
+	image->decoded = list;
+	image->decoded_len = len;
+	return TRUE;
+}
+
+static void free_lib(LibImage *image)
+{
+	xsf_maps_t *list = (xsf_maps_t *) image->decoded;
+	free_maps(list);
+	free(list);
+}
+
 typedef struct
 {
 	const char *tag;
@@ -237,23 +339,21 @@ static int load_psfcb(void *pWork, const char *pNameTop, const char *pNameEnd, c
 		}
 		else
 		{
-			void *libbuf;
-			unsigned libsize;
+			const LibImage *image;
 			memcpy(lib, pValueTop, l);
 			lib[l] = '\0';
-			if (!xsf_get_lib(lib, &libbuf, &libsize))
+			if (!(image = xsf_get_lib(lib, decode_lib, free_lib)))
 			{
 				ret = xsf_tagenum_callback_returnvaluebreak;
 			}
 			else
 			{
-				if (!load_libs(pwork->level + 1, libbuf, libsize) || !load_psf_one((unsigned char *) libbuf, libsize))
+				if (!load_libs(pwork->level + 1, image->raw, image->raw_len) ||
+				 !apply_maps((const xsf_maps_t *) image->decoded))
 					ret = xsf_tagenum_callback_returnvaluebreak;
 				else
-				{
 					pwork->found++;
-					free(libbuf);
-				}
+				libcache_release(image);
 			}
 			free(lib);
 		}
@@ -833,6 +933,131 @@ int xsf_gen(void *pbuffer, unsigned samples)
 	return ptr - (unsigned char *)pbuffer;
 }
 
+/* Most of the ARM9 memory map is left unused by sound drivers, so the state
+ * is saved in pages, leaving out those that are all zero. */
+#define SNAP_PAGE 4096
+#define SNAP_REGIONS (NDS_MAX_STATE_REGIONS + 3)
+
+struct xsf_snapshot
+{
+	size_t size;
+	unsigned pages;
+	/* followed by one byte per page, set if the page is stored, and then
+	 * the stored pages */
+};
+
+static int get_regions(NDS_StateRegion *regions)
+{
+	int n = NDS_GetStateRegions(regions);
+
+	regions[n].data = &sndifwork;
+	regions[n++].size = sizeof(sndifwork);
+	regions[n].data = sndifwork.pcmbuftop;
+	regions[n++].size = sndifwork.bufferbytes;
+	regions[n].data = (void *) &execute;
+	regions[n++].size = sizeof(execute);
+
+	return n;
+}
+
+static int page_is_zero(const unsigned char *page, unsigned len)
+{
+	return !page[0] && !memcmp(page, page + 1, len - 1);
+}
+
+xsf_snapshot *xsf_snapshot_take(void)
+{
+	NDS_StateRegion regions[SNAP_REGIONS];
+	int n = get_regions(regions);
+	unsigned pages = 0, i;
+	int r;
+
+	for (r = 0; r < n; r++)
+		pages += (regions[r].size + SNAP_PAGE - 1) / SNAP_PAGE;
+
+	unsigned char *stored = g_new(unsigned char, pages);
+	size_t size = sizeof(xsf_snapshot) + pages;
+
+	for (r = 0, i = 0; r < n; r++)
+	{
+		const unsigned char *data = (const unsigned char *) regions[r].data;
+		u32 off;
+
+		for (off = 0; off < regions[r].size; off += SNAP_PAGE, i++)
+		{
+			unsigned len = MIN(SNAP_PAGE, regions[r].size - off);
+			stored[i] = !page_is_zero(data + off, len);
+			if (stored[i])
+				size += len;
+		}
+	}
+
+	xsf_snapshot *snap = (xsf_snapshot *) g_malloc(size);
+	unsigned char *pos = (unsigned char *) (snap + 1);
+
+	snap->size = size;
+	snap->pages = pages;
+	memcpy(pos, stored, pages);
+	pos += pages;
+
+	for (r = 0, i = 0; r < n; r++)
+	{
+		const unsigned char *data = (const unsigned char *) regions[r].data;
+		u32 off;
+
+		for (off = 0; off < regions[r].size; off += SNAP_PAGE, i++)
+		{
+			unsigned len = MIN(SNAP_PAGE, regions[r].size - off);
+			if (stored[i])
+			{
+				memcpy(pos, data + off, len);
+				pos += len;
+			}
+		}
+	}
+
+	g_free(stored);
+	return snap;
+}
+
+void xsf_snapshot_restore(const xsf_snapshot *snap)
+{
+	NDS_StateRegion regions[SNAP_REGIONS];
+	int n = get_regions(regions);
+	const unsigned char *stored = (const unsigned char *) (snap + 1);
+	const unsigned char *pos = stored + snap->pages;
+	unsigned i;
+	int r;
+
+	for (r = 0, i = 0; r < n; r++)
+	{
+		unsigned char *data = (unsigned char *) regions[r].data;
+		u32 off;
+
+		for (off = 0; off < regions[r].size; off += SNAP_PAGE, i++)
+		{
+			unsigned len = MIN(SNAP_PAGE, regions[r].size - off);
+			if (stored[i])
+			{
+				memcpy(data + off, pos, len);
+				pos += len;
+			}
+			else
+				memset(data + off, 0, len);
+		}
+	}
+}
+
+size_t xsf_snapshot_size(const xsf_snapshot *snap)
+{
+	return snap->size;
+}
+
+void xsf_snapshot_free(xsf_snapshot *snap)
+{
+	g_free(snap);
+}
+
 void xsf_term(void)
 {
 	MMU_unsetRom();
@@ -1,7 +1,18 @@
+#include "../libemu/libcache.h"
+
 #define XSF_FALSE (0)
 #define XSF_TRUE (!XSF_FALSE)
 
 int xsf_start(void *pfile, unsigned bytes);
 int xsf_gen(void *pbuffer, unsigned samples);
-int xsf_get_lib(char *pfilename, void **ppbuffer, unsigned int *plength);
+/* returns the library file decoded by <decode>; see libcache.h */
+const LibImage *xsf_get_lib(char *pfilename, LibDecodeFunc decode, LibFreeFunc free_decoded);
 void xsf_term(void);
+
+/* Copy of the whole emulator state, valid until xsf_term() */
+typedef struct xsf_snapshot xsf_snapshot;
+
+xsf_snapshot *xsf_snapshot_take(void);
+void xsf_snapshot_restore(const xsf_snapshot *snap);
+size_t xsf_snapshot_size(const xsf_snapshot *snap);
+void xsf_snapshot_free(xsf_snapshot *snap);